@@ -124,6 +124,11 @@ Airport::Airport( int c, char* def)
         
         sprintf(ig_ds, "%s_runways", icao.c_str() ); 
         rm_ig = new tgIntersectionGenerator(ig_ds, 0, 0, LinearFeature::GetTextureInfo );
+
+        for ( unsigned int i=SINGLE_LINE; i<=CHECKERBOARD_WHITE; i++ ) {
+            lf_ig[i]->SetNumThreads( line_threads );
+        }
+        rm_ig->SetNumThreads( line_threads );
     }
 
     TG_LOG( SG_GENERAL, SG_DEBUG, "Read airport with icao " << icao << ", control tower " << ct << ", and description " << description );
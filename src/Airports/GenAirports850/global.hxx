@@ -34,4 +34,8 @@ extern double gSnap;
 extern double slope_max;
 extern double slope_eps;
 
+// Worker threads for each airport's linear feature intersections - the
+// airports themselves already run on --threads
+extern int line_threads;
+
 #endif
@@ -25,6 +25,8 @@
 
 #include <Include/version.h>
 
+#include <terragear/tg_array_cache.hxx>
+
 #include "scheduler.hxx"
 #include "beznode.hxx"
 #include "closedpoly.hxx"
@@ -39,8 +41,8 @@ static void usage( int argc, char **argv ) {
     TG_LOG(SG_GENERAL, SG_ALERT, "Usage: " << argv[0] << "\n--input=<apt_file>"
     << "\n--work=<work_dir>\n[ --start-id=abcd ] [ --restart-id=abcd ] [ --nudge=n ] "
     << "[--min-lon=<deg>] [--max-lon=<deg>] [--min-lat=<deg>] [--max-lat=<deg>] "
-    << "[ --airport=abcd ] [--max-slope=<decimal>] [--tile=<tile>] [--threads] [--threads=x]"
-    << "[--chunk=<chunk>] [--dem-path=<path>] [--verbose] [--help]");
+    << "[ --airport=abcd ] [--max-slope=<decimal>] [--tile=<tile>] [--threads] [--threads=x] [--line-threads=x]"
+    << "[--chunk=<chunk>] [--dem-path=<path>] [--dem-cache=<MB>] [--verbose] [--help]");
 }
 
 // Display help and usage
@@ -88,6 +90,7 @@ int nudge = 10;
 double gSnap = 0.00000001;      // approx 1 mm
 double slope_max = 0.02;
 double slope_eps = 0.00001;
+int line_threads = 1;
 
 int main(int argc, char **argv)
 {
@@ -182,10 +185,18 @@ int main(int argc, char **argv)
         {
             slope_max = atof( arg.substr(12).c_str() );
         }
+        else if ( (arg.find("--line-threads=") == 0) )
+        {
+            line_threads = atoi( arg.substr(15).c_str() );
+        }
         else if ( (arg.find("--threads=") == 0) )
         {
             num_threads = atoi( arg.substr(10).c_str() );
         }
+        else if ( (arg.find("--dem-cache=") == 0) )
+        {
+            tgArrayCache::instance().setBudget( (size_t)atol( arg.substr(12).c_str() ) * 1024 * 1024 );
+        }
         else if ( (arg.find("--threads") == 0) )
         {
             num_threads = boost::thread::hardware_concurrency();
@@ -325,6 +336,8 @@ int main(int argc, char **argv)
         }
     }
 
+    tgArrayCache::instance().report();
+
     TG_LOG(SG_GENERAL, SG_INFO, "Genapts finished successfully");
 
     return 0;
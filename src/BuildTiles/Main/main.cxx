@@ -22,19 +22,17 @@
 #  include <config.h>
 #endif
 
-#ifdef _MSC_VER
-#  include <windows.h>
-#  define tgSleep(x) Sleep(x*1000)
-#else
-#  define tgSleep(x) sleep(x)
-#endif
-
 #include <boost/thread.hpp>
 
 #include <simgear/debug/logstream.hxx>
 #include <Include/version.h>
 
+#include <terragear/tg_array_cache.hxx>
 #include <terragear/tg_mutex.hxx>
+#include <terragear/tg_profile.hxx>
+#include <terragear/tg_tile_scheduler.hxx>
+#include <terragear/mesh/tg_mesh.hxx>
+#include <terragear/mesh/tg_mesh_shared_edge_cache.hxx>
 
 #include "tgconstruct_stage1.hxx"
 #include "tgconstruct_stage2.hxx"
@@ -59,6 +57,16 @@ static void usage( const std::string& name ) {
     SG_LOG(SG_GENERAL, SG_ALERT, "  --ignore-landmass");
     SG_LOG(SG_GENERAL, SG_ALERT, "  --threads");
     SG_LOG(SG_GENERAL, SG_ALERT, "  --threads=<numthreads>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --dem-cache=<MB>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --edge-cache=<MB>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --profile=<file.csv|file.json>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --match-nodes=<merge|kdtree|verify>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --relocate=<auto|incremental|rebuild|verify>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --refine-max-points=<points per tile, 0 for no limit>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --refine-max-time=<seconds per tile>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --validate-mesh");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --booleans=<hybrid|exact|verify>");
+    SG_LOG(SG_GENERAL, SG_ALERT, "  --stage=<1|2>");
     SG_LOG(SG_GENERAL, SG_ALERT, " ]");
     exit(-1);
 }
@@ -96,131 +104,102 @@ std::vector<SGBucket> fillBucketList( long tile_id, const SGGeod& min, const SGG
     return bucketList;
 }
 
-void doStage3( int num_threads, std::vector<SGBucket>& bucketList, 
-               const std::string& priorities_file,
-               const std::string& work_base, const std::string& dem_base, 
-               const std::string& share_base, const std::string& debug_base, 
-               const std::string& output_base )
+// one construction thread - runs whichever tile stage the scheduler hands
+// it next, until all stages of all tiles are done.  Only the stages in
+// start_stage to end_stage get a construct object.
+class tgConstructWorker : public SGThread
 {
-    SGLockedQueue<SGBucket> wq;
-    
-    /* fill the workqueue */
-    for (unsigned int i=0; i<bucketList.size(); i++) {
-        wq.push( bucketList[i] );
-    }
-    
-    // now create the worker threads for stage 1
-    std::vector<tgConstructThird *> constructs;    
-    tgMutex filelock;
-    
-    for (int i=0; i<num_threads; i++) {
-        tgConstructThird* construct = new tgConstructThird( priorities_file, wq, &filelock );
-        construct->setPaths( work_base, dem_base, share_base, debug_base, output_base );
-        constructs.push_back( construct );
-    }
-    
-    // start all threads
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        constructs[i]->start();
-    }
-    // wait for workqueue to empty
-    while( wq.size() ) {
-        tgSleep( 5 );
-    }
-    // wait for all threads to complete
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        constructs[i]->join();
+public:
+    tgConstructWorker( tgTileScheduler& s, int start_stage, int end_stage,
+                       const std::string& priorities_file, tgMutex* l,
+                       const std::string& work_base, const std::string& dem_base,
+                       const std::string& share_base, const std::string& debug_base,
+                       const std::string& output_base ) :
+        scheduler(s), first(NULL), second(NULL), third(NULL)
+    {
+        if ( ( start_stage <= 1 ) && ( end_stage >= 1 ) ) {
+            first = new tgConstructFirst( priorities_file, l );
+            first->setPaths( work_base, dem_base, share_base, debug_base );
+        }
+        if ( ( start_stage <= 2 ) && ( end_stage >= 2 ) ) {
+            second = new tgConstructSecond( priorities_file, l );
+            second->setPaths( work_base, dem_base, share_base, debug_base );
+        }
+        if ( ( start_stage <= 3 ) && ( end_stage >= 3 ) ) {
+            third = new tgConstructThird( priorities_file, l );
+            third->setPaths( work_base, dem_base, share_base, debug_base, output_base );
+        }
     }
-    
-    // delete the stage 1 construct objects
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        delete constructs[i];
+
+    ~tgConstructWorker() {
+        delete first;
+        delete second;
+        delete third;
     }
-    constructs.clear();    
-}
 
-void doStage2( int num_threads, std::vector<SGBucket>& bucketList, 
-               const std::string& priorities_file,
-               const std::string& work_base, const std::string& dem_base, 
-               const std::string& share_base, const std::string& debug_base )
-{
-    SGLockedQueue<SGBucket> wq;
+private:
+    virtual void run() {
+        SGBucket b;
+        int      stage;
 
-    /* fill the workqueue */
-    for (unsigned int i=0; i<bucketList.size(); i++) {
-        wq.push( bucketList[i] );
-    }
+        while ( scheduler.next( b, stage ) ) {
+            tgProfile::instance().beginTile( b.gen_index_str(), stage );
+            {
+                tgProfilePhase phase( "construct" );
 
-    // now create the worker threads for stage 1
-    std::vector<tgConstructSecond *> constructs;    
-    tgMutex filelock;
+                switch ( stage ) {
+                    case 1: first->construct( b );   break;
+                    case 2: second->construct( b );  break;
+                    case 3: third->construct( b );   break;
+                }
+            }
+            tgProfile::instance().endTile();
 
-    for (int i=0; i<num_threads; i++) {
-        tgConstructSecond* construct = new tgConstructSecond( priorities_file, wq, &filelock );
-        construct->setPaths( work_base, dem_base, share_base, debug_base );
-        constructs.push_back( construct );
-    }
-    
-    // start all threads
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        constructs[i]->start();
-    }
-    // wait for workqueue to empty
-    while( wq.size() ) {
-        tgSleep( 5 );
-    }
-    // wait for all threads to complete
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        constructs[i]->join();
-    }
-    
-    // delete the stage 1 construct objects
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        delete constructs[i];
+            scheduler.done( b, stage );
+        }
     }
-    constructs.clear();    
-}
 
-void doStage1( int num_threads, std::vector<SGBucket>& bucketList, 
-               const std::string& priorities_file,
-               const std::string& work_base, const std::string& dem_base, 
-               const std::string& share_base, const std::string& debug_base )
-{
-    SGLockedQueue<SGBucket> wq;
+    tgTileScheduler&    scheduler;
 
-    /* fill the workqueue */
-    for (unsigned int i=0; i<bucketList.size(); i++) {
-        wq.push( bucketList[i] );
-    }
+    tgConstructFirst*   first;
+    tgConstructSecond*  second;
+    tgConstructThird*   third;
+};
 
-    // now create the worker threads for stage 1
-    std::vector<tgConstructFirst *> constructs;    
-    tgMutex filelock;
+// run stages start_stage to end_stage on all tiles.  a tile stage starts
+// as soon as the previous stage of the tile and its neighbours is done -
+// there is no barrier between stages.
+void doStages( int num_threads, int start_stage, int end_stage,
+               std::vector<SGBucket>& bucketList,
+               const std::string& priorities_file,
+               const std::string& work_base, const std::string& dem_base,
+               const std::string& share_base, const std::string& debug_base,
+               const std::string& output_base )
+{
+    tgTileScheduler scheduler( bucketList, start_stage, end_stage );
+    tgMutex         filelock;
 
+    std::vector<tgConstructWorker *> workers;
     for (int i=0; i<num_threads; i++) {
-        tgConstructFirst* construct = new tgConstructFirst( priorities_file, wq, &filelock );
-        construct->setPaths( work_base, dem_base, share_base, debug_base );
-        constructs.push_back( construct );
+        workers.push_back( new tgConstructWorker( scheduler, start_stage, end_stage, priorities_file, &filelock,
+                                                  work_base, dem_base, share_base, debug_base, output_base ) );
     }
 
     // start all threads
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        constructs[i]->start();
-    }
-    // wait for workqueue to empty
-    while( wq.size() ) {
-        tgSleep( 5 );
+    for (unsigned int i=0; i<workers.size(); i++) {
+        workers[i]->start();
     }
-    // wait for all threads to complete
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        constructs[i]->join();
+    // and wait for them to run out of work
+    for (unsigned int i=0; i<workers.size(); i++) {
+        workers[i]->join();
     }
 
-    // delete the stage 1 construct objects
-    for (unsigned int i=0; i<constructs.size(); i++) {
-        delete constructs[i];
+    for (unsigned int i=0; i<workers.size(); i++) {
+        delete workers[i];
     }
-    constructs.clear();    
+    workers.clear();
+
+    scheduler.report();
 }
 
 int main(int argc, char **argv) {
@@ -232,12 +211,15 @@ int main(int argc, char **argv) {
     std::string debug_dir = ".";
     
     std::string priorities_file = DEFAULT_PRIORITIES_FILE;
+    std::string profile_file = "";
     
     SGGeod min, max;
     long   tile_id = -1;
     int    num_threads = 1;
     int    start_stage = 1;
     int    end_stage   = 2;
+    long   refine_max_points  = -1;
+    double refine_max_seconds = 0.0;
 
     sglog().setLogLevels( SG_ALL, SG_INFO );
 
@@ -276,6 +258,54 @@ int main(int argc, char **argv) {
             num_threads = atoi( arg.substr(10).c_str() );
         } else if (arg.find("--threads") == 0) {
             num_threads = boost::thread::hardware_concurrency();
+        } else if (arg.find("--dem-cache=") == 0) {
+            tgArrayCache::instance().setBudget( (size_t)atol( arg.substr(12).c_str() ) * 1024 * 1024 );
+        } else if (arg.find("--edge-cache=") == 0) {
+            tgSharedEdgeCache::instance().setBudget( (size_t)atol( arg.substr(13).c_str() ) * 1024 * 1024 );
+        } else if (arg.find("--profile=") == 0) {
+            profile_file = arg.substr(10);
+            tgProfile::setEnabled( true );
+        } else if (arg.find("--match-nodes=") == 0) {
+            std::string method = arg.substr(14);
+            if ( method == "merge" ) {
+                tgMeshTriangulation::setMatchNodesMethod( tgMeshTriangulation::MATCH_NODES_MERGE );
+            } else if ( method == "kdtree" ) {
+                tgMeshTriangulation::setMatchNodesMethod( tgMeshTriangulation::MATCH_NODES_KDTREE );
+            } else if ( method == "verify" ) {
+                tgMeshTriangulation::setMatchNodesMethod( tgMeshTriangulation::MATCH_NODES_VERIFY );
+            } else {
+                usage(argv[0]);
+            }
+        } else if (arg.find("--relocate=") == 0) {
+            std::string method = arg.substr(11);
+            if ( method == "auto" ) {
+                tgMeshTriangulation::setRelocateMethod( tgMeshTriangulation::RELOCATE_AUTO );
+            } else if ( method == "incremental" ) {
+                tgMeshTriangulation::setRelocateMethod( tgMeshTriangulation::RELOCATE_INCREMENTAL );
+            } else if ( method == "rebuild" ) {
+                tgMeshTriangulation::setRelocateMethod( tgMeshTriangulation::RELOCATE_REBUILD );
+            } else if ( method == "verify" ) {
+                tgMeshTriangulation::setRelocateMethod( tgMeshTriangulation::RELOCATE_VERIFY );
+            } else {
+                usage(argv[0]);
+            }
+        } else if (arg.find("--refine-max-points=") == 0) {
+            refine_max_points = atol( arg.substr(20).c_str() );
+        } else if (arg.find("--refine-max-time=") == 0) {
+            refine_max_seconds = atof( arg.substr(18).c_str() );
+        } else if (arg.find("--validate-mesh") == 0) {
+            tgMeshTriangulation::setValidate( true );
+        } else if (arg.find("--booleans=") == 0) {
+            std::string method = arg.substr(11);
+            if ( method == "hybrid" ) {
+                tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_HYBRID );
+            } else if ( method == "exact" ) {
+                tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_EXACT );
+            } else if ( method == "verify" ) {
+                tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_VERIFY );
+            } else {
+                usage(argv[0]);
+            }
         } else if (arg.find("--stage=") == 0) {
             start_stage = atoi( arg.substr(8).c_str() );
             end_stage   = start_stage;
@@ -286,6 +316,19 @@ int main(int argc, char **argv) {
         }
     }
 
+    // stage 3 hasn't been brought over to the new mesh yet
+    if ( end_stage > 2 ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "Stage 3 is not supported yet - stopping after stage 2");
+        end_stage = 2;
+    }
+    if ( start_stage < 1 || start_stage > end_stage ) {
+        usage(argv[0]);
+    }
+
+    if ( refine_max_points >= 0 || refine_max_seconds > 0.0 ) {
+        tgMeshTriangulation::setRefineBudget( refine_max_points >= 0 ? (unsigned int)refine_max_points : DEFAULT_REFINE_MAX_POINTS, refine_max_seconds );
+    }
+
     if ( share_dir == "" ) {
         share_dir = work_dir + "/Shared";
     }
@@ -310,6 +353,9 @@ int main(int argc, char **argv) {
     }
 
     std::vector<SGBucket> bucketList = fillBucketList( tile_id, min, max );
+
+    // register the GDAL drivers before any worker thread opens a datasource
+    GDALAllRegister();
     
 # if 0 // tile matching     
     // tile work queue
@@ -332,14 +378,8 @@ int main(int argc, char **argv) {
     }
 #endif
 
-// STAGE 1
-    if ( ( start_stage <= 1 ) && ( end_stage >= 1 ) ) {
-        doStage1( num_threads, bucketList, priorities_file, work_dir, dem_dir, share_dir, debug_dir );
-    }
-    
-    if ( ( start_stage <= 2 ) && ( end_stage >= 2 ) ) {
-        doStage2( num_threads, bucketList, priorities_file, work_dir, dem_dir, share_dir, debug_dir );
-    }
+// STAGES 1 and 2
+    doStages( num_threads, start_stage, end_stage, bucketList, priorities_file, work_dir, dem_dir, share_dir, debug_dir, output_dir );
     
 // STAGE 2    
 #if 0    
@@ -411,6 +451,18 @@ int main(int argc, char **argv) {
     constructs.clear();
 #endif
 
+    tgArrayCache::instance().report();
+    tgSharedEdgeCache::instance().report();
+    tgMeshTriangulation::reportRefinement();
+    tgPolygonSet::reportBooleans();
+
+    if ( !profile_file.empty() ) {
+        tgProfile::instance().report();
+        if ( tgProfile::instance().write( profile_file ) ) {
+            SG_LOG(SG_GENERAL, SG_ALERT, "Profile written to " << profile_file);
+        }
+    }
+
     SG_LOG(SG_GENERAL, SG_ALERT, "[Finished successfully]");
     return 0;
 }
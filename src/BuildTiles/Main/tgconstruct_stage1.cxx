@@ -30,16 +30,17 @@
 #include <simgear/misc/sg_dir.hxx>
 #include <simgear/misc/sg_path.hxx>
 #include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include <terragear/tg_array.hxx>
+#include <terragear/tg_directory.hxx>
+#include <terragear/tg_profile.hxx>
 
 #include "tgconstruct_stage1.hxx"
 
 // Constructor
-tgConstructFirst::tgConstructFirst( const std::string& pfile, SGLockedQueue<SGBucket>& q, tgMutex* l) :
-        workQueue(q)
+tgConstructFirst::tgConstructFirst( const std::string& pfile, tgMutex* l)
 {
-    totalTiles = q.size();   
     lock = l;
 
     /* initialize tgMesh for the number of layers we have */
@@ -67,59 +68,54 @@ void tgConstructFirst::setPaths( const std::string& work, const std::string& dem
 
 void tgConstructFirst::safeMakeDirectory( const std::string& directory )
 {
-    lock->lock();
-    std::string dummy = directory + "/dummy";
-    SGPath sgp( dummy );
-    sgp.create_dir( 0755 );
-    lock->unlock();
+    // only threads creating the same directory wait on each other
+    tgMakeDirectory( directory );
 }
 
-void tgConstructFirst::run()
+void tgConstructFirst::construct( const SGBucket& b )
 {
-    unsigned int tilesComplete;
+    bucket = b;
 
-    // as long as we have feometry to parse, do so
-    while ( !workQueue.empty() ) {
-        bucket = workQueue.pop();
-        tilesComplete = totalTiles - workQueue.size();
+    SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Stage1 Construct in " << bucket.gen_base_path() << " using thread " << SGThread::current() );
 
-        SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Stage1 Construct in " << bucket.gen_base_path() << " tile " << tilesComplete << " of " << totalTiles << " using thread " << current() );
+    // assume non ocean tile until proven otherwise
+    isOcean = false;
 
-        // assume non ocean tile until proven otherwise
-        isOcean = false;
+    // clear mesh
+    tileMesh.clear();
 
-        // clear mesh
-        tileMesh.clear();
+    if ( !debugBase.empty() ) {
+        std::string debugPath = debugBase + "/tgconstruct_debug/stage1/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();                
+        safeMakeDirectory( debugPath );
 
-        if ( !debugBase.empty() ) {
-            std::string debugPath = debugBase + "/tgconstruct_debug/stage1/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();                
-            safeMakeDirectory( debugPath );
-
-            tileMesh.initDebug( debugPath );
-        }
+        tileMesh.initDebug( debugPath );
+    }
 
-        tileMesh.clipAgainstBucket( bucket );
+    tileMesh.clipAgainstBucket( bucket );
 
-        // STEP 1 - read in the polygon soup for this tile
-        loadLandclassPolys( workBase );
+    // STEP 1 - read in the polygon soup for this tile
+    {
+        tgProfilePhase phase( "loadPolys" );
+        tgProfile::count( "polys", loadLandclassPolys( workBase ) );
+    }
 
-        // Step 2 - add the fitted nodes ( important elevation points )
-        // add them to the mesh - which adds them in triangulation
+    // Step 2 - add the fitted nodes ( important elevation points )
+    // add them to the mesh - which adds them in triangulation
+    {
+        tgProfilePhase phase( "loadElevation" );
         loadElevation( demBase );
+    }
 
-        // generate the tile
-        tileMesh.generate();
-
-        // save the intermediate data
-        std::string sharedPath = shareBase + "/stage1/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
-        safeMakeDirectory( sharedPath );
+    // generate the tile
+    tileMesh.generate();
 
-        lock->lock();
-        tileMesh.save( sharedPath );
-        lock->unlock();
-    }
+    // save the intermediate data
+    std::string sharedPath = shareBase + "/stage1/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
+    safeMakeDirectory( sharedPath );
 
-    SG_LOG(SG_GENERAL, SG_DEBUG, bucket.gen_index_str() << " Thread " << current() << " finished");
+    // each tile writes to its own directory - no need for the global lock
+    tgProfilePhase phase( "save" );
+    tileMesh.save( sharedPath );
 }
 
 int tgConstructFirst::loadLandclassPolys( const std::string& path )
@@ -128,11 +124,17 @@ int tgConstructFirst::loadLandclassPolys( const std::string& path )
     tgPolygonSetList    polys;
     unsigned int        numPolys = 0;
 
-    // load 2D polygons from correct path
+    // the chopper writes all polys of a bucket to one file
     poly_path = path + "/" + bucket.gen_base_path() + '/' + bucket.gen_index_str();
 
+    // a single sequential read - what a damaged file has up to the damage
+    bool havePolysFile = tgPolygonSet::fromPolysFile( poly_path + ".polys.gz", polys ) || !polys.empty();
+    numPolys += addLandclassPolys( polys );
+
+    // shapefiles from older work directories - polys2shp output next to
+    // a polys file is a copy of it
     simgear::Dir d(poly_path);
-    if (d.exists() ) {
+    if ( !havePolysFile && d.exists() ) {
         simgear::PathList files = d.children(simgear::Dir::TYPE_FILE);
         SG_LOG( SG_GENERAL, SG_DEBUG, files.size() << " Files in " << d.path() );
 
@@ -146,20 +148,14 @@ int tgConstructFirst::loadLandclassPolys( const std::string& path )
                 // shapefile contains multiple polygons.
                 // read an array of them
                 tgPolygonSet::fromShapefile( p, polys );
-                numPolys += polys.size();
-                for ( unsigned int i=0; i<polys.size(); i++ ) {
-                    std::string material = polys[i].getMeta().getMaterial();
-
-                    int area = areaDefs.get_area_priority( material );                    
-                    tileMesh.addPoly( area, polys[i] );
-                }
+                numPolys += addLandclassPolys( polys );
             }
         }
+    }
 
-        if ( !tileMesh.empty() ) {
-            // add pcean polygon
-            addOceanPoly();
-        }
+    if ( !tileMesh.empty() ) {
+        // add pcean polygon
+        addOceanPoly();
     }
 
     SG_LOG(SG_GENERAL, SG_DEBUG, "loadLandclassPolys - loaded " << numPolys << " polys.  mesh is empty: " << tileMesh.empty() );
@@ -167,6 +163,18 @@ int tgConstructFirst::loadLandclassPolys( const std::string& path )
     return numPolys;
 }
 
+int tgConstructFirst::addLandclassPolys( tgPolygonSetList& polys )
+{
+    for ( unsigned int i=0; i<polys.size(); i++ ) {
+        std::string material = polys[i].getMeta().getMaterial();
+
+        int area = areaDefs.get_area_priority( material );
+        tileMesh.addPoly( area, polys[i] );
+    }
+
+    return polys.size();
+}
+
 void tgConstructFirst::loadElevation( const std::string& path ) {        
     std::string array_path = path + "/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
     tgArray     array;
@@ -29,19 +29,18 @@
 # error This library requires C++
 #endif                                   
 
-#include <simgear/threads/SGThread.hxx>
-#include <simgear/threads/SGQueue.hxx>
+#include <simgear/bucket/newbucket.hxx>
 
 #include <terragear/tg_mutex.hxx>
 #include <terragear/mesh/tg_mesh.hxx>
 
 #include "priorities.hxx"
 
-class tgConstructFirst : public SGThread
+class tgConstructFirst
 {
 public:
     // Constructor
-    tgConstructFirst( const std::string& priorities_file, SGLockedQueue<SGBucket>& q, tgMutex* l );
+    tgConstructFirst( const std::string& priorities_file, tgMutex* l );
 
     // Destructor
     ~tgConstructFirst();
@@ -49,15 +48,17 @@ public:
     // paths
     void setPaths( const std::string& work, const std::string& dem, const std::string& share, const std::string& debug );
 
-private:
-    virtual void run();
+    // run this stage on one tile
+    void construct( const SGBucket& b );
 
+private:
     // Ocean tile or not
     bool IsOceanTile()  { return isOcean; }
 
     // Load Data
     void loadElevation( const std::string& path );
     int  loadLandclassPolys( const std::string& path );
+    int  addLandclassPolys( tgPolygonSetList& polys );
     
     void processLayer(OGRLayer* poLayer);
     int  addShape(OGRFeature *poFeature, OGRPolygon* poGeometry);
@@ -68,10 +69,6 @@ private:
 private:
     TGAreaDefinitions           areaDefs;
     
-    // construct stage to perform
-    SGLockedQueue<SGBucket>&    workQueue;
-    unsigned int                totalTiles;
-    
     // paths
     std::string                 workBase;
     std::string                 demBase;
@@ -30,16 +30,17 @@
 #include <simgear/misc/sg_dir.hxx>
 #include <simgear/misc/sg_path.hxx>
 #include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include <terragear/tg_array.hxx>
+#include <terragear/tg_directory.hxx>
+#include <terragear/tg_profile.hxx>
 
 #include "tgconstruct_stage2.hxx"
 
 // Constructor
-tgConstructSecond::tgConstructSecond( const std::string& pfile, SGLockedQueue<SGBucket>& q, tgMutex* l) :
-        workQueue(q)
+tgConstructSecond::tgConstructSecond( const std::string& pfile, tgMutex* l)
 {
-    totalTiles = q.size();
     lock = l;
 
     /* initialize tgMesh for the number of layers we have */
@@ -67,53 +68,44 @@ void tgConstructSecond::setPaths( const std::string& work, const std::string& de
 
 void tgConstructSecond::safeMakeDirectory( const std::string& directory )
 {
-    lock->lock();
-    std::string dummy = directory + "/dummy";
-    SGPath sgp( dummy );
-    sgp.create_dir( 0755 );
-    lock->unlock();
+    // only threads creating the same directory wait on each other
+    tgMakeDirectory( directory );
 }
 
-void tgConstructSecond::run()
+void tgConstructSecond::construct( const SGBucket& b )
 {
-    unsigned int tilesComplete;
+    bucket = b;
 
-    // as long as we have feometry to parse, do so
-    while ( !workQueue.empty() ) {
-        bucket = workQueue.pop();
-        tilesComplete = totalTiles - workQueue.size();
+    SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Stage 2 Construct in " << bucket.gen_base_path() << " using thread " << SGThread::current() );
 
-        SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Stage 2 Construct in " << bucket.gen_base_path() << " tile " << tilesComplete << " of " << totalTiles << " using thread " << current() );
+    // and clear
+    tileMesh.clear();
 
-        // and clear
-        tileMesh.clear();
+    if ( !debugBase.empty() ) {
+        std::string debugPath = debugBase + "/tgconstruct_debug/stage2/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
+        safeMakeDirectory( debugPath );
 
-        if ( !debugBase.empty() ) {
-            std::string debugPath = debugBase + "/tgconstruct_debug/stage2/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
-            safeMakeDirectory( debugPath );
-
-            tileMesh.initDebug( debugPath );
-        }
+        tileMesh.initDebug( debugPath );
+    }
 
-        std::string sharedStage1Base = shareBase + "/stage1/";
+    std::string sharedStage1Base = shareBase + "/stage1/";
 
-        // STEP 1 - read in the stage 1 tile mesh triangulation, and the shared edge nodes - remesh to fit shared edges
-        isOcean = tileMesh.loadStage1( sharedStage1Base, bucket );
+    // STEP 1 - read in the stage 1 tile mesh triangulation, and the shared edge nodes - remesh to fit shared edges
+    isOcean = tileMesh.loadStage1( sharedStage1Base, bucket );
 
-        if ( !isOcean ) {
+    if ( !isOcean ) {
 #if 0
-            // Step 2 - calculate elevation
-            tileMesh.calcElevation( demBase );
+        // Step 2 - calculate elevation
+        tileMesh.calcElevation( demBase );
 #endif
 
-            // save the intermediate data
-            std::string sharedStage2 = shareBase + "/stage2/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
-            safeMakeDirectory( sharedStage2 );
+        // save the intermediate data
+        std::string sharedStage2 = shareBase + "/stage2/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
+        safeMakeDirectory( sharedStage2 );
 
-            lock->lock();
-            tileMesh.save2( sharedStage2 );
-            lock->unlock();
-        }
+        // each tile writes to its own directory - no need for the global lock
+        tgProfilePhase phase( "save" );
+        tileMesh.save2( sharedStage2 );
     }
 }
 
@@ -29,18 +29,17 @@
 # error This library requires C++
 #endif                                   
 
-#include <simgear/threads/SGThread.hxx>
-#include <simgear/threads/SGQueue.hxx>
+#include <simgear/bucket/newbucket.hxx>
 
 #include <terragear/mesh/tg_mesh.hxx>
 
 #include "priorities.hxx"
 
-class tgConstructSecond : public SGThread
+class tgConstructSecond
 {
 public:
     // Constructor
-    tgConstructSecond( const std::string& priorities_file, SGLockedQueue<SGBucket>& q, tgMutex* l );
+    tgConstructSecond( const std::string& priorities_file, tgMutex* l );
 
     // Destructor
     ~tgConstructSecond();
@@ -48,9 +47,10 @@ public:
     // paths
     void setPaths( const std::string& work, const std::string& dem, const std::string& share, const std::string& debug );
     
-private:
-    virtual void run();
+    // run this stage on one tile
+    void construct( const SGBucket& b );
 
+private:
     // Ocean tile or not
     bool IsOceanTile()  { return isOcean; }
 
@@ -62,10 +62,6 @@ private:
 private:
     TGAreaDefinitions           areaDefs;
     
-    // construct stage to perform
-    SGLockedQueue<SGBucket>&    workQueue;
-    unsigned int                totalTiles;
-    
     // paths
     std::string                 workBase;
     std::string                 demBase;
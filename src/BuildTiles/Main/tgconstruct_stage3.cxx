@@ -30,16 +30,15 @@
 #include <simgear/misc/sg_dir.hxx>
 #include <simgear/misc/sg_path.hxx>
 #include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGThread.hxx>
 
 #include <terragear/tg_array.hxx>
 
 #include "tgconstruct_stage3.hxx"
 
 // Constructor
-tgConstructThird::tgConstructThird( const std::string& pfile, SGLockedQueue<SGBucket>& q, tgMutex* l) :
-        workQueue(q)
+tgConstructThird::tgConstructThird( const std::string& pfile, tgMutex* l)
 {
-    totalTiles = q.size();   
     lock = l;
     
     /* initialize tgMesh for the number of layers we have */
@@ -66,63 +65,52 @@ void tgConstructThird::setPaths( const std::string& work, const std::string& dem
     outputBase = output;
 }
 
-void tgConstructThird::run()
+void tgConstructThird::construct( const SGBucket& b )
 {
-    unsigned int tilesComplete;
+    bucket = b;
 
-    SG_LOG(SG_GENERAL, SG_ALERT, " - Construct thread started " );
-    
-    // as long as we have feometry to parse, do so
-    while ( !workQueue.empty() ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, " - workqueue not empty " );
-        
-        bucket = workQueue.pop();
-
-        tilesComplete = totalTiles - workQueue.size();
-
-        // assume non ocean tile until proven otherwise
-        isOcean = false;
+    // assume non ocean tile until proven otherwise
+    isOcean = false;
 
 #if 0        
-        if (   ( bucket.gen_index() != 3006851 )
-            && ( bucket.gen_index() != 3023235 )
-            && ( bucket.gen_index() != 3039619 )
-            && ( bucket.gen_index() != 3056003 )
-            && ( bucket.gen_index() != 3072387 )
-            && ( bucket.gen_index() != 3105155 )
-            && ( bucket.gen_index() != 3121539 )
+    if (   ( bucket.gen_index() != 3006851 )
+        && ( bucket.gen_index() != 3023235 )
+        && ( bucket.gen_index() != 3039619 )
+        && ( bucket.gen_index() != 3056003 )
+        && ( bucket.gen_index() != 3072387 )
+        && ( bucket.gen_index() != 3105155 )
+        && ( bucket.gen_index() != 3121539 )
 #else
-        if ( true
+    if ( true
 #endif            
-        ) {       
-            if ( !debugBase.empty() ) {
-                SG_LOG(SG_GENERAL, SG_ALERT, " - Generate debug " );
-                
-                std::string debugPath = debugBase + "/tgconstruct_debug/stage2" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
-
-                lock->lock();
-                std::string dummy = debugPath + "/dummy";
-                SGPath sgp( dummy );
-                sgp.create_dir( 0755 );            
-                lock->unlock();
-                
-                SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Construct in " << bucket.gen_base_path() << " tile " << tilesComplete << " of " << totalTiles << " debug path is " << debugPath );
-                tileMesh.initDebug( debugPath );
-            }
+    ) {       
+        if ( !debugBase.empty() ) {
+            SG_LOG(SG_GENERAL, SG_ALERT, " - Generate debug " );
             
-            std::string sharedStage2Base = shareBase + "/stage12";
-                        
-            SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Construct in " << bucket.gen_base_path() << " tile " << tilesComplete << " of " << totalTiles << " using thread " << current() );
+            std::string debugPath = debugBase + "/tgconstruct_debug/stage2" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
 
-            // STEP 1 - read in the stage 1 tile mesh triangulation, and the shared edge nodes - remesh to fit shared edges
-            loadMesh( sharedStage2Base );
-            
-            // Step 2 - calculate elevation
-            tileMesh.calcFaceNormals();
+            lock->lock();
+            std::string dummy = debugPath + "/dummy";
+            SGPath sgp( dummy );
+            sgp.create_dir( 0755 );            
+            lock->unlock();
             
-            // and clear
-            tileMesh.clear();
+            SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Construct in " << bucket.gen_base_path() << " debug path is " << debugPath );
+            tileMesh.initDebug( debugPath );
         }
+        
+        std::string sharedStage2Base = shareBase + "/stage12";
+                    
+        SG_LOG(SG_GENERAL, SG_ALERT, bucket.gen_index_str() << " - Construct in " << bucket.gen_base_path() << " using thread " << SGThread::current() );
+
+        // STEP 1 - read in the stage 1 tile mesh triangulation, and the shared edge nodes - remesh to fit shared edges
+        loadMesh( sharedStage2Base );
+        
+        // Step 2 - calculate elevation
+        tileMesh.calcFaceNormals();
+        
+        // and clear
+        tileMesh.clear();
     }
 }
 
@@ -1,5 +1,8 @@
 #include <simgear/debug/logstream.hxx>
 
+#include <terragear/tg_array_cache.hxx>
+#include <terragear/tg_profile.hxx>
+
 #include "tg_mesh.hxx"
 
 void tgMesh::initPriorities( const std::vector<std::string>& names )
@@ -52,14 +55,28 @@ tgPolygonSet tgMesh::join( unsigned int priority, const tgPolygonSetMeta& meta )
 
 void tgMesh::generate( void )
 {
+    tgProfilePhase phase( "generate" );
+
     // mesh generation from polygon soup :)
     if ( !meshArrangement.empty() ) {
         // Step 1 - clip polys against one another - highest priority first ( on top )
-        meshArrangement.clipPolys( b, clipBucket );
+        {
+            tgProfilePhase clipPhase( "clipPolys" );
+            tgProfile::count( "polys", meshArrangement.getNumSourcePolys() );
+
+            meshArrangement.clipPolys( b, clipBucket );
+        }
 
         // Step 2 - insert clipped polys into an arrangement.
         // From this point on, we don't need the individual polygons.
-        meshArrangement.arrangePolys();
+        {
+            tgProfilePhase arrangePhase( "arrangePolys" );
+
+            meshArrangement.arrangePolys();
+
+            tgProfile::count( "faces", meshArrangement.getNumFaces() );
+            tgProfile::count( "edges", meshArrangement.getNumEdges() );
+        }
 
         // step 3 - clean up the arrangement - cluster nodes that are too close - don't want
         // really small triangles blowing up the refined mesh.
@@ -68,13 +85,31 @@ void tgMesh::generate( void )
         // we should remember be checking the delta in interiorPoints to see if we have 
         // polys that don't meat this criteria.
         // and if it doesn't - what do we do?
-        meshArrangement.cleanArrangement( lock );
+        {
+            tgProfilePhase cleanPhase( "cleanArrangement" );
+
+            meshArrangement.cleanArrangement( lock );
+
+            tgProfile::count( "faces", meshArrangement.getNumFaces() );
+            tgProfile::count( "edges", meshArrangement.getNumEdges() );
+        }
 
         // step 4 - create constrained triangulation with arrangement edges as the constraints
-        meshTriangulation.constrainedTriangulateWithEdgeModification( meshArrangement );
+        {
+            tgProfilePhase triPhase( "triangulate" );
+
+            meshTriangulation.constrainedTriangulateWithEdgeModification( meshArrangement );
+
+            tgProfile::count( "vertices",  meshTriangulation.getNumVertices() );
+            tgProfile::count( "triangles", meshTriangulation.getNumTriangles() );
+        }
 
         // step 5 - prepare for serialization
-        meshTriangulation.prepareTds();
+        {
+            tgProfilePhase prepPhase( "prepareTds" );
+
+            meshTriangulation.prepareTds();
+        }
     } else {
         SG_LOG(SG_GENERAL, SG_ALERT, "no source polys" );        
     }
@@ -86,69 +121,63 @@ bool tgMesh::loadStage1( const std::string& basePath, const SGBucket& bucket )
     bool isOcean = false;
     b = bucket;
 
+    tgProfilePhase phase( "loadStage1" );
+
     // now load the stage1 triangulation ( and lookup locations on the edges )
     if ( !meshTriangulation.loadTriangulation( basePath, bucket ) ) {
         isOcean = true;
     } else {
-        meshTriangulation.prepareTds();
-
-        // load the arrangement so we know what material each triangle is.
-        meshArrangement.loadArrangement( bucketPath );
-    }
+        {
+            tgProfilePhase prepPhase( "prepareTds" );
 
-    return isOcean;
-}
+            meshTriangulation.prepareTds();
+        }
 
-tgArray* tgMesh::loadElevationArray( const std::string& demBase, const SGBucket& bucket )
-{
-    std::string arrayPath = demBase + "/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
-    tgArray* array = new tgArray();
+        // load the arrangement so we know what material each triangle is.
+        tgProfilePhase arrPhase( "loadArrangement" );
 
-    if ( array->open(arrayPath) ) {
-        SG_LOG(SG_GENERAL, SG_INFO, "Opened Array file " << arrayPath);
+        meshArrangement.loadArrangement( bucketPath );
 
-        array->parse( bucket );
-        array->remove_voids( );
-        array->close();
-    } else {
-        SG_LOG(SG_GENERAL, SG_INFO, "Could not open Array file " << arrayPath);
+        tgProfile::count( "faces", meshArrangement.getNumFaces() );
+        tgProfile::count( "edges", meshArrangement.getNumEdges() );
     }
 
-    return array;
+    return isOcean;
 }
 
-
 void tgMesh::calcElevation( const std::string& basePath )
 {
     // load this, and surrounding tile elevation data
-    std::vector<tgArray*> northArrays;
+    tgArrayCache& arrays = tgArrayCache::instance();
+
+    std::vector<tgArrayPtr> northArrays;
     std::vector<SGBucket> northBuckets;
     b.siblings( -1, 1, northBuckets );
     b.siblings(  0, 1, northBuckets );
     b.siblings(  1, 1, northBuckets );
     for ( unsigned int i=0; i<northBuckets.size(); i++ ) {
-        northArrays.push_back( loadElevationArray( basePath, northBuckets[i] ) );
+        northArrays.push_back( arrays.get( basePath, northBuckets[i] ) );
     }
 
-    std::vector<tgArray*> southArrays;
+    std::vector<tgArrayPtr> southArrays;
     std::vector<SGBucket> southBuckets;
     b.siblings( -1, -1, southBuckets );
     b.siblings(  0, -1, southBuckets );
     b.siblings(  1, -1, southBuckets );
     for ( unsigned int i=0; i<southBuckets.size(); i++ ) {
-        southArrays.push_back( loadElevationArray( basePath, southBuckets[i] ) );
+        southArrays.push_back( arrays.get( basePath, southBuckets[i] ) );
     }
 
     // SGBucket eastBucket = b.sibling( 1, 0);
-    // tgArray* eastArray = loadElevationArray( basePath, eastBucket );
+    // tgArrayPtr eastArray = arrays.get( basePath, eastBucket );
 
     // SGBucket westBucket = b.sibling(-1, 0);
-    // tgArray* westArray = loadElevationArray( basePath, westBucket );
+    // tgArrayPtr westArray = arrays.get( basePath, westBucket );
 
-    tgArray* tileArray = loadElevationArray( basePath, b );
+    tgArrayPtr tileArray = arrays.get( basePath, b );
 
     // first calc the elevation of all nodes in this tile.
-    meshTriangulation.calcTileElevations( tileArray );
+    meshTriangulation.calcTileElevations( tileArray.get() );
 
 #if 0 // shared edges - is it needed?
 
@@ -245,3 +274,23 @@ void tgMesh::save2( const std::string& path ) const
     // generate edge node list
     // meshTriangulation.saveSharedEdgeFaces( path );
 }
+
+bool tgMesh::loadTds( const std::string& path )
+{
+    bool hasLand = meshTriangulation.loadTds( path );
+    if ( hasLand ) {
+        meshTriangulation.prepareTds();
+    }
+
+    return hasLand;
+}
+
+void tgMesh::saveTds( const std::string& path ) const
+{
+    meshTriangulation.saveTds( path );
+}
+
+void tgMesh::saveTdsShapefile( const std::string& path ) const
+{
+    meshTriangulation.saveTdsShapefile( path );
+}
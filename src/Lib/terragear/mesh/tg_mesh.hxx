@@ -56,6 +56,14 @@ public:
     void save( const std::string& path ) const;
     void save2( const std::string& path ) const;
 
+    // stage 1 triangulation only - tds.bin, or the debug shapefiles
+    bool loadTds( const std::string& path );
+    void saveTds( const std::string& path ) const;
+    void saveTdsShapefile( const std::string& path ) const;
+
+    const tgMeshArrangement& getArrangement( void ) const { return meshArrangement; }
+    const tgMeshTriangulation& getTriangulation( void ) const { return meshTriangulation; }
+
     std::string getDebugPath( void ) { return debugPath; }
     SGBucket    getBucket( void )    { return b; }
 
@@ -63,8 +71,6 @@ public:
     friend class tgMeshTriangulation;
 
 private:
-    tgArray* loadElevationArray( const std::string& demBase, const SGBucket& bucket );
-
     void saveIncidentFaces( const std::string& path, const char* layer, const std::vector<meshTriVertexHandle>& vertexes ) const;
 
     typedef enum {
@@ -74,6 +80,9 @@ private:
         LAYER_FIELDS_TDS_FACE
     } MeshLayerFields;
 
+    // GDALAllRegister(), the first time only
+    static void  registerDrivers( void );
+
     GDALDataset* openDatasource( const std::string& datasource_name ) const;
     OGRLayer*    openLayer( GDALDataset* poDS, OGRwkbGeometryType lt, MeshLayerFields lf, const char* layer_name ) const;
 
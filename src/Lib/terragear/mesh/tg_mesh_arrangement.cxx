@@ -30,6 +30,17 @@ bool tgMeshArrangement::empty( void )
     return empty;
 }
 
+unsigned int tgMeshArrangement::getNumSourcePolys( void ) const
+{
+    unsigned int numPolys = 0;
+
+    for ( unsigned int i=0; i<numPriorities; i++ ) {
+        numPolys += sourcePolys[i].size();
+    }
+
+    return numPolys;
+}
+
 void tgMeshArrangement::addPoly( unsigned int priority, const tgPolygonSet& poly )
 {
     sourcePolys[priority].push_back( poly );
@@ -77,6 +88,11 @@ void tgMeshArrangement::getSegments( std::vector<meshTriSegment>& constraints  )
     }
 }
 
+void tgMeshArrangement::addSegments( const std::vector<meshArrSegment>& segs )
+{
+    CGAL::insert( meshArr, segs.begin(), segs.end() );
+}
+
 // perform polygon clipping ( the soup )
 void tgMeshArrangement::clipPolys( const SGBucket& b, bool clipBucket )
 {
@@ -185,18 +201,70 @@ void tgMeshArrangement::arrangePolys( void )
 meshArrFaceConstHandle tgMeshArrangement::findPolyFace( meshArrFaceConstHandle f ) const
 {
     meshArrFaceConstHandle face = (meshArrFaceConstHandle)NULL;
-    bool found = false;
 
-    for ( unsigned int i=0; i<metaLookup.size() && !found; i++ ) {
-        if ( metaLookup[i].face == f ) {
-            face = f;
-            found = true;
-        }
+    if ( f != (meshArrFaceConstHandle)NULL && metaIndex[f] >= 0 ) {
+        face = f;
     }
 
     return face;
 }
 
+// material of the source polygon that generated the given face
+std::string tgMeshArrangement::getMaterial( meshArrFaceConstHandle f ) const
+{
+    std::string material;
+
+    if ( f != (meshArrFaceConstHandle)NULL && metaIndex[f] >= 0 ) {
+        material = metaLookup[metaIndex[f]].meta.material;
+    }
+
+    return material;
+}
+
+// a face may be found by more than one query point - lookups use the first
+void tgMeshArrangement::addFaceMeta( meshArrFaceConstHandle f, const cgalPoly_Point& qp, const tgPolygonSetMeta& meta )
+{
+    if ( metaIndex[f] < 0 ) {
+        metaIndex[f] = metaLookup.size();
+    }
+    metaLookup.push_back( tgMeshFaceMeta( f, qp, meta ) );
+}
+
+void tgMeshArrangement::clearFaceMeta( void )
+{
+    metaLookup.clear();
+    metaIndex.clear();
+}
+
+void tgMeshArrangement::mergeFaceMeta( meshArrFaceConstHandle keep, meshArrFaceConstHandle removed )
+{
+    int removedIndex = metaIndex[removed];
+
+    if ( removedIndex >= 0 ) {
+        for ( unsigned int i=removedIndex; i<metaLookup.size(); i++ ) {
+            if ( metaLookup[i].face == removed ) {
+                metaLookup[i].face = keep;
+            }
+        }
+
+        if ( metaIndex[keep] < 0 || metaIndex[keep] > removedIndex ) {
+            metaIndex[keep] = removedIndex;
+        }
+        metaIndex[removed] = -1;
+    }
+}
+
+void tgMeshArrFaceObserver::after_clear( void )
+{
+    owner->clearFaceMeta();
+}
+
+void tgMeshArrFaceObserver::before_merge_face( meshArrFaceHandle f1, meshArrFaceHandle f2, meshArrHalfedgeHandle e )
+{
+    // f2 is deleted by the merge
+    owner->mergeFaceMeta( f1, f2 );
+}
+
 // lookup a face in the arrangement from a point in the triangulation
 // need to convert the point from EPICK to EPECK
 meshArrFaceConstHandle tgMeshArrangement::findMeshFace( const meshTriPoint& tPt ) const
@@ -37,10 +37,27 @@ typedef std::vector<tgSharpAngleSeries>   tgSharpAngleSeriesList;
 
 /////////////////////////////////////////////////////////////////////////////////////////
 
+class tgMeshArrangement;
+
+// keeps the face meta index valid while the arrangement is modified -
+// cleared with the arrangement, and moved to the surviving face when two
+// faces are merged.
+class tgMeshArrFaceObserver : public CGAL::Arr_observer<meshArrangement>
+{
+public:
+    tgMeshArrFaceObserver( meshArrangement& arr, tgMeshArrangement* ma ) : CGAL::Arr_observer<meshArrangement>( arr ), owner( ma ) {}
+
+    virtual void after_clear( void );
+    virtual void before_merge_face( meshArrFaceHandle f1, meshArrFaceHandle f2, meshArrHalfedgeHandle e );
+
+private:
+    tgMeshArrangement*  owner;
+};
+
 class tgMeshArrangement
 {
 public:
-    tgMeshArrangement( tgMesh* m ) { mesh = m; }
+    tgMeshArrangement( tgMesh* m ) : metaIndex(-1), faceObserver( meshArr, this ) { mesh = m; }
 
     typedef enum {
         SRC_POINT_OK        = 0,
@@ -50,7 +67,7 @@ public:
 
     void clear( void ) {
         meshArr.clear();
-        metaLookup.clear();
+        clearFaceMeta();
 
         // clear source polys
         for ( unsigned int i=0; i<numPriorities; i++ ) {
@@ -77,11 +94,28 @@ public:
     void getPoints( std::vector<meshTriPoint>& points ) const;
     void getSegments( std::vector<meshTriSegment>& constraints ) const;
 
+    // snap rounding on its own, on an arrangement of plain segments
+    void addSegments( const std::vector<meshArrSegment>& segs );
+    void doSnapRound( void );
+
     meshArrFaceConstHandle findPolyFace( meshArrFaceConstHandle f ) const;
     meshArrFaceConstHandle findMeshFace( const meshArrPoint& pt) const;
     meshArrFaceConstHandle findMeshFace( const meshTriPoint& pt) const;
+    std::string            getMaterial( meshArrFaceConstHandle f ) const;
+
+    const std::vector<tgMeshFaceMeta>& getFaceMeta( void ) const { return metaLookup; }
+
+    unsigned int getNumSourcePolys( void ) const;
+    unsigned int getNumFaces( void ) const { return meshArr.number_of_faces(); }
+    unsigned int getNumEdges( void ) const { return meshArr.number_of_edges(); }
+
+    friend class tgMeshArrFaceObserver;
 
 private:
+    void addFaceMeta( meshArrFaceConstHandle f, const cgalPoly_Point& qp, const tgPolygonSetMeta& meta );
+    void clearFaceMeta( void );
+    void mergeFaceMeta( meshArrFaceConstHandle keep, meshArrFaceConstHandle removed );
+
     void arrangementInsert( std::vector<tgPolygonSet>::iterator pit );
 
     bool isEdgeVertex( meshArrVertexConstHandle v );
@@ -101,8 +135,6 @@ private:
     void addSharpAngle( std::vector<tgSharpAngle>& angles, meshArrVertexHandle v1, meshArrVertexHandle v2, meshArrVertexHandle v3, double angle );
     void findSpikes( meshArrFaceHandle f, std::vector<tgSharpAngle>& angles, std::vector<meshArrHalfedgeHandle>& dups );
 
-    void doSnapRound( SGMutex* lock );
-
     meshArrPoint toMeshArrPoint( const meshTriPoint& tPoint ) const {
         return meshArrPoint( tPoint.x(), tPoint.y() );
     }
@@ -149,6 +181,10 @@ private:
     meshArrangement                 meshArr;
     meshArrLandmarks_pl             meshPointLocation;
     std::vector<tgMeshFaceMeta>     metaLookup;
+
+    // metaLookup index of the first entry for each face, -1 if none
+    CGAL::Unique_hash_map<meshArrFaceConstHandle, int>  metaIndex;
+    tgMeshArrFaceObserver           faceObserver;
 };
 
 #endif /* __TG_MESH_ARRANGEMENT_HXX__ */
@@ -3,6 +3,7 @@
 // TODO - cluster used by vector intersection code, and mesh - let's clean it up
 // to show how generic it is.
 #include <terragear/tg_cluster.hxx>
+#include <terragear/tg_profile.hxx>
 
 #include "tg_mesh.hxx"
 #include "../polygon_set/tg_polygon_set.hxx"
@@ -71,16 +72,17 @@ void tgMeshArrangement::cleanArrangement( SGMutex* lock )
     // create the point list from the arrangement
     // TODO: cluster needs to know if a point can mode or not.
     // We don't want to average points on the tile edges...
+    tgProfilePhase clusterPhase( "cluster" );
+
     meshArrVertexConstIterator vit;
     std::list<tgClusterNode>   nodes;
     for ( vit = meshArr.vertices_begin(); vit != meshArr.vertices_end(); vit++ ) {
         nodes.push_back( tgClusterNode( toCpPoint(vit->point()), isEdgeVertex(vit) ) );
     }
+    tgProfile::count( "nodes", nodes.size() );
 
-    // create the cluster : not thread safe
-    lock->lock();
+    // create the cluster
     tgCluster cluster( nodes, 0.0000025, mesh->debugPath );
-    lock->unlock();
 
 #if DEBUG_MESH_CLEANING
     cluster.toShapefile( mesh->getDebugPath().c_str(), "cluster" );
@@ -92,6 +94,7 @@ void tgMeshArrangement::cleanArrangement( SGMutex* lock )
     // with clustered source / target points.
     // just add the segments that still exist
     doClusterEdges( cluster );
+    clusterPhase.end();
 
     // clean 2
     doRemoveAntenna();
@@ -111,7 +114,7 @@ void tgMeshArrangement::cleanArrangement( SGMutex* lock )
     // getting them back is tricky.
     // maybe mark edges as 'special?
     // let's try without, first.
-    doSnapRound( lock );
+    doSnapRound();
 
     // clean 4
     doRemoveAntenna();
@@ -159,7 +162,7 @@ void tgMeshArrangement::cleanArrangement( SGMutex* lock )
                     if (CGAL::assign(f, obj)) {
                         // point is in face - set the material, and the query point, so we can save it
                         if ( !f->is_unbounded() ) {
-                            metaLookup.push_back( tgMeshFaceMeta(f, queryPoints[i], pit->getMeta() ) );
+                            addFaceMeta( f, queryPoints[i], pit->getMeta() );
                         } else {
                             SG_LOG( SG_GENERAL, SG_INFO, "tgMesh::tgMesh - POINT " << i << " queryPoint found on unbounded FACE!" );
 #if DEBUG_MESH_CLEANING
@@ -184,7 +184,7 @@ void tgMeshArrangement::fromShapefile( const OGRFeatureDefn* poFDefn, OGRCoordin
 
 void tgMeshArrangement::fromShapefile( const std::string& filename, std::vector<meshArrSegment>& segments ) const
 {
-    GDALAllRegister();
+    tgMesh::registerDrivers();
     
     GDALDataset* poDS = (GDALDataset*)GDALOpenEx( filename.c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL );
     if( poDS == NULL )
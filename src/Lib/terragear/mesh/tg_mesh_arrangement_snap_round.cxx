@@ -1,87 +1,381 @@
-#include <CGAL/Snap_rounding_traits_2.h>
-#include <CGAL/Snap_rounding_2.h>
+#include <algorithm>
+#include <list>
+#include <set>
 
 #include <simgear/debug/logstream.hxx>
 
+#include <terragear/tg_profile.hxx>
+
 #include "tg_mesh.hxx"
+#include "tg_mesh_snap_round.hxx"
 
-// snap rounding looks like it causes more issues than it solves.
-// currently unused.
-// a few issues:
-// 1 - cgal translates points to the center of the pixel.  
+// snap rounding used to be done with CGAL::snap_rounding_2, which had a few
+// issues:
+// 1 - cgal translates points to the center of the pixel.
 //     I wish we could snap to the sw corner of the pixel.
 //     We need to translate all points sw by 1/2 pixel size after snap rounding
 // 2 - it looks like if we are on the pixel border, we sometimes translate
 //     'the wrong way' making tile edge in the incorrect position.
-//     I found this when tile matching broke for just a few tiles 
+//     I found this when tile matching broke for just a few tiles
 //     ( I beleive this is due to fp roundoff errors )
-// 3 - CGAL snaprounding is apparently not threadsafe - I had to protect the whole 
+// 3 - CGAL snaprounding is apparently not threadsafe - I had to protect the whole
 //     procedure with a mutex.
+//
+// tgMeshSnapRound snaps to the pixel centers directly, so there is no
+// offset to undo.  The pixel size is a power of two, so every lattice point
+// is an exact double, and bucket edges ( multiples of 1/8 degree ) are
+// lattice points - tile edge nodes do not move.  It keeps no global state,
+// so no lock is needed.
+
+// 2^-22 degrees - about 2.6 cm
+#define SR_PIXEL_SIZE       (1.0 / 4194304.0)
+
+// hot pixels are bucketed in cells of SR_CELL_SIZE x SR_CELL_SIZE pixels
+#define SR_CELL_SIZE        (64)
+
+// reroute passes before giving up on a segment
+#define SR_MAX_ITERATIONS   (16)
+
+static long long floorDiv( long long a, long long b )
+{
+    long long q = a / b;
+
+    if ( ( a % b != 0 ) && ( ( a < 0 ) != ( b < 0 ) ) ) {
+        q--;
+    }
+
+    return q;
+}
+
+tgMeshSnapRound::tgMeshSnapRound( double size ) :
+    pixelSize(size),
+    numHotPixels(0)
+{
+}
+
+meshArr_FT tgMeshSnapRound::pixelEdge( long long i ) const
+{
+    // low edge of pixel i
+    return meshArr_FT( ( (double)i - 0.5 ) * pixelSize );
+}
+
+long long tgMeshSnapRound::toPixel( const meshArr_FT& v, double d ) const
+{
+    // guess in doubles, then settle it exactly
+    long long i = (long long)floor( d / pixelSize + 0.5 );
+
+    while ( v < pixelEdge( i ) ) {
+        i--;
+    }
+    while ( v >= pixelEdge( i+1 ) ) {
+        i++;
+    }
+
+    return i;
+}
+
+tgMeshSnapRound::pixelKey tgMeshSnapRound::toPixel( const meshArrPoint& pt ) const
+{
+    return pixelKey( toPixel( pt.x(), CGAL::to_double( pt.x() ) ),
+                     toPixel( pt.y(), CGAL::to_double( pt.y() ) ) );
+}
+
+meshArrPoint tgMeshSnapRound::toCenter( const pixelKey& p ) const
+{
+    return meshArrPoint( (double)p.first * pixelSize, (double)p.second * pixelSize );
+}
 
-// instead of snaprounding, we remove small areas, then small angles ( spikes )
-// not as simple to code, but hopefully doesn't cause as many issues.
+meshArrPoint tgMeshSnapRound::snap( const meshArrPoint& pt ) const
+{
+    return toCenter( toPixel( pt ) );
+}
+
+void tgMeshSnapRound::addHotPixel( const meshArrPoint& pt )
+{
+    pixelKey p = toPixel( pt );
+    pixelKey c( floorDiv( p.first, SR_CELL_SIZE ), floorDiv( p.second, SR_CELL_SIZE ) );
 
-typedef CGAL::Snap_rounding_traits_2<meshArrKernel> srTraits;
-typedef std::list<meshArrSegment>                   srSegmentList;
-typedef std::vector<meshArrPoint>                   srPointList;
-typedef std::list<meshArrPoint>                     srPolyline;
-typedef std::list<srPolyline>                       srPolylineList;
+    std::vector<pixelKey>& cell = cells[c];
+    if ( std::find( cell.begin(), cell.end(), p ) == cell.end() ) {
+        cell.push_back( p );
+        numHotPixels++;
+    }
+}
 
-void tgMeshArrangement::doSnapRound( SGMutex* lock )
+// does the segment touch the closed pixel?
+bool tgMeshSnapRound::intersects( const meshArrPoint& s, const meshArrPoint& t, const pixelKey& p ) const
 {
-    srSegmentList  srInputSegs;
-    srPolylineList srOutputSegs;
-    srPointList    srInputPoints;
+    meshArr_FT x0 = pixelEdge( p.first );
+    meshArr_FT x1 = pixelEdge( p.first+1 );
+    meshArr_FT y0 = pixelEdge( p.second );
+    meshArr_FT y1 = pixelEdge( p.second+1 );
 
-    meshArrEdgeIterator eit;
-    for ( eit = meshArr.edges_begin(); eit != meshArr.edges_end(); ++eit ) {
-        srInputSegs.push_back( eit->curve() );
+    if ( ( s.x() < x0 && t.x() < x0 ) || ( s.x() > x1 && t.x() > x1 ) ||
+         ( s.y() < y0 && t.y() < y0 ) || ( s.y() > y1 && t.y() > y1 ) ) {
+        return false;
     }
 
-    meshArrVertexIterator vit;
-    for ( vit = meshArr.vertices_begin(); vit != meshArr.vertices_end(); ++vit ) {
+    // bounding boxes overlap - the segment misses the pixel only if all
+    // four corners are strictly on the same side of it
+    meshArrKernel::Orientation_2 orientation = meshArrKernel().orientation_2_object();
+
+    CGAL::Orientation o0 = orientation( s, t, meshArrPoint( x0, y0 ) );
+    CGAL::Orientation o1 = orientation( s, t, meshArrPoint( x1, y0 ) );
+    CGAL::Orientation o2 = orientation( s, t, meshArrPoint( x1, y1 ) );
+    CGAL::Orientation o3 = orientation( s, t, meshArrPoint( x0, y1 ) );
+
+    return !( o0 != CGAL::COLLINEAR && o0 == o1 && o0 == o2 && o0 == o3 );
+}
+
+// hot pixels touched by the segment, ordered from source to target
+void tgMeshSnapRound::findHotPixels( const meshArrPoint& s, const meshArrPoint& t, std::vector<pixelKey>& hot ) const
+{
+    // candidate search in pixel units - generous margins, the exact
+    // test decides
+    double sx = CGAL::to_double( s.x() ) / pixelSize;
+    double sy = CGAL::to_double( s.y() ) / pixelSize;
+    double tx = CGAL::to_double( t.x() ) / pixelSize;
+    double ty = CGAL::to_double( t.y() ) / pixelSize;
+
+    long long i0 = (long long)floor( std::min( sx, tx ) + 0.5 ) - 1;
+    long long i1 = (long long)floor( std::max( sx, tx ) + 0.5 ) + 1;
+    long long j0 = (long long)floor( std::min( sy, ty ) + 0.5 ) - 1;
+    long long j1 = (long long)floor( std::max( sy, ty ) + 0.5 ) + 1;
+
+    std::vector< std::pair<double, pixelKey> > found;
+
+    for ( long long cj = floorDiv( j0, SR_CELL_SIZE ); cj <= floorDiv( j1, SR_CELL_SIZE ); cj++ ) {
+        // x range of the segment within this row of cells
+        double ylo = std::max( (double)( cj * SR_CELL_SIZE ) - 1.5, std::min( sy, ty ) );
+        double yhi = std::min( (double)( ( cj+1 ) * SR_CELL_SIZE ) + 0.5, std::max( sy, ty ) );
+        double xlo, xhi;
+
+        if ( ylo > yhi ) {
+            continue;
+        }
+
+        if ( fabs( ty - sy ) < 1.0 ) {
+            xlo = std::min( sx, tx );
+            xhi = std::max( sx, tx );
+        } else {
+            double xa = sx + ( ylo - sy ) * ( tx - sx ) / ( ty - sy );
+            double xb = sx + ( yhi - sy ) * ( tx - sx ) / ( ty - sy );
+
+            xlo = std::min( xa, xb );
+            xhi = std::max( xa, xb );
+        }
+
+        long long ilo = std::max( i0, (long long)floor( xlo + 0.5 ) - 2 );
+        long long ihi = std::min( i1, (long long)floor( xhi + 0.5 ) + 2 );
+
+        for ( long long ci = floorDiv( ilo, SR_CELL_SIZE ); ci <= floorDiv( ihi, SR_CELL_SIZE ); ci++ ) {
+            std::map< pixelKey, std::vector<pixelKey> >::const_iterator cit = cells.find( pixelKey( ci, cj ) );
+            if ( cit == cells.end() ) {
+                continue;
+            }
+
+            const std::vector<pixelKey>& cell = cit->second;
+            for ( unsigned int k=0; k<cell.size(); k++ ) {
+                const pixelKey& p = cell[k];
+
+                if ( p.first  < i0 || p.first  > i1 ||
+                     p.second < j0 || p.second > j1 ) {
+                    continue;
+                }
+
+                if ( intersects( s, t, p ) ) {
+                    double along = ( (double)p.first - sx ) * ( tx - sx ) + ( (double)p.second - sy ) * ( ty - sy );
+                    found.push_back( std::make_pair( along, p ) );
+                }
+            }
+        }
+    }
+
+    std::sort( found.begin(), found.end() );
+    for ( unsigned int k=0; k<found.size(); k++ ) {
+        hot.push_back( found[k].second );
+    }
+}
+
+void tgMeshSnapRound::round( const meshArrSegment& seg, std::vector<meshArrPoint>& polyline ) const
+{
+    pixelKey ps = toPixel( seg.source() );
+    pixelKey pt = toPixel( seg.target() );
+
+    if ( ps == pt ) {
+        polyline.push_back( toCenter( ps ) );
+        return;
+    }
+
+    // route through the hot pixels the original segment touches.
+    // the flag marks route pieces that still need checking
+    typedef std::list< std::pair<pixelKey, bool> > pixelRoute;
+
+    std::vector<pixelKey> hot;
+    std::set<pixelKey>    onRoute;
+    pixelRoute            route;
+
+    findHotPixels( seg.source(), seg.target(), hot );
+
+    route.push_back( std::make_pair( ps, true ) );
+    onRoute.insert( ps );
+    onRoute.insert( pt );
+    for ( unsigned int i=0; i<hot.size(); i++ ) {
+        if ( onRoute.insert( hot[i] ).second ) {
+            route.push_back( std::make_pair( hot[i], true ) );
+        }
+    }
+    route.push_back( std::make_pair( pt, false ) );
+
+    // then keep rerouting the pieces through the hot pixels they touch
+    bool dirty = true;
+    for ( int iter = 0; dirty && iter < SR_MAX_ITERATIONS; iter++ ) {
+        dirty = false;
+
+        pixelRoute::iterator cur = route.begin();
+        pixelRoute::iterator next = cur; next++;
+        while ( next != route.end() ) {
+            if ( cur->second ) {
+                hot.clear();
+                findHotPixels( toCenter( cur->first ), toCenter( next->first ), hot );
+
+                for ( unsigned int i=0; i<hot.size(); i++ ) {
+                    if ( onRoute.insert( hot[i] ).second ) {
+                        route.insert( next, std::make_pair( hot[i], true ) );
+                        dirty = true;
+                    }
+                }
+                cur->second = false;
+            }
+
+            cur = next;
+            next++;
+        }
+    }
+
+    if ( dirty ) {
+        SG_LOG( SG_GENERAL, SG_WARN, "tgMeshSnapRound::round - segment still touches hot pixels after " << SR_MAX_ITERATIONS << " passes" );
+    }
+
+    for ( pixelRoute::const_iterator rit = route.begin(); rit != route.end(); rit++ ) {
+        polyline.push_back( toCenter( rit->first ) );
+    }
+}
+
+void tgMeshArrangement::doSnapRound( void )
+{
+    tgProfilePhase phase( "snapRound" );
+
+    tgMeshSnapRound sr( SR_PIXEL_SIZE );
+
+    // hot pixels - every segment endpoint, and every intersection, is
+    // already an arrangement vertex
+    std::vector<meshArrVertexHandle> isolated;
+    for ( meshArrVertexIterator vit = meshArr.vertices_begin(); vit != meshArr.vertices_end(); ++vit ) {
         if ( vit->is_isolated() ) {
-            srInputPoints.push_back( vit->point() );
+            isolated.push_back( vit );
+        } else {
+            sr.addHotPixel( vit->point() );
         }
     }
 
-    // snap rounding notes:
-    // 1) doesn't appear to be threadsafe
-    // 2) no way to define the origin of snapping.  so if a point is at 0,0, and pixel size is 1, new point will be at 0.5, 0.5.
-    //    We don't want this, so we translate the entire dataset back by 1/2 pixel size so 0,0 is still 0,0
+    // round every edge, but only remember the ones that moved
+    std::vector<meshArrHalfedgeHandle> movedEdges;
+    std::vector<meshArrSegment>        movedSegs;
+    std::vector<meshArrSegment>        keptSegs;
+    std::vector<meshArrPoint>          polyline;
 
-#define SR_OFFSET  (0.0000001)
-//#define SR_OFFSET  (0)
+    for ( meshArrEdgeIterator eit = meshArr.edges_begin(); eit != meshArr.edges_end(); ++eit ) {
+        const meshArrSegment& curve = eit->curve();
 
-    lock->lock();
-    CGAL::snap_rounding_2<srTraits, srSegmentList::const_iterator, srPolylineList>
-    (srInputSegs.begin(), srInputSegs.end(), srOutputSegs, 0.0000002, true, false, 5);
-    lock->unlock();
+        polyline.clear();
+        sr.round( curve, polyline );
 
-    std::vector<meshArrSegment> segs;
+        if ( polyline.size() == 2 &&
+             polyline[0] == curve.source() &&
+             polyline[1] == curve.target() ) {
+            keptSegs.push_back( curve );
+            continue;
+        }
 
-    srPolylineList::const_iterator iter1;
-    for (iter1 = srOutputSegs.begin(); iter1 != srOutputSegs.end(); ++iter1) {
-        srPolyline::const_iterator itSrc = iter1->begin();
-        srPolyline::const_iterator itTrg = itSrc; itTrg++;
-        while (itTrg != iter1->end()) {
-            meshArrPoint src( itSrc->x() - SR_OFFSET, itSrc->y() - SR_OFFSET );
-            meshArrPoint trg( itTrg->x() - SR_OFFSET, itTrg->y() - SR_OFFSET );
+        movedEdges.push_back( eit );
+        for ( unsigned int i=1; i<polyline.size(); i++ ) {
+            movedSegs.push_back( meshArrSegment( polyline[i-1], polyline[i] ) );
+        }
+    }
 
-            segs.push_back( meshArrSegment(src, trg) );
-            itSrc++; itTrg++;
+    std::vector<meshArrVertexHandle> movedPoints;
+    for ( unsigned int i=0; i<isolated.size(); i++ ) {
+        if ( sr.snap( isolated[i]->point() ) != isolated[i]->point() ) {
+            movedPoints.push_back( isolated[i] );
         }
     }
 
-    meshArr.clear();
-    CGAL::insert( meshArr, segs.begin(), segs.end() );
+    tgProfile::count( "hotPixels",  sr.getNumHotPixels() );
+    tgProfile::count( "movedEdges", movedEdges.size() );
+
+    SG_LOG( SG_GENERAL, SG_DEBUG, "tgMeshArrangement::doSnapRound - " << sr.getNumHotPixels() << " hot pixels, " <<
+                                  movedEdges.size() << " of " << meshArr.number_of_edges() << " edges moved, " <<
+                                  movedPoints.size() << " of " << isolated.size() << " isolated points moved" );
+
+    if ( movedEdges.empty() && movedPoints.empty() ) {
+        return;
+    }
+
+    if ( movedEdges.size() * 2 > meshArr.number_of_edges() ) {
+        // most of the arrangement moved ( the first rounding of a tile ) -
+        // rebuilding it with a single sweep is cheaper than removing and
+        // inserting edge by edge
+        std::vector<meshArrSegment> segs( keptSegs );
+        std::vector<meshArrPoint>   points;
+
+        segs.insert( segs.end(), movedSegs.begin(), movedSegs.end() );
 
-    // snap round the isolated vertices, too
-    srTraits srT;
-    for ( unsigned int i=0; i<srInputPoints.size(); i++ ) {
-        meshArr_FT x, y;
-        srT.snap_2_object()(srInputPoints[i], 0.0000002, x, y);
+        for ( unsigned int i=0; i<isolated.size(); i++ ) {
+            points.push_back( sr.snap( isolated[i]->point() ) );
+        }
+
+        meshArr.clear();
+        CGAL::insert( meshArr, segs.begin(), segs.end() );
+        for ( unsigned int i=0; i<points.size(); i++ ) {
+            CGAL::insert_point( meshArr, points[i] );
+        }
+    } else {
+        std::vector<meshArrPoint> points;
+        for ( unsigned int i=0; i<movedPoints.size(); i++ ) {
+            points.push_back( sr.snap( movedPoints[i]->point() ) );
+            meshArr.remove_isolated_vertex( movedPoints[i] );
+        }
+
+        // remove the moved edges without merging or removing their end
+        // vertices - that would free or rewrite edges still on the list.
+        // Endpoints left isolated go afterwards, the rounded segments
+        // bring back the ones that are still needed.
+        std::vector<meshArrVertexHandle> ends;
+        std::set<meshArrPoint>           endPoints;
+        for ( unsigned int i=0; i<movedEdges.size(); i++ ) {
+            if ( endPoints.insert( movedEdges[i]->source()->point() ).second ) {
+                ends.push_back( movedEdges[i]->source() );
+            }
+            if ( endPoints.insert( movedEdges[i]->target()->point() ).second ) {
+                ends.push_back( movedEdges[i]->target() );
+            }
+        }
 
-        CGAL::insert_point( meshArr, meshArrPoint( x - SR_OFFSET, y - SR_OFFSET ) );
+        for ( unsigned int i=0; i<movedEdges.size(); i++ ) {
+            meshArr.remove_edge( movedEdges[i], false, false );
+        }
+        for ( unsigned int i=0; i<ends.size(); i++ ) {
+            if ( ends[i]->is_isolated() ) {
+                meshArr.remove_isolated_vertex( ends[i] );
+            }
+        }
+
+        for ( unsigned int i=0; i<movedSegs.size(); i++ ) {
+            CGAL::insert( meshArr, movedSegs[i] );
+        }
+        for ( unsigned int i=0; i<points.size(); i++ ) {
+            CGAL::insert_point( meshArr, points[i] );
+        }
     }
-}
\ No newline at end of file
+}
@@ -34,6 +34,8 @@
 #include <CGAL/Arrangement_2.h>
 #include <CGAL/Arr_segment_traits_2.h>
 #include <CGAL/Arr_landmarks_point_location.h>
+#include <CGAL/Arr_observer.h>
+#include <CGAL/Unique_hash_map.h>
 
 // triangulation
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
@@ -87,13 +89,25 @@ struct tgMeshArrFaceInfo
     void clear( void ) {
         visited     = false;
         arrMeshFace = (meshArrFaceConstHandle)NULL;
+        material.clear();
     }
 
-    void setFace( meshArrFaceConstHandle f ) {
+    void setFace( meshArrFaceConstHandle f, const std::string& m ) {
         arrMeshFace = f;
+        material    = m;
         visited = true;
     }
 
+    // material is kept with the triangle, so it survives saving and
+    // loading the TDS without the arrangement
+    void setMaterial( const std::string& m ) {
+        material = m;
+    }
+
+    const std::string& getMaterial( void ) const {
+        return material;
+    }
+
     bool isVisited( void ) const { 
         return visited;
     }
@@ -182,6 +196,8 @@ public:
         }
     }
 
+    meshVertexInfo( int i, const meshTriPoint& p, double e ) : id(i), pt(p), elevation(e) {}
+
     meshVertexInfo( OGRFeature* poFeature ) {
         vh        = meshTriTDS::Vertex_handle();
 
@@ -243,6 +259,8 @@ public:
             }
             con[i]      = fh->is_constrained(i) ? 1 : 0;
         }
+
+        material    = fh->info().getMaterial();
     }
 
     meshFaceInfo( int i, int vi[3], int ni[3], int c[3] ) {
@@ -311,12 +329,21 @@ public:
         return con[i];
     }
 
+    const std::string& getMaterial( void ) const {
+        return material;
+    }
+
+    void setMaterial( const std::string& m ) {
+        material = m;
+    }
+
 private:
     int                 fid;        // our face id
     meshTriFaceHandle   fh;         // out hanfle
     int                 vid[3];     // vertex ids
     int                 nid[3];     // neighbor face ids
     int                 con[3];     // constrained edges
+    std::string         material;   // material of the arrangement face we belong to
 };
 
 #endif
\ No newline at end of file
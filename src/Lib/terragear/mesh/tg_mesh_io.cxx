@@ -4,6 +4,21 @@
 
 #include "tg_mesh.hxx"
 
+// drivers only need registering once per process - don't walk the driver
+// manager on every save.  The static is initialized by exactly one thread,
+// the others wait for it.
+static bool gdalRegister( void )
+{
+    GDALAllRegister();
+    return true;
+}
+
+void tgMesh::registerDrivers( void )
+{
+    static const bool registered = gdalRegister();
+    (void)registered;
+}
+
 GDALDataset* tgMesh::openDatasource( const std::string& datasource_name ) const
 {
     GDALDataset*    poDS = NULL;
@@ -12,7 +27,7 @@ GDALDataset* tgMesh::openDatasource( const std::string& datasource_name ) const
 
     SG_LOG( SG_GENERAL, SG_DEBUG, "Open Datasource: " << datasource_name );
 
-    GDALAllRegister();
+    registerDrivers();
 
     poDriver = GetGDALDriverManager()->GetDriverByName( format_name );
     if ( poDriver ) {    
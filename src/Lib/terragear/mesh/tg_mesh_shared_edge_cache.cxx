@@ -0,0 +1,200 @@
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include <terragear/tg_profile.hxx>
+
+#include "tg_mesh_shared_edge_cache.hxx"
+
+#define DEFAULT_SHARED_EDGE_CACHE_BUDGET    (128UL * 1024UL * 1024UL)
+
+tgSharedEdgeCache& tgSharedEdgeCache::instance( void )
+{
+    static tgSharedEdgeCache cache;
+
+    return cache;
+}
+
+tgSharedEdgeCache::tgSharedEdgeCache() :
+    budget(DEFAULT_SHARED_EDGE_CACHE_BUDGET),
+    bytesUsed(0),
+    peakBytes(0),
+    hits(0),
+    opens(0),
+    consumed(0),
+    evictions(0)
+{
+}
+
+void tgSharedEdgeCache::setBudget( size_t bytes )
+{
+    SGGuard<SGMutex> g( lock );
+
+    budget = bytes;
+    evict();
+}
+
+unsigned int tgSharedEdgeCache::numReaders( const SGBucket& b, edgeType edge )
+{
+    std::vector<SGBucket> across;
+
+    switch( edge ) {
+        case NORTH_EDGE:
+            b.siblings( 0, 1, across );
+            break;
+
+        case SOUTH_EDGE:
+            b.siblings( 0, -1, across );
+            break;
+
+        case EAST_EDGE:
+        case WEST_EDGE:
+            across.push_back( b );
+            break;
+    }
+
+    return 1 + across.size();
+}
+
+tgSharedEdgePtr tgSharedEdgeCache::get( const tgMeshTriangulation& tri, const std::string& file, const SGBucket& b, edgeType edge )
+{
+    {
+        tgProfileWait w( "edgeCache" );
+        lock.lock();
+    }
+
+    // another thread may still be reading it - and the last reader may
+    // drop it before we wake up
+    std::map<std::string, cacheEntry>::iterator it = entries.find( file );
+    while ( it != entries.end() && it->second.loading ) {
+        tgProfileWait w( "edgeCache" );
+        loaded.wait( lock );
+        it = entries.find( file );
+    }
+
+    if ( it != entries.end() ) {
+        hits++;
+
+        tgSharedEdgePtr nodes = it->second.nodes;
+        if ( it->second.remaining > 0 ) {
+            it->second.remaining--;
+        }
+        if ( it->second.remaining == 0 ) {
+            consumed++;
+            remove( it );
+        } else {
+            lruList.splice( lruList.begin(), lruList, it->second.lru );
+        }
+        lock.unlock();
+
+        return nodes;
+    }
+
+    // reserve the entry so other threads wait for us instead of reading it too
+    opens++;
+    it = entries.insert( std::make_pair( file, cacheEntry() ) ).first;
+    it->second.remaining = numReaders( b, edge ) - 1;
+    lruList.push_front( file );
+    it->second.lru = lruList.begin();
+    lock.unlock();
+
+    std::vector<meshVertexInfo>* points = new std::vector<meshVertexInfo>;
+    tri.fromShapefile( file, *points );
+    tgSharedEdgePtr nodes( points );
+
+    {
+        tgProfileWait w( "edgeCache" );
+        lock.lock();
+    }
+
+    // a missing file stays empty - reading it again won't help
+    it = entries.find( file );
+    it->second.nodes   = nodes;
+    it->second.bytes   = points->capacity() * sizeof(meshVertexInfo);
+    it->second.loading = false;
+
+    bytesUsed += it->second.bytes;
+    if ( bytesUsed > peakBytes ) {
+        peakBytes = bytesUsed;
+    }
+
+    if ( it->second.remaining == 0 ) {
+        consumed++;
+        remove( it );
+    }
+    evict();
+
+    loaded.broadcast();
+    lock.unlock();
+
+    return nodes;
+}
+
+// called with the lock held
+void tgSharedEdgeCache::remove( std::map<std::string, cacheEntry>::iterator it )
+{
+    bytesUsed -= it->second.bytes;
+
+    lruList.erase( it->second.lru );
+    entries.erase( it );
+}
+
+// called with the lock held
+void tgSharedEdgeCache::evict( void )
+{
+    std::list<std::string>::iterator lit = lruList.end();
+
+    while ( bytesUsed > budget && lit != lruList.begin() ) {
+        --lit;
+
+        std::map<std::string, cacheEntry>::iterator it = entries.find( *lit );
+
+        // keep edges being read, or still held by a caller
+        if ( it->second.loading || it->second.nodes.use_count() > 1 ) {
+            continue;
+        }
+
+        bytesUsed -= it->second.bytes;
+        evictions++;
+
+        lit = lruList.erase( lit );
+        entries.erase( it );
+    }
+}
+
+size_t tgSharedEdgeCache::getBudget( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return budget;
+}
+
+unsigned long tgSharedEdgeCache::getHits( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return hits;
+}
+
+unsigned long tgSharedEdgeCache::getOpens( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return opens;
+}
+
+unsigned long tgSharedEdgeCache::getEvictions( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return evictions;
+}
+
+void tgSharedEdgeCache::report( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+
+    unsigned long lookups = hits + opens;
+    double saved = lookups ? 100.0 * hits / lookups : 0.0;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Shared edge cache: " << lookups << " lookups, " <<
+                                  opens << " files read, " << hits << " shared, " <<
+                                  "opens saved " << saved << "%, " <<
+                                  consumed << " used up, " << evictions << " evictions, " <<
+                                  "peak " << peakBytes / 1024 << " KB of " << budget / (1024*1024) << " MB" );
+}
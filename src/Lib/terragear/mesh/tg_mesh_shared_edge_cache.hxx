@@ -0,0 +1,81 @@
+#ifndef __TG_MESH_SHARED_EDGE_CACHE_HXX__
+#define __TG_MESH_SHARED_EDGE_CACHE_HXX__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+#include "tg_mesh.hxx"
+
+// Process wide cache of the stage 1 shared edge nodes, for stage 2.
+//
+// Every edge file is read by its own tile, and by the tile(s) across the
+// edge - a northern or southern edge by every bucket across it.  The
+// first request reads the file, the rest share the nodes, and once all of
+// those tiles had theirs, the entry is dropped.  Entries of tiles outside
+// the run, or without land, are never used up - over budget, the least
+// recently used entries nobody holds are dropped first.  Concurrent
+// requests for the same edge wait for a single read.
+typedef boost::shared_ptr<const std::vector<meshVertexInfo> > tgSharedEdgePtr;
+
+class tgSharedEdgeCache
+{
+public:
+    static tgSharedEdgeCache& instance( void );
+
+    // nodes of edge of bucket b, saved in file - read with tri
+    tgSharedEdgePtr get( const tgMeshTriangulation& tri, const std::string& file, const SGBucket& b, edgeType edge );
+
+    void   setBudget( size_t bytes );
+    size_t getBudget( void ) const;
+
+    // taken under the lock, like report()
+    unsigned long getHits( void ) const;
+    unsigned long getOpens( void ) const;
+    unsigned long getEvictions( void ) const;
+
+    // log counters, opens saved and memory high water mark
+    void report( void ) const;
+
+private:
+    tgSharedEdgeCache();
+
+    struct cacheEntry {
+        cacheEntry() : bytes(0), remaining(0), loading(true) {}
+
+        tgSharedEdgePtr                     nodes;
+        size_t                              bytes;
+        unsigned int                        remaining;  // tiles still to read it
+        bool                                loading;
+        std::list<std::string>::iterator    lru;
+    };
+
+    // the tiles reading edge of b
+    static unsigned int numReaders( const SGBucket& b, edgeType edge );
+
+    void remove( std::map<std::string, cacheEntry>::iterator it );
+    void evict( void );
+
+    mutable SGMutex                     lock;
+    SGWaitCondition                     loaded;
+
+    std::map<std::string, cacheEntry>   entries;
+    std::list<std::string>              lruList;    // most recently used first
+
+    size_t                              budget;
+    size_t                              bytesUsed;
+    size_t                              peakBytes;
+
+    unsigned long                       hits;
+    unsigned long                       opens;
+    unsigned long                       consumed;
+    unsigned long                       evictions;
+};
+
+#endif /* __TG_MESH_SHARED_EDGE_CACHE_HXX__ */
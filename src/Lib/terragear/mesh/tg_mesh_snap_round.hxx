@@ -0,0 +1,54 @@
+#ifndef __TG_MESH_SNAP_ROUND_HXX__
+#define __TG_MESH_SNAP_ROUND_HXX__
+
+#include <map>
+#include <vector>
+
+#include "tg_mesh_def.hxx"
+
+// Iterated snap rounding of one tile's arrangement edges onto an integer
+// grid of square pixels.
+//
+// Pixels are centered on the lattice points i * pixelSize.  Every pixel
+// containing an arrangement vertex is 'hot'.  Each edge is replaced by the
+// polyline through the centers of the hot pixels it touches, and every
+// piece of that polyline is rerouted again through any further hot pixels
+// it touches, until nothing changes.  The result has no crossings other
+// than at shared endpoints.
+//
+// All state lives in the instance, and the predicates are exact, so tiles
+// may be rounded concurrently from different threads.
+class tgMeshSnapRound
+{
+public:
+    tgMeshSnapRound( double size );
+
+    void addHotPixel( const meshArrPoint& pt );
+    unsigned int getNumHotPixels( void ) const { return numHotPixels; }
+
+    // center of the pixel the point lies in
+    meshArrPoint snap( const meshArrPoint& pt ) const;
+
+    // the hot pixel centers the segment is routed through, source first.
+    // a segment collapsing into a single pixel gives a single point.
+    void round( const meshArrSegment& seg, std::vector<meshArrPoint>& polyline ) const;
+
+private:
+    typedef std::pair<long long, long long> pixelKey;
+
+    pixelKey     toPixel( const meshArrPoint& pt ) const;
+    long long    toPixel( const meshArr_FT& v, double d ) const;
+    meshArrPoint toCenter( const pixelKey& p ) const;
+    meshArr_FT   pixelEdge( long long i ) const;
+
+    bool intersects( const meshArrPoint& s, const meshArrPoint& t, const pixelKey& p ) const;
+    void findHotPixels( const meshArrPoint& s, const meshArrPoint& t, std::vector<pixelKey>& hot ) const;
+
+    double                                      pixelSize;
+    unsigned int                                numHotPixels;
+
+    // hot pixels, bucketed into coarse cells of CELL_SIZE x CELL_SIZE pixels
+    std::map< pixelKey, std::vector<pixelKey> > cells;
+};
+
+#endif /* __TG_MESH_SNAP_ROUND_HXX__ */
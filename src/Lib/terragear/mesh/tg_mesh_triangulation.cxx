@@ -1,4 +1,10 @@
 #include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <CGAL/centroid.h>
+
+#include <terragear/tg_profile.hxx>
 
 #include "tg_mesh.hxx"
 
@@ -8,6 +14,101 @@
 
 #define TRACE_MESH_TRIANGULATION            SG_DEBUG
 
+#define REFINE_STEPS_PER_CLOCK_CHECK        (1024)
+
+bool          tgMeshTriangulation::validate            = false;
+unsigned int  tgMeshTriangulation::refineMaxPoints     = DEFAULT_REFINE_MAX_POINTS;
+double        tgMeshTriangulation::refineMaxSeconds    = 0.0;
+
+SGMutex       tgMeshTriangulation::refineLock;
+unsigned long tgMeshTriangulation::refineSteinerPoints = 0;
+unsigned long tgMeshTriangulation::refineCount         = 0;
+unsigned long tgMeshTriangulation::refineStopped       = 0;
+
+void tgMeshTriangulation::setValidate( bool v )
+{
+    validate = v;
+}
+
+void tgMeshTriangulation::setRefineBudget( unsigned int maxPoints, double maxSeconds )
+{
+    refineMaxPoints  = maxPoints;
+    refineMaxSeconds = maxSeconds;
+}
+
+void tgMeshTriangulation::reportRefinement( void )
+{
+    SGGuard<SGMutex> g( refineLock );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Mesh refinement: " << refineCount << " triangulations refined, " <<
+                                  refineSteinerPoints << " Steiner points added, " <<
+                                  refineStopped << " stopped at the budget" );
+}
+
+// true when not validating - the triangulation was valid every time
+// anyone looked
+bool tgMeshTriangulation::isValid( const char* when ) const
+{
+    if ( !validate ) {
+        return true;
+    }
+
+    bool valid = meshTriangulation.is_valid();
+    if ( !valid ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMesh::constrainedTriangulate " << mesh->getBucket().gen_index_str() << " - triangulation " << when << " is not valid" );
+    }
+
+    return valid;
+}
+
+// refine until mesher is done, or out of budget - when stopped early, the
+// triangulation is still a valid CDT, just coarser than asked for.
+template <class Mesher>
+static unsigned int refineWithinBudget( meshTriCDT& cdt, Mesher& mesher, unsigned int maxPoints, double maxSeconds, bool& stopped, double& secs )
+{
+    unsigned int    start = cdt.number_of_vertices();
+    unsigned int    steps = 0;
+    SGTimeStamp     t;
+
+    t.stamp();
+    stopped = false;
+
+    mesher.init();
+    while ( mesher.step_by_step_refine_mesh() ) {
+        if ( maxPoints && cdt.number_of_vertices() - start >= maxPoints ) {
+            stopped = true;
+            break;
+        }
+
+        if ( maxSeconds > 0.0 && ++steps % REFINE_STEPS_PER_CLOCK_CHECK == 0 && t.elapsedUSec() > maxSeconds * 1000000.0 ) {
+            stopped = true;
+            break;
+        }
+    }
+
+    secs = t.elapsedUSec() / 1000000.0;
+
+    return cdt.number_of_vertices() - start;
+}
+
+void tgMeshTriangulation::refined( const char* stage, unsigned int steinerPoints, bool stopped, double secs ) const
+{
+    tgProfile::count( "steinerPoints", steinerPoints );
+
+    if ( stopped ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMesh::constrainedTriangulate " << mesh->getBucket().gen_index_str() << " - " << stage <<
+                                      " refinement stopped at the budget after " << steinerPoints << " Steiner points, " << secs << " s" );
+    }
+
+    SGGuard<SGMutex> g( refineLock );
+
+    refineSteinerPoints += steinerPoints;
+    refineCount++;
+    if ( stopped ) {
+        refineStopped++;
+    }
+}
+
 void tgMeshTriangulation::constrainedTriangulateWithEdgeModification( const tgMeshArrangement& arr )
 {
     std::vector<meshTriPoint>   points;
@@ -34,15 +135,13 @@ void tgMeshTriangulation::constrainedTriangulateWithEdgeModification( const tgMe
     meshTriangulation.insert_constraints( constraints.begin(), constraints.end() );
     meshTriangulation.insert( points.begin(), points.end() );
 
-    SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate - valid? " << 
-                                 (meshTriangulation.is_valid() ? "yes, and has " : "no, and has ") << 
-                                  meshTriangulation.number_of_faces() << " faces ");
+    SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate - has " << meshTriangulation.number_of_faces() << " faces ");
 
 #if DEBUG_MESH_TRIANGULATION    
     toShapefile( mesh->getDebugPath(), "stage1_pre_refined_triangulation", false );
 #endif
 
-    if ( meshTriangulation.is_valid() ) {        
+    if ( isValid( "before refining" ) ) {
 #if DEBUG_MESH_TRIANGULATION_DATAFILE_2 
         writeCdtFile2( "./output_cdt2.txt", meshTriangulation );
 #endif
@@ -59,7 +158,10 @@ void tgMeshTriangulation::constrainedTriangulateWithEdgeModification( const tgMe
         mesher.set_criteria(meshCriteria(0.1, 0.5));
 
         SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate - refine mesh" );
-        mesher.refine_mesh();
+        bool         stopped;
+        double       secs;
+        unsigned int steinerPoints = refineWithinBudget( meshTriangulation, mesher, refineMaxPoints, refineMaxSeconds, stopped, secs );
+        refined( "stage1", steinerPoints, stopped, secs );
 
         SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate - refined mesh number of faces: " << meshTriangulation.number_of_faces() );
 
@@ -74,51 +176,19 @@ void tgMeshTriangulation::constrainedTriangulateWithEdgeModification( const tgMe
 
 void tgMeshTriangulation::constrainedTriangulateWithoutEdgeModification( const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints )
 {
-    SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate before adding new nodes - valid? " << 
-        (meshTriangulation.is_valid() ? "yes, and has " : "no, and has ") << meshTriangulation.number_of_faces() << " faces ");
-
-    // first, let's move each node ( remove - and add back.  - this invalidates all the mappings
-    // if a vertex is incident to a constrained edge, we need to remove the constraint, then re-add once new vertex is added.
-    for( unsigned int i=0; i<movedPoints.size(); i++ )
-    {
-        // first, gather the constrained edges.  in debug mode, CGAL will assert if any incident edges are constrained
-        std::vector<meshTriEdge>            constrainedEdges;
-        std::vector<meshTriVertexHandle>    constrainedEndpoints;
-
-        meshTriVertexHandle target = movedPoints[i].oldPositionHandle;
-        meshTriangulation.incident_constraints( target, std::back_inserter( constrainedEdges ) );
-
-        // save vertex handle to the other end of each constraint.
-        for ( unsigned int j=0; j<constrainedEdges.size(); j++ ) {
-            meshTriFaceHandle   face  = constrainedEdges[j].first;
-            int                 index = constrainedEdges[j].second;
-
-            constrainedEndpoints.push_back( face->vertex( face->ccw(index) ) );
-            meshTriangulation.remove_constrained_edge( face, index );
-        }
-
-        SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate node to remove has " << constrainedEdges.size() << " constrained edges." ); 
-
-        meshTriangulation.remove( movedPoints[i].oldPositionHandle );
-        target = meshTriangulation.insert( movedPoints[i].newPosition );
-
-        for ( unsigned int j=0; j<constrainedEndpoints.size(); j++ ) {
-            meshTriangulation.insert_constraint( constrainedEndpoints[j], target );
-        }
-    }
+    SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate before adding new nodes - has " << meshTriangulation.number_of_faces() << " faces ");
+    isValid( "before adding new nodes" );
 
-    // now add new nodes
-    SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate adding " << addedPoints.size() << " nodes" );
-    meshTriangulation.insert( addedPoints.begin(), addedPoints.end() );
+    // move the matched nodes, and add the new ones
+    relocateNodes( movedPoints, addedPoints );
 
-    SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate after adding new nodes - valid? " << 
-        (meshTriangulation.is_valid() ? "yes, and has " : "no, and has ") << meshTriangulation.number_of_faces() << " faces ");
+    SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate after adding new nodes - has " << meshTriangulation.number_of_faces() << " faces ");
 
 #if DEBUG_MESH_TRIANGULATION    
     toShapefile( mesh->getDebugPath(), "stage2_pre_refined_triangulation", false );
 #endif
 
-    if ( meshTriangulation.is_valid() ) {
+    if ( isValid( "after adding new nodes" ) ) {
 #if DEBUG_MESH_TRIANGULATION_DATAFILE_2 
         writeCdtFile2( "./output_cdt2.txt", meshTriangulation );
 #endif
@@ -134,7 +204,10 @@ void tgMeshTriangulation::constrainedTriangulateWithoutEdgeModification( const s
         mesher.set_criteria(meshCriteria(0.1, 0.5));
 
         SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate - refine mesh" );
-        mesher.refine_mesh();
+        bool         stopped;
+        double       secs;
+        unsigned int steinerPoints = refineWithinBudget( meshTriangulation, mesher, refineMaxPoints, refineMaxSeconds, stopped, secs );
+        refined( "stage2", steinerPoints, stopped, secs );
 
         SG_LOG( SG_GENERAL, TRACE_MESH_TRIANGULATION, "tgMesh::constrainedTriangulate - refined mesh number of faces: " << meshTriangulation.number_of_faces() );
 
@@ -145,7 +218,7 @@ void tgMeshTriangulation::constrainedTriangulateWithoutEdgeModification( const s
 }
 
 // given a mesh face - mark all triangle faces within the constrained boundaries with the face handle from the arrangement
-void tgMeshTriangulation::markDomains(meshTriFaceHandle start, meshArrFaceConstHandle face, std::list<meshTriEdge>& border )
+void tgMeshTriangulation::markDomains(meshTriFaceHandle start, meshArrFaceConstHandle face, const std::string& material, std::list<meshTriEdge>& border )
 {
     if( start->info().isVisited() ) {
         return;
@@ -163,7 +236,7 @@ void tgMeshTriangulation::markDomains(meshTriFaceHandle start, meshArrFaceConstH
         if( !fh->info().isVisited() ) {
             // if it hasn't been handled yet
             // set it's face information
-            fh->info().setFace( face );
+            fh->info().setFace( face, material );
 
             // then check all three of the triangles edges
             for(int i = 0; i < 3; i++) {
@@ -216,7 +289,7 @@ void tgMeshTriangulation::markDomains( const tgMeshArrangement& arr )
     // first, mark all triangles on the arrangement infinite face with NULL.
     // this tells us that these triangles are junk, and will not be part of the final 
     // mesh
-    markDomains(meshTriangulation.infinite_face(), face, border);
+    markDomains(meshTriangulation.infinite_face(), face, "", border);
 
     // all edges that were constrained on the last boundary are then checked
     while( !border.empty() ) {
@@ -235,7 +308,7 @@ void tgMeshTriangulation::markDomains( const tgMeshArrangement& arr )
 
             // get face handle for point inside this facet
             face = arr.findMeshFace( CGAL::centroid(tri) );
-            markDomains(n, face, border);
+            markDomains(n, face, arr.getMaterial( face ), border);
         }
     }
 }
@@ -73,6 +73,9 @@ typedef CGAL::Search_traits_adapter<findVertexData,CGAL::Nth_of_tuple_property_m
 typedef CGAL::Fuzzy_iso_box<findVertexTraits>                                                                                           findVertexFuzzyBox;
 typedef CGAL::Kd_tree<findVertexTraits>                                                                                                 findVertexTree;
 
+// default refinement budget - Steiner points per triangulation
+#define DEFAULT_REFINE_MAX_POINTS   (1000000)
+
 class tgMeshTriangulation
 {
 public:
@@ -81,9 +84,46 @@ public:
     void constrainedTriangulateWithEdgeModification( const tgMeshArrangement& arr );
     void constrainedTriangulateWithoutEdgeModification( const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints );
 
+    // full is_valid() checks of the triangulation before refining - O(n),
+    // so off unless debugging
+    static void setValidate( bool v );
+
+    // refinement budget per triangulation - stop refining after maxPoints
+    // Steiner points, or maxSeconds.  0 for no limit.  A time limit makes
+    // the output depend on the machine, so by default only points are.
+    static void setRefineBudget( unsigned int maxPoints, double maxSeconds );
+
+    // log Steiner points added, and triangulations stopped at the budget
+    static void reportRefinement( void );
+
+    // how stage 2 moves the matched edge nodes, and adds the new ones - one
+    // vertex at a time, rebuilding the whole triangulation with them in
+    // place, whichever is cheaper for the number of nodes, or both,
+    // logging where their constraints differ
+    typedef enum {
+        RELOCATE_AUTO,
+        RELOCATE_INCREMENTAL,
+        RELOCATE_REBUILD,
+        RELOCATE_VERIFY
+    } relocateMethod;
+
+    static void setRelocateMethod( relocateMethod m );
+
+    // the relocators, on any triangulation.  The rebuild keeps the vertex
+    // info of every vertex, and the face materials of every constrained
+    // region.
+    static void relocateIncremental( meshTriCDT& cdt, const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints );
+    static void relocateRebuild( meshTriCDT& cdt, const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints );
+
+    // same vertex count and constrained edges
+    static bool sameConstraints( const meshTriCDT& a, const meshTriCDT& b );
+
     void clearDomains(void);
     void markDomains( const tgMeshArrangement& arr );
-    void markDomains(meshTriFaceHandle start, meshArrFaceConstHandle face, std::list<meshTriEdge>& border );
+    void markDomains(meshTriFaceHandle start, meshArrFaceConstHandle face, const std::string& material, std::list<meshTriEdge>& border );
+
+    unsigned int getNumTriangles( void ) const { return meshTriangulation.number_of_faces(); }
+    unsigned int getNumVertices( void ) const  { return meshTriangulation.number_of_vertices(); }
 
     void clear( void ) {
         meshTriangulation.clear();
@@ -97,6 +137,26 @@ public:
     // 2d triangulation shared edge matching - match current and neighbot nodes
     void matchNodes( edgeType edge, std::vector<meshVertexInfo>& current, std::vector<meshVertexInfo>& neighbor, std::vector<meshTriPoint>& addedNodes, std::vector<movedNode>& movedNodes );
 
+    // how matchNodes matches - merging the edges sorted along them, with
+    // the kd-trees it used to, or both, logging where they differ
+    typedef enum {
+        MATCH_NODES_MERGE,
+        MATCH_NODES_KDTREE,
+        MATCH_NODES_VERIFY
+    } matchNodesMethod;
+
+    static void setMatchNodesMethod( matchNodesMethod m );
+
+    // the matchers, without a triangulation - handles maps the ids of the
+    // current nodes to their vertexes.  The merge wants both edges sorted
+    // along the edge, as loadTriangulation leaves them - it sorts copies
+    // if they aren't.
+    static void matchNodesKdTree( const std::vector<meshVertexInfo>& current, const std::vector<meshVertexInfo>& neighbor, const std::map<int, meshTriVertexHandle>& handles, std::vector<meshTriPoint>& addedNodes, std::vector<movedNode>& movedNodes );
+    static void matchNodesMerge( edgeType edge, const std::vector<meshVertexInfo>& current, const std::vector<meshVertexInfo>& neighbor, const std::map<int, meshTriVertexHandle>& handles, std::vector<meshTriPoint>& addedNodes, std::vector<movedNode>& movedNodes );
+
+    // same nodes added and moved, in any order
+    static bool sameMatch( std::vector<meshTriPoint> addedA, std::vector<movedNode> movedA, std::vector<meshTriPoint> addedB, std::vector<movedNode> movedB );
+
     bool loadTriangulation( const std::string& path, const SGBucket& bucket );
 
 
@@ -139,12 +199,21 @@ public:
     // loading stage 1 triangulation 
     void fromShapefile( const std::string& filename, std::vector<meshFaceInfo>& faces ) const;
 
+    // the TDS is saved between stages in a binary file ( tds.bin ) that is
+    // mapped on load.  The shapefile version is a debug export, though it
+    // can still be loaded if no binary file exists.
     bool loadTds( const std::string& bucketPath );
+    bool loadTdsBinary( const std::string& filename );
+    bool loadTdsShapefile( const std::string& bucketPath );
 
     void prepareTds( void );
     void saveTds( const std::string& bucketPath ) const;
+    void saveTdsBinary( const std::string& filename ) const;
+    void saveTdsShapefile( const std::string& bucketPath ) const;
 
 private:
+    bool buildTds( const std::vector<meshVertexInfo>& points, const std::vector<meshFaceInfo>& faces );
+
     void loadStage1SharedEdge( const std::string& p, const SGBucket& b, edgeType edge, std::vector<meshVertexInfo>& points );
     void sortByLat( std::vector<meshVertexInfo>& points ) const;
     void sortByLon( std::vector<meshVertexInfo>& points ) const;
@@ -162,11 +231,28 @@ private:
 
     void saveEdgeBoundingBox( const meshTriPoint& lr, const meshTriPoint& ll, const meshTriPoint& ul, const meshTriPoint& ur, const char* name ) const;
 
+    bool isValid( const char* when ) const;
+    void relocateNodes( const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints );
+    void refined( const char* stage, unsigned int steinerPoints, bool stopped, double secs ) const;
+
     // CGAL debugging - save triangulation that can be read byt cgal_tri_test app - for reporting issues upstream
     void writeCdtFile(  const char* filename, std::vector<meshTriPoint>& points,  std::vector<meshTriSegment>& constraints ) const;
     void writeCdtFile2( const char* filename, const meshTriCDT& cdt) const;
 
 private:
+    static matchNodesMethod                         matchMethod;
+
+    static relocateMethod                           relocMethod;
+
+    static bool                                     validate;
+    static unsigned int                             refineMaxPoints;
+    static double                                   refineMaxSeconds;
+
+    static SGMutex                                  refineLock;
+    static unsigned long                            refineSteinerPoints;
+    static unsigned long                            refineCount;
+    static unsigned long                            refineStopped;
+
     // data
     tgMesh*                                         mesh;
     meshTriCDT                                      meshTriangulation;    
@@ -141,7 +141,7 @@ void tgMeshTriangulation::fromShapefile( const OGRFeatureDefn* poFDefn, OGRCoord
 // load all meshTriPoints from all layers of a shapefile
 void tgMeshTriangulation::fromShapefile( const std::string& filename, std::vector<meshVertexInfo>& points ) const
 {
-    GDALAllRegister();
+    tgMesh::registerDrivers();
 
     GDALDataset* poDS = (GDALDataset*)GDALOpenEx( filename.c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL );
     if( poDS == NULL )
@@ -184,7 +184,7 @@ void tgMeshTriangulation::fromShapefile( const std::string& filename, std::vecto
 
 void tgMeshTriangulation::fromShapefile( const std::string& filename, std::vector<meshFaceInfo>& faces ) const
 {
-    GDALAllRegister();
+    tgMesh::registerDrivers();
 
     GDALDataset* poDS = (GDALDataset*)GDALOpenEx( filename.c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL );
     if( poDS == NULL )
@@ -430,7 +430,8 @@ void tgMeshTriangulation::toShapefile( const std::string& datasource, const char
     }
 }
 
-void tgMeshTriangulation::saveTds( const std::string& bucketPath ) const
+// debug export of the TDS - the binary format is what's used between stages
+void tgMeshTriangulation::saveTdsShapefile( const std::string& bucketPath ) const
 {
     GDALDataset*  poDS = NULL;
     OGRLayer*     poPointLayer = NULL;
@@ -461,16 +462,12 @@ void tgMeshTriangulation::saveTds( const std::string& bucketPath ) const
     }
 }
 
-bool tgMeshTriangulation::loadTds( const std::string& bucketPath )
+bool tgMeshTriangulation::loadTdsShapefile( const std::string& bucketPath )
 {
     // load the tile points
     std::vector<meshVertexInfo>   points;
     std::vector<meshFaceInfo>     faces;
     std::string                   filePath;
-    bool                          hasLand = false;
-
-    meshTriTDS& tds = meshTriangulation.tds();
-    tds.clear();
 
     // load vertices, and save their handles in V
     filePath = bucketPath + "/tds_points.shp"; 
@@ -479,6 +476,17 @@ bool tgMeshTriangulation::loadTds( const std::string& bucketPath )
     filePath = bucketPath + "/tds_faces.shp"; 
     fromShapefile( filePath, faces );
 
+    return buildTds( points, faces );
+}
+
+// generate the TDS from the saved vertex and face info
+bool tgMeshTriangulation::buildTds( const std::vector<meshVertexInfo>& points, const std::vector<meshFaceInfo>& faces )
+{
+    bool                          hasLand = false;
+
+    meshTriTDS& tds = meshTriangulation.tds();
+    tds.clear();
+
     if (!points.empty() && !faces.empty()) {
         SG_LOG(SG_GENERAL, SG_DEBUG, "loadTDS from " << points.size() << " points and " << faces.size() << " faces" );
         SG_LOG(SG_GENERAL, SG_DEBUG, "loadTDS - begin valid: " << tds.is_valid() << " dimension: " << tds.dimension() << " verts: " << tds.number_of_vertices() );
@@ -499,8 +507,6 @@ bool tgMeshTriangulation::loadTds( const std::string& bucketPath )
 
             tds.set_dimension(2);
 
-            //std::vector<meshTriTDS::Vertex_handle> V(n+1);
-            //std::vector<meshTriTDS::Face_handle>   F(m);
             vertexIndexToHandleMap.clear();
             faceIndexToHandleMap.clear();
 
@@ -515,20 +521,28 @@ bool tgMeshTriangulation::loadTds( const std::string& bucketPath )
                 vertexIndexToHandleMap[index] = tds.create_vertex();
                 if (index) {
                     vertexIndexToHandleMap[index]->set_point( points[i].getPoint() );
+                    vertexIndexToHandleMap[index]->info().setElevation( points[i].getZ() );
                 }
             }
 
             for( i = 0; i < m; i++ ) {
                 int fid = faces[i].getFid();
 
-                faceIndexToHandleMap[fid] = tds.create_face();
+                meshTriFaceHandle fh = tds.create_face();
+                faceIndexToHandleMap[fid] = fh;
+
                 for(int j = 0; j < 3; j++){
                     int vid = faces[i].getVid(j);
-                    faceIndexToHandleMap[fid]->set_vertex(j, vertexIndexToHandleMap[vid]);
+                    fh->set_vertex(j, vertexIndexToHandleMap[vid]);
                     // The face pointer of vertices is set too often,
                     // but otherwise we had to use a further map
-                    vertexIndexToHandleMap[vid]->set_face( faceIndexToHandleMap[fid] );
+                    vertexIndexToHandleMap[vid]->set_face( fh );
+                }
+
+                for ( int j=0; j<3; j++ ) {
+                    fh->set_constraint(j, faces[i].getConstrained(j) ? true:false);
                 }
+                fh->info().setMaterial( faces[i].getMaterial() );
             }
 
             // Setting the neighbor pointers 
@@ -543,18 +557,8 @@ bool tgMeshTriangulation::loadTds( const std::string& bucketPath )
 
             meshTriangulation.set_infinite_vertex(vertexIndexToHandleMap[0]);
 
-            meshTriCDT::All_faces_iterator fit, fit_end;
-            int i;
-            for ( fit = meshTriangulation.all_faces_begin(), fit_end = meshTriangulation.all_faces_end(), i = 0; fit != fit_end; fit++, i++ ) {
-                for ( int j=0; j<3; j++ ) {
-                    bool con = faces[i].getConstrained(j) ? true:false;
-                    fit->set_constraint(j, con?true:false);
-                }
-            }
-
-            SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTDS - COMPLETE TDS valid: " << tds.is_valid() << " dimension: " << tds.dimension() << " verts: " << tds.number_of_vertices() );
-            meshTriangulation.is_valid(true);
-
+            SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTDS - COMPLETE TDS dimension: " << tds.dimension() << " verts: " << tds.number_of_vertices() );
+            isValid( "after loading" );
         }
     }
 
@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <list>
+#include <utility>
+
+#include <simgear/debug/logstream.hxx>
+
+#include <CGAL/centroid.h>
+#include <CGAL/property_map.h>
+#include <CGAL/spatial_sort.h>
+#include <CGAL/Spatial_sort_traits_adapter_2.h>
+
+#include <terragear/tg_profile.hxx>
+
+#include "tg_mesh.hxx"
+
+// rebuild instead of moving vertexes one at a time once the moved and
+// added nodes are more than 1 / RELOCATE_REBUILD_RATIO of the vertexes
+#define RELOCATE_REBUILD_RATIO  (32)
+
+typedef CGAL::Spatial_sort_traits_adapter_2<meshTriKernel, CGAL::Pointer_property_map<meshTriPoint>::type>  relocateSortTraits;
+typedef std::pair<meshTriPoint, meshTriPoint>                                                               relocateSegment;
+
+// a face in each constrained region, to find the region again after the
+// rebuild
+struct materialSeed {
+    materialSeed( const meshTriPoint& p, const std::string& m ) : point(p), material(m) {}
+
+    meshTriPoint    point;
+    std::string     material;
+};
+
+tgMeshTriangulation::relocateMethod tgMeshTriangulation::relocMethod = tgMeshTriangulation::RELOCATE_AUTO;
+
+void tgMeshTriangulation::setRelocateMethod( relocateMethod m )
+{
+    relocMethod = m;
+}
+
+void tgMeshTriangulation::relocateNodes( const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints )
+{
+    relocateMethod method = relocMethod;
+
+    if ( method == RELOCATE_AUTO ) {
+        if ( ( movedPoints.size() + addedPoints.size() ) * RELOCATE_REBUILD_RATIO > meshTriangulation.number_of_vertices() ) {
+            method = RELOCATE_REBUILD;
+        } else {
+            method = RELOCATE_INCREMENTAL;
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_DEBUG, "tgMesh::constrainedTriangulate moving " << movedPoints.size() << " and adding " << addedPoints.size() << " nodes - " <<
+                                  ( method == RELOCATE_REBUILD ? "rebuild" : method == RELOCATE_INCREMENTAL ? "incremental" : "verify" ) );
+
+    switch( method ) {
+        case RELOCATE_INCREMENTAL:
+            relocateIncremental( meshTriangulation, movedPoints, addedPoints );
+            tgProfile::count( "relocateIncremental", 1 );
+            break;
+
+        case RELOCATE_REBUILD:
+            relocateRebuild( meshTriangulation, movedPoints, addedPoints );
+            tgProfile::count( "relocateRebuild", 1 );
+            break;
+
+        case RELOCATE_VERIFY:
+        default:
+        {
+            // rebuild a copy - the moved handles are the original's
+            meshTriCDT              check( meshTriangulation );
+            std::vector<movedNode>  checkMoved;
+
+            for ( unsigned int i=0; i<movedPoints.size(); i++ ) {
+                meshTriVertexHandle vh;
+                if ( check.is_vertex( movedPoints[i].oldPosition, vh ) ) {
+                    checkMoved.push_back( movedNode( vh, movedPoints[i].oldPosition, movedPoints[i].newPosition ) );
+                }
+            }
+
+            relocateRebuild( check, checkMoved, addedPoints );
+            relocateIncremental( meshTriangulation, movedPoints, addedPoints );
+
+            if ( !sameConstraints( meshTriangulation, check ) ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "tgMesh::constrainedTriangulate " << mesh->getBucket().gen_index_str() << " - rebuild and incremental relocation differ" );
+            }
+            break;
+        }
+    }
+}
+
+static void materialSeeds( meshTriCDT& cdt, const CGAL::Unique_hash_map<meshTriVertexHandle, int>& moved, std::vector<materialSeed>& seeds );
+static void restoreMaterials( meshTriCDT& cdt, const std::vector<materialSeed>& seeds );
+
+// remove each moved vertex, and insert it at its new position.  if a vertex
+// is incident to a constrained edge, we need to remove the constraint, then
+// re-add once new vertex is added.  The faces created around it have no
+// material - restore them the way the rebuild does.
+void tgMeshTriangulation::relocateIncremental( meshTriCDT& cdt, const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints )
+{
+    CGAL::Unique_hash_map<meshTriVertexHandle, int> moved( -1 );
+    for ( unsigned int i=0; i<movedPoints.size(); i++ ) {
+        moved[movedPoints[i].oldPositionHandle] = i;
+    }
+
+    std::vector<materialSeed> seeds;
+    materialSeeds( cdt, moved, seeds );
+
+    for( unsigned int i=0; i<movedPoints.size(); i++ )
+    {
+        // first, gather the constrained edges.  in debug mode, CGAL will assert if any incident edges are constrained
+        std::vector<meshTriEdge>            constrainedEdges;
+        std::vector<meshTriVertexHandle>    constrainedEndpoints;
+
+        meshTriVertexHandle target = movedPoints[i].oldPositionHandle;
+        cdt.incident_constraints( target, std::back_inserter( constrainedEdges ) );
+
+        // save vertex handle to the other end of each constraint.
+        for ( unsigned int j=0; j<constrainedEdges.size(); j++ ) {
+            meshTriFaceHandle   face  = constrainedEdges[j].first;
+            int                 index = constrainedEdges[j].second;
+
+            constrainedEndpoints.push_back( face->vertex( face->ccw(index) ) );
+            cdt.remove_constrained_edge( face, index );
+        }
+
+        SG_LOG( SG_GENERAL, SG_DEBUG, "tgMesh::constrainedTriangulate node to remove has " << constrainedEdges.size() << " constrained edges." );
+
+        // a neighbor to start looking for the new position from
+        meshTriVertexHandle     neighbor;
+        meshTriCDT::Vertex_circulator vc = cdt.incident_vertices( target ), done( vc );
+        if ( vc != 0 ) {
+            do {
+                if ( !cdt.is_infinite( vc ) ) {
+                    neighbor = vc;
+                    break;
+                }
+            } while ( ++vc != done );
+        }
+
+        tgMeshVertexInfo info = target->info();
+
+        cdt.remove( target );
+        target = cdt.insert( movedPoints[i].newPosition, neighbor != meshTriVertexHandle() ? neighbor->face() : meshTriFaceHandle() );
+        target->info() = info;
+
+        for ( unsigned int j=0; j<constrainedEndpoints.size(); j++ ) {
+            cdt.insert_constraint( constrainedEndpoints[j], target );
+        }
+    }
+
+    // now add new nodes
+    cdt.insert( addedPoints.begin(), addedPoints.end() );
+
+    restoreMaterials( cdt, seeds );
+}
+
+// one face of every region bounded by constraints with a material - away
+// from the moved vertexes where we can, so it is still in the region once
+// they move
+static void materialSeeds( meshTriCDT& cdt, const CGAL::Unique_hash_map<meshTriVertexHandle, int>& moved, std::vector<materialSeed>& seeds )
+{
+    CGAL::Unique_hash_map<meshTriFaceHandle, bool> visited( false );
+
+    for ( meshTriCDT::Finite_faces_iterator fit = cdt.finite_faces_begin(); fit != cdt.finite_faces_end(); fit++ ) {
+        meshTriFaceHandle start = fit;
+        if ( visited[start] ) {
+            continue;
+        }
+
+        meshTriFaceHandle               seed;
+        std::list<meshTriFaceHandle>    queue;
+
+        visited[start] = true;
+        queue.push_back( start );
+
+        while ( !queue.empty() ) {
+            meshTriFaceHandle fh = queue.front();
+            queue.pop_front();
+
+            if ( seed == meshTriFaceHandle() &&
+                 moved[fh->vertex(0)] < 0 && moved[fh->vertex(1)] < 0 && moved[fh->vertex(2)] < 0 ) {
+                seed = fh;
+            }
+
+            for ( int i=0; i<3; i++ ) {
+                meshTriFaceHandle n = fh->neighbor(i);
+
+                if ( !cdt.is_infinite( n ) && !visited[n] && !cdt.is_constrained( meshTriEdge( fh, i ) ) ) {
+                    visited[n] = true;
+                    queue.push_back( n );
+                }
+            }
+        }
+
+        if ( seed == meshTriFaceHandle() ) {
+            seed = start;
+        }
+
+        if ( !seed->info().getMaterial().empty() ) {
+            seeds.push_back( materialSeed( CGAL::centroid( cdt.triangle( seed ) ), seed->info().getMaterial() ) );
+        }
+    }
+}
+
+static void restoreMaterials( meshTriCDT& cdt, const std::vector<materialSeed>& seeds )
+{
+    CGAL::Unique_hash_map<meshTriFaceHandle, bool> visited( false );
+    meshTriFaceHandle                              hint;
+
+    for ( unsigned int s=0; s<seeds.size(); s++ ) {
+        meshTriFaceHandle start = cdt.locate( seeds[s].point, hint );
+        if ( cdt.is_infinite( start ) || visited[start] ) {
+            continue;
+        }
+        hint = start;
+
+        std::list<meshTriFaceHandle> queue;
+
+        visited[start] = true;
+        queue.push_back( start );
+
+        while ( !queue.empty() ) {
+            meshTriFaceHandle fh = queue.front();
+            queue.pop_front();
+
+            fh->info().setMaterial( seeds[s].material );
+
+            for ( int i=0; i<3; i++ ) {
+                meshTriFaceHandle n = fh->neighbor(i);
+
+                if ( !cdt.is_infinite( n ) && !visited[n] && !cdt.is_constrained( meshTriEdge( fh, i ) ) ) {
+                    visited[n] = true;
+                    queue.push_back( n );
+                }
+            }
+        }
+    }
+}
+
+// take the points and constraints out with the moved nodes in their new
+// places, and the added nodes, and triangulate them all again - inserting
+// the points in spatial order, each next to the last one
+void tgMeshTriangulation::relocateRebuild( meshTriCDT& cdt, const std::vector<movedNode>& movedPoints, const std::vector<meshTriPoint>& addedPoints )
+{
+    CGAL::Unique_hash_map<meshTriVertexHandle, int> moved( -1 );
+    for ( unsigned int i=0; i<movedPoints.size(); i++ ) {
+        moved[movedPoints[i].oldPositionHandle] = i;
+    }
+
+    std::vector<meshTriPoint>                       points;
+    std::vector<tgMeshVertexInfo>                   infos;
+    CGAL::Unique_hash_map<meshTriVertexHandle, int> index( -1 );
+
+    points.reserve( cdt.number_of_vertices() + addedPoints.size() );
+    infos.reserve( cdt.number_of_vertices() + addedPoints.size() );
+
+    for ( meshTriCDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++ ) {
+        meshTriVertexHandle vh = vit;
+        int                 m  = moved[vh];
+
+        index[vh] = points.size();
+        points.push_back( m >= 0 ? movedPoints[m].newPosition : vh->point() );
+        infos.push_back( vh->info() );
+    }
+    for ( unsigned int i=0; i<addedPoints.size(); i++ ) {
+        points.push_back( addedPoints[i] );
+        infos.push_back( tgMeshVertexInfo() );
+    }
+
+    std::vector< std::pair<int, int> > constraints;
+    for ( meshTriCDT::Finite_edges_iterator eit = cdt.finite_edges_begin(); eit != cdt.finite_edges_end(); eit++ ) {
+        if ( cdt.is_constrained( *eit ) ) {
+            meshTriFaceHandle f = eit->first;
+            int               i = eit->second;
+
+            constraints.push_back( std::make_pair( index[f->vertex( f->cw(i) )], index[f->vertex( f->ccw(i) )] ) );
+        }
+    }
+
+    std::vector<materialSeed> seeds;
+    materialSeeds( cdt, moved, seeds );
+
+    cdt.clear();
+
+    std::vector<std::size_t> order( points.size() );
+    for ( unsigned int i=0; i<order.size(); i++ ) {
+        order[i] = i;
+    }
+    CGAL::spatial_sort( order.begin(), order.end(), relocateSortTraits( CGAL::make_property_map( points ) ) );
+
+    std::vector<meshTriVertexHandle> handles( points.size() );
+    meshTriFaceHandle                hint;
+
+    for ( unsigned int k=0; k<order.size(); k++ ) {
+        std::size_t  i      = order[k];
+        unsigned int before = cdt.number_of_vertices();
+
+        handles[i] = cdt.insert( points[i], hint );
+        hint       = handles[i]->face();
+
+        // a point on an existing vertex keeps that one's info
+        if ( cdt.number_of_vertices() > before ) {
+            handles[i]->info() = infos[i];
+        }
+    }
+
+    for ( unsigned int c=0; c<constraints.size(); c++ ) {
+        meshTriVertexHandle va = handles[constraints[c].first];
+        meshTriVertexHandle vb = handles[constraints[c].second];
+
+        if ( va != vb ) {
+            cdt.insert_constraint( va, vb );
+        }
+    }
+
+    restoreMaterials( cdt, seeds );
+}
+
+static void constrainedSegments( const meshTriCDT& cdt, std::vector<relocateSegment>& segments )
+{
+    for ( meshTriCDT::Finite_edges_iterator eit = cdt.finite_edges_begin(); eit != cdt.finite_edges_end(); eit++ ) {
+        if ( cdt.is_constrained( *eit ) ) {
+            meshTriFaceHandle f = eit->first;
+            int               i = eit->second;
+            meshTriPoint      a = f->vertex( f->cw(i) )->point();
+            meshTriPoint      b = f->vertex( f->ccw(i) )->point();
+
+            segments.push_back( b < a ? relocateSegment( b, a ) : relocateSegment( a, b ) );
+        }
+    }
+
+    std::sort( segments.begin(), segments.end() );
+}
+
+bool tgMeshTriangulation::sameConstraints( const meshTriCDT& a, const meshTriCDT& b )
+{
+    if ( a.number_of_vertices() != b.number_of_vertices() ) {
+        SG_LOG( SG_GENERAL, SG_INFO, "sameConstraints: " << a.number_of_vertices() << " vs " << b.number_of_vertices() << " vertices" );
+        return false;
+    }
+
+    std::vector<relocateSegment> segsA, segsB;
+    constrainedSegments( a, segsA );
+    constrainedSegments( b, segsB );
+
+    if ( segsA != segsB ) {
+        SG_LOG( SG_GENERAL, SG_INFO, "sameConstraints: " << segsA.size() << " vs " << segsB.size() << " constrained edges" );
+        return false;
+    }
+
+    // and the same material everywhere - the diagonals may differ, so
+    // compare each face of a with the face of b holding its centroid
+    meshTriFaceHandle hint;
+    unsigned int      differ = 0;
+
+    for ( meshTriCDT::Finite_faces_iterator fit = a.finite_faces_begin(); fit != a.finite_faces_end(); fit++ ) {
+        meshTriFaceHandle fb = b.locate( CGAL::centroid( a.triangle( fit ) ), hint );
+
+        if ( b.is_infinite( fb ) || fb->info().getMaterial() != fit->info().getMaterial() ) {
+            differ++;
+        } else {
+            hint = fb;
+        }
+    }
+
+    if ( differ ) {
+        SG_LOG( SG_GENERAL, SG_INFO, "sameConstraints: " << differ << " faces with another material" );
+        return false;
+    }
+
+    return true;
+}
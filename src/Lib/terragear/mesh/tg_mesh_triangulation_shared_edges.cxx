@@ -3,23 +3,148 @@
 
 #include <simgear/debug/logstream.hxx>
 
+#include <terragear/tg_profile.hxx>
+
 #include "tg_mesh.hxx"
+#include "tg_mesh_shared_edge_cache.hxx"
 
 #define THRESHOLD_SAME      (0.0000000000001)
 #define THRESHOLD_TOO_CLOSE (0.00000001)
 
 #define DEBUG_SHARED_EDGE   (0)
 
+static bool lessLatitude(const meshVertexInfo& a, const meshVertexInfo& b);
+static bool lessLongitude(const meshVertexInfo& a, const meshVertexInfo& b);
+
+tgMeshTriangulation::matchNodesMethod tgMeshTriangulation::matchMethod = tgMeshTriangulation::MATCH_NODES_MERGE;
+
+void tgMeshTriangulation::setMatchNodesMethod( matchNodesMethod m )
+{
+    matchMethod = m;
+}
+
+static const char* nodeMembershipName( nodeMembership m )
+{
+    switch( m ) {
+        case NODE_BOTH:     return "BOTH";
+        case NODE_CURRENT:  return "CURRENT";
+        case NODE_NEIGHBOR: return "NEIGHBOR";
+    }
+
+    return "";
+}
+
+static void addMovedNode( const std::map<int, meshTriVertexHandle>& handles, const nodeMembershipData& node, const meshTriPoint& newPosition, std::vector<movedNode>& movedNodes )
+{
+    int index = boost::get<2>(node);
+    std::map<int, meshTriVertexHandle>::const_iterator hit = handles.find( index );
+
+    if ( hit != handles.end() ) {
+        movedNodes.push_back( movedNode(hit->second, boost::get<0>(node), newPosition) );
+    } else {
+        SG_LOG(SG_GENERAL, SG_INFO, "Can't find index " << index << " map size is " << handles.size() );
+    }
+}
+
+// add or merge a node that is only on one of the edges - nextNode is the closest other node on the edge, NULL if there is none
+static void resolveNode( const nodeMembershipData& thisNode, const nodeMembershipData* nextNode, double distSq, const std::map<int, meshTriVertexHandle>& handles, std::vector<meshTriPoint>& addedNodes, std::vector<movedNode>& movedNodes )
+{
+    // if the distance between nodes is less than the merge threshold - see if we can merge them.
+    if ( nextNode && distSq < THRESHOLD_TOO_CLOSE ) {
+        std::string debugInfo = "dist is within merge thresh.  ";
+        debugInfo += std::string(" this is ") + nodeMembershipName( boost::get<1>(thisNode) ) + ", ";
+        debugInfo += std::string(" next is ") + nodeMembershipName( boost::get<1>(*nextNode) );
+
+        // merge these points only if they are in opposite tiles
+        if ( boost::get<1>(*nextNode) != NODE_BOTH ) {
+            // NOTE - we're going to add the moved node twice ( once from curent, and once from neighbot.
+            // This is OK, as we will lookup and find just the one - from current
+            if ( (boost::get<1>(thisNode) == NODE_CURRENT) && (boost::get<1>(*nextNode) == NODE_NEIGHBOR) ) {
+                debugInfo += ": MERGE";
+
+                // moving thisNode to midpoint of this and next
+                addMovedNode( handles, thisNode, CGAL::midpoint( boost::get<0>(thisNode), boost::get<0>(*nextNode) ), movedNodes );
+            } else if ( (boost::get<1>(thisNode) == NODE_NEIGHBOR) && (boost::get<1>(*nextNode) == NODE_CURRENT) ) {
+                debugInfo += ": MERGE";
+
+                // moving nextNode to midpoint of this and next
+                addMovedNode( handles, *nextNode, CGAL::midpoint( boost::get<0>(thisNode), boost::get<0>(*nextNode) ), movedNodes );
+            } else {
+                // we've found 2 points that are very close in the same tile - if it's the neighbor tile, go ahead and add it
+                if ( boost::get<1>(thisNode) == NODE_NEIGHBOR ) {
+                    debugInfo += ": CAN'T MERGE - both points neighbor - addding neighbor node";
+                    addedNodes.push_back( boost::get<0>(thisNode) );
+                } else {
+                    debugInfo += ": CAN'T MERGE - both points current - ignore";
+                }
+            }
+        } else {
+            // current node is on just one edge, but next is on both
+            // if it is on the neighbor edge, add it to current
+            if ( boost::get<1>(thisNode) == NODE_NEIGHBOR ) {
+                debugInfo += ": CAN'T MERGE - next closest on both edges - adding neighbor node";
+                addedNodes.push_back( boost::get<0>(thisNode) );
+            } else {
+                // current node is by definition, on current tile edge.
+                debugInfo += ": CAN'T MERGE - next closest on both edges - skipping current node";
+            }
+        }
+
+        SG_LOG( SG_GENERAL, SG_DEBUG, debugInfo );
+    } else {
+        // distance between nodes is too large to merge
+        // - if cur is on neighbor edge, add it to current
+        if ( boost::get<1>(thisNode) == NODE_NEIGHBOR ) {
+            addedNodes.push_back( boost::get<0>(thisNode) );
+        } else {
+            // current node is by definition, on current tile edge.
+        }
+    }
+}
+
 /* This will add or move nodes to match a neighbor edge.  Algorithm is designed to give the same result for both tiles.  
  * (it is run twice - once for each tile on the shared edge )
  */
 void tgMeshTriangulation::matchNodes( edgeType edge, std::vector<meshVertexInfo>& curVertexes, std::vector<meshVertexInfo>& neighVertexes, std::vector<meshTriPoint>& addedNodes, std::vector<movedNode>& movedNodes )
+{
+    const char *edgestr[4] = {
+        "north",
+        "south",
+        "east",
+        "west"
+    };
+
+    SG_LOG(SG_GENERAL, SG_DEBUG, "edge matching bucket " << mesh->getBucket().gen_index_str() << " edge " << edgestr[edge] << ".  current - " << curVertexes.size() << ", neighbor - " << neighVertexes.size() );
+
+    if ( matchMethod == MATCH_NODES_KDTREE ) {
+        matchNodesKdTree( curVertexes, neighVertexes, vertexIndexToHandleMap, addedNodes, movedNodes );
+    } else if ( matchMethod == MATCH_NODES_MERGE ) {
+        matchNodesMerge( edge, curVertexes, neighVertexes, vertexIndexToHandleMap, addedNodes, movedNodes );
+    } else {
+        std::vector<meshTriPoint> kdAdded, mergeAdded;
+        std::vector<movedNode>    kdMoved, mergeMoved;
+
+        matchNodesKdTree( curVertexes, neighVertexes, vertexIndexToHandleMap, kdAdded, kdMoved );
+        matchNodesMerge( edge, curVertexes, neighVertexes, vertexIndexToHandleMap, mergeAdded, mergeMoved );
+
+        if ( !sameMatch( kdAdded, kdMoved, mergeAdded, mergeMoved ) ) {
+            SG_LOG(SG_GENERAL, SG_ALERT, "matchNodes: bucket " << mesh->getBucket().gen_index_str() << " edge " << edgestr[edge] << 
+                                         ": kd-tree added " << kdAdded.size() << ", moved " << kdMoved.size() <<
+                                         " - merge added " << mergeAdded.size() << ", moved " << mergeMoved.size() );
+        }
+
+        addedNodes.insert( addedNodes.end(), kdAdded.begin(), kdAdded.end() );
+        movedNodes.insert( movedNodes.end(), kdMoved.begin(), kdMoved.end() );
+    }
+}
+
+void tgMeshTriangulation::matchNodesKdTree( const std::vector<meshVertexInfo>& curVertexes, const std::vector<meshVertexInfo>& neighVertexes, const std::map<int, meshTriVertexHandle>& handles, std::vector<meshTriPoint>& addedNodes, std::vector<movedNode>& movedNodes )
 {
     // we'll build a search tree of all nodes on the shared edge - flag which ones are current, which are neighbor, and which are both.
     // to determine if they are on both, we'll create 2 kd-trees to search first.
     // CGAL kd trees cannot remove items, so merging in tree is innefficient.
     nodeMembershipTree  curTree, neighTree;
-    std::vector<meshVertexInfo>::iterator viIt;
+    std::vector<meshVertexInfo>::const_iterator viIt;
 
     for ( viIt = curVertexes.begin(); viIt != curVertexes.end(); viIt++ ) {
         curTree.insert( nodeMembershipData( viIt->getPoint(), NODE_CURRENT, viIt->getId() ) );        
@@ -32,15 +157,6 @@ void tgMeshTriangulation::matchNodes( edgeType edge, std::vector<meshVertexInfo>
     // does this need to be a tree as well?
     nodeMembershipTree  nodeTree;
 
-    const char *edgestr[4] = {
-        "north",
-        "south",
-        "east",
-        "west"
-    };
-
-    SG_LOG(SG_GENERAL, SG_DEBUG, "edge matching bucket " << mesh->getBucket().gen_index_str() << " edge " << edgestr[edge] << ".  current - " << curTree.size() << ", neighbor - " << neighTree.size() );           
-
     // traverse neighbor tile - nodes are either both, or neighbor
     for( viIt = neighVertexes.begin(); viIt != neighVertexes.end(); viIt++ ) {
         nodeMembershipSearch           currentSearch( curTree, viIt->getPoint(), 1 ); 
@@ -102,9 +218,7 @@ void tgMeshTriangulation::matchNodes( edgeType edge, std::vector<meshVertexInfo>
 
     // we now have a search tree with all nodes on the shared edge.  each node is marked cur, neigh, or both.
     // now we look for cur and neigh nodes that are very close to an opposite neigh or current to merge them.
-    // first - let's dump the debug output
     nodeMembershipTree::const_iterator mit;
-    unsigned int nodeCnt = 1;
 
     // now traverse the tree again, and either add or merge nodes.  
     // This tree should be exactly the same for each tile sharing the edge.
@@ -117,8 +231,8 @@ void tgMeshTriangulation::matchNodes( edgeType edge, std::vector<meshVertexInfo>
         queryPoints.push_back( *mit );
     }
 
-    std::vector<nodeMembershipData>::const_iterator qpit = queryPoints.begin();
-    while ( qpit != queryPoints.end() ) {
+    std::vector<nodeMembershipData>::const_iterator qpit;
+    for ( qpit = queryPoints.begin(); qpit != queryPoints.end(); qpit++ ) {
         // Only worry about nodes that are NOT on both edges - either add them or merge them
         if ( boost::get<1>(*qpit) != NODE_BOTH ) {
 
@@ -132,81 +246,11 @@ void tgMeshTriangulation::matchNodes( edgeType edge, std::vector<meshVertexInfo>
 
                 nodeMembershipData thisNode = rit->first;
                 rit++;
-                nodeMembershipData nextNode = rit->first;
-                double             distSq   = rit->second;
-
-                // if the distance between nodes is less than the merge threshold - see if we can merge them.
-                if ( distSq < THRESHOLD_TOO_CLOSE ) {
-                    std::string debugInfo = "dist is within merge thresh.  ";
-                    switch( boost::get<1>(thisNode) ) {
-                        case NODE_BOTH:     debugInfo += " this is BOTH, ";       break;
-                        case NODE_CURRENT:  debugInfo += " this is CURRENT, ";    break;
-                        case NODE_NEIGHBOR: debugInfo += " this is NEIGHBOR, ";   break;
-                    }
-                    switch( boost::get<1>(nextNode) ) {
-                        case NODE_BOTH:     debugInfo += " next is BOTH";         break;
-                        case NODE_CURRENT:  debugInfo += " next is CURRENT";      break;
-                        case NODE_NEIGHBOR: debugInfo += " next is NEIGHBOR";     break;
-                    }
 
-                    // merge these points only if they are in opposite tiles
-                    if ( boost::get<1>(nextNode) != NODE_BOTH ) {
-                        int index;
-
-                        // NOTE - we're going to add the moved node twice ( once from curent, and once from neighbot.
-                        // This is OK, as we will lookup and find just the one - from current
-                        if ( (boost::get<1>(thisNode) == NODE_CURRENT) && (boost::get<1>(nextNode) == NODE_NEIGHBOR) ) {
-                            debugInfo += ": MERGE";
-
-                            // moving thisNode to midpoint of this and next
-                            index = boost::get<2>(thisNode);
-                            if ( vertexIndexToHandleMap.find(index) != vertexIndexToHandleMap.end() ) {
-                                meshTriTDS::Vertex_handle vHand = vertexIndexToHandleMap[index];
-                                movedNodes.push_back( movedNode(vHand, boost::get<0>(thisNode), CGAL::midpoint( boost::get<0>(thisNode), boost::get<0>(nextNode)) ) );
-                            } else {
-                                SG_LOG(SG_GENERAL, SG_INFO, "Can't find index " << index << " map size is " << vertexIndexToHandleMap.size() );
-                            }
-                        } else if ( (boost::get<1>(thisNode) == NODE_NEIGHBOR) && (boost::get<1>(nextNode) == NODE_CURRENT) ) {
-                            debugInfo += ": MERGE";
-
-                            // moving nextNode to midpoint of this and next
-                            index = boost::get<2>(nextNode);
-                            if ( vertexIndexToHandleMap.find(index) != vertexIndexToHandleMap.end() ) {
-                                meshTriTDS::Vertex_handle vHand = vertexIndexToHandleMap[index];
-                                movedNodes.push_back( movedNode(vHand, boost::get<0>(nextNode), CGAL::midpoint( boost::get<0>(thisNode), boost::get<0>(nextNode)) ) );
-                            } else {
-                                SG_LOG(SG_GENERAL, SG_INFO, "Can't find index " << index << " map size is " << vertexIndexToHandleMap.size() );
-                            }
-                        } else {
-                            // we've found 2 points that are very close in the same tile - if it's the neighbor tile, go ahead and add it
-                            if ( boost::get<1>(thisNode) == NODE_NEIGHBOR ) {
-                                debugInfo += ": CAN'T MERGE - both points neighbor - addding neighbor node";
-                                addedNodes.push_back( boost::get<0>(thisNode) );
-                            } else {
-                                debugInfo += ": CAN'T MERGE - both points current - ignore";
-                            }
-                        }
-                    } else {
-                        // current node is on just one edge, but next is on both 
-                        // if it is on the neighbor edge, add it to current
-                        if ( boost::get<1>(thisNode) == NODE_NEIGHBOR ) {
-                            debugInfo += ": CAN'T MERGE - next closest on both edges - adding neighbor node";
-                            addedNodes.push_back( boost::get<0>(thisNode) );
-                        } else {
-                            // current node is by definition, on current tile edge.
-                            debugInfo += ": CAN'T MERGE - next closest on both edges - skipping current node";
-                        }
-                    }
-
-                    SG_LOG( SG_GENERAL, SG_DEBUG, debugInfo );
+                if ( rit != memberSearch.end() ) {
+                    resolveNode( thisNode, &rit->first, rit->second, handles, addedNodes, movedNodes );
                 } else {
-                    // distance between nodes is too large to merge 
-                    // - if cur is on neighbor edge, add it to current
-                    if ( boost::get<1>(thisNode) == NODE_NEIGHBOR ) {
-                        addedNodes.push_back( boost::get<0>(thisNode) );
-                    } else {
-                        // current node is by definition, on current tile edge.
-                    }
+                    resolveNode( thisNode, NULL, 0.0, handles, addedNodes, movedNodes );
                 }
             } else {
                 SG_LOG(SG_GENERAL, SG_DEBUG, "ERROR: search returned no results 4" );
@@ -214,13 +258,217 @@ void tgMeshTriangulation::matchNodes( edgeType edge, std::vector<meshVertexInfo>
         } else {
             // node is already on both edges - ignore.
         }
+    }
+}
+
+// position along the edge - the edge nodes are sorted by it
+static inline double edgePosition( edgeType edge, const meshTriPoint& p )
+{
+    return ( edge == NORTH_EDGE || edge == SOUTH_EDGE ) ? p.x() : p.y();
+}
 
-        // try next node ( or next  next, in case of merge )
-        if ( qpit != queryPoints.end() ) {
-            nodeCnt++;
-            qpit++;
+static bool sortedAlongEdge( edgeType edge, const std::vector<meshVertexInfo>& nodes )
+{
+    for ( unsigned int i=1; i<nodes.size(); i++ ) {
+        if ( edgePosition( edge, nodes[i].getPoint() ) < edgePosition( edge, nodes[i-1].getPoint() ) ) {
+            return false;
         }
     }
+
+    return true;
+}
+
+// the closest of the sorted nodes to p closer than the square root of
+// maxDistSq, -1 if none is.  Only the nodes within that distance along the
+// edge can be - first is moved past the ones before them, so a search for
+// the next p along the edge can start there.
+static int closestAlongEdge( edgeType edge, const std::vector<meshVertexInfo>& nodes, const meshTriPoint& p, double maxDistSq, unsigned int& first, double& distSq )
+{
+    double pos = edgePosition( edge, p );
+    int    closest = -1;
+
+    while ( first < nodes.size() ) {
+        double d = pos - edgePosition( edge, nodes[first].getPoint() );
+        if ( d <= 0.0 || d * d < maxDistSq ) {
+            break;
+        }
+        first++;
+    }
+
+    distSq = maxDistSq;
+    for ( unsigned int i=first; i<nodes.size(); i++ ) {
+        double d = edgePosition( edge, nodes[i].getPoint() ) - pos;
+        if ( d > 0.0 && d * d >= maxDistSq ) {
+            break;
+        }
+
+        double dsq = CGAL::squared_distance( p, nodes[i].getPoint() );
+        if ( dsq < distSq ) {
+            distSq  = dsq;
+            closest = i;
+        }
+    }
+
+    return closest;
+}
+
+// the same matching as matchNodesKdTree, with the nodes sorted along the
+// edge.  Nodes further apart along the edge than a threshold distance can't
+// be closer than it, so every search is a scan of the few nodes around a
+// position along the edge, and the searches in sorted order are merges.
+void tgMeshTriangulation::matchNodesMerge( edgeType edge, const std::vector<meshVertexInfo>& curVertexes, const std::vector<meshVertexInfo>& neighVertexes, const std::map<int, meshTriVertexHandle>& handles, std::vector<meshTriPoint>& addedNodes, std::vector<movedNode>& movedNodes )
+{
+    // loadTriangulation sorts them
+    if ( !sortedAlongEdge( edge, curVertexes ) || !sortedAlongEdge( edge, neighVertexes ) ) {
+        std::vector<meshVertexInfo> cur( curVertexes ), neigh( neighVertexes );
+
+        if ( edge == NORTH_EDGE || edge == SOUTH_EDGE ) {
+            std::stable_sort( cur.begin(), cur.end(), lessLongitude );
+            std::stable_sort( neigh.begin(), neigh.end(), lessLongitude );
+        } else {
+            std::stable_sort( cur.begin(), cur.end(), lessLatitude );
+            std::stable_sort( neigh.begin(), neigh.end(), lessLatitude );
+        }
+
+        matchNodesMerge( edge, cur, neigh, handles, addedNodes, movedNodes );
+        return;
+    }
+
+    // nothing is matched unless both edges have nodes
+    if ( curVertexes.empty() || neighVertexes.empty() ) {
+        return;
+    }
+
+    // all nodes on the shared edge, neighbor nodes - both, or neighbor -
+    // first, then the current nodes not on the neighbor edge.  Both runs are
+    // sorted along the edge.
+    std::vector<nodeMembershipData> nodes;
+    nodes.reserve( curVertexes.size() + neighVertexes.size() );
+
+    unsigned int first = 0;
+    double       distSq;
+
+    for ( unsigned int i=0; i<neighVertexes.size(); i++ ) {
+        int c = closestAlongEdge( edge, curVertexes, neighVertexes[i].getPoint(), THRESHOLD_SAME, first, distSq );
+
+        if ( c >= 0 ) {
+            // use the current info id
+            nodes.push_back( nodeMembershipData(neighVertexes[i].getPoint(), NODE_BOTH, curVertexes[c].getId()) );
+        } else {
+            nodes.push_back( nodeMembershipData(neighVertexes[i].getPoint(), NODE_NEIGHBOR, -1) );
+        }
+    }
+
+    unsigned int numNeighbor = nodes.size();
+
+    first = 0;
+    for ( unsigned int i=0; i<curVertexes.size(); i++ ) {
+        // on the neighbor edge, too - already in as both
+        if ( closestAlongEdge( edge, neighVertexes, curVertexes[i].getPoint(), THRESHOLD_SAME, first, distSq ) < 0 ) {
+            nodes.push_back( nodeMembershipData(curVertexes[i].getPoint(), NODE_CURRENT, curVertexes[i].getId()) );
+        }
+    }
+
+    // merge the runs into one sorted order, and remember where each node is in it
+    std::vector<unsigned int> order( nodes.size() );
+    std::vector<unsigned int> rank( nodes.size() );
+    unsigned int              n = 0, c = numNeighbor, o = 0;
+
+    while ( n < numNeighbor || c < nodes.size() ) {
+        if ( c == nodes.size() || ( n < numNeighbor && edgePosition( edge, boost::get<0>(nodes[n]) ) <= edgePosition( edge, boost::get<0>(nodes[c]) ) ) ) {
+            order[o] = n++;
+        } else {
+            order[o] = c++;
+        }
+        rank[order[o]] = o;
+        o++;
+    }
+
+    // either add or merge the nodes on just one of the edges
+    for ( unsigned int i=0; i<nodes.size(); i++ ) {
+        if ( boost::get<1>(nodes[i]) == NODE_BOTH ) {
+            continue;
+        }
+
+        const meshTriPoint&  qp  = boost::get<0>(nodes[i]);
+        double               pos = edgePosition( edge, qp );
+        int                  next = -1;
+
+        distSq = THRESHOLD_TOO_CLOSE;
+
+        // closest other node, on either side along the edge
+        for ( int r = (int)rank[i] - 1; r >= 0; r-- ) {
+            const meshTriPoint& p = boost::get<0>(nodes[order[r]]);
+            double              d = pos - edgePosition( edge, p );
+
+            if ( d > 0.0 && d * d >= THRESHOLD_TOO_CLOSE ) {
+                break;
+            }
+
+            double dsq = CGAL::squared_distance( qp, p );
+            if ( dsq < distSq ) {
+                distSq = dsq;
+                next   = order[r];
+            }
+        }
+        for ( unsigned int r = rank[i] + 1; r < order.size(); r++ ) {
+            const meshTriPoint& p = boost::get<0>(nodes[order[r]]);
+            double              d = edgePosition( edge, p ) - pos;
+
+            if ( d > 0.0 && d * d >= THRESHOLD_TOO_CLOSE ) {
+                break;
+            }
+
+            double dsq = CGAL::squared_distance( qp, p );
+            if ( dsq < distSq ) {
+                distSq = dsq;
+                next   = order[r];
+            }
+        }
+
+        resolveNode( nodes[i], next >= 0 ? &nodes[next] : NULL, distSq, handles, addedNodes, movedNodes );
+    }
+}
+
+static bool lessPoint( const meshTriPoint& a, const meshTriPoint& b )
+{
+    return a.x() < b.x() || ( a.x() == b.x() && a.y() < b.y() );
+}
+
+static bool lessMovedNode( const movedNode& a, const movedNode& b )
+{
+    if ( lessPoint( a.oldPosition, b.oldPosition ) ) return true;
+    if ( lessPoint( b.oldPosition, a.oldPosition ) ) return false;
+
+    return lessPoint( a.newPosition, b.newPosition );
+}
+
+bool tgMeshTriangulation::sameMatch( std::vector<meshTriPoint> addedA, std::vector<movedNode> movedA, std::vector<meshTriPoint> addedB, std::vector<movedNode> movedB )
+{
+    if ( addedA.size() != addedB.size() || movedA.size() != movedB.size() ) {
+        return false;
+    }
+
+    std::sort( addedA.begin(), addedA.end(), lessPoint );
+    std::sort( addedB.begin(), addedB.end(), lessPoint );
+    std::sort( movedA.begin(), movedA.end(), lessMovedNode );
+    std::sort( movedB.begin(), movedB.end(), lessMovedNode );
+
+    for ( unsigned int i=0; i<addedA.size(); i++ ) {
+        if ( addedA[i] != addedB[i] ) {
+            return false;
+        }
+    }
+
+    for ( unsigned int i=0; i<movedA.size(); i++ ) {
+        if ( movedA[i].oldPositionHandle != movedB[i].oldPositionHandle ||
+             movedA[i].oldPosition != movedB[i].oldPosition ||
+             movedA[i].newPosition != movedB[i].newPosition ) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 void tgMeshTriangulation::loadStage1SharedEdge( const std::string& p, const SGBucket& bucket, edgeType edge, std::vector<meshVertexInfo>& points ) 
@@ -237,19 +485,24 @@ void tgMeshTriangulation::loadStage1SharedEdge( const std::string& p, const SGBu
     std::string filePath = p + bucket.gen_base_path() + "/" + bucket.gen_index_str() + "/" + filename;
 
     SG_LOG(SG_GENERAL, SG_DEBUG, "Loading Bucket " << bucket.gen_index_str() << " edge " << edgestr[edge] << " from " << filePath );           
-    fromShapefile( filePath, points );
 
-    SG_LOG(SG_GENERAL, SG_DEBUG, "Loaded " << points.size() << " nodes on edge " << edgestr[edge] );        
+    // the tile across the edge reads it too
+    tgSharedEdgePtr nodes = tgSharedEdgeCache::instance().get( *this, filePath, bucket, edge );
+    points.insert( points.end(), nodes->begin(), nodes->end() );
+
+    SG_LOG(SG_GENERAL, SG_DEBUG, "Loaded " << nodes->size() << " nodes on edge " << edgestr[edge] );        
 }
 
 // load stage1 triangulation - translate nodes on edges if we merged nodes with a shared edge
 bool tgMeshTriangulation::loadTriangulation( const std::string& basePath, const SGBucket& bucket )
 {
     std::string bucketPath = basePath + "/" + bucket.gen_base_path() + "/" + bucket.gen_index_str();
+    tgProfilePhase loadPhase( "loadTds" );
     bool hasLand = loadTds( bucketPath );
+    loadPhase.end();
 
     if ( hasLand ) {
-        SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTriangulation - Triangulation valid? " << meshTriangulation.is_valid() );
+        SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTriangulation - Triangulation has " << meshTriangulation.number_of_faces() << " faces" );
 
         // match edges
         std::vector<meshVertexInfo> currentNorth, currentSouth, currentEast, currentWest;
@@ -263,6 +516,8 @@ bool tgMeshTriangulation::loadTriangulation( const std::string& basePath, const
         // Ask Martin...
 
         // load our shared edge data
+        tgProfilePhase edgePhase( "loadSharedEdges" );
+
         SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTriangulation - north edge " );
 
         loadStage1SharedEdge( basePath, bucket, NORTH_EDGE, currentNorth );
@@ -319,10 +574,15 @@ bool tgMeshTriangulation::loadTriangulation( const std::string& basePath, const
         loadStage1SharedEdge( basePath, eastBucket, WEST_EDGE, neighborEast );
         sortByLat( neighborEast );
 
+        edgePhase.end();
+
         // match edges - add corrected locations into search tree, and new nodes into array
         std::vector<meshTriPoint> addedNodes;
         std::vector<movedNode>    movedNodes;
 
+        tgProfilePhase matchPhase( "matchNodes" );
+        tgProfile::count( "edgeNodes", currentNorth.size() + currentSouth.size() + currentEast.size() + currentWest.size() );
+
         SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTriangulation - match north " );
         matchNodes( NORTH_EDGE, currentNorth, neighborNorth, addedNodes, movedNodes );
 
@@ -341,10 +601,16 @@ bool tgMeshTriangulation::loadTriangulation( const std::string& basePath, const
         toShapefile( mesh->getDebugPath(), "moved_nodes", movedNodes );
 #endif
 
+        tgProfile::count( "addedNodes", addedNodes.size() );
+        tgProfile::count( "movedNodes", movedNodes.size() );
+        matchPhase.end();
+
         // remesh with the moved and added nodes to the triangulation
         SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTriangulation - remesh " );
 
+        tgProfilePhase remeshPhase( "remesh" );
         constrainedTriangulateWithoutEdgeModification( movedNodes, addedNodes );
+        tgProfile::count( "triangles", getNumTriangles() );
     }
 
     SG_LOG(SG_GENERAL, SG_DEBUG, "LoadTriangulation complete.  hasLand " << hasLand );
@@ -0,0 +1,266 @@
+#define DEBUG_MESH_TDS_SHAPEFILE    (0)     // also write the tds_points / tds_faces shapefiles next to tds.bin
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/misc/sg_path.hxx>
+
+#include <terragear/tg_mapped_file.hxx>
+
+#include "tg_mesh.hxx"
+
+// Binary TDS intermediate file.
+//
+// Written in native byte order, and laid out so every array is naturally
+// aligned when the file is mapped:
+//
+//   tdsHeader
+//   tdsVertex   vertices[numVertices]      finite vertices - vertex n has id n+1 ( 0 is infinite )
+//   tdsFace     faces[numFaces]            vertex and neighbor ids
+//   int32_t     material[numFaces]         index into material table, -1 for none
+//   uint8_t     constrained[bitmapBytes]   3 bits per face - bit (3*face + edge)
+//   material table[numMaterials]           uint32_t length, followed by the characters
+//
+// Bump TDS_VERSION whenever the layout changes - old files are then
+// rejected, and stage 1 must be rerun.
+
+#define TDS_MAGIC       "TGTDS01"
+#define TDS_VERSION     (1)
+#define TDS_BYTE_ORDER  (0x01020304)
+
+struct tdsHeader {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byteOrder;
+    uint32_t    numVertices;
+    uint32_t    numFaces;
+    uint32_t    numMaterials;
+    uint32_t    bitmapBytes;
+};
+
+struct tdsVertex {
+    double      x;
+    double      y;
+    double      z;
+};
+
+struct tdsFace {
+    int32_t     vid[3];
+    int32_t     nid[3];
+};
+
+void tgMeshTriangulation::saveTdsBinary( const std::string& filename ) const
+{
+    tdsHeader                   header;
+    std::vector<tdsVertex>      vertices;
+    std::vector<tdsFace>        faces;
+    std::vector<int32_t>        materials;
+    std::vector<uint8_t>        constrained;
+    std::vector<std::string>    materialNames;
+    std::map<std::string, int>  materialIndex;
+
+    // vertices - skip the infinite vertex, it has no position
+    for ( unsigned int i=1; i<vertexInfo.size(); i++ ) {
+        if ( vertexInfo[i].getId() != (int)i ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::saveTdsBinary - vertex " << i << " has id " << vertexInfo[i].getId() << " - call prepareTds first" );
+            return;
+        }
+
+        tdsVertex v;
+        v.x = vertexInfo[i].getX();
+        v.y = vertexInfo[i].getY();
+        v.z = vertexInfo[i].getZ();
+        vertices.push_back( v );
+    }
+
+    // faces, their materials and constraints
+    constrained.resize( (3*faceInfo.size() + 7) / 8, 0 );
+    for ( unsigned int i=0; i<faceInfo.size(); i++ ) {
+        tdsFace f;
+
+        for ( unsigned int j=0; j<3; j++ ) {
+            f.vid[j] = faceInfo[i].getVid(j);
+            f.nid[j] = faceInfo[i].getNid(j);
+
+            if ( faceInfo[i].getConstrained(j) ) {
+                unsigned int bit = 3*i + j;
+                constrained[bit/8] |= ( 1 << (bit%8) );
+            }
+        }
+        faces.push_back( f );
+
+        const std::string& material = faceInfo[i].getMaterial();
+        if ( material.empty() ) {
+            materials.push_back( -1 );
+        } else {
+            std::map<std::string, int>::iterator mit = materialIndex.find( material );
+            if ( mit == materialIndex.end() ) {
+                mit = materialIndex.insert( std::make_pair( material, (int)materialNames.size() ) ).first;
+                materialNames.push_back( material );
+            }
+            materials.push_back( mit->second );
+        }
+    }
+
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, TDS_MAGIC, sizeof(header.magic) );
+    header.version      = TDS_VERSION;
+    header.byteOrder    = TDS_BYTE_ORDER;
+    header.numVertices  = vertices.size();
+    header.numFaces     = faces.size();
+    header.numMaterials = materialNames.size();
+    header.bitmapBytes  = constrained.size();
+
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if ( !fp ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::saveTdsBinary - can't open " << filename );
+        return;
+    }
+
+    bool ok = ( fwrite( &header, sizeof(header), 1, fp ) == 1 );
+    if ( ok && !vertices.empty() ) {
+        ok = ( fwrite( &vertices[0], sizeof(tdsVertex), vertices.size(), fp ) == vertices.size() );
+    }
+    if ( ok && !faces.empty() ) {
+        ok = ( fwrite( &faces[0], sizeof(tdsFace), faces.size(), fp ) == faces.size() ) &&
+             ( fwrite( &materials[0], sizeof(int32_t), materials.size(), fp ) == materials.size() ) &&
+             ( fwrite( &constrained[0], 1, constrained.size(), fp ) == constrained.size() );
+    }
+    for ( unsigned int i=0; ok && i<materialNames.size(); i++ ) {
+        uint32_t len = materialNames[i].size();
+        ok = ( fwrite( &len, sizeof(len), 1, fp ) == 1 ) &&
+             ( fwrite( materialNames[i].c_str(), 1, len, fp ) == len );
+    }
+
+    if ( fclose( fp ) != 0 ) {
+        ok = false;
+    }
+
+    if ( !ok ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::saveTdsBinary - error writing " << filename );
+    }
+}
+
+bool tgMeshTriangulation::loadTdsBinary( const std::string& filename )
+{
+    tgMappedFile                file;
+    std::vector<meshVertexInfo> points;
+    std::vector<meshFaceInfo>   faces;
+
+    if ( !file.open( filename ) ) {
+        SG_LOG( SG_GENERAL, SG_DEBUG, "tgMeshTriangulation::loadTdsBinary - can't open " << filename );
+        return buildTds( points, faces );
+    }
+
+    const unsigned char* cur = file.data();
+    const unsigned char* end = file.data() + file.size();
+
+    if ( file.size() < sizeof(tdsHeader) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::loadTdsBinary - " << filename << " is truncated" );
+        return buildTds( points, faces );
+    }
+
+    const tdsHeader* header = (const tdsHeader*)cur;
+    cur += sizeof(tdsHeader);
+
+    if ( memcmp( header->magic, TDS_MAGIC, sizeof(header->magic) ) ||
+         header->version   != TDS_VERSION ||
+         header->byteOrder != TDS_BYTE_ORDER ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::loadTdsBinary - " << filename << " is not a version " << TDS_VERSION << " TDS file for this platform" );
+        return buildTds( points, faces );
+    }
+
+    size_t arrayBytes = header->numVertices * sizeof(tdsVertex) +
+                        header->numFaces    * ( sizeof(tdsFace) + sizeof(int32_t) ) +
+                        header->bitmapBytes;
+    if ( (size_t)(end - cur) < arrayBytes || header->bitmapBytes < ( 3*header->numFaces + 7 ) / 8 ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::loadTdsBinary - " << filename << " is truncated" );
+        return buildTds( points, faces );
+    }
+
+    const tdsVertex* vertices    = (const tdsVertex*)cur;
+    cur += header->numVertices * sizeof(tdsVertex);
+    const tdsFace*   faceArray   = (const tdsFace*)cur;
+    cur += header->numFaces * sizeof(tdsFace);
+    const int32_t*   materials   = (const int32_t*)cur;
+    cur += header->numFaces * sizeof(int32_t);
+    const uint8_t*   constrained = (const uint8_t*)cur;
+    cur += header->bitmapBytes;
+
+    std::vector<std::string> materialNames;
+    for ( unsigned int i=0; i<header->numMaterials; i++ ) {
+        uint32_t len;
+
+        if ( (size_t)(end - cur) < sizeof(len) ) {
+            break;
+        }
+        memcpy( &len, cur, sizeof(len) );
+        cur += sizeof(len);
+
+        if ( (size_t)(end - cur) < len ) {
+            break;
+        }
+        materialNames.push_back( std::string( (const char*)cur, len ) );
+        cur += len;
+    }
+    if ( materialNames.size() != header->numMaterials ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::loadTdsBinary - " << filename << " has a truncated material table" );
+        return buildTds( points, faces );
+    }
+
+    points.reserve( header->numVertices );
+    for ( unsigned int i=0; i<header->numVertices; i++ ) {
+        points.push_back( meshVertexInfo( i+1, meshTriPoint( vertices[i].x, vertices[i].y ), vertices[i].z ) );
+    }
+
+    faces.reserve( header->numFaces );
+    for ( unsigned int i=0; i<header->numFaces; i++ ) {
+        int vid[3], nid[3], con[3];
+
+        for ( unsigned int j=0; j<3; j++ ) {
+            unsigned int bit = 3*i + j;
+
+            vid[j] = faceArray[i].vid[j];
+            nid[j] = faceArray[i].nid[j];
+            con[j] = ( constrained[bit/8] & ( 1 << (bit%8) ) ) ? 1 : 0;
+
+            if ( vid[j] < 0 || vid[j] > (int)header->numVertices ||
+                 nid[j] < 0 || nid[j] >= (int)header->numFaces ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "tgMeshTriangulation::loadTdsBinary - " << filename << " face " << i << " has an invalid index" );
+                points.clear();
+                faces.clear();
+                return buildTds( points, faces );
+            }
+        }
+
+        faces.push_back( meshFaceInfo( i, vid, nid, con ) );
+        if ( materials[i] >= 0 && materials[i] < (int)materialNames.size() ) {
+            faces.back().setMaterial( materialNames[materials[i]] );
+        }
+    }
+
+    return buildTds( points, faces );
+}
+
+void tgMeshTriangulation::saveTds( const std::string& bucketPath ) const
+{
+    saveTdsBinary( bucketPath + "/tds.bin" );
+
+#if DEBUG_MESH_TDS_SHAPEFILE
+    saveTdsShapefile( bucketPath );
+#endif
+}
+
+bool tgMeshTriangulation::loadTds( const std::string& bucketPath )
+{
+    std::string binaryPath = bucketPath + "/tds.bin";
+
+    // fall back to the shapefiles for stage 1 data written before the binary format
+    if ( SGPath( binaryPath ).exists() ) {
+        return loadTdsBinary( binaryPath );
+    } else {
+        return loadTdsShapefile( bucketPath );
+    }
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -477,105 +478,122 @@ void tgAccumulator::Add_cgal( const tgPolygon& subject )
 
 #endif
 
-// rewrite to use bounding boxes, and lists of polygons with holes 
-// need a few functions:
-// 1) generate a Polygon_set from the Polygons_with_holes in the list that intersect subject bounding box
-// 2) Add to the Polygons_with_holes list with a Polygon set ( and the bounding boxes )
-void tgAccumulator::GetAccumPolygonSet( const CGAL::Bbox_2& bbox, cgalPoly_PolygonSet& accumPs ) 
+// verify polygon sets going in and out of the accumulator - slow
+#define DEBUG_ACCUMULATOR_VALIDITY  (0)
+
+// don't grow cached unions beyond this many vertices - differencing
+// against one huge union costs more than against a few smaller ones
+#define ACCUM_MAX_ENTRY_VERTICES    (4096)
+
+static tgAccumBox toAccumBox( const CGAL::Bbox_2& bb )
 {
-    std::list<tgAccumEntry>::const_iterator it;
-    std::list<cgalPoly_PolygonWithHoles> accum;
-//  static int num_iter = 1;
-    
-    // traverse all of the Polygon_with_holes and accumulate their union
-    for ( it=accum_cgal_list.begin(); it!=accum_cgal_list.end(); it++ ) {
-        if ( CGAL::do_overlap( bbox, (*it).bbox ) ) {
-#if 0
-            if ( (*it).pwh.is_unbounded() ) {
-                SG_LOG(SG_GENERAL, SG_ALERT, "tgAccumulator::GetAccumPolygonSet - pwh is unbounded" );
-            } else {
-                SG_LOG(SG_GENERAL, SG_ALERT, "tgAccumulator::GetAccumPolygonSet - pwh is bounded" );
-            }
-#endif            
-            accum.push_back( (*it).pwh );
-        }
+    return tgAccumBox( tgAccumPoint( bb.xmin(), bb.ymin() ), tgAccumPoint( bb.xmax(), bb.ymax() ) );
+}
+
+static unsigned int countVertices( const cgalPoly_PolygonWithHoles& pwh )
+{
+    unsigned int count = pwh.outer_boundary().size();
+
+    cgalPoly_PolygonWithHoles::Hole_const_iterator hit;
+    for ( hit = pwh.holes_begin(); hit != pwh.holes_end(); ++hit ) {
+        count += hit->size();
     }
-    
-#if 0
-    if ( num_iter == 44 ) {
-        GDALDataset* pDS    = tgPolygonSet::openDatasource( "./joinDbg" );
-        char layer[128];
-        int  poly = 1;
-        
-        std::list<cgalPoly_PolygonWithHoles>::const_iterator pwhit = accum.begin();
-        while ( pwhit != accum.end() ) {
-            sprintf( layer, "poly_%04d", poly++ );
-            OGRLayer* pLayer = tgPolygonSet::openLayer( pDS, wkbLineString25D, tgPolygonSet::LF_DEBUG, layer );
-            tgPolygonSet::toDebugShapefile( pLayer, (*pwhit), "poly" );
-     
-            pwhit++;
-        }
-        GDALClose( pDS );        
+
+    return count;
+}
+
+// the accumulated entries whose bounding boxes overlap any of the
+// polygons_with_holes in ps - checking each piece keeps a multi part
+// subject spanning the tile from picking up everything in between
+void tgAccumulator::GetAccumEntries( const cgalPoly_PolygonSet& ps, std::vector<unsigned int>& found ) const
+{
+    std::list<cgalPoly_PolygonWithHoles> pwh_list;
+    std::list<cgalPoly_PolygonWithHoles>::const_iterator it;
+    std::vector<tgAccumValue> hits;
+
+    ps.polygons_with_holes( std::back_inserter(pwh_list) );
+    for (it = pwh_list.begin(); it != pwh_list.end(); ++it) {
+        index.query( boost::geometry::index::intersects( toAccumBox( it->outer_boundary().bbox() ) ), std::back_inserter(hits) );
     }
-#endif
 
-#if 0  
-    if ( num_iter == 44 ) {
-        std::ofstream output_file("./output_polys.txt");
-        if (!output_file.is_open()) {
-            std::cerr << "Failed to open the " << "./output_polys.txt" << std::endl;
-            exit(0);
-        }
-        
-        std::list<cgalPoly_PolygonWithHoles>::const_iterator pwhit = accum.begin();
-
-//      CGAL::set_pretty_mode(output_file);
-        output_file << std::setprecision(64);
-        output_file << accum.size() << "\n";
-        while ( pwhit != accum.end() ) {
-            output_file << (*pwhit);
-            pwhit++;
+    for ( unsigned int i=0; i<hits.size(); i++ ) {
+        found.push_back( hits[i].second );
+    }
+
+    std::sort( found.begin(), found.end() );
+    found.erase( std::unique( found.begin(), found.end() ), found.end() );
+}
+
+// merge the new piece with the cached unions it may touch, so later
+// lookups find one entry instead of many small ones
+void tgAccumulator::AddAccumPolygonWithHoles( const cgalPoly_PolygonWithHoles& pwh )
+{
+    std::vector<cgalPoly_PolygonWithHoles> pieces;
+    std::vector<tgAccumValue> hits;
+    CGAL::Bbox_2 bbox = pwh.outer_boundary().bbox();
+    unsigned int numVertices = countVertices( pwh );
+
+    pieces.push_back( pwh );
+
+    index.query( boost::geometry::index::intersects( toAccumBox( bbox ) ), std::back_inserter(hits) );
+    for ( unsigned int i=0; i<hits.size(); i++ ) {
+        tgAccumEntry& e = entries[hits[i].second];
+
+        if ( numVertices + e.numVertices > ACCUM_MAX_ENTRY_VERTICES ) {
+            continue;
         }
-        output_file.close();
+
+        e.ps.polygons_with_holes( std::back_inserter(pieces) );
+        bbox        += e.bbox;
+        numVertices += e.numVertices;
+
+        index.remove( hits[i] );
+        e = tgAccumEntry();
+        freeEntries.push_back( hits[i].second );
     }
-#endif
 
-//  SG_LOG(SG_GENERAL, SG_ALERT, "tgAccumulator::GetAccumPolygonSet " << num_iter << " join " << accum.size() << " Polygon_with_holes ");
-    accumPs.join( accum.begin(), accum.end() );
+    tgAccumEntry merged;
+    merged.ps.join( pieces.begin(), pieces.end() );
+    merged.bbox = bbox;
 
-#if 0    
-    std::list<cgalPoly_PolygonWithHoles>::const_iterator pwhit = accum.begin();
-    int joinNum = 1;
-    while ( pwhit != accum.end() ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, "tgAccumulator::GetAccumPolygonSet " << num_iter << " join " << joinNum++ );
-        ps.join( (*pwhit) );
-        pwhit++;
+    // touching pieces lose their shared vertices - count again
+    std::list<cgalPoly_PolygonWithHoles> pwh_list;
+    std::list<cgalPoly_PolygonWithHoles>::const_iterator it;
+    merged.ps.polygons_with_holes( std::back_inserter(pwh_list) );
+    for (it = pwh_list.begin(); it != pwh_list.end(); ++it) {
+        merged.numVertices += countVertices( *it );
     }
-#endif
 
-//  SG_LOG(SG_GENERAL, SG_ALERT, "tgAccumulator::GetAccumPolygonSet " << num_iter++ << " complete" );
+    unsigned int id;
+    if ( !freeEntries.empty() ) {
+        id = freeEntries.back();
+        freeEntries.pop_back();
+        entries[id] = merged;
+    } else {
+        id = entries.size();
+        entries.push_back( merged );
+    }
+
+    index.insert( tgAccumValue( toAccumBox( merged.bbox ), id ) );
 }
 
 void tgAccumulator::AddAccumPolygonSet( const cgalPoly_PolygonSet& ps )
 {
     std::list<cgalPoly_PolygonWithHoles> pwh_list;
     std::list<cgalPoly_PolygonWithHoles>::const_iterator it;
-    CGAL::Bbox_2 bbox;
 
+#if DEBUG_ACCUMULATOR_VALIDITY
     // make sure polygonSet is valid
     cgalPoly_PolygonSet tmp(ps);
     if ( !tmp.is_valid() ) {
         SG_LOG(SG_GENERAL, SG_ALERT, "tgAccumulator::AddAccumPolygonSet - polygonSet is invalid" );
     }
+#endif
 
     ps.polygons_with_holes( std::back_inserter(pwh_list) );
     for (it = pwh_list.begin(); it != pwh_list.end(); ++it) {
-        tgAccumEntry entry;
-        entry.pwh  = (*it);
-        entry.bbox =  entry.pwh.outer_boundary().bbox();
-
-        accum_cgal_list.push_back( entry );
-    }    
+        AddAccumPolygonWithHoles( *it );
+    }
 }
 
 void tgAccumulator::add( const tgPolygonSet& ps )
@@ -591,15 +609,17 @@ void tgAccumulator::Diff_and_Add_cgal( tgPolygonSet& subject )
 #endif
     
     cgalPoly_PolygonSet subPs  = subject.getPs();
-    
+
+#if DEBUG_ACCUMULATOR_VALIDITY
     // verify subject is valid
     if ( !subPs.is_valid() ) {
         SG_LOG(SG_GENERAL, SG_ALERT, "tgAccumulator::Diff_and_Add_cgal - subject is INVALID" );
     }
-    
-    cgalPoly_PolygonSet difPs;
-    GetAccumPolygonSet( subject.getBoundingBox(), difPs );
-    
+#endif
+
+    std::vector<unsigned int> candidates;
+    GetAccumEntries( subPs, candidates );
+
 #if DEBUG_DIFF_AND_ADD    
     sprintf( layer, "clip_%03ld_pre_subject", subject.getId() );
     toShapefile( add, layer );
@@ -617,8 +637,12 @@ void tgAccumulator::Diff_and_Add_cgal( tgPolygonSet& subject )
     ToShapefile( diff, layer );
 #endif
 
-    if ( difPs.number_of_polygons_with_holes() ) {
-        subPs.difference( difPs );
+    if ( !candidates.empty() ) {
+        // A - ( B u C ) == ( A - B ) - C : difference against each cached
+        // union in turn, rather than joining them all first
+        for ( unsigned int i=0; i<candidates.size() && !subPs.is_empty(); i++ ) {
+            tgPolygonSet::polygonBoolean( tgPolygonSet::BOOLEAN_DIFFERENCE, subPs, entries[candidates[i]].ps, subPs );
+        }
             
 #if DEBUG_DIFF_AND_ADD    
         sprintf( layer, "clip_%03ld_post_subject", subject.getId() );
@@ -628,15 +652,19 @@ void tgAccumulator::Diff_and_Add_cgal( tgPolygonSet& subject )
         subject.setPs( subPs );            
     }
 
-    // add the polygons_with_holes to the accumulator list
+    // add the polygons_with_holes to the accumulator
     AddAccumPolygonSet( subPs );
 }
 
 void tgAccumulator::toShapefile( const char* ds, const char* layer )
 {
-    CGAL::Bbox_2 bbox;
+    std::vector<cgalPoly_PolygonWithHoles> pieces;
     cgalPoly_PolygonSet all;
-    GetAccumPolygonSet( bbox, all );
+
+    for ( unsigned int i=0; i<entries.size(); i++ ) {
+        entries[i].ps.polygons_with_holes( std::back_inserter(pieces) );
+    }
+    all.join( pieces.begin(), pieces.end() );
     
     //all.toShapefile( ds, layer );    
 }
@@ -1,34 +1,49 @@
 #ifndef _TGACCUMULATOR_HXX
 #define _TGACCUMULATOR_HXX
 
+#include <boost/geometry.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
 #include "tg_polygon_set.hxx"
 
+// the accumulated area is kept as a number of polygon sets, each the
+// union of nearby pieces, indexed by bounding box in an R-tree
+typedef boost::geometry::model::point<double, 2, boost::geometry::cs::cartesian>    tgAccumPoint;
+typedef boost::geometry::model::box<tgAccumPoint>                                   tgAccumBox;
+typedef std::pair<tgAccumBox, unsigned int>                                         tgAccumValue;
+typedef boost::geometry::index::rtree< tgAccumValue, boost::geometry::index::quadratic<16> >  tgAccumTree;
+
 struct tgAccumEntry
 {
 public:
-    cgalPoly_PolygonWithHoles   pwh;
+    tgAccumEntry() : numVertices(0) {}
+
+    cgalPoly_PolygonSet         ps;
     CGAL::Bbox_2                bbox;
+    unsigned int                numVertices;
 };
 
 class tgAccumulator
 {
 public:
-    tgAccumulator() { accumEmpty = true; }
+    tgAccumulator() {}
 
     void      add(const tgPolygonSet& subject);
     void      Diff_and_Add_cgal( tgPolygonSet& subject );
-    
+
+    unsigned int getNumEntries( void ) const { return index.size(); }
+
     void      toShapefile( const char* datasource, const char* layer );
-    
-    
+
 private:
-    void                    GetAccumPolygonSet( const CGAL::Bbox_2& bb, cgalPoly_PolygonSet& accumPs );
+    void                    GetAccumEntries( const cgalPoly_PolygonSet& ps, std::vector<unsigned int>& found ) const;
     void                    AddAccumPolygonSet( const cgalPoly_PolygonSet& ps );
+    void                    AddAccumPolygonWithHoles( const cgalPoly_PolygonWithHoles& pwh );
 
-    bool                        accumEmpty;
-    cgalPoly_PolygonSet         accum_cgal;
-
-    std::list<tgAccumEntry>     accum_cgal_list;
+    // entries merged into others are cleared, and their slots reused
+    std::vector<tgAccumEntry>   entries;
+    std::vector<unsigned int>   freeEntries;
+    tgAccumTree                 index;
 };
 
-#endif // _TGACCUMULATOR_HXX
\ No newline at end of file
+#endif // _TGACCUMULATOR_HXX
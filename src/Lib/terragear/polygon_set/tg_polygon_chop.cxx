@@ -61,7 +61,7 @@ void tgChopper::Add( const tgPolygonSet& subject )
     PreChop( subject, chunks);
 
     for ( unsigned int i=0; i < chunks.size(); i++ ) {
-        chunks[i].clip(bucket_id, root_path, &lock);
+        chunks[i].clip( *this );
     }
 }
 
@@ -163,13 +163,11 @@ void tgChopper::PreChop( const tgPolygonSet& subject, std::vector<tgChopperChunk
     }
 }
 
-void tgChopperChunk::clip( long int bucket_id, std::string& rootPath, SGMutex* lock )
+void tgChopperChunk::clip( tgChopper& chopper )
 {
     for ( unsigned int i=0; i<buckets.size(); i++ ) {
         cgalPoly_Point    base_pts[4];
-        const std::string material = chunk.getMeta().material;
         SGGeod            pt;
-        char              layer[256];
         tgPolygonSet      result;
     
         SGTimeStamp       chop_begin, chop_end, chop_time;
@@ -190,11 +188,12 @@ void tgChopperChunk::clip( long int bucket_id, std::string& rootPath, SGMutex* l
     
 #if DEBUG_CHOPPER
         static unsigned int curClip=1;
+        const std::string material = chunk.getMeta().material;
         char debugDatasetName[128];
     
         sprintf(debugDatasetName, "./Chopper/tile_%s_%s", b.gen_index_str().c_str(), material.c_str() );
     
-        lock->lock();
+        chopper.lock.lock();
         SGPath sgp( debugDatasetName );
         sgp.create_dir( 0755 );
         
@@ -220,7 +219,7 @@ void tgChopperChunk::clip( long int bucket_id, std::string& rootPath, SGMutex* l
     
         curClip++;
         GDALClose( poDS );
-        lock->unlock();
+        chopper.lock.unlock();
 #endif
     
         if ( !result.isEmpty() ) {
@@ -229,29 +228,7 @@ void tgChopperChunk::clip( long int bucket_id, std::string& rootPath, SGMutex* l
             //          result.SetPreserve3D( true );
             //      }
         
-            long int cur_bucket = buckets[i].gen_index();
-            if ( ( bucket_id < 0 ) || (cur_bucket == bucket_id ) ) {
-                std::string path = rootPath + "/" + buckets[i].gen_base_path();
-                std::string polyfile = path + "/" + buckets[i].gen_index_str();
-            
-                // lock mutex to simgear directory creation
-                lock->lock();
-                SGPath sgp( polyfile );
-                sgp.create_dir( 0755 );
-                //lock.unlock();
-            
-                // now get a per dataset lock
-                //dataset.Request( cur_bucket );
-            
-                snprintf( layer, 256, "%s_%s", material.c_str(), result.getMeta().getMetaType().c_str() );
-            
-                // save chopped polygon to a Shapefile in layer named from material
-                result.toShapefile( polyfile.c_str(), material.c_str() );
-            
-                // Release per dataset lock
-                //dataset.Release( cur_bucket );
-                lock->unlock();
-            }
+            chopper.Save( buckets[i], result );
         }
 
         // dump debug...
@@ -259,4 +236,81 @@ void tgChopperChunk::clip( long int bucket_id, std::string& rootPath, SGMutex* l
         SG_LOG( SG_GENERAL, SG_DEBUG, "tgChopper Clip - avg chop time: " << total_chop_time/num_chops );
         num_chops++;        
     }
-}
\ No newline at end of file
+}
+
+void tgChopper::Save( const SGBucket& b, const tgPolygonSet& piece )
+{
+    long int cur_bucket = b.gen_index();
+    if ( ( bucket_id >= 0 ) && ( cur_bucket != bucket_id ) ) {
+        return;
+    }
+
+    tgchopperbuffer_map full;
+
+    lock.lock();
+
+    tgchopperbuffer_map::iterator it = buffers.find( cur_bucket );
+    if ( it == buffers.end() ) {
+        std::string path = root_path + "/" + b.gen_base_path();
+
+        // simgear directory creation isn't thread safe
+        SGPath sgp( path );
+        sgp.append( "dummy" );
+        sgp.create_dir( 0755 );
+
+        path += "/" + b.gen_index_str() + ".polys.gz";
+        it = buffers.insert( std::make_pair( cur_bucket, new tgChopperBuffer( path ) ) ).first;
+    }
+
+    it->second->polys.push_back( piece );
+    num_buffered++;
+
+    // take the buffers to write - the others can go on buffering meanwhile
+    if ( it->second->polys.size() >= flush_size ) {
+        num_buffered -= it->second->polys.size();
+        full.insert( *it );
+        buffers.erase( it );
+    } else if ( num_buffered >= max_buffered ) {
+        full.swap( buffers );
+        num_buffered = 0;
+    }
+
+    lock.unlock();
+
+    for ( tgchopperbuffer_map::iterator fit = full.begin(); fit != full.end(); fit++ ) {
+        Write( fit->first, fit->second );
+    }
+}
+
+void tgChopper::Write( long int bucket, tgChopperBuffer* buffer )
+{
+    // another thread may be writing the same bucket
+    dataset.Request( bucket );
+
+    if ( !tgPolygonSet::toPolysFile( buffer->path, buffer->polys ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgChopper: lost " << buffer->polys.size() << " polys for " << buffer->path );
+    }
+
+    dataset.Release( bucket );
+
+    delete buffer;
+}
+
+void tgChopper::Flush( void )
+{
+    tgchopperbuffer_map full;
+
+    lock.lock();
+    full.swap( buffers );
+    num_buffered = 0;
+    lock.unlock();
+
+    for ( tgchopperbuffer_map::iterator it = full.begin(); it != full.end(); it++ ) {
+        Write( it->first, it->second );
+    }
+}
+
+tgChopper::~tgChopper()
+{
+    Flush();
+}
@@ -7,6 +7,11 @@
 #include <terragear/tg_dataset_protect.hxx>
 #include "tg_polygon_set.hxx"
 
+#define CHOPPER_FLUSH_SIZE      (256)
+#define CHOPPER_MAX_BUFFERED    (65536)
+
+class tgChopper;
+
 class tgChopperChunk
 {
 public:
@@ -16,28 +21,68 @@ public:
     
     void setBuckets( const SGGeod& min, const SGGeod& max, bool checkBorders );
     
-    void clip( long int bucket_id, std::string& rootPath, SGMutex* lock );
+    void clip( tgChopper& chopper );
     
 private:
     std::vector<SGBucket>   buckets;
     tgPolygonSet            chunk;
 };
 
+// chopped polygons of one bucket, waiting to be written
+struct tgChopperBuffer
+{
+    tgChopperBuffer( const std::string& p ) : path(p) {}
+
+    std::string         path;           // the polys file
+    tgPolygonSetList    polys;
+};
+
+typedef std::map<long int, tgChopperBuffer*>   tgchopperbuffer_map;
+
+// Clips polygons to the buckets they cover, and appends the pieces to the
+// bucket's polys file - see tgPolygonSet::toPolysFile.  The pieces are
+// buffered per bucket, and a bucket is written in one go when it has
+// flushSize pieces, when all buckets together hold maxBuffered, and on
+// Flush() or destruction.  Different buckets are written at the same
+// time; tgDatasetAcess keeps two threads out of the same one.
 class tgChopper
 {
 public:
     tgChopper( const std::string& path, long int bid = -1 ) {
-        root_path = path;
-        bucket_id = bid;
+        root_path    = path;
+        bucket_id    = bid;
+        flush_size   = CHOPPER_FLUSH_SIZE;
+        max_buffered = CHOPPER_MAX_BUFFERED;
+        num_buffered = 0;
     }
+    ~tgChopper();
 
     void Add( const tgPolygonSet& poly );
 
+    // write out every buffered piece
+    void Flush( void );
+
+    // pieces per bucket to buffer before writing it - 1 writes each
+    // piece as it is clipped
+    void SetFlushSize( unsigned int s ) { flush_size = s ? s : 1; }
+
+    friend class tgChopperChunk;
+
 private:
     void PreChop( const tgPolygonSet& subject, std::vector<tgChopperChunk>& chunks );
 
-    long int         bucket_id;     // set if we only want to save a single bucket
-    std::string      root_path;
-    SGMutex          lock;
-    tgDatasetAcess   dataset;
-};
\ No newline at end of file
+    // buffer a clipped piece
+    void Save( const SGBucket& b, const tgPolygonSet& piece );
+    void Write( long int bucket, tgChopperBuffer* buffer );
+
+    long int            bucket_id;     // set if we only want to save a single bucket
+    std::string         root_path;
+    unsigned int        flush_size;
+    unsigned int        max_buffered;
+
+    SGMutex             lock;           // buffers, and directory creation
+    tgchopperbuffer_map buffers;
+    unsigned int        num_buffered;
+
+    tgDatasetAcess      dataset;
+};
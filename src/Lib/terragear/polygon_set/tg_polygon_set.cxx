@@ -302,22 +302,24 @@ void tgPolygonSet::calcInteriorPoints( void )
 void tgPolygonSet::intersection2( const tgPolygonSet& subject, const cgalPoly_Polygon& diff )
 {    
     cgalPoly_PolygonSet psDiff(diff);
-    ps.intersection( subject.getPs(), psDiff );
+    polygonBoolean( BOOLEAN_INTERSECTION, subject.getPs(), psDiff, ps );
     meta = subject.getMeta();
 }
 
 void tgPolygonSet::intersection2( const cgalPoly_Polygon& diff )
 {    
-    ps.intersection( diff );
+    cgalPoly_PolygonSet psDiff(diff);
+    polygonBoolean( BOOLEAN_INTERSECTION, ps, psDiff, ps );
 }
 
 // intersect and return a new tgPolygonSet
 tgPolygonSet tgPolygonSet::intersection( const cgalPoly_Polygon& other ) const
 {
     // copy the geometry;
-    cgalPoly_PolygonSet result = getPs();
+    cgalPoly_PolygonSet result;
+    cgalPoly_PolygonSet psOther(other);
 
-    result.intersection( other );
+    polygonBoolean( BOOLEAN_INTERSECTION, getPs(), psOther, result );
     
     // create a new polygonSet
     return tgPolygonSet( result, getMeta() );
@@ -330,17 +332,15 @@ void tgPolygonSet::difference( const cgalPoly_Polygon& other )
 
 void tgPolygonSet::join( const cgalPoly_Polygon& other )
 {    
-    ps.join( other );    
+    cgalPoly_PolygonSet psOther(other);
+    polygonBoolean( BOOLEAN_UNION, ps, psOther, ps );
 }
 
 tgPolygonSet tgPolygonSet::join( const tgPolygonSetList& sets, const tgPolygonSetMeta& m )
 {
-    tgPolygonSetList::const_iterator it;
     cgalPoly_PolygonSet              result;
     
-    for ( it = sets.begin(); it != sets.end(); it++ ) {
-        result.join( it->getPs() );
-    }
+    polygonUnion( sets, result );
     
     return tgPolygonSet( result, m );
 }
@@ -349,7 +349,7 @@ tgPolygonSet tgPolygonSet::symmetricDifference( const tgPolygonSet& a, const tgP
 {
     cgalPoly_PolygonSet result;
     
-    result.symmetric_difference( a.getPs(), b.getPs() );
+    polygonBoolean( BOOLEAN_SYMMETRIC_DIFFERENCE, a.getPs(), b.getPs(), result );
     
     return tgPolygonSet( result, m );
 }
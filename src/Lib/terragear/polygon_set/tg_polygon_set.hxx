@@ -1,8 +1,12 @@
 #ifndef __TG_POLYGON_SET_HXX__
 #define __TG_POLYGON_SET_HXX__
 
+#include <zlib.h>
+
 #include <ogrsf_frmts.h>
 
+#include <simgear/threads/SGThread.hxx>
+
 #include <terragear/clipper.hpp>
 #include <terragear/tg_surface.hxx>
 #include <terragear/tg_cluster.hxx>
@@ -109,6 +113,9 @@ public:
     // I/O
     void getFeatureFields( OGRFeature* poFeature );
     void setFeatureFields( OGRFeature* poFeature ) const;
+
+    void SaveToGzFile( gzFile& fp ) const;
+    void LoadFromGzFile( gzFile& fp );
     
     MetaInfo_e      info;
 
@@ -214,6 +221,15 @@ public:
     // Intermediate file input
     static void                         fromShapefile( const SGPath& p, tgPolygonSetList& polys );
 
+    // Chopped polygon files - all polygon sets of a bucket in one file,
+    // <base path>/<index>.polys.gz.  Writers append - the file is locked
+    // against other processes, but not against other threads.
+    static bool                         toPolysFile( const std::string& path, const tgPolygonSetList& polys );
+    static bool                         fromPolysFile( const std::string& path, tgPolygonSetList& polys );
+
+    void                                SaveToGzFile( gzFile& fp ) const;
+    void                                LoadFromGzFile( gzFile& fp );
+
     // Static Debug functions
     static void                         toDebugShapefile( OGRLayer* poLayer, const cgalPoly_Point& point, const char* desc );
     static void                         toDebugShapefile( OGRLayer* poLayer, const cgalPoly_PolygonSet& polySet, const char* desc );
@@ -247,6 +263,31 @@ public:
     void                                join( const cgalPoly_Polygon& other );
     static tgPolygonSet                 join( const tgPolygonSetList& sets, const tgPolygonSetMeta& meta );
     static tgPolygonSet                 symmetricDifference( const tgPolygonSet& a, const tgPolygonSet& b, const tgPolygonSetMeta& meta );
+
+    // how the booleans above are computed - with clipper on the 1e-12
+    // degree grid, falling back to exact CGAL when the input is too close
+    // to degenerate for the grid, or the result fails a cheap area check,
+    // always exact, or both, logging where the areas differ
+    typedef enum {
+        BOOLEANS_HYBRID,
+        BOOLEANS_EXACT,
+        BOOLEANS_VERIFY
+    } booleanMethod;
+
+    typedef enum {
+        BOOLEAN_INTERSECTION,
+        BOOLEAN_UNION,
+        BOOLEAN_DIFFERENCE,
+        BOOLEAN_SYMMETRIC_DIFFERENCE
+    } booleanType;
+
+    static void                         setBooleanMethod( booleanMethod m );
+
+    // result = a op b - result may be a
+    static void                         polygonBoolean( booleanType op, const cgalPoly_PolygonSet& a, const cgalPoly_PolygonSet& b, cgalPoly_PolygonSet& result );
+
+    // log how many booleans went through clipper, and why the rest fell back
+    static void                         reportBooleans( void );
     
     tgPolygonSet                        offset( double oset ) const;
         
@@ -266,18 +307,37 @@ private:
     cgalPoly_PolygonWithHoles           splitLongEdges( cgalPoly_PolygonWithHoles& pwh, int maxSegmentLength );
   
 // to / from clipper for Polygon Offsetting ( Can't get CGAL to propery shrink Polygons....  TODO, maybe
-    double                              toClipper( double dist ) const;
+    static double                       toClipper( double dist );
     
-    ClipperLib::IntPoint                toClipper( const cgalPoly_Point& p ) const;
-    cgalPoly_Point                      fromClipper( const ClipperLib::IntPoint& p ) const;
+    static ClipperLib::IntPoint         toClipper( const cgalPoly_Point& p );
+    static cgalPoly_Point               fromClipper( const ClipperLib::IntPoint& p );
     
-    ClipperLib::Path                    toClipper( const cgalPoly_Polygon& subject, bool isHole ) const;
-    cgalPoly_Polygon                    fromClipper( const ClipperLib::Path& subject ) const;
+    static ClipperLib::Path             toClipper( const cgalPoly_Polygon& subject, bool isHole );
+    static cgalPoly_Polygon             fromClipper( const ClipperLib::Path& subject );
     
-    void                                toClipper( const cgalPoly_PolygonWithHoles& pwh, ClipperLib::Paths& paths ) const;
-    ClipperLib::Paths                   toClipper( const cgalPoly_PolygonSet& ps ) const;
+    static void                         toClipper( const cgalPoly_PolygonWithHoles& pwh, ClipperLib::Paths& paths );
+    static ClipperLib::Paths            toClipper( const cgalPoly_PolygonSet& ps );
     
-    cgalPoly_PolygonSet                 fromClipper( const ClipperLib::Paths& subject ) const;
+    static cgalPoly_PolygonSet          fromClipper( const ClipperLib::Paths& subject );
+
+    // booleans through clipper - false, with the reason counted, when the
+    // result can't be trusted
+    static bool                         clipperBoolean( booleanType op, const std::vector<ClipperLib::Paths>& subjects, const ClipperLib::Paths& clip, cgalPoly_PolygonSet& result );
+    static bool                         wellConditioned( const ClipperLib::Paths& paths );
+    static void                         fromClipper( const ClipperLib::PolyNode* node, std::vector<cgalPoly_PolygonWithHoles>& pwhs );
+    static void                         exactBoolean( booleanType op, const cgalPoly_PolygonSet& a, const cgalPoly_PolygonSet& b, cgalPoly_PolygonSet& result );
+    static void                         verifyBoolean( const cgalPoly_PolygonSet& fast, const cgalPoly_PolygonSet& exact );
+    static void                         polygonUnion( const tgPolygonSetList& sets, cgalPoly_PolygonSet& result );
+
+    static booleanMethod                boolMethod;
+
+    static SGMutex                      boolLock;
+    static unsigned long                boolFast;
+    static unsigned long                boolExact;
+    static unsigned long                boolBadInput;
+    static unsigned long                boolFailed;
+    static unsigned long                boolBadArea;
+    static unsigned long                boolMismatch;
     
     cgalPoly_PolygonSet                 ps;
     std::vector<cgalPoly_Point>         interiorPoints;
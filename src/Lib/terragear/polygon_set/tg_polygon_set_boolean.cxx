@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <cmath>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include <terragear/tg_profile.hxx>
+
+#include "tg_polygon_set.hxx"
+
+// clipper results are off the exact ones by at most half a grid unit per
+// vertex - the area by at most the perimeter.  Anything more, and
+// something went wrong.
+#define BOOLEAN_AREA_TOLERANCE      (1.0e-7)
+
+tgPolygonSet::booleanMethod tgPolygonSet::boolMethod   = tgPolygonSet::BOOLEANS_HYBRID;
+
+SGMutex       tgPolygonSet::boolLock;
+unsigned long tgPolygonSet::boolFast     = 0;
+unsigned long tgPolygonSet::boolExact    = 0;
+unsigned long tgPolygonSet::boolBadInput = 0;
+unsigned long tgPolygonSet::boolFailed   = 0;
+unsigned long tgPolygonSet::boolBadArea  = 0;
+unsigned long tgPolygonSet::boolMismatch = 0;
+
+static const ClipperLib::ClipType clipTypes[4] = {
+    ClipperLib::ctIntersection,
+    ClipperLib::ctUnion,
+    ClipperLib::ctDifference,
+    ClipperLib::ctXor
+};
+
+// signed area in grid units - holes are negative - and the perimeter
+static double clipperArea( const ClipperLib::Path& path, double& perimeter )
+{
+    for ( unsigned int i=0; i<path.size(); i++ ) {
+        const ClipperLib::IntPoint& p = path[i];
+        const ClipperLib::IntPoint& q = path[ (i+1) % path.size() ];
+
+        perimeter += sqrt( (double)( q.X - p.X ) * ( q.X - p.X ) + (double)( q.Y - p.Y ) * ( q.Y - p.Y ) );
+    }
+
+    return ClipperLib::Area( path );
+}
+
+static double clipperArea( const ClipperLib::Paths& paths, double& perimeter )
+{
+    double area = 0.0;
+
+    for ( unsigned int i=0; i<paths.size(); i++ ) {
+        area += clipperArea( paths[i], perimeter );
+    }
+
+    return area;
+}
+
+void tgPolygonSet::setBooleanMethod( booleanMethod m )
+{
+    boolMethod = m;
+}
+
+void tgPolygonSet::reportBooleans( void )
+{
+    SGGuard<SGMutex> g( boolLock );
+
+    unsigned long fallbacks = boolBadInput + boolFailed + boolBadArea;
+    unsigned long hybrid    = boolFast + fallbacks;
+    double        rate      = hybrid ? 100.0 * fallbacks / hybrid : 0.0;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Polygon booleans: " << boolFast << " through clipper, " <<
+                                  fallbacks << " fell back to exact (" << rate << "%) - " <<
+                                  boolBadInput << " near degenerate input, " << boolFailed << " clipper failures, " <<
+                                  boolBadArea << " failed the area check - " <<
+                                  boolExact << " exact only, " << boolMismatch << " mismatches" );
+}
+
+// every ring still a ring on the grid - no vertices rounded onto their
+// neighbors, and no rings flattened
+bool tgPolygonSet::wellConditioned( const ClipperLib::Paths& paths )
+{
+    for ( unsigned int i=0; i<paths.size(); i++ ) {
+        const ClipperLib::Path& path = paths[i];
+
+        if ( path.size() < 3 ) {
+            return false;
+        }
+        for ( unsigned int j=0; j<path.size(); j++ ) {
+            if ( path[j] == path[ (j+1) % path.size() ] ) {
+                return false;
+            }
+        }
+        if ( ClipperLib::Area( path ) == 0.0 ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// an outer boundary, its holes, and whatever is inside those
+void tgPolygonSet::fromClipper( const ClipperLib::PolyNode* node, std::vector<cgalPoly_PolygonWithHoles>& pwhs )
+{
+    cgalPoly_Polygon outer = fromClipper( node->Contour );
+    if ( !ClipperLib::Orientation( node->Contour ) ) {
+        outer.reverse_orientation();
+    }
+
+    cgalPoly_PolygonWithHoles pwh( outer );
+    for ( unsigned int i=0; i<node->Childs.size(); i++ ) {
+        const ClipperLib::PolyNode* hole = node->Childs[i];
+
+        cgalPoly_Polygon inner = fromClipper( hole->Contour );
+        if ( ClipperLib::Orientation( hole->Contour ) ) {
+            inner.reverse_orientation();
+        }
+        pwh.add_hole( inner );
+
+        for ( unsigned int j=0; j<hole->Childs.size(); j++ ) {
+            fromClipper( hole->Childs[j], pwhs );
+        }
+    }
+
+    pwhs.push_back( pwh );
+}
+
+// the subjects are or'ed together, then combined with clip.  The result
+// only has points read from the grid, so the polygon set is built
+// without any exact constructions.
+bool tgPolygonSet::clipperBoolean( booleanType op, const std::vector<ClipperLib::Paths>& subjects, const ClipperLib::Paths& clip, cgalPoly_PolygonSet& result )
+{
+    double subjectArea = 0.0, subjectMax = 0.0, clipArea, resultArea = 0.0;
+    double perimeter = 0.0;
+
+    bool conditioned = wellConditioned( clip );
+    for ( unsigned int i=0; i<subjects.size() && conditioned; i++ ) {
+        conditioned = wellConditioned( subjects[i] );
+    }
+    if ( !conditioned ) {
+        SGGuard<SGMutex> g( boolLock );
+        boolBadInput++;
+        return false;
+    }
+
+    // clipper won't execute without edges
+    bool empty = clip.empty();
+    for ( unsigned int i=0; i<subjects.size() && empty; i++ ) {
+        empty = subjects[i].empty();
+    }
+    if ( empty ) {
+        result.clear();
+
+        SGGuard<SGMutex> g( boolLock );
+        boolFast++;
+        return true;
+    }
+
+    ClipperLib::Clipper  c;
+    ClipperLib::PolyTree tree;
+    bool                 executed;
+
+    c.StrictlySimple( true );
+    try {
+        for ( unsigned int i=0; i<subjects.size(); i++ ) {
+            double a = clipperArea( subjects[i], perimeter );
+
+            subjectArea += a;
+            if ( a > subjectMax ) {
+                subjectMax = a;
+            }
+            c.AddPaths( subjects[i], ClipperLib::ptSubject, true );
+        }
+        clipArea = clipperArea( clip, perimeter );
+        c.AddPaths( clip, ClipperLib::ptClip, true );
+
+        executed = c.Execute( clipTypes[op], tree, ClipperLib::pftNonZero, ClipperLib::pftNonZero );
+    } catch ( ClipperLib::clipperException& e ) {
+        SG_LOG( SG_GENERAL, SG_INFO, "tgPolygonSet::clipperBoolean - " << e.what() );
+        executed = false;
+    }
+
+    if ( !executed ) {
+        SGGuard<SGMutex> g( boolLock );
+        boolFailed++;
+        return false;
+    }
+
+    // the input perimeter bounds the result's for everything but the
+    // vertices clipper adds - count those too
+    for ( ClipperLib::PolyNode* node = tree.GetFirst(); node; node = node->GetNext() ) {
+        resultArea += clipperArea( node->Contour, perimeter );
+    }
+
+    double tolerance = BOOLEAN_AREA_TOLERANCE * ( subjectArea + clipArea ) + perimeter;
+    bool   areaOk    = ( resultArea >= -tolerance );
+
+    switch( op ) {
+        case BOOLEAN_INTERSECTION:
+            areaOk = areaOk && resultArea <= std::min( subjectArea, clipArea ) + tolerance;
+            break;
+
+        case BOOLEAN_UNION:
+            areaOk = areaOk && resultArea >= std::max( subjectMax, clipArea ) - tolerance &&
+                               resultArea <= subjectArea + clipArea + tolerance;
+            break;
+
+        case BOOLEAN_DIFFERENCE:
+            areaOk = areaOk && resultArea >= subjectArea - clipArea - tolerance &&
+                               resultArea <= subjectArea + tolerance;
+            break;
+
+        case BOOLEAN_SYMMETRIC_DIFFERENCE:
+            areaOk = areaOk && resultArea >= fabs( subjectArea - clipArea ) - tolerance &&
+                               resultArea <= subjectArea + clipArea + tolerance;
+            break;
+    }
+
+    if ( !areaOk ) {
+        SG_LOG( SG_GENERAL, SG_INFO, "tgPolygonSet::clipperBoolean - result area " << resultArea << " out of bounds for inputs " << subjectArea << ", " << clipArea );
+
+        SGGuard<SGMutex> g( boolLock );
+        boolBadArea++;
+        return false;
+    }
+
+    std::vector<cgalPoly_PolygonWithHoles> pwhs;
+    for ( unsigned int i=0; i<tree.Childs.size(); i++ ) {
+        fromClipper( tree.Childs[i], pwhs );
+    }
+
+    // the pieces only touch - joining them finds no new intersections
+    result.clear();
+    result.join( pwhs.begin(), pwhs.end() );
+
+    SGGuard<SGMutex> g( boolLock );
+    boolFast++;
+
+    return true;
+}
+
+void tgPolygonSet::exactBoolean( booleanType op, const cgalPoly_PolygonSet& a, const cgalPoly_PolygonSet& b, cgalPoly_PolygonSet& result )
+{
+    // the two operand versions build a new arrangement before replacing
+    // ours - result can be a or b
+    switch( op ) {
+        case BOOLEAN_INTERSECTION:
+            result.intersection( a, b );
+            break;
+
+        case BOOLEAN_UNION:
+            result.join( a, b );
+            break;
+
+        case BOOLEAN_DIFFERENCE:
+            result.difference( a, b );
+            break;
+
+        case BOOLEAN_SYMMETRIC_DIFFERENCE:
+            result.symmetric_difference( a, b );
+            break;
+    }
+}
+
+void tgPolygonSet::verifyBoolean( const cgalPoly_PolygonSet& fast, const cgalPoly_PolygonSet& exact )
+{
+    double perimeter = 0.0;
+    double fastArea  = clipperArea( toClipper( fast ), perimeter );
+    double exactArea = clipperArea( toClipper( exact ), perimeter );
+
+    if ( fabs( fastArea - exactArea ) > BOOLEAN_AREA_TOLERANCE * exactArea + perimeter ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgPolygonSet::verifyBoolean - clipper area " << fastArea << " exact area " << exactArea );
+
+        SGGuard<SGMutex> g( boolLock );
+        boolMismatch++;
+    }
+}
+
+void tgPolygonSet::polygonBoolean( booleanType op, const cgalPoly_PolygonSet& a, const cgalPoly_PolygonSet& b, cgalPoly_PolygonSet& result )
+{
+    if ( boolMethod == BOOLEANS_EXACT ) {
+        exactBoolean( op, a, b, result );
+
+        SGGuard<SGMutex> g( boolLock );
+        boolExact++;
+        return;
+    }
+
+    std::vector<ClipperLib::Paths> subjects( 1 );
+    subjects[0] = toClipper( a );
+
+    cgalPoly_PolygonSet fast;
+    bool                ok = clipperBoolean( op, subjects, toClipper( b ), fast );
+
+    if ( boolMethod == BOOLEANS_VERIFY ) {
+        exactBoolean( op, a, b, result );
+        if ( ok ) {
+            verifyBoolean( fast, result );
+        }
+    } else if ( ok ) {
+        result = fast;
+    } else {
+        tgProfile::count( "booleanFallbacks", 1 );
+        exactBoolean( op, a, b, result );
+    }
+}
+
+// all sets at once - one clipper union instead of one join per set
+void tgPolygonSet::polygonUnion( const tgPolygonSetList& sets, cgalPoly_PolygonSet& result )
+{
+    tgPolygonSetList::const_iterator it;
+    bool                             ok = false;
+    cgalPoly_PolygonSet              fast;
+
+    if ( boolMethod != BOOLEANS_EXACT ) {
+        std::vector<ClipperLib::Paths> subjects;
+        for ( it = sets.begin(); it != sets.end(); it++ ) {
+            subjects.push_back( toClipper( it->getPs() ) );
+        }
+
+        ok = clipperBoolean( BOOLEAN_UNION, subjects, ClipperLib::Paths(), fast );
+        if ( ok && boolMethod == BOOLEANS_HYBRID ) {
+            result = fast;
+            return;
+        }
+    }
+
+    result.clear();
+    for ( it = sets.begin(); it != sets.end(); it++ ) {
+        result.join( it->getPs() );
+    }
+
+    if ( boolMethod == BOOLEANS_VERIFY ) {
+        if ( ok ) {
+            verifyBoolean( fast, result );
+        }
+    } else if ( boolMethod == BOOLEANS_EXACT ) {
+        SGGuard<SGMutex> g( boolLock );
+        boolExact++;
+    } else {
+        tgProfile::count( "booleanFallbacks", 1 );
+    }
+}
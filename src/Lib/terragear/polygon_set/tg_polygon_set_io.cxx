@@ -1,9 +1,20 @@
+#include <cstdio>
+
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
 #include <simgear/debug/logstream.hxx>
+#include <simgear/io/lowlevel.hxx>
 
 #include "tg_polygon_set.hxx"
 
 #include <simgear/misc/sg_path.hxx> // for file i/o
 
+// every append to a polys file starts with a header of magic, version,
+// and the number of polygon sets that follow
+#define POLYS_FILE_MAGIC        (0x54475053)    // "TGPS"
+#define POLYS_FILE_VERSION      (1)
+
 // we are loading polygonal data from untrusted sources
 // high probability this will crash CGAL if we just load 
 // the points.  previous terragear would attempt to clean
@@ -664,3 +675,175 @@ void tgPolygonSet::fromShapefile( const SGPath& p, tgPolygonSetList& polys )
         SG_LOG( SG_GENERAL, SG_DEBUG, "return poly " << i << " with material " << polys[i].getMeta().getMaterial() );
     }        
 }
+
+static void ringToGzFile( gzFile& fp, const cgalPoly_Polygon& ring )
+{
+    cgalPoly_Polygon::Vertex_const_iterator vit;
+
+    sgWriteUInt( fp, ring.size() );
+    for ( vit = ring.vertices_begin(); vit != ring.vertices_end(); vit++ ) {
+        sgWriteDouble( fp, CGAL::to_double( vit->x() ) );
+        sgWriteDouble( fp, CGAL::to_double( vit->y() ) );
+    }
+}
+
+static void ringFromGzFile( gzFile& fp, std::vector<cgalPoly_Point>& nodes )
+{
+    unsigned int count;
+    double       x, y;
+
+    sgReadUInt( fp, &count );
+
+    nodes.clear();
+    for ( unsigned int i=0; i<count && !gzeof( fp ); i++ ) {
+        sgReadDouble( fp, &x );
+        sgReadDouble( fp, &y );
+        nodes.push_back( cgalPoly_Point( x, y ) );
+    }
+}
+
+void tgPolygonSet::SaveToGzFile( gzFile& fp ) const
+{
+    std::list<cgalPoly_PolygonWithHoles>                 pwh_list;
+    std::list<cgalPoly_PolygonWithHoles>::const_iterator it;
+
+    meta.SaveToGzFile( fp );
+
+    ps.polygons_with_holes( std::back_inserter(pwh_list) );
+    sgWriteUInt( fp, pwh_list.size() );
+
+    for (it = pwh_list.begin(); it != pwh_list.end(); ++it) {
+        ringToGzFile( fp, it->outer_boundary() );
+
+        sgWriteUInt( fp, it->number_of_holes() );
+
+        cgalPoly_PolygonWithHoles::Hole_const_iterator hit;
+        for (hit = it->holes_begin(); hit != it->holes_end(); ++hit) {
+            ringToGzFile( fp, *hit );
+        }
+    }
+}
+
+// the rings are rounded to doubles - rebuild the set from them the way
+// we do from shapefiles
+void tgPolygonSet::LoadFromGzFile( gzFile& fp )
+{
+    std::vector<cgalPoly_Polygon>	boundaries;
+    std::vector<cgalPoly_Polygon>	holes;
+    cgalPoly_PolygonSet             holesUnion;
+    std::vector<cgalPoly_Point>     nodes;
+    unsigned int                    numPwh, numHoles;
+
+    meta.LoadFromGzFile( fp );
+
+    sgReadUInt( fp, &numPwh );
+    for ( unsigned int i=0; i<numPwh && !gzeof( fp ); i++ ) {
+        ringFromGzFile( fp, nodes );
+        facesFromUntrustedNodes( nodes, boundaries, holes );
+
+        sgReadUInt( fp, &numHoles );
+        for ( unsigned int j=0; j<numHoles && !gzeof( fp ); j++ ) {
+            ringFromGzFile( fp, nodes );
+            facesFromUntrustedNodes( nodes, holes, boundaries );
+        }
+    }
+
+    ps.clear();
+
+    // join all the boundaries
+    ps.join( boundaries.begin(), boundaries.end() );
+
+    // join all the holes
+    holesUnion.join( holes.begin(), holes.end() );
+
+    // perform difference
+    ps.difference( holesUnion );
+}
+
+bool tgPolygonSet::toPolysFile( const std::string& path, const tgPolygonSetList& polys )
+{
+    // the file lock needs the file
+    FILE* f = fopen( path.c_str(), "ab" );
+    if ( !f ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgPolygonSet::toPolysFile: can't open " << path );
+        return false;
+    }
+    fclose( f );
+
+    // other processes may be chopping into the same bucket
+    boost::interprocess::file_lock                                  flock( path.c_str() );
+    boost::interprocess::scoped_lock<boost::interprocess::file_lock> guard( flock );
+
+    // appending starts a new gzip member - gzread reads on through them
+    gzFile fp = gzopen( path.c_str(), "ab" );
+    if ( !fp ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgPolygonSet::toPolysFile: can't open " << path );
+        return false;
+    }
+
+    sgWriteUInt( fp, POLYS_FILE_MAGIC );
+    sgWriteUInt( fp, POLYS_FILE_VERSION );
+    sgWriteUInt( fp, polys.size() );
+
+    for ( unsigned int i=0; i<polys.size(); i++ ) {
+        polys[i].SaveToGzFile( fp );
+    }
+
+    if ( gzclose( fp ) != Z_OK ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgPolygonSet::toPolysFile: error writing " << path );
+        return false;
+    }
+
+    return true;
+}
+
+// the read error flag of sgRead... is shared by all threads - we look
+// for the end of the file instead
+bool tgPolygonSet::fromPolysFile( const std::string& path, tgPolygonSetList& polys )
+{
+    bool ok = true;
+
+    polys.clear();
+
+    gzFile fp = gzopen( path.c_str(), "rb" );
+    if ( !fp ) {
+        SG_LOG( SG_GENERAL, SG_DEBUG, "tgPolygonSet::fromPolysFile: can't open " << path );
+        return false;
+    }
+
+    while ( ok ) {
+        unsigned int magic, version, count;
+
+        sgReadUInt( fp, &magic );
+        if ( gzeof( fp ) ) {
+            break;
+        }
+
+        sgReadUInt( fp, &version );
+        sgReadUInt( fp, &count );
+        if ( magic != POLYS_FILE_MAGIC || version != POLYS_FILE_VERSION ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "tgPolygonSet::fromPolysFile: " << path << " is not a version " << POLYS_FILE_VERSION << " polys file" );
+            ok = false;
+            break;
+        }
+
+        for ( unsigned int i=0; i<count; i++ ) {
+            tgPolygonSet poly;
+
+            poly.LoadFromGzFile( fp );
+            if ( gzeof( fp ) ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "tgPolygonSet::fromPolysFile: " << path << " is truncated" );
+                ok = false;
+                break;
+            }
+
+            polys.push_back( poly );
+        }
+    }
+
+    gzclose( fp );
+
+    SG_LOG( SG_GENERAL, SG_DEBUG, "tgPolygonSet::fromPolysFile: read " << polys.size() << " polys from " << path );
+
+    return ok;
+}
@@ -1,4 +1,6 @@
 #include <simgear/debug/logstream.hxx>
+#include <simgear/io/lowlevel.hxx>
+
 #include "tg_polygon_set.hxx"
 
 // every polygon set (metadata) gets its own unique identifier
@@ -216,3 +218,105 @@ void tgPolygonSetMeta::getFieldAsString( OGRFeature* poFeature, const char* fiel
     }
 }
 
+
+// the fields the shapefiles carry, and the smoothing surface
+void tgPolygonSetMeta::SaveToGzFile( gzFile& fp ) const
+{
+    sgWriteInt( fp, (int)info );
+    sgWriteString( fp, material.c_str() );
+    sgWriteInt( fp, (int)method );
+
+    sgWriteDouble( fp, reflon );
+    sgWriteDouble( fp, reflat );
+    sgWriteDouble( fp, width );
+    sgWriteDouble( fp, length );
+    sgWriteDouble( fp, heading );
+
+    sgWriteDouble( fp, minu );
+    sgWriteDouble( fp, maxu );
+    sgWriteDouble( fp, minv );
+    sgWriteDouble( fp, maxv );
+
+    sgWriteDouble( fp, min_clipu );
+    sgWriteDouble( fp, max_clipu );
+    sgWriteDouble( fp, min_clipv );
+    sgWriteDouble( fp, max_clipv );
+
+    sgWriteDouble( fp, center_lat );
+
+    sgWriteUInt( fp, surfaceCoefficients.size() );
+    for ( unsigned int i=0; i<surfaceCoefficients.size(); i++ ) {
+        sgWriteDouble( fp, surfaceCoefficients[i] );
+    }
+    sgWriteGeod( fp, surfaceMin );
+    sgWriteGeod( fp, surfaceMax );
+    sgWriteGeod( fp, surfaceCenter );
+
+    sgWriteUInt( fp, (unsigned int)flags );
+    sgWriteUInt( fp, (unsigned int)id );
+    sgWriteUInt( fp, (unsigned int)fid );
+    sgWriteString( fp, description.c_str() );
+}
+
+void tgPolygonSetMeta::LoadFromGzFile( gzFile& fp )
+{
+    unsigned int count, value;
+    int          ivalue;
+    char*        strbuff;
+
+    sgReadInt( fp, &ivalue );
+    info = (MetaInfo_e)ivalue;
+
+    sgReadString( fp, &strbuff );
+    if ( strbuff ) {
+        material = strbuff;
+        delete[] strbuff;
+    }
+
+    sgReadInt( fp, &ivalue );
+    method = (TextureMethod_e)ivalue;
+
+    sgReadDouble( fp, &reflon );
+    sgReadDouble( fp, &reflat );
+    sgReadDouble( fp, &width );
+    sgReadDouble( fp, &length );
+    sgReadDouble( fp, &heading );
+
+    sgReadDouble( fp, &minu );
+    sgReadDouble( fp, &maxu );
+    sgReadDouble( fp, &minv );
+    sgReadDouble( fp, &maxv );
+
+    sgReadDouble( fp, &min_clipu );
+    sgReadDouble( fp, &max_clipu );
+    sgReadDouble( fp, &min_clipv );
+    sgReadDouble( fp, &max_clipv );
+
+    sgReadDouble( fp, &center_lat );
+
+    // a damaged count runs out of file, rather than sizing the vector
+    sgReadUInt( fp, &count );
+    surfaceCoefficients.clear();
+    for ( unsigned int i=0; i<count && !gzeof( fp ); i++ ) {
+        double coeff;
+
+        sgReadDouble( fp, &coeff );
+        surfaceCoefficients.push_back( coeff );
+    }
+    sgReadGeod( fp, surfaceMin );
+    sgReadGeod( fp, surfaceMax );
+    sgReadGeod( fp, surfaceCenter );
+
+    sgReadUInt( fp, &value );
+    flags = value;
+    sgReadUInt( fp, &value );
+    id = value;
+    sgReadUInt( fp, &value );
+    fid = value;
+
+    sgReadString( fp, &strbuff );
+    if ( strbuff ) {
+        description = strbuff;
+        delete[] strbuff;
+    }
+}
@@ -19,12 +19,12 @@ tgPolygonSet tgPolygonSet::offset( double oset ) const
     return tgPolygonSet( result, getMeta() );    
 }
 
-double tgPolygonSet::toClipper( double dist ) const
+double tgPolygonSet::toClipper( double dist )
 {
     return ( (dist / CLIPPER_METERS_PER_DEGREE) * CLIPPER_FIXEDPT );
 }
 
-ClipperLib::IntPoint tgPolygonSet::toClipper( const cgalPoly_Point& p ) const
+ClipperLib::IntPoint tgPolygonSet::toClipper( const cgalPoly_Point& p )
 {
     ClipperLib::cInt x, y;
     
@@ -43,7 +43,7 @@ ClipperLib::IntPoint tgPolygonSet::toClipper( const cgalPoly_Point& p ) const
     return ClipperLib::IntPoint( x, y );
 }
 
-cgalPoly_Point tgPolygonSet::fromClipper( const ClipperLib::IntPoint& p ) const
+cgalPoly_Point tgPolygonSet::fromClipper( const ClipperLib::IntPoint& p )
 {
     double lon, lat;
     
@@ -53,7 +53,7 @@ cgalPoly_Point tgPolygonSet::fromClipper( const ClipperLib::IntPoint& p ) const
     return cgalPoly_Point( lon, lat );
 }
 
-ClipperLib::Path tgPolygonSet::toClipper( const cgalPoly_Polygon& subject, bool isHole ) const
+ClipperLib::Path tgPolygonSet::toClipper( const cgalPoly_Polygon& subject, bool isHole )
 {
     ClipperLib::Path  contour;
     
@@ -75,7 +75,7 @@ ClipperLib::Path tgPolygonSet::toClipper( const cgalPoly_Polygon& subject, bool
     return contour;
 }
 
-void tgPolygonSet::toClipper( const cgalPoly_PolygonWithHoles& pwh, ClipperLib::Paths& paths ) const
+void tgPolygonSet::toClipper( const cgalPoly_PolygonWithHoles& pwh, ClipperLib::Paths& paths )
 {
     // first, add outer boundary
     paths.push_back( toClipper( pwh.outer_boundary(), false ) );
@@ -86,7 +86,7 @@ void tgPolygonSet::toClipper( const cgalPoly_PolygonWithHoles& pwh, ClipperLib::
     }
 }
 
-ClipperLib::Paths tgPolygonSet::toClipper( const cgalPoly_PolygonSet& polySet ) const
+ClipperLib::Paths tgPolygonSet::toClipper( const cgalPoly_PolygonSet& polySet )
 {
     ClipperLib::Paths result;
     
@@ -106,7 +106,7 @@ ClipperLib::Paths tgPolygonSet::toClipper( const cgalPoly_PolygonSet& polySet )
     return result;
 }
 
-cgalPoly_Polygon tgPolygonSet::fromClipper( const ClipperLib::Path& subject ) const
+cgalPoly_Polygon tgPolygonSet::fromClipper( const ClipperLib::Path& subject )
 {
     cgalPoly_Polygon poly;
     
@@ -119,7 +119,7 @@ cgalPoly_Polygon tgPolygonSet::fromClipper( const ClipperLib::Path& subject ) co
     return poly;
 }
 
-cgalPoly_PolygonSet tgPolygonSet::fromClipper( const ClipperLib::Paths& subject ) const
+cgalPoly_PolygonSet tgPolygonSet::fromClipper( const ClipperLib::Paths& subject )
 {
     std::vector<cgalPoly_Polygon> boundaries;
     std::vector<cgalPoly_Polygon> holes;
@@ -23,24 +23,68 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <limits>
+
+#include <zlib.h>
 
 #include <simgear/compiler.h>
+#include <simgear/constants.h>
 #include <simgear/io/iostreams/sgstream.hxx>
 #include <simgear/debug/logstream.hxx>
 #include <simgear/misc/strutils.hxx>
 #include <simgear/misc/sg_path.hxx>
 #include <simgear/io/lowlevel.hxx>
+#include <simgear/threads/SGGuard.hxx>
 
 #include "tg_array.hxx"
 
 using std::string;
 
+// .arr.raw - the header, then either cols * rows native endian shorts,
+// column major like .arr.gz, or the file offsets of num_blocks + 1
+// zlib blocks.  Blocks are block_size squared samples, column major,
+// numbered column major too - smaller at the north and east edges.
+#define ARR_RAW_MAGIC       (0x5447414e)    // 'TGAN'
+#define ARR_RAW_VERSION     (1)
+
+enum {
+    ARR_RAW_UNCOMPRESSED = 0,
+    ARR_RAW_ZLIB_BLOCKS  = 1
+};
+
+struct arrRawHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t compression;
+    int32_t  originx, originy;
+    int32_t  cols, col_step;
+    int32_t  rows, row_step;
+    int32_t  block_size;
+    uint32_t num_blocks;
+};
+
+// .fit.bin.gz - the magic, version and point count, then lon, lat and
+// elevation of every point as little endian doubles.  Unlike the .fit.gz
+// text, which rounds them to 8 and 2 decimals, it holds exactly what
+// terrafit fitted.
+#define FIT_BIN_MAGIC       (0x54474654)    // 'TGFT'
+#define FIT_BIN_VERSION     (1)
+#define FIT_BIN_CHUNK       (4096)          // points per read
+
 
 tgArray::tgArray( void ):
   array_in(NULL),
   fitted_in(NULL),
-  in_data(NULL)
+  fitted_bin(NULL),
+  in_data(NULL),
+  raw_data(NULL),
+  raw_blocks(NULL),
+  raw_block_size(0),
+  raw_block_rows(0)
 {
 
 }
@@ -49,24 +93,65 @@ tgArray::tgArray( void ):
 tgArray::tgArray( const string &file ):
   array_in(NULL),
   fitted_in(NULL),
-      in_data(NULL)
+  fitted_bin(NULL),
+  in_data(NULL),
+  raw_data(NULL),
+  raw_blocks(NULL),
+  raw_block_size(0),
+  raw_block_rows(0)
 {
     tgArray::open(file);
 }
 
 
+// the choppers write the .arr.gz again, but leave the .arr.raw alone - a
+// raw file older than its .arr.gz holds the old elevations
+static bool raw_is_current( const string& raw_name, const string& array_name ) {
+    SGPath raw( raw_name ), array( array_name );
+
+    if ( !raw.exists() ) {
+        return false;
+    }
+    if ( array.exists() && raw.modTime() < array.modTime() ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "  " << raw_name << " is older than " << array_name << ", ignoring it - convert the .arr.gz again");
+        return false;
+    }
+
+    return true;
+}
+
 // open an Array file (and fitted file if it exists)
-bool tgArray::open( const string& file_base ) {
-    // open array data file
+bool tgArray::open( const string& file_base, bool use_raw ) {
     string array_name = file_base + ".arr.gz";
+    string raw_name   = file_base + ".arr.raw";
 
-    array_in = gzopen( array_name.c_str(), "rb" );
-    if (array_in == NULL) {
-        return false;
+    // prefer the mapped array, then the gzipped one
+    if ( !use_raw || !raw_is_current( raw_name, array_name ) || !open_raw( raw_name ) ) {
+        array_in = gzopen( array_name.c_str(), "rb" );
+        if (array_in == NULL) {
+            return false;
+        }
     }
 
-    // open fitted data file
-    string fitted_name = file_base + ".fit.gz";
+    // open fitted data file - the binary one if there is one
+    string fitted_name = file_base + ".fit.bin.gz";
+    fitted_bin = gzopen( fitted_name.c_str(), "rb" );
+    if ( fitted_bin ) {
+        int32_t magic = 0;
+        sgReadLong(fitted_bin, &magic);
+        gzrewind(fitted_bin);
+
+        if ( magic == FIT_BIN_MAGIC ) {
+            SG_LOG(SG_GENERAL, SG_DEBUG, "  Opening fitted data file: " << fitted_name );
+            return true;
+        }
+
+        SG_LOG(SG_GENERAL, SG_ALERT, "  " << fitted_name << " is not a fitted data file, ignoring it" );
+        gzclose(fitted_bin);
+        fitted_bin = NULL;
+    }
+
+    fitted_name = file_base + ".fit.gz";
     fitted_in = new sg_gzifstream( fitted_name );
     if ( !fitted_in->is_open() ) {
         // not having a .fit file is unfortunate, but not fatal.  We
@@ -80,7 +165,69 @@ bool tgArray::open( const string& file_base ) {
         SG_LOG(SG_GENERAL, SG_DEBUG, "  Opening fitted data file: " << fitted_name );
     }
 
-    return (array_in != NULL) ? true : false;
+    return true;
+}
+
+// map a .arr.raw file - false, and left closed, unless it is one we can
+// read in place
+bool tgArray::open_raw( const string& file ) {
+    if ( !raw_file.open( file ) ) {
+        return false;
+    }
+
+    const arrRawHeader* h = (const arrRawHeader*)raw_file.data();
+    size_t expected = 0;
+
+    if ( raw_file.size() < sizeof(arrRawHeader) ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " is truncated");
+    } else if ( h->magic != ARR_RAW_MAGIC ) {
+        // native endian - written on a machine of the other byte order
+        SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " is not a raw array of this machine - convert the .arr.gz again");
+    } else if ( h->version != ARR_RAW_VERSION ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " is raw array version " << h->version << ", expected " << ARR_RAW_VERSION);
+    } else if ( h->cols < 2 || h->rows < 2 ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " has " << h->cols << " x " << h->rows << " samples");
+    } else if ( h->compression == ARR_RAW_UNCOMPRESSED ) {
+        expected = sizeof(arrRawHeader) + sizeof(short) * h->cols * h->rows;
+    } else if ( h->compression == ARR_RAW_ZLIB_BLOCKS && h->block_size > 0 ) {
+        // get_block_elev() trusts the block grid and decode_block() the
+        // offsets - check both before we read through them
+        const uint64_t* offsets = (const uint64_t*)( raw_file.data() + sizeof(arrRawHeader) );
+        uint64_t block_cols = ( (uint64_t)h->cols + h->block_size - 1 ) / h->block_size;
+        uint64_t block_rows = ( (uint64_t)h->rows + h->block_size - 1 ) / h->block_size;
+        uint64_t table_end  = sizeof(arrRawHeader) + sizeof(uint64_t) * ( (uint64_t)h->num_blocks + 1 );
+
+        if ( h->num_blocks != block_cols * block_rows ) {
+            SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " has " << h->num_blocks << " blocks, expected " << block_cols * block_rows);
+        } else if ( raw_file.size() < table_end ) {
+            SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " is truncated");
+        } else {
+            bool ordered = ( offsets[0] >= table_end );
+            for ( uint32_t i = 0; i < h->num_blocks && ordered; ++i ) {
+                ordered = ( offsets[i] < offsets[i+1] );
+            }
+
+            if ( !ordered || offsets[h->num_blocks] > raw_file.size() ) {
+                SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " has block offsets out of order or past the end");
+            } else {
+                expected = offsets[h->num_blocks];
+            }
+        }
+    } else {
+        SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " has unknown compression " << h->compression);
+    }
+
+    if ( !expected || raw_file.size() != expected ) {
+        if ( expected ) {
+            SG_LOG(SG_GENERAL, SG_ALERT, "  " << file << " has " << raw_file.size() << " bytes, expected " << expected);
+        }
+        raw_file.close();
+        return false;
+    }
+
+    SG_LOG(SG_GENERAL, SG_DEBUG, "  Mapped raw array file: " << file );
+
+    return true;
 }
 
 
@@ -98,6 +245,11 @@ tgArray::close() {
         fitted_in = NULL;
     }
 
+    if (fitted_bin) {
+        gzclose(fitted_bin);
+        fitted_bin = NULL;
+    }
+
     return true;
 }
 
@@ -114,11 +266,27 @@ tgArray::unload( void ) {
         fitted_in = NULL;
     }
 
+    if (fitted_bin) {
+        gzclose(fitted_bin);
+        fitted_bin = NULL;
+    }
+
     if (in_data) {
         delete[] in_data;
         in_data = NULL;
     }
 
+    for ( unsigned int i = 0; i < block_data.size(); ++i ) {
+        delete[] block_data[i];
+    }
+    block_data.clear();
+
+    raw_data   = NULL;
+    raw_blocks = NULL;
+    raw_file.close();
+
+    nearest_index.clear();
+
     corner_list.clear();
     fitted_list.clear();
 }
@@ -130,7 +298,9 @@ tgArray::parse( const SGBucket& b ) {
     // Parse/load the array data file
     SG_LOG(SG_GENERAL, SG_DEBUG, " Parse bucket centered at " << b.get_center() );
     
-    if ( array_in ) {
+    if ( raw_file.isOpen() ) {
+        parse_raw();
+    } else if ( array_in ) {
         parse_bin();
     } else {
         // file not open (not found?), fill with zero'd data        
@@ -156,7 +326,12 @@ tgArray::parse( const SGBucket& b ) {
     }
 
     // Parse/load the fitted data file
-    if ( fitted_in && fitted_in->is_open() ) {
+    if ( fitted_bin ) {
+        if ( !read_fitted_bin( fitted_bin, fitted_list ) ) {
+            SG_LOG(SG_GENERAL, SG_ALERT, "  Truncated binary fitted data file, ignoring it" );
+            fitted_list.clear();
+        }
+    } else if ( fitted_in && fitted_in->is_open() ) {
         int fitted_size;
         double x, y, z;
         *fitted_in >> fitted_size;
@@ -170,6 +345,122 @@ tgArray::parse( const SGBucket& b ) {
     return true;
 }
 
+// read the points of a .fit.bin.gz - false if it isn't one
+bool tgArray::read_fitted_bin( gzFile fp, std::vector<SGGeod>& points )
+{
+    int32_t magic, version, count;
+    sgReadLong(fp, &magic);
+    sgReadLong(fp, &version);
+    sgReadLong(fp, &count);
+
+    if ( magic != FIT_BIN_MAGIC || version != FIT_BIN_VERSION || count < 0 ) {
+        return false;
+    }
+
+    // a chunk per read - sgReadDouble() is per value.  A damaged count
+    // runs out of file, rather than sizing the buffer.
+    std::vector<double> coords( 3 * FIT_BIN_CHUNK );
+    size_t first = points.size();
+
+    for ( int32_t done = 0; done < count; ) {
+        int n     = std::min( count - done, FIT_BIN_CHUNK );
+        int bytes = sizeof(double) * 3 * n;
+
+        if ( gzread( fp, &coords[0], bytes ) != bytes ) {
+            points.resize( first );
+            return false;
+        }
+
+        if ( sgIsBigEndian() ) {
+            for ( int i = 0; i < 3 * n; ++i ) {
+                sgEndianSwap( (uint64_t*)&coords[i] );
+            }
+        }
+
+        for ( int i = 0; i < n; ++i ) {
+            points.push_back( SGGeod::fromDegM(coords[3*i], coords[3*i+1], coords[3*i+2]) );
+        }
+        done += n;
+    }
+
+    return true;
+}
+
+bool tgArray::read_fitted( const string& file, std::vector<SGGeod>& points )
+{
+    gzFile fp = gzopen( file.c_str(), "rb" );
+    if ( !fp ) {
+        return false;
+    }
+
+    bool ok = read_fitted_bin( fp, points );
+    gzclose( fp );
+
+    if ( ok ) {
+        return true;
+    }
+
+    // the .fit.gz text
+    sg_gzifstream in( file );
+    int fitted_size = -1;
+    double x, y, z;
+
+    in >> fitted_size;
+    for ( int i = 0; i < fitted_size && in; ++i ) {
+        in >> x >> y >> z;
+        points.push_back( SGGeod::fromDegM(x, y, z) );
+    }
+
+    return fitted_size >= 0 && (bool)in;
+}
+
+bool tgArray::write_fitted( const string& file_base, const std::vector<SGGeod>& points )
+{
+    string fitted_file = file_base + ".fit.bin.gz";
+    string new_file    = fitted_file + ".new";
+
+    gzFile fp = gzopen( new_file.c_str(), "wb9" );
+    if ( !fp ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "ERROR:  cannot open " << new_file << " for writing!" );
+        return false;
+    }
+
+    std::vector<double> coords( 3 * points.size() );
+    for ( unsigned int i = 0; i < points.size(); ++i ) {
+        coords[3*i]   = points[i].getLongitudeDeg();
+        coords[3*i+1] = points[i].getLatitudeDeg();
+        coords[3*i+2] = points[i].getElevationM();
+    }
+
+    if ( sgIsBigEndian() ) {
+        for ( unsigned int i = 0; i < coords.size(); ++i ) {
+            sgEndianSwap( (uint64_t*)&coords[i] );
+        }
+    }
+
+    sgWriteLong(fp, FIT_BIN_MAGIC);
+    sgWriteLong(fp, FIT_BIN_VERSION);
+    sgWriteLong(fp, (int32_t)points.size());
+
+    int  bytes = sizeof(double) * coords.size();
+    bool ok = ( !bytes || gzwrite( fp, &coords[0], bytes ) == bytes );
+
+    if ( gzclose( fp ) != Z_OK ) {
+        ok = false;
+    }
+
+    if ( ok ) {
+        ok = ( rename( new_file.c_str(), fitted_file.c_str() ) == 0 );
+    }
+
+    if ( !ok ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "ERROR:  writing " << fitted_file << " failed" );
+        remove( new_file.c_str() );
+    }
+
+    return ok;
+}
+
 void tgArray::parse_bin()
 {
     int32_t header;
@@ -203,6 +494,194 @@ void tgArray::parse_bin()
     
 }
 
+// nothing to decode - point at the samples, or the block offsets
+void tgArray::parse_raw()
+{
+    const arrRawHeader* h = (const arrRawHeader*)raw_file.data();
+
+    originx  = h->originx;
+    originy  = h->originy;
+    cols     = h->cols;
+    col_step = h->col_step;
+    rows     = h->rows;
+    row_step = h->row_step;
+
+    if ( h->compression == ARR_RAW_UNCOMPRESSED ) {
+        raw_data = (const short*)( raw_file.data() + sizeof(arrRawHeader) );
+    } else {
+        raw_blocks     = (const uint64_t*)( raw_file.data() + sizeof(arrRawHeader) );
+        raw_block_size = h->block_size;
+        raw_block_rows = ( rows + raw_block_size - 1 ) / raw_block_size;
+
+        block_data.assign( h->num_blocks, (short *)NULL );
+    }
+
+    SG_LOG(SG_GENERAL, SG_DEBUG, "    origin  = " << originx << "  " << originy );
+    SG_LOG(SG_GENERAL, SG_DEBUG, "    cols = " << cols << "  rows = " << rows );
+    SG_LOG(SG_GENERAL, SG_DEBUG, "    col_step = " << col_step << "  row_step = " << row_step );
+}
+
+int tgArray::get_block_elev( int col, int row ) const
+{
+    int bc = col / raw_block_size;
+    int br = row / raw_block_size;
+    unsigned int b = bc * raw_block_rows + br;
+
+    // arrays are shared between threads
+    SGGuard<SGMutex> g( block_lock );
+
+    if ( !block_data[b] ) {
+        decode_block( b );
+    }
+
+    int bh = std::min( raw_block_size, rows - br * raw_block_size );
+
+    return block_data[b][ ( col - bc * raw_block_size ) * bh + row - br * raw_block_size ];
+}
+
+// called with the block lock held
+void tgArray::decode_block( unsigned int b ) const
+{
+    int bc = b / raw_block_rows;
+    int br = b % raw_block_rows;
+    int bw = std::min( raw_block_size, cols - bc * raw_block_size );
+    int bh = std::min( raw_block_size, rows - br * raw_block_size );
+
+    short* data = new short[bw * bh];
+    uLongf len  = sizeof(short) * bw * bh;
+
+    if ( uncompress( (Bytef*)data, &len, raw_file.data() + raw_blocks[b], raw_blocks[b+1] - raw_blocks[b] ) != Z_OK ||
+         len != sizeof(short) * bw * bh ) {
+        // a void - remove_voids() fills it
+        SG_LOG(SG_GENERAL, SG_ALERT, "  can't inflate raw array block " << b );
+        std::fill( data, data + bw * bh, -32768 );
+    }
+
+    block_data[b] = data;
+}
+
+void tgArray::materialize()
+{
+    if ( in_data || ( !raw_data && !raw_blocks ) ) {
+        return;
+    }
+
+    short* data = new short[cols * rows];
+
+    if ( raw_data ) {
+        memcpy( data, raw_data, sizeof(short) * cols * rows );
+    } else {
+        for ( int i = 0; i < cols; ++i ) {
+            for ( int j = 0; j < rows; ++j ) {
+                data[(i * rows) + j] = get_block_elev( i, j );
+            }
+        }
+
+        // all reads go to in_data from now on
+        for ( unsigned int i = 0; i < block_data.size(); ++i ) {
+            delete[] block_data[i];
+            block_data[i] = NULL;
+        }
+    }
+
+    in_data = data;
+}
+
+bool tgArray::write_raw( const string& file_base, bool compressed, int block_size, int level ) const
+{
+    // the old file may be mapped - by us, too - so don't write over it
+    string array_file = file_base + ".arr.raw";
+    string new_file   = array_file + ".new";
+
+    FILE* fp = fopen( new_file.c_str(), "wb" );
+    if ( !fp ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "ERROR:  cannot open " << new_file << " for writing!" );
+        return false;
+    }
+
+    arrRawHeader h;
+    memset( &h, 0, sizeof(h) );
+
+    h.magic       = ARR_RAW_MAGIC;
+    h.version     = ARR_RAW_VERSION;
+    h.compression = compressed ? ARR_RAW_ZLIB_BLOCKS : ARR_RAW_UNCOMPRESSED;
+    h.originx     = (int)originx;
+    h.originy     = (int)originy;
+    h.cols        = cols;
+    h.col_step    = (int)col_step;
+    h.rows        = rows;
+    h.row_step    = (int)row_step;
+
+    bool ok = true;
+
+    if ( !compressed ) {
+        std::vector<short> data( cols * rows );
+        for ( int i = 0; i < cols; ++i ) {
+            for ( int j = 0; j < rows; ++j ) {
+                data[(i * rows) + j] = get_array_elev( i, j );
+            }
+        }
+
+        ok = fwrite( &h, sizeof(h), 1, fp ) == 1 &&
+             fwrite( &data[0], sizeof(short), data.size(), fp ) == data.size();
+    } else {
+        int block_cols = ( cols + block_size - 1 ) / block_size;
+        int block_rows = ( rows + block_size - 1 ) / block_size;
+
+        h.block_size = block_size;
+        h.num_blocks = block_cols * block_rows;
+
+        std::vector<uint64_t>      offsets( h.num_blocks + 1 );
+        std::vector<unsigned char> deflated;
+
+        offsets[0] = sizeof(h) + sizeof(uint64_t) * offsets.size();
+
+        for ( unsigned int b = 0; b < h.num_blocks; ++b ) {
+            int bc = b / block_rows;
+            int br = b % block_rows;
+            int bw = std::min( block_size, cols - bc * block_size );
+            int bh = std::min( block_size, rows - br * block_size );
+
+            std::vector<short> block( bw * bh );
+            for ( int i = 0; i < bw; ++i ) {
+                for ( int j = 0; j < bh; ++j ) {
+                    block[i * bh + j] = get_array_elev( bc * block_size + i, br * block_size + j );
+                }
+            }
+
+            uLongf len = compressBound( sizeof(short) * block.size() );
+            size_t pos = deflated.size();
+
+            deflated.resize( pos + len );
+            if ( compress2( &deflated[pos], &len, (const Bytef*)&block[0], sizeof(short) * block.size(), level ) != Z_OK ) {
+                ok = false;
+            }
+            deflated.resize( pos + len );
+
+            offsets[b+1] = offsets[0] + deflated.size();
+        }
+
+        ok = ok && fwrite( &h, sizeof(h), 1, fp ) == 1 &&
+             fwrite( &offsets[0], sizeof(uint64_t), offsets.size(), fp ) == offsets.size() &&
+             fwrite( &deflated[0], 1, deflated.size(), fp ) == deflated.size();
+    }
+
+    if ( fclose( fp ) != 0 ) {
+        ok = false;
+    }
+
+    if ( ok ) {
+        ok = ( rename( new_file.c_str(), array_file.c_str() ) == 0 );
+    }
+
+    if ( !ok ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "ERROR:  writing " << array_file << " failed" );
+        remove( new_file.c_str() );
+    }
+
+    return ok;
+}
+
 // write an Array file
 bool tgArray::write( const string root_dir, SGBucket& b ) {
     // generate output file name
@@ -239,108 +718,196 @@ bool tgArray::write( const string root_dir, SGBucket& b ) {
 
 // do our best to remove voids by picking data from the nearest neighbor.
 void tgArray::remove_voids( ) {
-    // need two passes to ensure that all voids are removed (unless entire
-    // array is a void.)
-    bool have_void = true;
-    int last_elev = -32768;
-    for ( int pass = 0; pass < 2 && have_void; ++pass ) {
-        // attempt to fill in any void data horizontally
-        for ( int i = 0; i < cols; i++ ) {
-            int j;
-
-            // fill in front ways
-            last_elev = -32768;
-            have_void = false;
-            for ( j = 0; j < rows; j++ ) {
-                if ( get_array_elev(i,j) > -9000 ) {
-                    last_elev = get_array_elev(i,j) ;
-                } else if ( last_elev > -9000 ) {
-                    set_array_elev(i, j, last_elev);
-                } else {
-                    have_void = true;
-                }
+    // reads every sample - inflate all blocks once, instead of locking
+    // for each sample
+    if ( raw_blocks ) {
+        materialize();
+    }
+
+    // most arrays have none
+    bool have_void = false;
+    for ( int i = 0; i < cols && !have_void; ++i ) {
+        for ( int j = 0; j < rows && !have_void; ++j ) {
+            have_void = ( get_array_elev(i, j) <= -9000 );
+        }
+    }
+
+    if ( !have_void ) {
+        return;
+    }
+
+    std::vector<int> index;
+    compute_nearest( index );
+
+    // non-void samples are their own nearest, so it doesn't matter which
+    // voids are filled first
+    for ( int s = 0; s < cols * rows; ++s ) {
+        if ( index[s] == s ) {
+            continue;
+        }
+
+        if ( index[s] < 0 ) {
+            // the entire array is void.  Fill in the void areas with
+            // zero as a panic fall back.
+            set_array_elev( s / rows, s % rows, 0 );
+        } else {
+            set_array_elev( s / rows, s % rows, get_array_elev( index[s] / rows, index[s] % rows ) );
+        }
+    }
+}
+
+
+// distance transform of the voids, after Felzenszwalb and Huttenlocher,
+// "Distance Transforms of Sampled Functions" - index[col * rows + row] is
+// the index of the non-void sample closest to the sample on the ground,
+// -1 if the entire array is void.  Exact, and linear in the number of
+// samples: a pass along every column finds the closest non-void sample
+// in the column, and a pass along every row the lower envelope of the
+// parabolas of the squared distances to those.
+void tgArray::compute_nearest( std::vector<int>& index ) const
+{
+    const double inf = std::numeric_limits<double>::max();
+
+    // the columns close in towards the poles - use the spacing at the
+    // middle of the array
+    double center_lat = ( originy + 0.5 * ( rows - 1 ) * row_step ) / 3600.0;
+    double wx = col_step * cos( center_lat * SGD_DEGREES_TO_RADIANS );
+    double wy = row_step;
+
+    // row major, for the passes along the rows
+    std::vector<int>    near_row( cols * rows );
+    std::vector<int>    nr( rows );
+
+    index.assign( cols * rows, -1 );
+
+    for ( int i = 0; i < cols; ++i ) {
+        int last = -1;
+
+        for ( int j = 0; j < rows; ++j ) {
+            if ( get_array_elev(i, j) > -9000 ) {
+                last = j;
             }
-            // fill in back ways
-            last_elev = -32768;
-            have_void = false;
-            for ( j = rows - 1; j >= 0; j-- ) {
-                if ( get_array_elev(i,j) > -9000 ) {
-                    last_elev = get_array_elev(i,j);
-                } else if ( last_elev > -9000 ) {
-                    set_array_elev(i, j, last_elev);
-                } else {
-                    have_void = true;
-                }
+            nr[j] = last;
+        }
+
+        last = -1;
+        for ( int j = rows - 1; j >= 0; --j ) {
+            if ( nr[j] == j ) {
+                last = j;
             }
+            if ( last >= 0 && ( nr[j] < 0 || last - j < j - nr[j] ) ) {
+                nr[j] = last;
+            }
+            near_row[j * cols + i] = nr[j];
         }
+    }
 
-        // attempt to fill in any void data vertically
-        for ( int j = 0; j < rows; j++ ) {
-            int i;
-
-            // fill in front ways
-            last_elev = -32768;
-            have_void = false;
-            for ( i = 0; i < cols; i++ ) {
-                if ( get_array_elev(i,j) > -9999 ) {
-                    last_elev = get_array_elev(i,j);
-                } else if ( last_elev > -9999 ) {
-                    set_array_elev(i, j, last_elev);
-                } else {
-                    have_void = true;
-                }
+    std::vector<double> fj( cols );
+    std::vector<int>    v( cols );
+    std::vector<double> z( cols + 1 );
+    double              wx2 = wx * wx;
+
+    for ( int j = 0; j < rows; ++j ) {
+        const int* nrj = &near_row[j * cols];
+
+        // squared distance to the closest non-void sample of each column
+        for ( int q = 0; q < cols; ++q ) {
+            double d = wy * ( j - nrj[q] );
+            fj[q] = ( nrj[q] < 0 ) ? inf : d * d;
+        }
+
+        int k = -1;
+
+        for ( int q = 0; q < cols; ++q ) {
+            if ( fj[q] == inf ) {
+                continue;
             }
 
-            // fill in back ways
-            last_elev = -32768;
-            have_void = false;
-            for ( i = cols - 1; i >= 0; i-- ) {
-                if ( get_array_elev(i,j) > -9999 ) {
-                    last_elev = get_array_elev(i,j);
-                } else if ( last_elev > -9999 ) {
-                    set_array_elev(i, j, last_elev);
-                } else {
-                    have_void = true;
+            // drop the parabolas this one is below from where they begin
+            double s = -inf;
+            while ( k >= 0 ) {
+                int p = v[k];
+
+                s = ( ( fj[q] + wx2 * q * q ) - ( fj[p] + wx2 * p * p ) ) / ( 2.0 * wx2 * ( q - p ) );
+                if ( s > z[k] ) {
+                    break;
                 }
+                --k;
             }
+
+            ++k;
+            v[k]     = q;
+            z[k]     = ( k == 0 ) ? -inf : s;
+            z[k + 1] = inf;
         }
-    }
 
-    if ( have_void ) {
-        // after all that work we still have a void, likely the
-        // entire array is void.  Fill in the void areas with zero
-        // as a panic fall back.
-        for ( int i = 0; i < cols; i++ ) {
-            for ( int j = 0; j < rows; j++ ) {
-                if ( get_array_elev(i,j) <= -9999 ) {
-                    set_array_elev(i, j, 0);
-                }
+        if ( k < 0 ) {
+            // no column has a non-void sample
+            continue;
+        }
+
+        k = 0;
+        for ( int q = 0; q < cols; ++q ) {
+            while ( z[k + 1] < q ) {
+                ++k;
             }
+
+            int p = v[k];
+            index[q * rows + j] = p * rows + nrj[p];
         }
     }
 }
 
 
-// Return the elevation of the closest non-void grid point to lon, lat
+// Return the elevation of the closest non-void grid point to lon, lat -
+// the closest of those of the corners of the cell lon, lat is in.  Exact
+// at the grid points, within a cell of it in between.
 double tgArray::closest_nonvoid_elev( double lon, double lat ) const {
-    double mindist = 99999999999.9;
-    double minelev = -9999.0;
-    SGGeod p0 = SGGeod::fromDeg( lon, lat );
-
-    for ( int row = 0; row < rows; row++ ) {
-        for ( int col = 0; col < cols; col++ ) {
-            SGGeod p1 = SGGeod::fromDeg( originx + col * col_step, originy + row * row_step );
-            double dist = SGGeodesy::distanceM( p0, p1 );
-            double elev = get_array_elev(col, row);
-            if ( dist < mindist && elev > -9000 ) {
-                mindist = dist;
-                minelev = elev;
-            }
+    if ( cols <= 0 || rows <= 0 ) {
+        return 0.0;
+    }
+
+    {
+        SGGuard<SGMutex> g( nearest_lock );
+
+        if ( nearest_index.empty() ) {
+            compute_nearest( nearest_index );
         }
     }
 
-    if ( minelev > -9999.0 ) {
-        return minelev;
+    double center_lat = ( originy + 0.5 * ( rows - 1 ) * row_step ) / 3600.0;
+    double wx = cos( center_lat * SGD_DEGREES_TO_RADIANS );
+
+    double fx = ( lon - originx ) / col_step;
+    double fy = ( lat - originy ) / row_step;
+    int    x0 = std::max( 0, std::min( cols - 1, (int)floor( fx ) ) );
+    int    y0 = std::max( 0, std::min( rows - 1, (int)floor( fy ) ) );
+    int    x1 = std::min( cols - 1, x0 + 1 );
+    int    y1 = std::min( rows - 1, y0 + 1 );
+
+    const int corners[4] = { x0 * rows + y0, x1 * rows + y0, x0 * rows + y1, x1 * rows + y1 };
+
+    double mindist = std::numeric_limits<double>::max();
+    int    closest = -1;
+
+    for ( int c = 0; c < 4; ++c ) {
+        int s = nearest_index[corners[c]];
+        if ( s < 0 ) {
+            continue;
+        }
+
+        double dx = wx * ( originx + ( s / rows ) * col_step - lon );
+        double dy = originy + ( s % rows ) * row_step - lat;
+        double dist = dx * dx + dy * dy;
+
+        if ( dist < mindist ) {
+            mindist = dist;
+            closest = s;
+        }
+    }
+
+    if ( closest >= 0 ) {
+        return get_array_elev( closest / rows, closest % rows );
     } else {
         return 0.0;
     }
@@ -465,6 +1032,10 @@ tgArray::~tgArray( void )
         in_data = NULL;
     }
 
+    for ( unsigned int i = 0; i < block_data.size(); ++i ) {
+        delete[] block_data[i];
+    }
+
     if (array_in) {
         gzclose(array_in);
         array_in = NULL;
@@ -475,21 +1046,64 @@ tgArray::~tgArray( void )
         delete fitted_in;
         fitted_in = NULL;
     }
+
+    if (fitted_bin) {
+        gzclose(fitted_bin);
+        fitted_bin = NULL;
+    }
+}
+
+size_t tgArray::memory_usage() const
+{
+    size_t bytes = sizeof(tgArray);
+
+    if ( in_data ) {
+        bytes += sizeof(short) * cols * rows;
+    }
+
+    // mapped samples are page cache, not heap
+    {
+        SGGuard<SGMutex> g( block_lock );
+
+        for ( unsigned int i = 0; i < block_data.size(); ++i ) {
+            if ( block_data[i] ) {
+                bytes += sizeof(short) * raw_block_size * raw_block_size;
+            }
+        }
+    }
+    bytes += sizeof(int) * nearest_index.capacity();
+    bytes += sizeof(SGGeod) * ( corner_list.capacity() + fitted_list.capacity() );
+
+    return bytes;
 }
 
 int tgArray::get_array_elev( int col, int row ) const
 {
-    return in_data[(col * rows) + row];
+    if ( in_data ) {
+        return in_data[(col * rows) + row];
+    } else if ( raw_data ) {
+        return raw_data[(col * rows) + row];
+    } else {
+        return get_block_elev( col, row );
+    }
 }
 
 void tgArray::set_array_elev( int col, int row, int val )
 {
+    // the mapping is read only
+    materialize();
+
     in_data[(col * rows) + row] = val;
+
+    // may not be the closest non-void sample any more, or now be one
+    if ( !nearest_index.empty() ) {
+        nearest_index.clear();
+    }
 }
 
 bool tgArray::is_open() const
 {
-  if ( array_in != NULL ) {
+  if ( array_in != NULL || raw_file.isOpen() ) {
       return true;
   } else {
       return false;
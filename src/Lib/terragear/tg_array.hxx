@@ -23,10 +23,16 @@
 #ifndef _TG_ARRAY_HXX
 #define _TG_ARRAY_HXX
 
+#include <stdint.h>
+#include <vector>
+
 #include <simgear/compiler.h>
 #include <simgear/bucket/newbucket.hxx>
 #include <simgear/math/sg_types.hxx>
 #include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+#include "tg_mapped_file.hxx"
 
 class tgArray {
 
@@ -35,6 +41,7 @@ private:
 
     // fitted file pointer
     sg_gzifstream *fitted_in;
+    gzFile fitted_bin;
 
     // coordinates (in arc seconds) of south west corner
     double originx, originy;
@@ -48,11 +55,40 @@ private:
     // pointers to the actual grid data allocated here
     short *in_data;
 
+    // a .arr.raw file is mapped, and read in place - the samples of an
+    // uncompressed one, or the offsets of the blocks of a compressed one,
+    // which are inflated on first use
+    tgMappedFile raw_file;
+    const short *raw_data;
+    const uint64_t *raw_blocks;
+    int raw_block_size, raw_block_rows;
+
+    mutable std::vector<short *> block_data;
+    mutable SGMutex block_lock;
+
+    // the closest non-void sample of every sample, built by the first
+    // closest_nonvoid_elev(), and dropped when a sample changes
+    mutable std::vector<int> nearest_index;
+    mutable SGMutex nearest_lock;
+
     // output nodes
     std::vector<SGGeod> corner_list;
     std::vector<SGGeod> fitted_list;
 
     void parse_bin();
+
+    static bool read_fitted_bin( gzFile fp, std::vector<SGGeod>& points );
+
+    bool open_raw( const std::string& file );
+    void parse_raw();
+    int get_block_elev( int col, int row ) const;
+    void decode_block( unsigned int b ) const;
+
+    // copy the samples out of the mapping, before changing them
+    void materialize();
+
+    // index of the closest non-void sample of every sample
+    void compute_nearest( std::vector<int>& index ) const;
 public:
 
     // Constructor
@@ -62,10 +98,13 @@ public:
     // Destructor
     ~tgArray( void );
 
-    // open an Array file (use "-" if input is coming from stdin)
-    bool open ( const std::string& file_base );
+    // open an Array file (use "-" if input is coming from stdin) - the
+    // .arr.raw if there is one at least as new as the .arr.gz, unless
+    // use_raw is false
+    bool open ( const std::string& file_base, bool use_raw = true );
 
-    // return if array was successfully opened or not
+    // return if array was successfully opened or not - a .arr.raw stays
+    // open until unload(), the samples are read from it
     bool is_open() const;
 
     // close a Array file
@@ -77,8 +116,19 @@ public:
     // write an Array file
     bool write( const std::string root_dir, SGBucket& b );
 
+    // write the parsed samples to <file_base>.arr.raw - in blocks of
+    // block_size squared samples, deflated at level, when compressed
+    bool write_raw( const std::string& file_base, bool compressed, int block_size = 64, int level = 1 ) const;
+
+    // write fitted points to <file_base>.fit.bin.gz - preferred over the
+    // .fit.gz text by open()
+    static bool write_fitted( const std::string& file_base, const std::vector<SGGeod>& points );
+
+    // append the points of a .fit.bin.gz or .fit.gz file
+    static bool read_fitted( const std::string& file, std::vector<SGGeod>& points );
+
     // do our best to remove voids by picking data from the nearest
-    // neighbor.
+    // neighbor - the closest non-void sample on the ground
     void remove_voids();
 
     // Return the elevation of the closest non-void grid point to lon, lat
@@ -100,6 +150,9 @@ public:
     inline std::vector<SGGeod> const& get_corner_list() const { return corner_list; }
     inline std::vector<SGGeod> const& get_fitted_list() const { return fitted_list; }
 
+    // approximate heap footprint of the grid and fitted nodes
+    size_t memory_usage() const;
+
     int get_array_elev( int col, int row ) const;
     void set_array_elev( int col, int row, int val );
 
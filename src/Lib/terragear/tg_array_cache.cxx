@@ -0,0 +1,189 @@
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include "tg_array_cache.hxx"
+#include "tg_profile.hxx"
+
+#define DEFAULT_ARRAY_CACHE_BUDGET  (1024UL * 1024UL * 1024UL)
+
+tgArrayCache& tgArrayCache::instance( void )
+{
+    static tgArrayCache cache;
+
+    return cache;
+}
+
+tgArrayCache::tgArrayCache() :
+    budget(DEFAULT_ARRAY_CACHE_BUDGET),
+    bytesUsed(0),
+    peakBytes(0),
+    hits(0),
+    misses(0),
+    evictions(0)
+{
+}
+
+void tgArrayCache::setBudget( size_t bytes )
+{
+    SGGuard<SGMutex> g( lock );
+
+    budget = bytes;
+    evict();
+}
+
+tgArrayPtr tgArrayCache::get( const std::string& demDir, const SGBucket& b )
+{
+    return get( std::vector<std::string>( 1, demDir ), b );
+}
+
+tgArrayPtr tgArrayCache::get( const std::vector<std::string>& demDirs, const SGBucket& b )
+{
+    std::string key = b.gen_index_str();
+    for ( unsigned int i=0; i<demDirs.size(); i++ ) {
+        key += "|" + demDirs[i];
+    }
+
+    {
+        tgProfileWait w( "demCache" );
+        lock.lock();
+    }
+
+    // another thread may still be loading it - and it may be evicted
+    // before we wake up
+    std::map<std::string, cacheEntry>::iterator it = entries.find( key );
+    while ( it != entries.end() && it->second.loading ) {
+        tgProfileWait w( "demCache" );
+        loaded.wait( lock );
+        it = entries.find( key );
+    }
+
+    if ( it != entries.end() ) {
+        hits++;
+        lruList.splice( lruList.begin(), lruList, it->second.lru );
+
+        tgArrayPtr array = it->second.array;
+        lock.unlock();
+
+        return array;
+    }
+
+    // reserve the entry so other threads wait for us instead of loading it too
+    misses++;
+    it = entries.insert( std::make_pair( key, cacheEntry() ) ).first;
+    lruList.push_front( key );
+    it->second.lru = lruList.begin();
+    lock.unlock();
+
+    tgArrayPtr array = load( demDirs, b );
+
+    {
+        tgProfileWait w( "demCache" );
+        lock.lock();
+    }
+
+    // evict() leaves loading entries alone, but don't count on an
+    // iterator kept across the unlock
+    it = entries.find( key );
+    it->second.array   = array;
+    it->second.bytes   = array->memory_usage();
+    it->second.loading = false;
+
+    bytesUsed += it->second.bytes;
+    if ( bytesUsed > peakBytes ) {
+        peakBytes = bytesUsed;
+    }
+    evict();
+
+    loaded.broadcast();
+    lock.unlock();
+
+    return array;
+}
+
+tgArrayPtr tgArrayCache::load( const std::vector<std::string>& demDirs, const SGBucket& b ) const
+{
+    tgArray* array = new tgArray();
+    std::string base = b.gen_base_path() + "/" + b.gen_index_str();
+
+    // try the various elevation sources
+    bool found = false;
+    for ( unsigned int i=0; i<demDirs.size() && !found; i++ ) {
+        std::string arrayPath = demDirs[i] + "/" + base;
+
+        if ( array->open( arrayPath ) ) {
+            SG_LOG( SG_GENERAL, SG_INFO, "Opened Array file " << arrayPath );
+            found = true;
+        }
+    }
+    if ( !found ) {
+        SG_LOG( SG_GENERAL, SG_INFO, "Could not open Array file for " << base );
+    }
+
+    // this will fill in a zero structure if no array data
+    // found/opened
+    array->parse( b );
+    array->remove_voids();
+    array->close();
+
+    return tgArrayPtr( array );
+}
+
+// called with the lock held
+void tgArrayCache::evict( void )
+{
+    std::list<std::string>::iterator lit = lruList.end();
+
+    while ( bytesUsed > budget && lit != lruList.begin() ) {
+        --lit;
+
+        std::map<std::string, cacheEntry>::iterator it = entries.find( *lit );
+
+        // keep arrays being loaded, or still held by a caller
+        if ( it->second.loading || it->second.array.use_count() > 1 ) {
+            continue;
+        }
+
+        bytesUsed -= it->second.bytes;
+        evictions++;
+
+        lit = lruList.erase( lit );
+        entries.erase( it );
+    }
+}
+
+size_t tgArrayCache::getBudget( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return budget;
+}
+
+unsigned long tgArrayCache::getHits( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return hits;
+}
+
+unsigned long tgArrayCache::getMisses( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return misses;
+}
+
+unsigned long tgArrayCache::getEvictions( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return evictions;
+}
+
+void tgArrayCache::report( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+
+    unsigned long lookups = hits + misses;
+    double hitRate = lookups ? 100.0 * hits / lookups : 0.0;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Elevation array cache: " << lookups << " lookups, " <<
+                                  hits << " hits, " << misses << " misses, " << evictions << " evictions, " <<
+                                  "hit rate " << hitRate << "%, " <<
+                                  "peak " << peakBytes / (1024*1024) << " of " << budget / (1024*1024) << " MB" );
+}
@@ -0,0 +1,76 @@
+#ifndef __TG_ARRAY_CACHE_HXX__
+#define __TG_ARRAY_CACHE_HXX__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+#include "tg_array.hxx"
+
+// Process wide cache of parsed, void filled elevation arrays.
+//
+// Arrays are keyed by bucket index and the list of DEM directories
+// searched for them, and handed out as shared pointers - an array evicted
+// while a caller still holds it lives on until the caller lets go.  When
+// over budget, the least recently used arrays nobody holds are dropped
+// first.  Concurrent requests for the same array wait for a single load.
+typedef boost::shared_ptr<const tgArray> tgArrayPtr;
+
+class tgArrayCache
+{
+public:
+    static tgArrayCache& instance( void );
+
+    // first of the DEM directories with an array for the bucket - or a
+    // zero filled array when none has one
+    tgArrayPtr get( const std::vector<std::string>& demDirs, const SGBucket& b );
+    tgArrayPtr get( const std::string& demDir, const SGBucket& b );
+
+    void   setBudget( size_t bytes );
+    size_t getBudget( void ) const;
+
+    // taken under the lock, like report()
+    unsigned long getHits( void ) const;
+    unsigned long getMisses( void ) const;
+    unsigned long getEvictions( void ) const;
+
+    // log counters, hit rate and memory high water mark
+    void report( void ) const;
+
+private:
+    tgArrayCache();
+
+    struct cacheEntry {
+        cacheEntry() : bytes(0), loading(true) {}
+
+        tgArrayPtr                          array;
+        size_t                              bytes;
+        bool                                loading;
+        std::list<std::string>::iterator    lru;
+    };
+
+    tgArrayPtr load( const std::vector<std::string>& demDirs, const SGBucket& b ) const;
+    void       evict( void );
+
+    mutable SGMutex                     lock;
+    SGWaitCondition                     loaded;
+
+    std::map<std::string, cacheEntry>   entries;
+    std::list<std::string>              lruList;    // most recently used first
+
+    size_t                              budget;
+    size_t                              bytesUsed;
+    size_t                              peakBytes;
+
+    unsigned long                       hits;
+    unsigned long                       misses;
+    unsigned long                       evictions;
+};
+
+#endif /* __TG_ARRAY_CACHE_HXX__ */
@@ -0,0 +1,95 @@
+#ifndef __TG_BOUNDED_QUEUE_HXX__
+#define __TG_BOUNDED_QUEUE_HXX__
+
+#include <deque>
+
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+// A queue between producer and consumer threads, holding at most capacity
+// items - push() blocks while it is full, so a fast producer can't get
+// ahead of the consumers by more than that.  A capacity of 0 never blocks.
+//
+// pop() blocks while the queue is empty, until the producer calls close().
+// After that it returns false, once the queue has drained.
+template <class T>
+class tgBoundedQueue
+{
+public:
+    tgBoundedQueue( unsigned int c = 0 ) : capacity(c), closed(false), highWater(0) {}
+
+    void push( const T& item ) {
+        SGGuard<SGMutex> g( lock );
+
+        while ( capacity && items.size() >= capacity ) {
+            notFull.wait( lock );
+        }
+
+        items.push_back( item );
+        if ( items.size() > highWater ) {
+            highWater = items.size();
+        }
+
+        notEmpty.signal();
+    }
+
+    bool pop( T& item ) {
+        SGGuard<SGMutex> g( lock );
+
+        while ( items.empty() && !closed ) {
+            notEmpty.wait( lock );
+        }
+        if ( items.empty() ) {
+            return false;
+        }
+
+        item = items.front();
+        items.pop_front();
+
+        notFull.signal();
+
+        return true;
+    }
+
+    // no more items will be pushed - wakes all waiting consumers
+    void close( void ) {
+        SGGuard<SGMutex> g( lock );
+
+        closed = true;
+        notEmpty.broadcast();
+    }
+
+    // start over, for the next producer
+    void reopen( void ) {
+        SGGuard<SGMutex> g( lock );
+
+        closed    = false;
+        highWater = items.size();
+    }
+
+    unsigned int size( void ) {
+        SGGuard<SGMutex> g( lock );
+        return items.size();
+    }
+
+    // the most items ever queued at once
+    unsigned int peak( void ) {
+        SGGuard<SGMutex> g( lock );
+        return highWater;
+    }
+
+private:
+    tgBoundedQueue( const tgBoundedQueue& );
+    tgBoundedQueue& operator=( const tgBoundedQueue& );
+
+    std::deque<T>       items;
+    unsigned int        capacity;
+    bool                closed;
+    unsigned int        highWater;
+
+    SGMutex             lock;
+    SGWaitCondition     notEmpty;
+    SGWaitCondition     notFull;
+};
+
+#endif /* __TG_BOUNDED_QUEUE_HXX__ */
@@ -2,7 +2,6 @@
 #include <fstream>
 #include <cassert>
 #include <iterator>
-#include <CGAL/Cartesian.h>
 #include <vector>
 #include <math.h>
 #include <algorithm>
@@ -12,368 +11,248 @@
 #include "tg_cluster.hxx"
 #include "tg_shapefile.hxx"
 
-// TODO Voronoi convergence is a bit slow - anything faster?
 #define DEBUG_CLUSTER   (0)
 #define LOG_CLUSER      SG_DEBUG
 
+// nodes closer than this are the same node
+#define CLUSTER_DUPLICATE_RADIUS    (0.000000001)
 
-std::list<EPECSegment_2>::iterator it;
-std::vector<EPECPoint_2>::iterator vfrom,vto;
-std::vector<EPECPoint_2>::iterator fcit;
+// maximum number of Lloyd relaxation iterations
+#define CLUSTER_MAX_RELAX_ITER      (40)
 
-EPECPoint_2 tgCluster::Locate(const EPECPoint_2& point) const
+tgCluster::tgCluster( const std::list<tgClusterNode>& points, double err, const std::string& d )
 {
-    VDLocateResult lr = vd.locate(point);
-    EPECPoint_2    q;
+    squaredError = err;
+    debug = d;
 
-    if ( VDVertexHandle* v = boost::get<VDVertexHandle>(&lr) ) 
-    {
-        q = (*v)->site(0)->point();
-    } 
-    else if ( VDHalfedgeHandle* e = boost::get<VDHalfedgeHandle>(&lr) )
-    {
-        q = (*e)->up()->point();        
-    } 
-    else if ( VDFaceHandle* f = boost::get<VDFaceHandle>(&lr) ) 
-    {
-        q = (*f)->dual()->point();
+    nodes.assign( points.begin(), points.end() );
+
+    std::vector<clusterCenter> centers;
+    for ( unsigned int i=0; i<nodes.size(); i++ ) {
+        nodePoints.push_back( tgClusterPoint( CGAL::to_double( nodes[i].point.x() ), CGAL::to_double( nodes[i].point.y() ) ) );
+        centers.push_back( clusterCenter( nodePoints[i], nodes[i].fixed ) );
     }
 
-    return q;
-}
+    SG_LOG( SG_GENERAL, LOG_CLUSER,  "tgCluster: " << centers.size() << " original points" );
 
-void tgCluster::computenewcentroids(void)
-{
-    std::vector<tgVoronoiCell>::iterator oc, nc;
+#if DEBUG_CLUSTER
+    toShapefile( debug, "original_points", nodes );
+#endif
 
-    tag tg;
-    vd.clear();
-    for(oc = oldcells.begin(); oc!= oldcells.end(); oc++)
-    {
-        (*oc).face = vd.insert((*oc).centroid);
-        (*oc).nodes.clear();
-    }
-    assert( vd.is_valid() );
+    // first step is to merge points really close to one another.
+    mergeDuplicates( centers );
 
-    for ( std::list<tgClusterNode>::iterator it = nodes.begin(); it != nodes.end(); it++ )
-    {
-        EPECPoint_2 q = Locate(it->point);
+    SG_LOG( SG_GENERAL, LOG_CLUSER,  "tgCluster: " << centers.size() << " unique points " );
 
-        for(oc = oldcells.begin(); oc!= oldcells.end(); oc++)
-        {
-            if ( (*oc).centroid == q ) {
-                (*oc).nodes.push_back(*it);
-                break;
-            }
-        }
-    }
+    // then pull together centers within the cluster radius, until none move
+    int tree_iter = 1;
+    do {
+        SG_LOG( SG_GENERAL, LOG_CLUSER,  "Find centroids iteration " << tree_iter << " num_centroids is " << centers.size() );
+        tree_iter++;
+    } while ( mergeCenters( centers ) );
 
-    // UPDATE THE CENTROIDS HERE
-    oc = oldcells.begin();
-    newcells.clear();
+    SG_LOG( SG_GENERAL, LOG_CLUSER,  " Do voronoi relaxation with " << centers.size() << " nodes" );
 
-    for(oc = oldcells.begin(); oc!= oldcells.end(); oc++)
-    {
-        tgVoronoiCell newvc;
-        if ((*oc).nodes.empty())
-        {
-            newvc.centroid = (*oc).centroid;
-            newvc.face     = (*oc).face;
-            newvc.nodes    = (*oc).nodes;
+    // Lloyd relaxation - move each center to the centroid of the nodes
+    // closest to it, until the centers stop moving.
+    // Locate uses the centers of the last assignment
+    std::vector<tgClusterPoint> cur, next;
+    for ( unsigned int i=0; i<centers.size(); i++ ) {
+        cur.push_back( centers[i].point );
+    }
+
+    for ( int iiter = 0; iiter < CLUSTER_MAX_RELAX_ITER && !cur.empty(); iiter++ ) {
+        if ( !relax( cur, next ) ) {
+            break;
         }
-        else
-        {
-            // if he voronoi cell has fixed nodes, set them as centroids for new cells
-            std::vector<tgClusterNode>::const_iterator nit = (*oc).nodes.begin();
-
-            // todo - split a voronoi cell if more than 1 fixed node inside
-            std::vector<EPECPoint_2> positions;
-            while ( nit != (*oc).nodes.end() ) {
-                positions.push_back( nit->point );
-                nit++;
-            }
 
-            newvc.centroid = CGAL::centroid(positions.begin(),positions.end(),tg);
-            newvc.face     = (*oc).face;
-            newvc.nodes    = (*oc).nodes;
+        if ( iiter < CLUSTER_MAX_RELAX_ITER-1 ) {
+            cur.swap( next );
         }
-        newcells.push_back(newvc);
     }
-}
-
-tgCluster::tgCluster( std::list<tgClusterNode>& points, double err, const std::string& d )
-{
-    int  kiter = 40, iiter = 0;
-    bool is_equal = false;
-
-    squaredError = err;
-    debug = d;
 
-    std::list<tgClusterNode>::iterator lit;
-    std::vector<tgClusterNode>::iterator it;
-
-    // first step is to merge points really close to one another.
-    // note: fixed nodes Should NOT move!
-    // move to newcentroids
-    for ( lit = points.begin(); lit != points.end(); lit++ ) {
-        oldcentroids.push_back( *lit );
+    // round the final centers to the exact kernel
+    tree.clear();
+    for ( unsigned int i=0; i<cur.size(); i++ ) {
+        centroids.push_back( EPECPoint_2( cur[i].x(), cur[i].y() ) );
+        tree.insert( tgClusterData( cur[i], i ) );
     }
 
-    SG_LOG( SG_GENERAL, LOG_CLUSER,  "tgCluster: " << oldcentroids.size() << " original points" );
-
-#if DEBUG_CLUSTER
-    toShapefile( debug, "original_points", oldcentroids );
-#endif
-
-    // remove dups
-    // char layer[256];
+    // build now - searching an unbuilt tree modifies it, and Locate
+    // may be called from more than one thread
+    if ( !centroids.empty() ) {
+        tree.build();
+    }
+}
 
-    tree.clear();
-    for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
-        tree.insert( nodesData( it->point, it ) );
+EPECPoint_2 tgCluster::Locate( const EPECPoint_2& point ) const
+{
+    if ( centroids.empty() ) {
+        return point;
     }
 
-    // clear new centroids
-    newcentroids.clear();
+    tgClusterPoint pt( CGAL::to_double( point.x() ), CGAL::to_double( point.y() ) );
 
-    std::list<nodesData>           query_result;
-    std::list<nodesData>::iterator qrit;
+    return centroids[ nearest( tree, pt ) ];
+}
 
-    unsigned int centroidIdx = 1;
-    for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
-        if ( !it->added ) {
-            it->added = true;
+int tgCluster::nearest( const tgClusterTree& centerTree, const tgClusterPoint& pt ) const
+{
+    tgClusterNeighborSearch search( centerTree, pt, 1 );
 
-            VDnodesFuzzyCir query_circle( (it->point), 0.000000001);
+    return boost::get<1>( search.begin()->first );
+}
 
-            // perform the query
-            query_result.clear();
-            tree.search(std::back_inserter( query_result ), query_circle);
+// merge nodes at the same location - a merged node is fixed if any of its
+// nodes are
+void tgCluster::mergeDuplicates( std::vector<clusterCenter>& centers ) const
+{
+    std::vector<clusterCenter> unique;
+    tgClusterTree              dupTree;
+    std::list<tgClusterData>   query_result;
 
-            // we should always have at least one result
-            if ( query_result.size() > 1 ) {
-                std::vector<EPECPoint_2>             positions;
-                std::vector<tgClusterNode>::iterator pos_it;
-
-                // we create centroids for each fixed node.
-                // If there are no fixed nodes, take the average
-                bool fixed = false;
-                for ( qrit = query_result.begin(); qrit != query_result.end(); qrit++ ) {
-                    EPECPoint_2 pos = boost::get<0>(*qrit);
-                    pos_it = boost::get<1>(*qrit);
-
-                    positions.push_back(pos);
-                    pos_it->added = true;
-                    if ( pos_it->fixed ) {
-                        fixed = true;
-                    }
-                }
+    for ( unsigned int i=0; i<centers.size(); i++ ) {
+        dupTree.insert( tgClusterData( centers[i].point, i ) );
+    }
 
-                SG_LOG( SG_GENERAL, LOG_CLUSER,  " - found " << positions.size() << " dups" );
+    for ( unsigned int i=0; i<centers.size(); i++ ) {
+        if ( !centers[i].added ) {
+            bool fixed = centers[i].fixed;
+            centers[i].added = true;
 
-#if DEBUG_CLUSTER
-                GDALDataset* poDs = openDatasource( debug );
+            tgClusterFuzzyCir query_circle( centers[i].point, CLUSTER_DUPLICATE_RADIUS );
 
-                sprintf( layer, "node_%05d_dup", centroidIdx );
-                OGRLayer* poDupLayer = openLayer( poDs, wkbPoint25D, layer );
-                toShapefile( poDupLayer, positions );
-#endif
+            query_result.clear();
+            dupTree.search( std::back_inserter( query_result ), query_circle );
 
-                newcentroids.push_back( tgClusterNode( it->point, fixed ) );
+            for ( std::list<tgClusterData>::iterator qrit = query_result.begin(); qrit != query_result.end(); qrit++ ) {
+                clusterCenter& dup = centers[ boost::get<1>(*qrit) ];
 
-#if DEBUG_CLUSTER
-                GDALClose( poDs );
-#endif
+                dup.added = true;
+                if ( dup.fixed ) {
+                    fixed = true;
+                }
+            }
 
-            } else {
-                newcentroids.push_back( tgClusterNode( it->point, it->fixed ) );
+            if ( query_result.size() > 1 ) {
+                SG_LOG( SG_GENERAL, LOG_CLUSER,  " - found " << query_result.size() << " dups" );
             }
 
-            centroidIdx++;
+            unique.push_back( clusterCenter( centers[i].point, fixed ) );
         }
     }
 
-    // copy new centroids to old array
-    oldcentroids.clear();
-    for ( it = newcentroids.begin(); it != newcentroids.end(); it++ ) {
-        oldcentroids.push_back( tgClusterNode(it->point, it->fixed) );
-    }
-
-    SG_LOG( SG_GENERAL, LOG_CLUSER,  "tgCluster: " << oldcentroids.size() << " unique points " );
-
-    int tree_iter = 1;
-    bool merged_centroid = false;
+    centers.swap( unique );
+}
 
-    do {
-        // move new centroids into kd-tree
-        SG_LOG( SG_GENERAL, LOG_CLUSER,  "Find centroids iteration " << tree_iter << " num_centroids is " << oldcentroids.size() );
+// one pass of merging centers within the cluster radius.  Fixed centers
+// never move - if a neighborhood has any, they all survive and the free
+// centers around them are dropped.  Otherwise the free centers are
+// replaced by their centroid.  Returns true if anything was merged.
+bool tgCluster::mergeCenters( std::vector<clusterCenter>& centers ) const
+{
+    std::vector<clusterCenter> merged;
+    tgClusterTree              centerTree;
+    std::list<tgClusterData>   query_result;
+    bool                       merged_centroid = false;
+
+    for ( unsigned int i=0; i<centers.size(); i++ ) {
+        centers[i].added = false;
+        centerTree.insert( tgClusterData( centers[i].point, i ) );
+    }
 
-        tree.clear();
-        for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
-            tree.insert( nodesData( it->point, it ) );
+    for ( unsigned int i=0; i<centers.size(); i++ ) {
+        if ( centers[i].added ) {
+            continue;
         }
 
-        // clear new centroids
-        newcentroids.clear();
-
-        merged_centroid = false;
-        std::list<nodesData>           query_result;
-        std::list<nodesData>::iterator qrit;
-
-        unsigned int centroidIdx = 1;
-        for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
-            if ( !it->added ) {
-                VDnodesFuzzyCir query_circle( (it->point), squaredError);
-
-                // perform the query
-                query_result.clear();
-                tree.search(std::back_inserter( query_result ), query_circle);
-
-                // we should always have at least one result
-                if ( query_result.size() > 1 ) {
-                    std::vector<EPECPoint_2> fixedPos;
-                    std::vector<EPECPoint_2> notFixedPos;
-                    tgClusterNode            center;
-                    tag                      tg;
-
-                    // we create centroids for each fixed node.
-                    // If there are no fixed nodes, take the average
-                    for ( qrit = query_result.begin(); qrit != query_result.end(); qrit++ ) {
-                        EPECPoint_2 pos = boost::get<0>(*qrit);
-                        std::vector<tgClusterNode>::iterator pos_it = boost::get<1>(*qrit);;
-
-                        // we only care abount non-added points
-                        if ( !pos_it->added ) {
-                            if ( pos_it->fixed ) {
-                                fixedPos.push_back(pos);
-                            } else {
-                                notFixedPos.push_back(pos);
-                            }
-
-                            pos_it->added = true;
-                        }
-                    }
+        tgClusterFuzzyCir query_circle( centers[i].point, squaredError );
 
-                    SG_LOG( SG_GENERAL, LOG_CLUSER,  " - found " << fixedPos.size() << " fixed nodes and " << notFixedPos.size() << " not fixed nodes" );
+        query_result.clear();
+        centerTree.search( std::back_inserter( query_result ), query_circle );
 
-    #if DEBUG_CLUSTER
-                    GDALDataset* poDs = openDatasource( debug );
+        if ( query_result.size() > 1 ) {
+            std::vector<tgClusterPoint> fixedPos;
+            double                      sumX = 0.0, sumY = 0.0;
+            unsigned int                numNotFixed = 0;
 
-                    sprintf( layer, "tree_%02d_node_%05d_cent", tree_iter, centroidIdx );
-                    OGRLayer* poCentroidLayer = openLayer( poDs, wkbPoint25D, layer );
-                    toShapefile( poCentroidLayer, (*it) );
+            // we only care about non-added points
+            for ( std::list<tgClusterData>::iterator qrit = query_result.begin(); qrit != query_result.end(); qrit++ ) {
+                clusterCenter& c = centers[ boost::get<1>(*qrit) ];
 
-                    if ( !fixedPos.empty() ) {
-                        sprintf( layer, "tree_%02d_node_%05d_fixed", tree_iter, centroidIdx );
-                        OGRLayer* poFixedLayer = openLayer( poDs, wkbPoint25D, layer );
-                        toShapefile( poFixedLayer, fixedPos );
-                    }
-
-                    if ( !notFixedPos.empty() ) {
-                        sprintf( layer, "tree_%02d_node_%05d_not_fixed", tree_iter, centroidIdx );
-                        OGRLayer* poNotFixedLayer = openLayer( poDs, wkbPoint25D, layer );
-                        toShapefile( poNotFixedLayer, notFixedPos );
-                    }
-
-                    sprintf( layer, "tree_%02d_node_%05d_new_centers", tree_iter, centroidIdx );
-                    OGRLayer* poNewCentersLayer = openLayer( poDs, wkbPoint25D, layer );
-    #endif
-
-                    if ( !fixedPos.empty() ) {
-                        for ( unsigned int i=0; i<fixedPos.size(); i++ ) {
-                            center = tgClusterNode( fixedPos[i], true );
-
-    #if DEBUG_CLUSTER
-                            toShapefile( poNewCentersLayer, center );
-    #endif
-
-                            newcentroids.push_back( center );
-                        }
-                    } else if ( !notFixedPos.empty() )  {
-                        center = tgClusterNode( centroid( notFixedPos.begin(), notFixedPos.end(), tg), false );
-
-    #if DEBUG_CLUSTER
-                        toShapefile( poNewCentersLayer, center );
-    #endif
-
-                        newcentroids.push_back( center );
-                        merged_centroid = true;
+                if ( !c.added ) {
+                    if ( c.fixed ) {
+                        fixedPos.push_back( c.point );
                     } else {
-                        SG_LOG( SG_GENERAL, LOG_CLUSER,  " no other nodes in cluster" );
-                        newcentroids.push_back( tgClusterNode( it->point, it->fixed ) );
+                        sumX += c.point.x();
+                        sumY += c.point.y();
+                        numNotFixed++;
                     }
 
-    #if DEBUG_CLUSTER
-                    GDALClose( poDs );
-    #endif
-
-                } else {
-                    qrit = query_result.begin();
-                    EPECPoint_2 pos = boost::get<0>(*qrit);
-                    std::vector<tgClusterNode>::iterator pos_it = boost::get<1>(*qrit);;
-
-                    pos_it->added = true;
-
-                    newcentroids.push_back( tgClusterNode( pos, pos_it->fixed ) );
+                    c.added = true;
                 }
             }
 
-            centroidIdx++;
-        }
+            SG_LOG( SG_GENERAL, LOG_CLUSER,  " - found " << fixedPos.size() << " fixed nodes and " << numNotFixed << " not fixed nodes" );
 
-        // copy new centroids to old array
-        oldcentroids.clear();
-        for ( it = newcentroids.begin(); it != newcentroids.end(); it++ ) {
-            oldcentroids.push_back( *it );
+            if ( !fixedPos.empty() ) {
+                for ( unsigned int j=0; j<fixedPos.size(); j++ ) {
+                    merged.push_back( clusterCenter( fixedPos[j], true ) );
+                }
+            } else if ( numNotFixed ) {
+                merged.push_back( clusterCenter( tgClusterPoint( sumX / numNotFixed, sumY / numNotFixed ), false ) );
+                merged_centroid = true;
+            } else {
+                SG_LOG( SG_GENERAL, LOG_CLUSER,  " no other nodes in cluster" );
+                merged.push_back( clusterCenter( centers[i].point, centers[i].fixed ) );
+            }
+        } else {
+            centers[i].added = true;
+            merged.push_back( clusterCenter( centers[i].point, centers[i].fixed ) );
         }
+    }
 
-        tree_iter++;
-    } while ( merged_centroid );
+    centers.swap( merged );
 
-    nodes = points;
+    return merged_centroid;
+}
 
-    SG_LOG( SG_GENERAL, LOG_CLUSER,  " Do voronoi relaxation with " << oldcentroids.size() << " nodes" );
+// one Lloyd iteration - assign every node to its nearest center, and
+// compute the centroid of each center's nodes.  Centers without nodes
+// stay put.  Returns false once the centers no longer move.
+bool tgCluster::relax( const std::vector<tgClusterPoint>& centers, std::vector<tgClusterPoint>& next )
+{
+    tgClusterTree centerTree;
 
-    // create voronoi cells for each centroid
-    for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
-        tgVoronoiCell newvc;
-        newvc.centroid = it->point;
-        newvc.fixed    = it->fixed;
-        oldcells.push_back( newvc );
+    for ( unsigned int i=0; i<centers.size(); i++ ) {
+        centerTree.insert( tgClusterData( centers[i], i ) );
     }
+    centerTree.build();
 
-    while( iiter < kiter )
-    {
-        computenewcentroids();
-        iiter++;
+    std::vector<double>       sumX( centers.size(), 0.0 );
+    std::vector<double>       sumY( centers.size(), 0.0 );
+    std::vector<unsigned int> count( centers.size(), 0 );
 
-        if(newcells.size() < oldcells.size())
-        {
-            is_equal = std::equal(newcells.begin(),newcells.end(),oldcells.begin());
-        }
-        else
-        {
-            is_equal = std::equal(oldcells.begin(),oldcells.end(),newcells.begin());
-        }
+    membership.resize( nodePoints.size() );
+    for ( unsigned int i=0; i<nodePoints.size(); i++ ) {
+        int c = nearest( centerTree, nodePoints[i] );
 
-        if( is_equal )
-        {
-            is_equal = false;
-            break;
-        }
-        else 
-        {
-            // iterate again - move new to old
-            oldcells.clear();
-            std::vector<tgVoronoiCell>::iterator cit = newcells.begin();
-            for(cit = newcells.begin(); cit!= newcells.end(); cit++)
-            {
-                tgVoronoiCell newvc;
-                newvc.centroid = (*cit).centroid;
-                oldcells.push_back( newvc );
-            }
+        membership[i] = c;
+        sumX[c] += nodePoints[i].x();
+        sumY[c] += nodePoints[i].y();
+        count[c]++;
+    }
+
+    next.clear();
+    for ( unsigned int i=0; i<centers.size(); i++ ) {
+        if ( count[i] ) {
+            next.push_back( tgClusterPoint( sumX[i] / count[i], sumY[i] / count[i] ) );
+        } else {
+            next.push_back( centers[i] );
         }
     }
+
+    return next != centers;
 }
 
 void tgCluster::toShapefile( const char* datasource, const char* layer_prefix )
@@ -381,55 +260,35 @@ void tgCluster::toShapefile( const char* datasource, const char* layer_prefix )
     char layer[256];
     char layer2[256];
     char description[32];
-    int  cell_id = 1;
 
-    std::vector<tgVoronoiCell>::iterator cit;
-    for(cit = newcells.begin(); cit!= newcells.end(); cit++, cell_id++)
-    {
-        std::vector<tgSegment> edges;
+    std::vector< std::vector<unsigned int> > cellNodes( centroids.size() );
+    for ( unsigned int i=0; i<membership.size(); i++ ) {
+        cellNodes[ membership[i] ].push_back( i );
+    }
 
+    for ( unsigned int c=0; c<centroids.size(); c++ )
+    {
         // label each centroid
-        sprintf( description, "voronoi_cell_%04d", cell_id );
+        sprintf( description, "voronoi_cell_%04d", c+1 );
         sprintf( layer, "%s_centroids", layer_prefix ); 
 
         // dump centroid ( only if there are more than one nodes in the cell )
-        if ( (*cit).nodes.size() > 1 ) {
-            SGGeod centroid = SGGeod::fromDeg( CGAL::to_double( (*cit).centroid.x() ),
-                                               CGAL::to_double( (*cit).centroid.y() ) );
+        if ( cellNodes[c].size() > 1 ) {
+            SGGeod centroid = SGGeod::fromDeg( CGAL::to_double( centroids[c].x() ),
+                                               CGAL::to_double( centroids[c].y() ) );
 
             tgShapefile::FromGeod( centroid, datasource, layer, description );
         }
 
-        // dump edges
-        VDCcbHalfedgeCirculator ec_start = (*cit).face->ccb();
-        VDCcbHalfedgeCirculator ec       = ec_start;
-
-        sprintf( layer, "%s_edges", layer_prefix ); 
-        edges.clear();
-        do
-        {
-            VDHalfedgeHandle e = ec;
-            if ( e->is_segment() ) {
-                SGGeod gsrc = SGGeod::fromDeg( CGAL::to_double(e->source()->point().x()),
-                                               CGAL::to_double(e->source()->point().y()) );
-                SGGeod gtrg = SGGeod::fromDeg( CGAL::to_double(e->target()->point().x()),
-                                               CGAL::to_double(e->target()->point().y()) );
-
-                edges.push_back( tgSegment(gsrc, gtrg) );
-            }
-
-        } while ( ++ec != ec_start );
-
-        tgShapefile::FromSegmentList( edges, false, datasource, layer, description );
-
         // generate node list
         sprintf( layer, "%s_nodes", layer_prefix ); 
         sprintf( layer2, "%s_fixed_nodes", layer_prefix ); 
-        for ( std::vector<tgClusterNode>::iterator nit = (*cit).nodes.begin(); nit != (*cit).nodes.end(); nit++ ) 
+        for ( unsigned int i=0; i<cellNodes[c].size(); i++ )
         {
-            SGGeod node = SGGeod::fromDeg( CGAL::to_double( nit->point.x() ),
-                                           CGAL::to_double( nit->point.y() ) );
-            if ( nit->fixed ) {
+            const tgClusterNode& n = nodes[ cellNodes[c][i] ];
+            SGGeod node = SGGeod::fromDeg( CGAL::to_double( n.point.x() ),
+                                           CGAL::to_double( n.point.y() ) );
+            if ( n.fixed ) {
                 tgShapefile::FromGeod( node, datasource, layer2, description );
             } else {
                 tgShapefile::FromGeod( node, datasource, layer, description );
@@ -7,41 +7,28 @@
 #include "tg_cgal_epec.hxx"
 #include "tg_cgal.hxx"
 
-// includes for defining the Voronoi diagram adaptor
-#include <CGAL/basic.h>
-#include <CGAL/Triangulation_2.h>
-#include <CGAL/Delaunay_triangulation_2.h>
-#include <CGAL/Voronoi_diagram_2.h>
-#include <CGAL/Delaunay_triangulation_adaptation_traits_2.h>
-#include <CGAL/Delaunay_triangulation_adaptation_policies_2.h>
-#include <CGAL/centroid.h>
-#include <CGAL/Dimension.h>
+#include <boost/tuple/tuple.hpp>
 
 #include <CGAL/Kd_tree.h>
 #include <CGAL/algorithm.h>
 #include <CGAL/Fuzzy_sphere.h>
 #include <CGAL/Search_traits_2.h>
+#include <CGAL/Search_traits_adapter.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
 
-// typedefs for defining the adaptor
-typedef CGAL::Delaunay_triangulation_2<EPECKernel>                           DT;
-typedef CGAL::Delaunay_triangulation_adaptation_traits_2<DT>                 AT;
-typedef CGAL::Delaunay_triangulation_caching_degeneracy_removal_policy_2<DT> AP;
-typedef CGAL::Voronoi_diagram_2<DT,AT,AP>                                    VD;
-typedef CGAL::Dimension_tag<0>                                               tag;
+// The clustering itself runs on doubles - only the final centroids are
+// converted to the exact kernel.  Nodes and centroids are kept in kd-trees
+// of ( position, index ) tuples.
+typedef EPICKernel::Point_2                     tgClusterPoint;
 
-//typedef K::Point_2                            Point;
-typedef EPECKernel::Iso_rectangle_2             EPECIsoRectangle;
+typedef boost::tuple<tgClusterPoint, int>       tgClusterData;
+typedef CGAL::Search_traits_2<EPICKernel>       tgClusterTraitsBase;
+typedef CGAL::Search_traits_adapter<tgClusterData, CGAL::Nth_of_tuple_property_map<0, tgClusterData>, tgClusterTraitsBase>  tgClusterTraits;
 
-// typedef for the result type of the point location
-typedef AT::Site_2                              EPECSite;
-
-typedef VD::Locate_result                       VDLocateResult;
-typedef AT::Nearest_site_2                      ATLocateResult;
-typedef VD::Vertex_handle                       VDVertexHandle;
-typedef VD::Face_handle                         VDFaceHandle;
-typedef VD::Halfedge_handle                     VDHalfedgeHandle;
-typedef VD::Ccb_halfedge_circulator             VDCcbHalfedgeCirculator;
-typedef VD::Halfedge_around_vertex_circulator   VDHalfedge_around_vertex_circulator;
+typedef CGAL::Fuzzy_sphere<tgClusterTraits>                 tgClusterFuzzyCir;
+typedef CGAL::Orthogonal_k_neighbor_search<tgClusterTraits> tgClusterNeighborSearch;
+typedef tgClusterNeighborSearch::Tree                       tgClusterTree;
+typedef tgClusterNeighborSearch::Distance                   tgClusterDistance;
 
 struct tgClusterNode
 {
@@ -58,41 +45,34 @@ public:
     bool        added;
 };
 
-typedef boost::tuple<EPECPoint_2, std::vector<tgClusterNode>::iterator> nodesData;
-typedef CGAL::Search_traits_2<EPECKernel>       nodesTraitsBase;
-typedef CGAL::Search_traits_adapter<nodesData, CGAL::Nth_of_tuple_property_map<0, nodesData>,nodesTraitsBase>  VDnodesTraits;
-//typedef CGAL::Search_traits_2<EPECKernel>                         VDnodesTraits;
-
-typedef CGAL::Fuzzy_sphere<VDnodesTraits>       VDnodesFuzzyCir;
-typedef CGAL::Kd_tree<VDnodesTraits>            VDnodesTree;
-
-typedef std::vector<EPECPoint_2>                Points;
-typedef std::vector<Points>                     PointsArray;
-
-struct tgVoronoiCell 
+// Clusters nodes closer than err to one another, then relaxes the cluster
+// centers with Lloyd iterations.  Holds no global state - separate
+// instances may be built and queried from different threads.
+class tgCluster
 {
 public:
+    tgCluster( const std::list<tgClusterNode>& points, double err, const std::string& d );
 
-    EPECPoint_2                centroid;
-    bool                       fixed;
-    VDFaceHandle               face;
-    std::vector<tgClusterNode> nodes;
-
-    bool operator==(const tgVoronoiCell& other ) {
-        return (centroid == other.centroid);
-    }
-};
-
-class tgCluster 
-{
-public:
-    tgCluster( std::list<tgClusterNode>& points, double err, const std::string& d );
+    // the cluster center the point belongs to
     EPECPoint_2 Locate( const EPECPoint_2& point ) const;
 
+    unsigned int getNumCentroids( void ) const { return centroids.size(); }
+
     void toShapefile( const char* datasource, const char* layer );
 
 private:
-    void computenewcentroids(void);
+    struct clusterCenter {
+        clusterCenter( const tgClusterPoint& p, bool f ) : point(p), fixed(f), added(false) {}
+
+        tgClusterPoint  point;
+        bool            fixed;
+        bool            added;
+    };
+
+    void mergeDuplicates( std::vector<clusterCenter>& centers ) const;
+    bool mergeCenters( std::vector<clusterCenter>& centers ) const;
+    bool relax( const std::vector<tgClusterPoint>& centers, std::vector<tgClusterPoint>& next );
+    int  nearest( const tgClusterTree& centerTree, const tgClusterPoint& pt ) const;
 
     // debug
     GDALDataset* openDatasource( const std::string& debug ) const;
@@ -103,19 +83,16 @@ private:
     void toShapefile( OGRLayer* poLayer, const std::vector<EPECPoint_2>& points );
     void toShapefile( OGRLayer* poLayer, const EPECPoint_2& point );
 
-    std::list<tgClusterNode>  nodes;
-    double                    squaredError;
-    int                       numcentroids;
-
-    std::vector<tgsegment_list> v_faces;       // segments making up the face
-    PointsArray                 vpoints;
+    std::vector<tgClusterNode>  nodes;
+    std::vector<tgClusterPoint> nodePoints;
+    double                      squaredError;
 
-    std::vector<tgClusterNode>  oldcentroids, newcentroids;
-    std::vector<tgVoronoiCell>  oldcells,     newcells;
+    // final cluster centers, and the center each node belongs to
+    std::vector<EPECPoint_2>    centroids;
+    std::vector<int>            membership;
 
-    VDnodesTree tree;
-    VD          vd;
-    std::string debug;
+    tgClusterTree               tree;
+    std::string                 debug;
 };
 
 #endif /* __TG_CLUSTER_HXX__ */
\ No newline at end of file
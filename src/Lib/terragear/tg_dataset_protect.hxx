@@ -22,6 +22,8 @@
 // when the last task is finished with a tile,  it is remved from 
 // the map.
 
+// tgChopper uses this to write the buffered polygons of different
+// tiles at the same time.
 
 // structure containg information about a tile
 // in use, number of waiters, etc...
@@ -30,21 +32,20 @@ public:
     tileInfo( unsigned long id ) : tid( id ), numWaiting(1), inUse( true ) {}
 
     void AddWaiter( SGMutex& m ) {
-        //SGGuard<SGMutex> g(mutex);
-
-        SG_LOG(SG_GENERAL, SG_INFO, "tgDataSetProtect task " << SGThread::current() << " waiting on tile " << tid << " num ahead is " << numWaiting );
+        SG_LOG(SG_GENERAL, SG_DEBUG, "tgDataSetProtect task " << SGThread::current() << " waiting on tile " << tid << " num ahead is " << numWaiting );
         
         numWaiting++;
         while ( inUse ) {            
             available.wait( m );
-            SG_LOG(SG_GENERAL, SG_INFO, "tgDataSetProtect task " << SGThread::current() << " signalled for tile " << tid << " num waiting is " << numWaiting << " inUse is " << inUse );            
+            SG_LOG(SG_GENERAL, SG_DEBUG, "tgDataSetProtect task " << SGThread::current() << " signalled for tile " << tid << " num waiting is " << numWaiting << " inUse is " << inUse );            
         }
+
+        // it's ours now - anyone asking after us has to wait
+        inUse = true;
     }
 
     bool RemoveWaiter( void ) {
-        //SGGuard<SGMutex> g(mutex);
-
-        SG_LOG(SG_GENERAL, SG_INFO, "tgDataSetProtect task " << SGThread::current() << " finished with tile " << tid << " num waiting is " << numWaiting );
+        SG_LOG(SG_GENERAL, SG_DEBUG, "tgDataSetProtect task " << SGThread::current() << " finished with tile " << tid << " num waiting is " << numWaiting );
         
         numWaiting--;
         inUse = false;
@@ -57,7 +58,6 @@ public:
     }
 
     SGWaitCondition available;
-    //SGMutex         mutex;
 
     unsigned long   tid;
     int             numWaiting;     // when this is 0, we can remove tileInfo from the map
@@ -82,7 +82,7 @@ public:
             waitingTasks[tileId] = new tileInfo( tileId );
             // we can continue to use it - we're the first to ask for it
             // so no call to AddWaiter
-            SG_LOG(SG_GENERAL, SG_INFO, "tgDataSetProtect task " << SGThread::current() << " working on tile " << tileId );
+            SG_LOG(SG_GENERAL, SG_DEBUG, "tgDataSetProtect task " << SGThread::current() << " working on tile " << tileId );
         } else {
             // tile is in the map, so it is already in use
             // once AddWaiter returns, we have the tile for ourselves
@@ -110,7 +110,7 @@ public:
         } else {
 
             // uh-oh - this shouldn't happen
-            SG_LOG( SG_GENERAL, SG_INFO, "tgDatasetAccess::Released tile " << tileId << " NOT IN MAP - ERROR " );
+            SG_LOG( SG_GENERAL, SG_ALERT, "tgDatasetAccess::Released tile " << tileId << " NOT IN MAP - ERROR " );
         }
     }
 
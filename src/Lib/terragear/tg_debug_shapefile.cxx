@@ -0,0 +1,236 @@
+#include <deque>
+
+#include <ogrsf_frmts.h>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+
+#include "tg_debug_shapefile.hxx"
+
+// writes the in memory datasets of buffered debug output to shapefiles -
+// one thread for the process, started on the first flush
+class tgDebugShapefileWriter : public SGThread
+{
+public:
+    static tgDebugShapefileWriter& instance( void ) {
+        static tgDebugShapefileWriter writer;
+
+        return writer;
+    }
+
+    void add( const std::string& datasource, GDALDataset* memDS ) {
+        SGGuard<SGMutex> g( lock );
+
+        if ( !running ) {
+            running = true;
+            start();
+        }
+
+        jobs.push_back( job( datasource, memDS ) );
+        jobsReady.signal();
+    }
+
+    void sync( void ) {
+        SGGuard<SGMutex> g( lock );
+
+        while ( !jobs.empty() || busy ) {
+            idle.wait( lock );
+        }
+    }
+
+    // write whatever is still queued before the process exits
+    ~tgDebugShapefileWriter() {
+        {
+            SGGuard<SGMutex> g( lock );
+            stopping = true;
+            jobsReady.signal();
+        }
+
+        if ( running ) {
+            join();
+        }
+    }
+
+private:
+    typedef std::pair<std::string, GDALDataset*> job;
+
+    tgDebugShapefileWriter() : running(false), stopping(false), busy(false) {}
+
+    virtual void run() {
+        while ( true ) {
+            job cur;
+            {
+                SGGuard<SGMutex> g( lock );
+
+                while ( jobs.empty() && !stopping ) {
+                    jobsReady.wait( lock );
+                }
+                if ( jobs.empty() ) {
+                    break;
+                }
+
+                cur = jobs.front();
+                jobs.pop_front();
+                busy = true;
+            }
+
+            write( cur.first, cur.second );
+
+            {
+                SGGuard<SGMutex> g( lock );
+
+                busy = false;
+                if ( jobs.empty() ) {
+                    idle.broadcast();
+                }
+            }
+        }
+    }
+
+    void write( const std::string& datasource, GDALDataset* memDS ) {
+        GDALDataset* poDS = (GDALDataset*)tgShapefile::OpenDatasource( datasource.c_str() );
+
+        if ( poDS ) {
+            for ( int i=0; i<memDS->GetLayerCount(); i++ ) {
+                OGRLayer* src = memDS->GetLayer( i );
+                OGRLayer* dst = (OGRLayer*)tgShapefile::OpenLayer( poDS, src->GetName(), layerType( src->GetGeomType() ) );
+                if ( !dst ) {
+                    continue;
+                }
+
+                OGRFeature* feature;
+                src->ResetReading();
+                while ( ( feature = src->GetNextFeature() ) != NULL ) {
+                    OGRFeature* copy = OGRFeature::CreateFeature( dst->GetLayerDefn() );
+                    copy->SetFrom( feature );
+                    if ( dst->CreateFeature( copy ) != OGRERR_NONE ) {
+                        SG_LOG( SG_GENERAL, SG_ALERT, "tgDebugShapefile: failed to create feature in " << datasource << " layer " << src->GetName() );
+                    }
+
+                    OGRFeature::DestroyFeature( copy );
+                    OGRFeature::DestroyFeature( feature );
+                }
+            }
+
+            tgShapefile::CloseDatasource( poDS );
+        }
+
+        GDALClose( memDS );
+    }
+
+    static tgShapefile::shapefile_layer_t layerType( OGRwkbGeometryType t ) {
+        switch( wkbFlatten( t ) ) {
+            case wkbPoint:
+                return tgShapefile::LT_POINT;
+
+            case wkbLineString:
+                return tgShapefile::LT_LINE;
+
+            default:
+                return tgShapefile::LT_POLY;
+        }
+    }
+
+    std::deque<job>     jobs;
+    bool                running;
+    bool                stopping;
+    bool                busy;
+
+    SGMutex             lock;
+    SGWaitCondition     jobsReady;
+    SGWaitCondition     idle;
+};
+
+tgDebugShapefile::~tgDebugShapefile()
+{
+    flush();
+}
+
+void tgDebugShapefile::setLevel( level_t l )
+{
+    if ( l != level ) {
+        flush();
+        level = l;
+    }
+}
+
+void tgDebugShapefile::setDatasource( const std::string& ds )
+{
+    if ( ds != datasource ) {
+        flush();
+        datasource = ds;
+    }
+}
+
+void* tgDebugShapefile::getLayer( const char* layer, tgShapefile::shapefile_layer_t type )
+{
+    if ( level == DEBUG_OFF ) {
+        return NULL;
+    }
+
+    if ( !poDS ) {
+        if ( level == DEBUG_BUFFERED ) {
+            GDALAllRegister();
+
+            GDALDriver* poDriver = GetGDALDriverManager()->GetDriverByName( "Memory" );
+            if ( poDriver ) {
+                poDS = poDriver->Create( "", 0, 0, 0, GDT_Unknown, NULL );
+            }
+        } else {
+            poDS = tgShapefile::OpenDatasource( datasource.c_str() );
+        }
+
+        if ( !poDS ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "tgDebugShapefile: can't open debug datasource " << datasource << " - debug output is off" );
+            level = DEBUG_OFF;
+            return NULL;
+        }
+    }
+
+    std::map<std::string, void*>::iterator it = layers.find( layer );
+    if ( it != layers.end() ) {
+        return it->second;
+    }
+
+    void* lid = tgShapefile::OpenLayer( poDS, layer, type );
+    layers[layer] = lid;
+
+    return lid;
+}
+
+void tgDebugShapefile::flush( void )
+{
+    if ( !poDS ) {
+        return;
+    }
+
+    if ( level == DEBUG_BUFFERED ) {
+        tgDebugShapefileWriter::instance().add( datasource, (GDALDataset*)poDS );
+    } else {
+        tgShapefile::CloseDatasource( poDS );
+    }
+
+    poDS = NULL;
+    layers.clear();
+}
+
+void tgDebugShapefile::sync( void )
+{
+    tgDebugShapefileWriter::instance().sync();
+}
+
+bool tgDebugShapefile::parseLevel( const std::string& s, level_t& l )
+{
+    if ( s == "off" ) {
+        l = DEBUG_OFF;
+    } else if ( s == "buffered" ) {
+        l = DEBUG_BUFFERED;
+    } else if ( s == "full" ) {
+        l = DEBUG_FULL;
+    } else {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef __TG_DEBUG_SHAPEFILE_HXX__
+#define __TG_DEBUG_SHAPEFILE_HXX__
+
+#include <map>
+#include <string>
+
+#include "tg_shapefile.hxx"
+
+// Debug shapefile output for one datasource, at one of three levels:
+//
+// DEBUG_OFF      - nothing is written.  Callers check isEnabled() before
+//                  they build any debug geometry, so this costs a test.
+// DEBUG_BUFFERED - features go to an in memory dataset.  flush() hands it
+//                  to a background thread, which writes the shapefiles.
+// DEBUG_FULL     - features are written to the shapefiles as they come.
+//
+// Features are added with the tgShapefile::From...( void* lid, ... )
+// functions, on a layer from getLayer().  Layers are only valid up to the
+// next flush().  A tgDebugShapefile is used from one thread at a time.
+class tgDebugShapefile
+{
+public:
+    typedef enum {
+        DEBUG_OFF,
+        DEBUG_BUFFERED,
+        DEBUG_FULL
+    } level_t;
+
+    tgDebugShapefile( const std::string& ds, level_t l = DEBUG_OFF ) : datasource(ds), level(l), poDS(NULL) {}
+    ~tgDebugShapefile();
+
+    bool    isEnabled( void ) const { return level != DEBUG_OFF; }
+    level_t getLevel( void ) const  { return level; }
+    void    setLevel( level_t l );
+
+    const std::string& getDatasource( void ) const { return datasource; }
+    void    setDatasource( const std::string& ds );
+
+    // NULL when debugging is off
+    void*   getLayer( const char* layer, tgShapefile::shapefile_layer_t type );
+
+    // write out - or hand to the writer thread - everything added so far
+    void    flush( void );
+
+    // wait until the writer thread has written everything flushed
+    static void sync( void );
+
+    // "off", "buffered" or "full"
+    static bool parseLevel( const std::string& s, level_t& l );
+
+private:
+    tgDebugShapefile( const tgDebugShapefile& );
+    tgDebugShapefile& operator=( const tgDebugShapefile& );
+
+    std::string                     datasource;
+    level_t                         level;
+
+    void*                           poDS;
+    std::map<std::string, void*>    layers;
+};
+
+#endif /* __TG_DEBUG_SHAPEFILE_HXX__ */
@@ -0,0 +1,68 @@
+#include <map>
+#include <set>
+
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include "tg_directory.hxx"
+#include "tg_profile.hxx"
+
+// the map lock is only held long enough to find ( or create ) the guard
+// for a directory - never while touching the filesystem
+static SGMutex                          dirMapLock;
+static std::map<std::string, SGMutex*>  dirGuards;
+static std::set<std::string>            dirsCreated;
+
+static SGMutex* getDirGuard( const std::string& directory )
+{
+    SGGuard<SGMutex> g( dirMapLock );
+
+    std::map<std::string, SGMutex*>::iterator it = dirGuards.find( directory );
+    if ( it == dirGuards.end() ) {
+        it = dirGuards.insert( std::make_pair( directory, new SGMutex ) ).first;
+    }
+
+    return it->second;
+}
+
+static bool isCreated( const std::string& directory )
+{
+    SGGuard<SGMutex> g( dirMapLock );
+
+    return ( dirsCreated.find( directory ) != dirsCreated.end() );
+}
+
+static void setCreated( const std::string& directory )
+{
+    SGGuard<SGMutex> g( dirMapLock );
+
+    dirsCreated.insert( directory );
+}
+
+void tgMakeDirectory( const std::string& directory )
+{
+    if ( directory.empty() || isCreated( directory ) ) {
+        return;
+    }
+
+    // walk the path from the top, creating each missing component
+    // while holding just that component's guard.  Once we get to a
+    // component, all of its parents already exist.
+    std::string::size_type pos = 0;
+    do {
+        pos = directory.find_first_of( "/\\", pos+1 );
+
+        std::string component = directory.substr( 0, pos );
+        if ( !isCreated( component ) ) {
+            tgProfileGuard<SGMutex> g( *getDirGuard( component ), "directory" );
+
+            SGPath sgp( component );
+            if ( !sgp.exists() ) {
+                sgp.append( "dummy" );
+                sgp.create_dir( 0755 );
+            }
+            setCreated( component );
+        }
+    } while ( pos != std::string::npos );
+}
@@ -0,0 +1,12 @@
+#ifndef __TG_DIRECTORY_HXX__
+#define __TG_DIRECTORY_HXX__
+
+#include <string>
+
+// Create a directory ( and any missing parents ) - safe to call from
+// multiple threads.  Each path component is created under its own guard,
+// so threads creating different tile directories only wait on one another
+// while creating a parent they have in common.
+void tgMakeDirectory( const std::string& directory );
+
+#endif /* __TG_DIRECTORY_HXX__ */
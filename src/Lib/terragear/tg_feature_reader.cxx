@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+
+#include <ogrsf_frmts.h>
+
+#include <simgear/debug/logstream.hxx>
+
+#include "tg_feature_reader.hxx"
+
+#define BATCH_FILTER_PAD    (0.01)
+
+tgFeatureReader::tgFeatureReader( OGRLayer* layer ) :
+    poLayer(layer), toWGS84(NULL), fromWGS84(NULL),
+    useExtent(false), extMinLon(0.0), extMinLat(0.0), extMaxLon(0.0), extMaxLat(0.0),
+    batchSize(0.0), startRecord(0),
+    started(false), firstCol(0), firstRow(0), numCols(1), numRows(1), curBatch(0), numRead(0)
+{
+    OGRSpatialReference* oSourceSRS = poLayer->GetSpatialRef();
+
+    if ( oSourceSRS ) {
+        OGRSpatialReference oTargetSRS;
+        oTargetSRS.SetWellKnownGeogCS( "WGS84" );
+
+        // our own transformations - the decoders' one is used on other threads
+        toWGS84   = OGRCreateCoordinateTransformation( oSourceSRS, &oTargetSRS );
+        fromWGS84 = OGRCreateCoordinateTransformation( &oTargetSRS, oSourceSRS );
+    }
+}
+
+tgFeatureReader::~tgFeatureReader()
+{
+    if ( toWGS84 ) {
+        OCTDestroyCoordinateTransformation( toWGS84 );
+    }
+    if ( fromWGS84 ) {
+        OCTDestroyCoordinateTransformation( fromWGS84 );
+    }
+}
+
+void tgFeatureReader::setExtent( double minLon, double minLat, double maxLon, double maxLat )
+{
+    useExtent = true;
+    extMinLon = minLon;
+    extMinLat = minLat;
+    extMaxLon = maxLon;
+    extMaxLat = maxLat;
+}
+
+void tgFeatureReader::setBatchSize( double deg )
+{
+    batchSize = deg;
+}
+
+void tgFeatureReader::setStartRecord( int rec )
+{
+    startRecord = rec;
+}
+
+OGRFeature* tgFeatureReader::next( void )
+{
+    if ( !started ) {
+        begin();
+    }
+
+    while ( curBatch < getNumBatches() ) {
+        OGRFeature* poFeature = poLayer->GetNextFeature();
+
+        if ( poFeature ) {
+            if ( ownsFeature( poFeature ) ) {
+                numRead++;
+                return poFeature;
+            }
+
+            // read with an earlier or a later batch
+            OGRFeature::DestroyFeature( poFeature );
+        } else if ( ++curBatch < getNumBatches() ) {
+            beginBatch( curBatch );
+        }
+    }
+
+    return NULL;
+}
+
+void tgFeatureReader::begin( void )
+{
+    started = true;
+
+    if ( batchSize > 0.0 && !useExtent ) {
+        OGREnvelope env;
+
+        if ( poLayer->GetExtent( &env, TRUE ) == OGRERR_NONE ) {
+            double x[4] = { env.MinX, env.MaxX, env.MinX, env.MaxX };
+            double y[4] = { env.MinY, env.MinY, env.MaxY, env.MaxY };
+
+            if ( !toWGS84 || toWGS84->Transform( 4, x, y ) ) {
+                extMinLon = std::min( std::min( x[0], x[1] ), std::min( x[2], x[3] ) );
+                extMinLat = std::min( std::min( y[0], y[1] ), std::min( y[2], y[3] ) );
+                extMaxLon = std::max( std::max( x[0], x[1] ), std::max( x[2], x[3] ) );
+                extMaxLat = std::max( std::max( y[0], y[1] ), std::max( y[2], y[3] ) );
+                useExtent = true;
+            }
+        }
+
+        if ( !useExtent ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "tgFeatureReader: no extent for layer " << poLayer->GetName() << " - reading it in one batch" );
+            batchSize = 0.0;
+        }
+    }
+
+    if ( batchSize > 0.0 ) {
+        firstCol = (int)floor( extMinLon / batchSize );
+        firstRow = (int)floor( extMinLat / batchSize );
+        numCols  = std::max( (int)ceil( extMaxLon / batchSize ) - firstCol, 1 );
+        numRows  = std::max( (int)ceil( extMaxLat / batchSize ) - firstRow, 1 );
+
+        if ( startRecord ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "tgFeatureReader: start record is ignored when reading in batches" );
+        }
+
+        SG_LOG( SG_GENERAL, SG_INFO, "tgFeatureReader: reading layer " << poLayer->GetName() << " in " << numCols << " x " << numRows << " batches" );
+
+        // a little wider than the cells, for projections that bend their
+        // borders - features found twice are dropped by ownsFeature()
+        double pad = batchSize * BATCH_FILTER_PAD;
+
+        batchFilters.resize( getNumBatches() );
+        for ( unsigned int b=0; b<getNumBatches(); b++ ) {
+            double minLon = ( firstCol + (int)( b % numCols ) ) * batchSize;
+            double minLat = ( firstRow + (int)( b / numCols ) ) * batchSize;
+
+            getFilter( std::max( minLon - pad, extMinLon ), std::max( minLat - pad, extMinLat ),
+                       std::min( minLon + batchSize + pad, extMaxLon ), std::min( minLat + batchSize + pad, extMaxLat ),
+                       batchFilters[b] );
+        }
+
+        beginBatch( 0 );
+    } else {
+        if ( useExtent ) {
+            OGREnvelope filter;
+
+            getFilter( extMinLon, extMinLat, extMaxLon, extMaxLat, filter );
+            poLayer->SetSpatialFilterRect( filter.MinX, filter.MinY, filter.MaxX, filter.MaxY );
+        }
+
+        poLayer->ResetReading();
+        poLayer->SetNextByIndex( startRecord );
+    }
+}
+
+void tgFeatureReader::beginBatch( unsigned int b )
+{
+    const OGREnvelope& filter = batchFilters[b];
+
+    poLayer->SetSpatialFilterRect( filter.MinX, filter.MinY, filter.MaxX, filter.MaxY );
+    poLayer->ResetReading();
+}
+
+// the filter is the envelope of the rectangle's corners, in the layer's
+// coordinates
+void tgFeatureReader::getFilter( double minLon, double minLat, double maxLon, double maxLat, OGREnvelope& filter )
+{
+    double x[4] = { minLon, maxLon, minLon, maxLon };
+    double y[4] = { minLat, minLat, maxLat, maxLat };
+
+    if ( fromWGS84 ) {
+        fromWGS84->Transform( 4, x, y );
+    }
+
+    filter.MinX = std::min( std::min( x[0], x[1] ), std::min( x[2], x[3] ) );
+    filter.MinY = std::min( std::min( y[0], y[1] ), std::min( y[2], y[3] ) );
+    filter.MaxX = std::max( std::max( x[0], x[1] ), std::max( x[2], x[3] ) );
+    filter.MaxY = std::max( std::max( y[0], y[1] ), std::max( y[2], y[3] ) );
+}
+
+// a feature belongs to the first batch returning it - no point of the
+// geometry need be inside its cell, the cell need only be where it enters
+// the extent.  Features a later batch's filter may return too are
+// remembered, and dropped there.
+bool tgFeatureReader::ownsFeature( OGRFeature* feature )
+{
+    if ( getNumBatches() == 1 ) {
+        return true;
+    }
+
+    OGRGeometry* poGeometry = feature->GetGeometryRef();
+    if ( !poGeometry ) {
+        return true;
+    }
+
+    GIntBig fid = feature->GetFID();
+    if ( fid == OGRNullFID ) {
+        SG_LOG( SG_GENERAL, SG_DEBUG, "tgFeatureReader: feature without FID - reading it with batch " << curBatch );
+        return true;
+    }
+
+    if ( readShared.find( fid ) != readShared.end() ) {
+        return false;
+    }
+
+    OGREnvelope env;
+    poGeometry->getEnvelope( &env );
+
+    for ( unsigned int b=curBatch+1; b<getNumBatches(); b++ ) {
+        if ( env.Intersects( batchFilters[b] ) ) {
+            readShared.insert( fid );
+            break;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef __TG_FEATURE_READER_HXX__
+#define __TG_FEATURE_READER_HXX__
+
+#include <set>
+#include <vector>
+
+#include <ogr_core.h>
+
+class OGRLayer;
+class OGRFeature;
+class OGRCoordinateTransformation;
+
+// Reads the features of an OGR layer one at a time, so the decoders can
+// start on the first ones while the rest are still on disk.
+//
+// With a batch size set, the extent - the spatial query, or else the whole
+// layer - is cut into cells of batchSize degrees, and the layer is read one
+// cell at a time, row by row from the south west.  The features come out
+// roughly sorted by location, and the chopper works on a few buckets at a
+// time.  A feature crossing cell borders is returned once, with the first
+// cell whose filter returns it.
+class tgFeatureReader
+{
+public:
+    tgFeatureReader( OGRLayer* layer );
+    ~tgFeatureReader();
+
+    // only read features intersecting the WGS84 rectangle
+    void setExtent( double minLon, double minLat, double maxLon, double maxLat );
+
+    // read in batches of deg x deg - 0 reads the layer in one go
+    void setBatchSize( double deg );
+
+    // skip the first rec features - only without batches
+    void setStartRecord( int rec );
+
+    // the next feature, owned by the caller - NULL at the end of the layer
+    OGRFeature* next( void );
+
+    unsigned int getNumBatches( void ) const { return numCols * numRows; }
+    unsigned long getNumRead( void ) const   { return numRead; }
+
+private:
+    tgFeatureReader( const tgFeatureReader& );
+    tgFeatureReader& operator=( const tgFeatureReader& );
+
+    void begin( void );
+    void beginBatch( unsigned int b );
+    void getFilter( double minLon, double minLat, double maxLon, double maxLat, OGREnvelope& filter );
+    bool ownsFeature( OGRFeature* feature );
+
+    OGRLayer*                       poLayer;
+    OGRCoordinateTransformation*    toWGS84;
+    OGRCoordinateTransformation*    fromWGS84;
+
+    bool                            useExtent;
+    double                          extMinLon, extMinLat, extMaxLon, extMaxLat;
+    double                          batchSize;
+    int                             startRecord;
+
+    bool                            started;
+    int                             firstCol, firstRow;
+    unsigned int                    numCols, numRows;
+    unsigned int                    curBatch;
+    unsigned long                   numRead;
+
+    // the spatial filter of every batch, and the features already read
+    // that a later one returns as well
+    std::vector<OGREnvelope>        batchFilters;
+    std::set<GIntBig>               readShared;
+};
+
+#endif /* __TG_FEATURE_READER_HXX__ */
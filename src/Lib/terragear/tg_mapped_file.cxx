@@ -0,0 +1,122 @@
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#include <simgear/debug/logstream.hxx>
+
+#include "tg_mapped_file.hxx"
+
+#ifdef _WIN32
+
+tgMappedFile::tgMappedFile() : base(NULL), length(0), file(INVALID_HANDLE_VALUE), mapping(NULL)
+{
+}
+
+bool tgMappedFile::open( const std::string& filename )
+{
+    close();
+
+    file = CreateFileA( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( file == INVALID_HANDLE_VALUE ) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if ( !GetFileSizeEx( (HANDLE)file, &fileSize ) || fileSize.QuadPart == 0 ) {
+        close();
+        return false;
+    }
+    length = (size_t)fileSize.QuadPart;
+
+    mapping = CreateFileMappingA( (HANDLE)file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if ( mapping == NULL ) {
+        close();
+        return false;
+    }
+
+    base = (const unsigned char*)MapViewOfFile( (HANDLE)mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( base == NULL ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMappedFile: can't map " << filename );
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void tgMappedFile::close( void )
+{
+    if ( base ) {
+        UnmapViewOfFile( base );
+    }
+    if ( mapping ) {
+        CloseHandle( (HANDLE)mapping );
+    }
+    if ( file != INVALID_HANDLE_VALUE ) {
+        CloseHandle( (HANDLE)file );
+    }
+
+    base    = NULL;
+    length  = 0;
+    mapping = NULL;
+    file    = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+tgMappedFile::tgMappedFile() : base(NULL), length(0), fd(-1)
+{
+}
+
+bool tgMappedFile::open( const std::string& filename )
+{
+    close();
+
+    fd = ::open( filename.c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+        close();
+        return false;
+    }
+    length = (size_t)st.st_size;
+
+    void* addr = mmap( NULL, length, PROT_READ, MAP_SHARED, fd, 0 );
+    if ( addr == MAP_FAILED ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgMappedFile: can't map " << filename );
+        close();
+        return false;
+    }
+    base = (const unsigned char*)addr;
+
+    return true;
+}
+
+void tgMappedFile::close( void )
+{
+    if ( base ) {
+        munmap( (void*)base, length );
+    }
+    if ( fd >= 0 ) {
+        ::close( fd );
+    }
+
+    base   = NULL;
+    length = 0;
+    fd     = -1;
+}
+
+#endif
+
+tgMappedFile::~tgMappedFile()
+{
+    close();
+}
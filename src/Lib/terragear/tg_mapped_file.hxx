@@ -0,0 +1,40 @@
+#ifndef __TG_MAPPED_FILE_HXX__
+#define __TG_MAPPED_FILE_HXX__
+
+#include <string>
+#include <cstddef>
+
+// Read only view of a whole file, mapped into memory.
+// Used for the binary intermediate formats, so loading them is just
+// a matter of pointing at the data - no parsing, and the pages are
+// shared between threads / processes reading the same file.
+class tgMappedFile
+{
+public:
+    tgMappedFile();
+    ~tgMappedFile();
+
+    bool open( const std::string& filename );
+    void close( void );
+
+    bool                 isOpen( void ) const { return base != NULL; }
+    const unsigned char* data( void ) const   { return base; }
+    size_t               size( void ) const   { return length; }
+
+private:
+    // not copyable - we own the mapping
+    tgMappedFile( const tgMappedFile& );
+    tgMappedFile& operator=( const tgMappedFile& );
+
+    const unsigned char* base;
+    size_t               length;
+
+#ifdef _WIN32
+    void*                file;
+    void*                mapping;
+#else
+    int                  fd;
+#endif
+};
+
+#endif /* __TG_MAPPED_FILE_HXX__ */
@@ -3,6 +3,8 @@
 
 #include <simgear/threads/SGThread.hxx>
 
+#include "tg_profile.hxx"
+
 #define DEBUG_LOCKS (0)
 
 class tgMutex : public SGMutex
@@ -23,7 +25,10 @@ public:
         }
 #endif
 
-        SGMutex::lock();
+        {
+            tgProfileWait w( "tgMutex" );
+            SGMutex::lock();
+        }
 
 #if DEBUG_LOCKS
         held = SGThread::current();
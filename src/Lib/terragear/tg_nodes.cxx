@@ -5,100 +5,100 @@
 
 const double fgPoint3_Epsilon = 0.000001;
 
-// The spacial search utilizes the boost tuple construct.
-// The k-d tree is generated in two dimensions. and the first element of the tuple is this 2d point
-// the second element of the tuple is the elevation of this point
-// Three dimensional queries is a bit overkill, but the code, although faster, is slightly more cumbersome
+// Duplicate detection uses a spatial hash of TG_NODE_FUZZ sized cells.  Unlike
+// a k-d tree, it doesn't need rebuilding when nodes are added between
+// lookups, so adding n nodes is O(n).
+// The range queries below still use a k-d tree.  The tree is generated in
+// two dimensions, and the first element of the tuple is this 2d point.  The
+// second element is the node index - indices stay valid as the node list
+// grows, where pointers into it would not.
+
+unsigned int TGNodes::find_close( const TGNodePoint& pt ) const {
+    long long    cx, cy;
+    unsigned int found = TG_NODE_NONE;
+
+    get_cell( pt, cx, cy );
+    for ( long long x = cx-1; x <= cx+1; x++ ) {
+        for ( long long y = cy-1; y <= cy+1; y++ ) {
+            boost::unordered_map<unsigned long long, unsigned int>::const_iterator it = tg_node_cells.find( cell_key( x, y ) );
+            if ( it == tg_node_cells.end() ) {
+                continue;
+            }
+
+            for ( unsigned int i = it->second; i != TG_NODE_NONE; i = tg_node_next[i] ) {
+                const SGGeod& pos = tg_node_list[i].GetPosition();
+                double dx = pos.getLongitudeDeg() - pt.x();
+                double dy = pos.getLatitudeDeg()  - pt.y();
+
+                if ( dx*dx + dy*dy <= TG_NODE_FUZZ*TG_NODE_FUZZ && i < found ) {
+                    found = i;
+                }
+            }
+        }
+    }
+
+    return found;
+}
 
 unsigned int TGNodes::unique_add( SGGeod& p, tgNodeType t ) {
-    //static unsigned int calls = 0;
-    
-    std::list<TGNodeData>   searchResults;
-    unsigned int            index;
-    
-    // first - create a search node
-    TGNodePoint     pt( p.getLongitudeDeg(), p.getLatitudeDeg() );
-    //TGNodeFuzzyCir  query_circle( pt, 0.000000001 );  // approx .1 mm
-    TGNodeFuzzyCir  query_circle( pt, 0.0000001 );  // approx 1 cm
-    
-    // perform the query
-    searchResults.clear();
-    tg_kd_tree.search(std::back_inserter( searchResults ), query_circle);
-    
-    if ( searchResults.empty() ) {
+    TGNodePoint  pt( p.getLongitudeDeg(), p.getLatitudeDeg() );
+    unsigned int index = find_close( pt );
+
+    if ( index == TG_NODE_NONE ) {
         // no node here - add a new one
+        long long cx, cy;
+        get_cell( pt, cx, cy );
+
         index = tg_node_list.size();
-        double e = p.getElevationM();
-        
         tg_node_list.push_back( TGNode(p,t) );
-        
-        TGNodeData data(pt, e, index, &tg_node_list[index]);
-        
-        tg_kd_tree.insert(data);            
+
+        // push it on the front of its cell's list
+        std::pair<boost::unordered_map<unsigned long long, unsigned int>::iterator, bool> ins = tg_node_cells.insert( std::make_pair( cell_key( cx, cy ), index ) );
+        if ( ins.second ) {
+            tg_node_next.push_back( TG_NODE_NONE );
+        } else {
+            tg_node_next.push_back( ins.first->second );
+            ins.first->second = index;
+        }
+
+        kd_tree_valid = false;
     } else {
         // we found a node - use it
-        std::list<TGNodeData>::const_iterator it = searchResults.begin();
-        index = boost::get<2>(*it);
         p = tg_node_list[index].GetPosition();
     }
-    
-#if 0        
-    calls++;
-    if ( calls % 100 == 0 ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, "TGNode::unique_add called " << calls << " times ");
-    }
-#endif        
 
     return index;
 }
 
 int TGNodes::find(  const SGGeod& p ) const {
-    std::list<TGNodeData>   searchResults;
-    int index = -1;
-    // static unsigned int calls = 0;
-    
-    // first - create a search node
-    TGNodePoint     pt( p.getLongitudeDeg(), p.getLatitudeDeg() );
-    TGNodeFuzzyCir  query_circle( pt, 0.0000001 );  // approx 1 cm
-    
-    // perform the query
-    searchResults.clear();
-    tg_kd_tree.search(std::back_inserter( searchResults ), query_circle);
-    
-    if ( !searchResults.empty() ) {
-        // we found a node - use it
-        std::list<TGNodeData>::const_iterator it = searchResults.begin();
-        index = (int)boost::get<2>(*it);
-    }
-    
-#if 0        
-    calls++;
-    if ( calls % 100 == 0 ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, "TGNode::find called " << calls << " times ");
-    }
-#endif
+    unsigned int index = find_close( TGNodePoint( p.getLongitudeDeg(), p.getLatitudeDeg() ) );
 
-    return index;
+    return ( index == TG_NODE_NONE ) ? -1 : (int)index;
 }
 
-// Build the k-d tree
-void TGNodes::init_spacial_query( void )
+void TGNodes::build_kd_tree( void ) const
 {
-#if 0    
-    tg_kd_tree.clear();
-
-    for(unsigned int i = 0; i < tg_node_list.size(); i++) {
-        // generate the tuple
-        tgn_Point pt( tg_node_list[i].GetPosition().getLongitudeDeg(), tg_node_list[i].GetPosition().getLatitudeDeg() );
-        double    e( tg_node_list[i].GetPosition().getElevationM() );
-        Point_and_Elevation pande( pt, e, &tg_node_list[i] );
+    if ( kd_tree_valid ) {
+        return;
+    }
 
-        // and insert into tree
-        tg_kd_tree.insert( pande );
+    std::vector<TGNodeData> data;
+    data.reserve( tg_node_list.size() );
+    for ( unsigned int i = 0; i < tg_node_list.size(); i++ ) {
+        const SGGeod& pos = tg_node_list[i].GetPosition();
+        data.push_back( TGNodeData( TGNodePoint( pos.getLongitudeDeg(), pos.getLatitudeDeg() ), i ) );
     }
 
+    tg_kd_tree.clear();
+    tg_kd_tree.insert( data.begin(), data.end() );
+
     kd_tree_valid = true;
-#endif    
+}
+
+// Build the k-d tree
+void TGNodes::init_spacial_query( void )
+{
+    build_kd_tree();
 }
 
 // Spacial Queries using CGAL and boost tuple
@@ -107,14 +107,7 @@ void TGNodes::init_spacial_query( void )
 bool TGNodes::get_geod_inside( const SGGeod& min, const SGGeod& max, std::vector<SGGeod>& points ) const {
     points.clear();
 
-#if 0
-    // Have we generated the k-d tree?
-    if ( !kd_tree_valid ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, "get_geod_inside called with invalid kdtree" );
-        exit(0);
-        return false;
-    }
-#endif
+    build_kd_tree();
 
     // define an exact rectangulat range query  (fuzziness=0)
     TGNodePoint     ll( min.getLongitudeDeg() - fgPoint3_Epsilon, min.getLatitudeDeg() - fgPoint3_Epsilon );
@@ -130,7 +123,7 @@ bool TGNodes::get_geod_inside( const SGGeod& min, const SGGeod& max, std::vector
 
     // and convert the tuples back into SGGeod
     for ( it = result.begin(); it != result.end(); it++ ) {
-        points.push_back( SGGeod::fromDegM( boost::get<0>(*it).x(), boost::get<0>(*it).y(), boost::get<1>(*it) ) );
+        points.push_back( tg_node_list[ boost::get<1>(*it) ].GetPosition() );
     }
 
     return true;
@@ -139,14 +132,7 @@ bool TGNodes::get_geod_inside( const SGGeod& min, const SGGeod& max, std::vector
 bool TGNodes::get_nodes_inside( const SGGeod& min, const SGGeod& max, std::vector<TGNode*>& points ) const {
     points.clear();
     
-#if 0    
-    // Have we generated the k-d tree?
-    if ( !kd_tree_valid ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, "get_nodes_inside called with invalid kdtree" );
-        exit(0);
-        return false;
-    }
-#endif
+    build_kd_tree();
 
     // define an exact rectangulat range query  (fuzziness=0)
     TGNodePoint     ll( min.getLongitudeDeg() - fgPoint3_Epsilon, min.getLatitudeDeg() - fgPoint3_Epsilon );
@@ -162,7 +148,7 @@ bool TGNodes::get_nodes_inside( const SGGeod& min, const SGGeod& max, std::vecto
     
     // and convert the tuples back into SGGeod
     for ( it = result.begin(); it != result.end(); it++ ) {
-        points.push_back( boost::get<3>(*it) );
+        points.push_back( const_cast<TGNode*>( &tg_node_list[ boost::get<1>(*it) ] ) );
     }
     
     return true;
@@ -187,14 +173,7 @@ bool TGNodes::get_geod_edge( const SGBucket& b, std::vector<SGGeod>& north, std:
     east.clear();
     west.clear();
 
-#if 0    
-    // Have we generated the k-d tree?
-    if ( !kd_tree_valid ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, "get_geod_edge called with invalid kdtree" );
-        exit(0);
-        return false;
-    }
-#endif
+    build_kd_tree();
 
     // find northern points
     ll = TGNodePoint( west_compare - fgPoint3_Epsilon, north_compare - fgPoint3_Epsilon );
@@ -204,7 +183,7 @@ bool TGNodes::get_geod_edge( const SGBucket& b, std::vector<SGGeod>& north, std:
     result.clear();
     tg_kd_tree.search(std::back_inserter( result ), exact_bb);
     for ( it = result.begin(); it != result.end(); it++ ) {
-        north.push_back( SGGeod::fromDegM( boost::get<0>(*it).x(), boost::get<0>(*it).y(), boost::get<1>(*it) ) );
+        north.push_back( tg_node_list[ boost::get<1>(*it) ].GetPosition() );
     }
 
     // find southern points
@@ -215,7 +194,7 @@ bool TGNodes::get_geod_edge( const SGBucket& b, std::vector<SGGeod>& north, std:
 
     tg_kd_tree.search(std::back_inserter( result ), exact_bb);
     for ( it = result.begin(); it != result.end(); it++ ) {
-        south.push_back( SGGeod::fromDegM( boost::get<0>(*it).x(), boost::get<0>(*it).y(), boost::get<1>(*it) ) );
+        south.push_back( tg_node_list[ boost::get<1>(*it) ].GetPosition() );
     }
 
     // find eastern points
@@ -226,7 +205,7 @@ bool TGNodes::get_geod_edge( const SGBucket& b, std::vector<SGGeod>& north, std:
 
     tg_kd_tree.search(std::back_inserter( result ), exact_bb);
     for ( it = result.begin(); it != result.end(); it++ ) {
-        east.push_back( SGGeod::fromDegM( boost::get<0>(*it).x(), boost::get<0>(*it).y(), boost::get<1>(*it) ) );
+        east.push_back( tg_node_list[ boost::get<1>(*it) ].GetPosition() );
     }
 
     // find western points
@@ -237,7 +216,7 @@ bool TGNodes::get_geod_edge( const SGBucket& b, std::vector<SGGeod>& north, std:
 
     tg_kd_tree.search(std::back_inserter( result ), exact_bb);
     for ( it = result.begin(); it != result.end(); it++ ) {
-        west.push_back( SGGeod::fromDegM( boost::get<0>(*it).x(), boost::get<0>(*it).y(), boost::get<1>(*it) ) );
+        west.push_back( tg_node_list[ boost::get<1>(*it) ].GetPosition() );
     }
 
     return true;
@@ -268,9 +247,8 @@ void TGNodes::DeleteUnused( void ) {
         }
     }
     
-    // rebuild and reindex the tree
-    tg_node_list.clear();
-    tg_kd_tree.clear();
+    // rebuild and reindex the hash
+    clear();
     
     for(unsigned int i = 0; i < used_nodes.size(); i++) {
         SGGeod pos = used_nodes[i].GetPosition();
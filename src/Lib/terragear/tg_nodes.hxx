@@ -5,6 +5,7 @@
 # error This library requires C++
 #endif
 
+#include <cmath>
 #include <cstdlib>
 
 #include <CGAL/Simple_cartesian.h>
@@ -15,6 +16,7 @@
 #include <CGAL/Search_traits_2.h>
 #include <CGAL/Search_traits_adapter.h>     /* Just use two dimensional lookup - elevation is a trait */
 #include <boost/iterator/zip_iterator.hpp>
+#include <boost/unordered_map.hpp>
 
 #include <simgear/compiler.h>
 #include <simgear/bucket/newbucket.hxx>
@@ -162,7 +164,7 @@ private:
 
 typedef CGAL::Simple_cartesian<double>                                                                          TGNodeKernel;
 typedef TGNodeKernel::Point_2                                                                                   TGNodePoint;
-typedef boost::tuple<TGNodePoint,double,unsigned int,TGNode*>                                                   TGNodeData;
+typedef boost::tuple<TGNodePoint,unsigned int>                                                                  TGNodeData;
 typedef CGAL::Search_traits_2<TGNodeKernel>                                                                     TGNodeTraitsBase;
 typedef CGAL::Search_traits_adapter<TGNodeData,CGAL::Nth_of_tuple_property_map<0, TGNodeData>,TGNodeTraitsBase> TGNodeTraits;
 
@@ -170,6 +172,10 @@ typedef CGAL::Fuzzy_iso_box<TGNodeTraits>
 typedef CGAL::Fuzzy_sphere<TGNodeTraits>                                                                        TGNodeFuzzyCir;
 typedef CGAL::Kd_tree<TGNodeTraits>                                                                             TGNodeTree;
 
+// two nodes closer than this are the same node ( approx 1 cm )
+#define TG_NODE_FUZZ        (0.0000001)
+#define TG_NODE_NONE        (0xFFFFFFFF)
+
 
 /* This class handles ALL of the nodes in a tile : 3d nodes in elevation data, 2d nodes generated from landclass, etc) */
 class TGNodes {
@@ -179,17 +185,20 @@ public:
     TGNodes( void )     {
         array         = NULL;
         tris          = NULL;
+        kd_tree_valid = false;
     }
 
     ~TGNodes( void )    {
-        tg_node_list.clear();
-        tg_kd_tree.clear();
+        clear();
     }
 
     // delete all the data out of node_list
     inline void clear() {
         tg_node_list.clear();
+        tg_node_next.clear();
+        tg_node_cells.clear();
         tg_kd_tree.clear();
+        kd_tree_valid = false;
     }
 
     // Add a point to the point list if it doesn't already exist.
@@ -204,6 +213,8 @@ public:
         tg_node_list[idx].SetUsed();
     }
     
+    // build the k-d tree for the range queries now, rather than on the
+    // first query after nodes were added
     void init_spacial_query( void );
 
     void SetArray( tgArray* a ) {
@@ -267,10 +278,32 @@ public:
     void LoadFromGzFile( gzFile& fp );
 
 private:
+    // spatial hash cell of a point - cells are TG_NODE_FUZZ wide, so a
+    // node matching a point is in the point's cell, or one next to it
+    static inline void get_cell( const TGNodePoint& pt, long long& x, long long& y ) {
+        x = (long long)floor( pt.x() / TG_NODE_FUZZ );
+        y = (long long)floor( pt.y() / TG_NODE_FUZZ );
+    }
+    static inline unsigned long long cell_key( long long x, long long y ) {
+        return ( (unsigned long long)(unsigned int)x << 32 ) | (unsigned int)y;
+    }
+
+    // lowest index of the nodes within TG_NODE_FUZZ of pt, or TG_NODE_NONE
+    unsigned int find_close( const TGNodePoint& pt ) const;
+
+    // the range queries use a k-d tree, built on demand
+    void build_kd_tree( void ) const;
+
     //UniqueTGNodeSet tg_node_list;
     std::vector<TGNode> tg_node_list;
-    TGNodeTree          tg_kd_tree;
-    //bool            kd_tree_valid;
+
+    // spatial hash - first node in each cell, and the next node in the
+    // same cell for each node
+    boost::unordered_map<unsigned long long, unsigned int> tg_node_cells;
+    std::vector<unsigned int>                              tg_node_next;
+
+    mutable TGNodeTree  tg_kd_tree;
+    mutable bool        kd_tree_valid;
     //double          tex_v;
 
     // temp pointers - not serialized
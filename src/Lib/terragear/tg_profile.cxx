@@ -0,0 +1,317 @@
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#  include <time.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include "tg_profile.hxx"
+
+bool tgProfile::enabled = false;
+
+// what the current thread is working on
+struct tgProfileOpenPhase
+{
+    std::string                     name;
+    SGTimeStamp                     wall;
+    int64_t                         cpuStart;
+    long                            rssStart;
+    std::map<std::string, int64_t>  lockWaitUsec;
+    std::map<std::string, long>     counts;
+};
+
+struct tgProfileContext
+{
+    tgProfileContext() : stage(0) {}
+
+    std::string                     tile;
+    int                             stage;
+    std::vector<tgProfileOpenPhase> phases;
+};
+
+static thread_local tgProfileContext context;
+
+tgProfile& tgProfile::instance( void )
+{
+    static tgProfile profile;
+
+    return profile;
+}
+
+int64_t tgProfile::threadCpuUsec( void )
+{
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if ( GetThreadTimes( GetCurrentThread(), &created, &exited, &kernel, &user ) ) {
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+
+        // 100ns units
+        return ( k.QuadPart + u.QuadPart ) / 10;
+    }
+    return 0;
+#else
+    struct timespec ts;
+    if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) == 0 ) {
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+    return 0;
+#endif
+}
+
+// the peak RSS is process wide - with several threads, a phase's delta
+// includes whatever the others allocated meanwhile
+long tgProfile::peakRssKb( void )
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof(pmc) ) ) {
+        return pmc.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) == 0 ) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+    return 0;
+#endif
+}
+
+void tgProfile::beginTile( const std::string& tile, int stage )
+{
+    if ( !enabled ) {
+        return;
+    }
+
+    context.tile  = tile;
+    context.stage = stage;
+    context.phases.clear();
+}
+
+void tgProfile::endTile( void )
+{
+    context.tile.clear();
+    context.stage = 0;
+    context.phases.clear();
+}
+
+void tgProfile::count( const char* name, long value )
+{
+    if ( enabled && !context.phases.empty() ) {
+        context.phases.back().counts[name] += value;
+    }
+}
+
+void tgProfile::lockWait( const char* lock, int64_t usec )
+{
+    // like wall time, the wait counts for every enclosing phase
+    for ( unsigned int i=0; i<context.phases.size(); i++ ) {
+        context.phases[i].lockWaitUsec[lock] += usec;
+    }
+}
+
+void tgProfile::record( const tgProfileRecord& r )
+{
+    SGGuard<SGMutex> g( lock );
+
+    records.push_back( r );
+}
+
+tgProfilePhase::tgProfilePhase( const char* name ) : active( tgProfile::isEnabled() )
+{
+    if ( active ) {
+        context.phases.push_back( tgProfileOpenPhase() );
+
+        tgProfileOpenPhase& p = context.phases.back();
+        p.name     = name;
+        p.cpuStart = tgProfile::threadCpuUsec();
+        p.rssStart = tgProfile::peakRssKb();
+        p.wall.stamp();
+    }
+}
+
+tgProfilePhase::~tgProfilePhase()
+{
+    end();
+}
+
+void tgProfilePhase::end( void )
+{
+    if ( !active || context.phases.empty() ) {
+        return;
+    }
+    active = false;
+
+    const tgProfileOpenPhase& p = context.phases.back();
+    tgProfileRecord r;
+
+    r.wallUsec   = p.wall.elapsedUSec();
+    r.cpuUsec    = tgProfile::threadCpuUsec() - p.cpuStart;
+    r.rssDeltaKb = tgProfile::peakRssKb() - p.rssStart;
+
+    r.tile   = context.tile;
+    r.stage  = context.stage;
+    r.depth  = context.phases.size() - 1;
+    r.thread = SGThread::current();
+    for ( unsigned int i=0; i<context.phases.size(); i++ ) {
+        if ( i ) {
+            r.phase += "/";
+        }
+        r.phase += context.phases[i].name;
+    }
+    r.lockWaitUsec = p.lockWaitUsec;
+    r.counts       = p.counts;
+
+    context.phases.pop_back();
+
+    tgProfile::instance().record( r );
+}
+
+bool tgProfile::write( const std::string& path ) const
+{
+    std::ofstream out( path.c_str() );
+    if ( !out ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgProfile::write - can't open " << path );
+        return false;
+    }
+
+    SGGuard<SGMutex> g( lock );
+
+    if ( path.size() > 5 && path.compare( path.size() - 5, 5, ".json" ) == 0 ) {
+        return writeJSON( out );
+    } else {
+        return writeCSV( out );
+    }
+}
+
+bool tgProfile::writeCSV( std::ostream& out ) const
+{
+    // one column for every lock and count seen in any phase
+    std::set<std::string> locks, counts;
+    for ( unsigned int i=0; i<records.size(); i++ ) {
+        for ( std::map<std::string, int64_t>::const_iterator it = records[i].lockWaitUsec.begin(); it != records[i].lockWaitUsec.end(); it++ ) {
+            locks.insert( it->first );
+        }
+        for ( std::map<std::string, long>::const_iterator it = records[i].counts.begin(); it != records[i].counts.end(); it++ ) {
+            counts.insert( it->first );
+        }
+    }
+
+    out << "tile,stage,phase,depth,thread,wall_ms,cpu_ms,peak_rss_delta_kb,lock_wait_ms";
+    for ( std::set<std::string>::const_iterator it = locks.begin(); it != locks.end(); it++ ) {
+        out << ",wait_" << *it << "_ms";
+    }
+    for ( std::set<std::string>::const_iterator it = counts.begin(); it != counts.end(); it++ ) {
+        out << "," << *it;
+    }
+    out << "\n";
+
+    for ( unsigned int i=0; i<records.size(); i++ ) {
+        const tgProfileRecord& r = records[i];
+
+        int64_t waitUsec = 0;
+        for ( std::map<std::string, int64_t>::const_iterator it = r.lockWaitUsec.begin(); it != r.lockWaitUsec.end(); it++ ) {
+            waitUsec += it->second;
+        }
+
+        out << r.tile << "," << r.stage << "," << r.phase << "," << r.depth << "," << r.thread << "," <<
+               r.wallUsec / 1000.0 << "," << r.cpuUsec / 1000.0 << "," << r.rssDeltaKb << "," << waitUsec / 1000.0;
+
+        for ( std::set<std::string>::const_iterator it = locks.begin(); it != locks.end(); it++ ) {
+            std::map<std::string, int64_t>::const_iterator lit = r.lockWaitUsec.find( *it );
+            out << "," << ( lit != r.lockWaitUsec.end() ? lit->second / 1000.0 : 0.0 );
+        }
+        for ( std::set<std::string>::const_iterator it = counts.begin(); it != counts.end(); it++ ) {
+            std::map<std::string, long>::const_iterator cit = r.counts.find( *it );
+            out << ",";
+            if ( cit != r.counts.end() ) {
+                out << cit->second;
+            }
+        }
+        out << "\n";
+    }
+
+    return out.good();
+}
+
+bool tgProfile::writeJSON( std::ostream& out ) const
+{
+    out << "{\n  \"phases\": [\n";
+
+    std::map<std::string, int64_t> lockTotals;
+    for ( unsigned int i=0; i<records.size(); i++ ) {
+        const tgProfileRecord& r = records[i];
+
+        out << "    { \"tile\": \"" << r.tile << "\", \"stage\": " << r.stage << ", \"phase\": \"" << r.phase << "\", " <<
+               "\"depth\": " << r.depth << ", \"thread\": " << r.thread << ", " <<
+               "\"wall_ms\": " << r.wallUsec / 1000.0 << ", \"cpu_ms\": " << r.cpuUsec / 1000.0 << ", " <<
+               "\"peak_rss_delta_kb\": " << r.rssDeltaKb << ",\n      \"lock_wait_ms\": {";
+
+        for ( std::map<std::string, int64_t>::const_iterator it = r.lockWaitUsec.begin(); it != r.lockWaitUsec.end(); it++ ) {
+            out << ( it == r.lockWaitUsec.begin() ? " " : ", " ) << "\"" << it->first << "\": " << it->second / 1000.0;
+            if ( r.depth == 0 ) {
+                lockTotals[it->first] += it->second;
+            }
+        }
+        out << " }, \"counts\": {";
+        for ( std::map<std::string, long>::const_iterator it = r.counts.begin(); it != r.counts.end(); it++ ) {
+            out << ( it == r.counts.begin() ? " " : ", " ) << "\"" << it->first << "\": " << it->second;
+        }
+        out << " } }" << ( i+1 < records.size() ? "," : "" ) << "\n";
+    }
+
+    out << "  ],\n  \"lock_wait_ms\": {";
+    for ( std::map<std::string, int64_t>::const_iterator it = lockTotals.begin(); it != lockTotals.end(); it++ ) {
+        out << ( it == lockTotals.begin() ? " " : ", " ) << "\"" << it->first << "\": " << it->second / 1000.0;
+    }
+    out << " }\n}\n";
+
+    return out.good();
+}
+
+static bool slowerTile( const tgProfileRecord* a, const tgProfileRecord* b )
+{
+    return a->wallUsec > b->wallUsec;
+}
+
+void tgProfile::report( unsigned int numTiles ) const
+{
+    SGGuard<SGMutex> g( lock );
+
+    std::vector<const tgProfileRecord*> tiles;
+    std::map<std::string, int64_t>      lockTotals;
+    for ( unsigned int i=0; i<records.size(); i++ ) {
+        if ( records[i].depth == 0 ) {
+            tiles.push_back( &records[i] );
+
+            for ( std::map<std::string, int64_t>::const_iterator it = records[i].lockWaitUsec.begin(); it != records[i].lockWaitUsec.end(); it++ ) {
+                lockTotals[it->first] += it->second;
+            }
+        }
+    }
+    std::sort( tiles.begin(), tiles.end(), slowerTile );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Profile: " << records.size() << " phases in " << tiles.size() << " tile stages" );
+    for ( unsigned int i=0; i<tiles.size() && i<numTiles; i++ ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << tiles[i]->tile << " stage " << tiles[i]->stage << ": " <<
+                                      tiles[i]->wallUsec / 1000 << " ms wall, " << tiles[i]->cpuUsec / 1000 << " ms cpu, " <<
+                                      tiles[i]->rssDeltaKb << " KB peak RSS growth" );
+    }
+    for ( std::map<std::string, int64_t>::const_iterator it = lockTotals.begin(); it != lockTotals.end(); it++ ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  waited " << it->second / 1000 << " ms on " << it->first );
+    }
+}
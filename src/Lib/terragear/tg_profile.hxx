@@ -0,0 +1,143 @@
+#ifndef __TG_PROFILE_HXX__
+#define __TG_PROFILE_HXX__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+// Per tile, per phase instrumentation for tg-construct.
+//
+// Each construction thread opens a tile with beginTile(), and marks the
+// interesting parts of the work with tgProfilePhase objects.  Phases nest -
+// a phase is recorded with the names of all enclosing phases, and its times
+// include those of the phases inside it.  For every phase we keep the wall
+// and thread CPU time, the growth of the process peak RSS, the time spent
+// waiting on the global locks, and whatever counts the code adds.
+//
+// Profiling is off unless enabled before the threads start - then phases
+// cost a single test.
+struct tgProfileRecord
+{
+    tgProfileRecord() : stage(0), depth(0), thread(0), wallUsec(0), cpuUsec(0), rssDeltaKb(0) {}
+
+    std::string                     tile;
+    int                             stage;
+    std::string                     phase;      // enclosing phases, '/' separated
+    int                             depth;
+    long                            thread;
+
+    int64_t                         wallUsec;
+    int64_t                         cpuUsec;
+    long                            rssDeltaKb;
+
+    std::map<std::string, int64_t>  lockWaitUsec;
+    std::map<std::string, long>     counts;
+};
+
+class tgProfile
+{
+public:
+    static tgProfile& instance( void );
+
+    static bool isEnabled( void ) { return enabled; }
+    static void setEnabled( bool e ) { enabled = e; }
+
+    // everything recorded on this thread up to endTile() belongs to the tile
+    void beginTile( const std::string& tile, int stage );
+    void endTile( void );
+
+    // add to a count of the innermost open phase
+    static void count( const char* name, long value );
+
+    // time the calling thread spent waiting for a global lock
+    static void lockWait( const char* lock, int64_t usec );
+
+    // CSV, or JSON if the file name ends in .json
+    bool write( const std::string& path ) const;
+
+    // log the slowest tiles, and the lock wait totals
+    void report( unsigned int numTiles = 10 ) const;
+
+    // the process peak RSS so far
+    static long    peakRssKb( void );
+
+    friend class tgProfilePhase;
+
+private:
+    tgProfile() {}
+
+    static int64_t threadCpuUsec( void );
+
+    void record( const tgProfileRecord& r );
+
+    bool writeCSV( std::ostream& out ) const;
+    bool writeJSON( std::ostream& out ) const;
+
+    static bool                     enabled;
+
+    mutable SGMutex                 lock;
+    std::vector<tgProfileRecord>    records;
+};
+
+// a phase of the current tile - from construction to destruction
+class tgProfilePhase
+{
+public:
+    tgProfilePhase( const char* name );
+    ~tgProfilePhase();
+
+    // for phases that end before the scope does
+    void end( void );
+
+private:
+    bool        active;
+};
+
+// times how long the calling thread blocks in its scope - wrap the lock
+// call of a global lock in one
+class tgProfileWait
+{
+public:
+    tgProfileWait( const char* n ) : name(n), active( tgProfile::isEnabled() ) {
+        if ( active ) {
+            start.stamp();
+        }
+    }
+
+    ~tgProfileWait() {
+        if ( active ) {
+            tgProfile::lockWait( name, start.elapsedUSec() );
+        }
+    }
+
+private:
+    const char*     name;
+    bool            active;
+    SGTimeStamp     start;
+};
+
+// SGGuard, with the wait for the lock profiled
+template <class L>
+class tgProfileGuard
+{
+public:
+    tgProfileGuard( L& l, const char* name ) : lock(l) {
+        tgProfileWait w( name );
+        lock.lock();
+    }
+
+    ~tgProfileGuard() {
+        lock.unlock();
+    }
+
+private:
+    tgProfileGuard( const tgProfileGuard& );
+    tgProfileGuard& operator=( const tgProfileGuard& );
+
+    L&  lock;
+};
+
+#endif /* __TG_PROFILE_HXX__ */
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <gdal_priv.h>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include "tg_profile.hxx"
+#include "tg_raster_block_cache.hxx"
+
+#define DEFAULT_RASTER_CACHE_BUDGET     (512UL * 1024UL * 1024UL)
+#define DEFAULT_RASTER_CACHE_READAHEAD  (4)
+
+tgRasterBlockCache& tgRasterBlockCache::instance( void )
+{
+    static tgRasterBlockCache cache;
+
+    return cache;
+}
+
+tgRasterBlockCache::tgRasterBlockCache() :
+    budget(DEFAULT_RASTER_CACHE_BUDGET),
+    bytesUsed(0),
+    peakBytes(0),
+    readAhead(DEFAULT_RASTER_CACHE_READAHEAD),
+    hits(0),
+    misses(0),
+    reads(0)
+{
+}
+
+void tgRasterBlockCache::setBudget( size_t bytes )
+{
+    SGGuard<SGMutex> g( lock );
+
+    budget = bytes;
+    evict( budget );
+}
+
+void tgRasterBlockCache::setReadAhead( unsigned int blocks )
+{
+    SGGuard<SGMutex> g( lock );
+
+    readAhead = blocks;
+}
+
+void tgRasterBlockCache::clear( void )
+{
+    SGGuard<SGMutex> g( lock );
+
+    evict( 0 );
+}
+
+std::string tgRasterBlockCache::key( const std::string& name, GDALRasterBand* band, int bx, int by )
+{
+    char k[64];
+    sprintf( k, "|%d|%d|%d", band->GetBand(), bx, by );
+
+    return name + k;
+}
+
+tgRasterBlockPtr tgRasterBlockCache::get( const std::string& name, GDALRasterBand* band, int bx, int by )
+{
+    int numBx = ( band->GetXSize() + TG_RASTER_BLOCK_SIZE - 1 ) / TG_RASTER_BLOCK_SIZE;
+    int numBy = ( band->GetYSize() + TG_RASTER_BLOCK_SIZE - 1 ) / TG_RASTER_BLOCK_SIZE;
+
+    if ( bx < 0 || by < 0 || bx >= numBx || by >= numBy ) {
+        return tgRasterBlockPtr();
+    }
+
+    std::string k = key( name, band, bx, by );
+
+    {
+        tgProfileWait w( "rasterCache" );
+        lock.lock();
+    }
+
+    // another thread may still be reading it - and it may be evicted
+    // before we wake up
+    std::map<std::string, cacheEntry>::iterator it = entries.find( k );
+    while ( it != entries.end() && it->second.loading ) {
+        tgProfileWait w( "rasterCache" );
+        loaded.wait( lock );
+        it = entries.find( k );
+    }
+
+    if ( it != entries.end() ) {
+        hits++;
+        lruList.splice( lruList.begin(), lruList, it->second.lru );
+
+        tgRasterBlockPtr block = it->second.block;
+        lock.unlock();
+
+        return block;
+    }
+
+    // reserve the block, and the uncached blocks east of it we read along,
+    // so other threads wait for us instead of reading them too
+    misses++;
+
+    int count = 0;
+    do {
+        it = entries.insert( std::make_pair( key( name, band, bx + count, by ), cacheEntry() ) ).first;
+        lruList.push_front( it->first );
+        it->second.lru = lruList.begin();
+        count++;
+    } while ( count <= (int)readAhead && bx + count < numBx && entries.find( key( name, band, bx + count, by ) ) == entries.end() );
+
+    lock.unlock();
+
+    return load( name, band, bx, by, count );
+}
+
+// reads count blocks of a row in one go, and hands them to the reserved
+// entries - returns the first, which may be evicted as soon as we let go
+// of the lock
+tgRasterBlockPtr tgRasterBlockCache::load( const std::string& name, GDALRasterBand* band, int bx, int by, int count )
+{
+    int xoff = bx * TG_RASTER_BLOCK_SIZE;
+    int yoff = by * TG_RASTER_BLOCK_SIZE;
+    int w    = std::min( count * TG_RASTER_BLOCK_SIZE, band->GetXSize() - xoff );
+    int h    = std::min( TG_RASTER_BLOCK_SIZE, band->GetYSize() - yoff );
+
+    std::vector<int> strip( (size_t)w * h );
+    bool ok = ( band->RasterIO( GF_Read, xoff, yoff, w, h, &strip[0], w, h, GDT_Int32, 0, 0 ) == CE_None );
+
+    if ( !ok ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgRasterBlockCache: can't read " << w << " x " << h << " at " << xoff << ", " << yoff << " from " << name << ": " << CPLGetLastErrorMsg() );
+    }
+
+    std::vector<tgRasterBlockPtr> blocks( count );
+    for ( int b=0; b<count && ok; b++ ) {
+        tgRasterBlock* block = new tgRasterBlock;
+
+        block->width  = std::min( TG_RASTER_BLOCK_SIZE, w - b * TG_RASTER_BLOCK_SIZE );
+        block->height = h;
+        block->data.resize( (size_t)block->width * block->height );
+
+        for ( int y=0; y<h; y++ ) {
+            std::copy( strip.begin() + (size_t)y * w + b * TG_RASTER_BLOCK_SIZE,
+                       strip.begin() + (size_t)y * w + b * TG_RASTER_BLOCK_SIZE + block->width,
+                       block->data.begin() + (size_t)y * block->width );
+        }
+
+        blocks[b] = tgRasterBlockPtr( block );
+    }
+
+    {
+        tgProfileWait w( "rasterCache" );
+        lock.lock();
+    }
+
+    reads++;
+
+    // a block that can't be read stays empty - reading it again won't help
+    for ( int b=0; b<count; b++ ) {
+        cacheEntry& entry = entries[key( name, band, bx + b, by )];
+
+        entry.block   = blocks[b];
+        entry.bytes   = blocks[b] ? blocks[b]->data.size() * sizeof(int) : 0;
+        entry.loading = false;
+
+        bytesUsed += entry.bytes;
+    }
+
+    if ( bytesUsed > peakBytes ) {
+        peakBytes = bytesUsed;
+    }
+
+    evict( budget );
+
+    loaded.broadcast();
+    lock.unlock();
+
+    return blocks[0];
+}
+
+void tgRasterBlockCache::sampleGrid( const std::string& name, GDALRasterBand* band, const double* geoXfrm,
+                                     double x, double y, double colstep, double rowstep,
+                                     int w, int h, int* buffer )
+{
+    int    hasNodata;
+    double nodata = band->GetNoDataValue( &hasNodata );
+    int    xsize  = band->GetXSize();
+    int    ysize  = band->GetYSize();
+
+    // source column of every sample column
+    std::vector<int> srcCols( w );
+    for ( int i=0; i<w; i++ ) {
+        double px = floor( ( x + i * colstep - geoXfrm[0] ) / geoXfrm[1] );
+
+        srcCols[i] = ( px >= 0 && px < xsize ) ? (int)px : -1;
+    }
+
+    tgRasterBlockPtr block;
+    int              curBx = -1, curBy = -1;
+
+    for ( int j=0; j<h; j++ ) {
+        double py = floor( ( y + j * rowstep - geoXfrm[3] ) / geoXfrm[5] );
+        if ( py < 0 || py >= ysize ) {
+            continue;
+        }
+
+        int by = (int)py / TG_RASTER_BLOCK_SIZE;
+        int ry = (int)py - by * TG_RASTER_BLOCK_SIZE;
+
+        for ( int i=0; i<w; i++ ) {
+            if ( srcCols[i] < 0 ) {
+                continue;
+            }
+
+            int bx = srcCols[i] / TG_RASTER_BLOCK_SIZE;
+            if ( bx != curBx || by != curBy ) {
+                block = get( name, band, bx, by );
+                curBx = bx;
+                curBy = by;
+            }
+            if ( !block ) {
+                continue;
+            }
+
+            int v = block->data[ (size_t)ry * block->width + srcCols[i] - bx * TG_RASTER_BLOCK_SIZE ];
+            if ( hasNodata && v == nodata ) {
+                continue;
+            }
+
+            buffer[ j * w + i ] = v;
+        }
+    }
+}
+
+// called with the lock held
+void tgRasterBlockCache::evict( size_t limit )
+{
+    std::list<std::string>::iterator lit = lruList.end();
+
+    while ( bytesUsed > limit && lit != lruList.begin() ) {
+        --lit;
+
+        std::map<std::string, cacheEntry>::iterator it = entries.find( *lit );
+
+        // keep blocks being read, or still held by a caller
+        if ( it->second.loading || it->second.block.use_count() > 1 ) {
+            continue;
+        }
+
+        bytesUsed -= it->second.bytes;
+
+        lit = lruList.erase( lit );
+        entries.erase( it );
+    }
+}
+
+unsigned long tgRasterBlockCache::getHits( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return hits;
+}
+
+unsigned long tgRasterBlockCache::getMisses( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return misses;
+}
+
+unsigned long tgRasterBlockCache::getReads( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+    return reads;
+}
+
+void tgRasterBlockCache::report( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+
+    unsigned long lookups = hits + misses;
+    double hitRate = lookups ? 100.0 * hits / lookups : 0.0;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Raster block cache: " << lookups << " lookups, " <<
+                                  hits << " hits, " << misses << " misses, " << reads << " reads, " <<
+                                  "hit rate " << hitRate << "%, " <<
+                                  "peak " << peakBytes / (1024*1024) << " of " << budget / (1024*1024) << " MB" );
+}
@@ -0,0 +1,98 @@
+#ifndef __TG_RASTER_BLOCK_CACHE_HXX__
+#define __TG_RASTER_BLOCK_CACHE_HXX__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <simgear/threads/SGThread.hxx>
+
+class GDALRasterBand;
+
+// Process wide cache of source raster blocks, for the raster choppers.
+//
+// Rasters are cut into blocks of TG_RASTER_BLOCK_SIZE pixels square, read
+// as Int32.  GDAL handles aren't thread safe, so every thread opens the
+// raster itself and passes its own band in - the cache is keyed by the
+// raster's name and band number, so neighbouring buckets chopped on
+// different threads share the blocks they have in common.
+//
+// A miss reads the block and the next readAhead blocks of its row that
+// aren't cached yet in one go - buckets are chopped west to east.  Over
+// budget, the least recently used blocks nobody holds are dropped.
+#define TG_RASTER_BLOCK_SIZE    (256)
+
+struct tgRasterBlock
+{
+    int                 width, height;
+    std::vector<int>    data;           // row major
+};
+
+typedef boost::shared_ptr<const tgRasterBlock> tgRasterBlockPtr;
+
+class tgRasterBlockCache
+{
+public:
+    static tgRasterBlockCache& instance( void );
+
+    // block (bx, by) of band - NULL if band can't read it
+    tgRasterBlockPtr get( const std::string& name, GDALRasterBand* band, int bx, int by );
+
+    // nearest neighbour samples of a w x h lon / lat grid with its first
+    // sample at (x, y), from a north up raster with geo transform geoXfrm.
+    // Samples outside the raster, or of its nodata value, are left alone.
+    void sampleGrid( const std::string& name, GDALRasterBand* band, const double* geoXfrm,
+                     double x, double y, double colstep, double rowstep,
+                     int w, int h, int* buffer );
+
+    void setBudget( size_t bytes );
+    void setReadAhead( unsigned int blocks );
+
+    // drop all blocks nobody holds
+    void clear( void );
+
+    // taken under the lock, like report()
+    unsigned long getHits( void ) const;
+    unsigned long getMisses( void ) const;
+    unsigned long getReads( void ) const;
+
+    // log counters, hit rate and memory high water mark
+    void report( void ) const;
+
+private:
+    tgRasterBlockCache();
+
+    struct cacheEntry {
+        cacheEntry() : bytes(0), loading(true) {}
+
+        tgRasterBlockPtr                    block;
+        size_t                              bytes;
+        bool                                loading;
+        std::list<std::string>::iterator    lru;
+    };
+
+    static std::string key( const std::string& name, GDALRasterBand* band, int bx, int by );
+
+    tgRasterBlockPtr load( const std::string& name, GDALRasterBand* band, int bx, int by, int count );
+    void evict( size_t limit );
+
+    mutable SGMutex                     lock;
+    SGWaitCondition                     loaded;
+
+    std::map<std::string, cacheEntry>   entries;
+    std::list<std::string>              lruList;    // most recently used first
+
+    size_t                              budget;
+    size_t                              bytesUsed;
+    size_t                              peakBytes;
+    unsigned int                        readAhead;
+
+    unsigned long                       hits;
+    unsigned long                       misses;
+    unsigned long                       reads;
+};
+
+#endif /* __TG_RASTER_BLOCK_CACHE_HXX__ */
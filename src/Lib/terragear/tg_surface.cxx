@@ -29,7 +29,7 @@
 #include <simgear/math/SGMath.hxx>
 #include <simgear/debug/logstream.hxx>
 
-#include <terragear/tg_array.hxx>
+#include <terragear/tg_array_cache.hxx>
 
 #include "TNT/jama_qr.h"
 #include "tg_surface.hxx"
@@ -94,13 +94,18 @@ static void tgCalcElevations( const std::string &root, const string_list elev_sr
 {
     bool done = false;
     int i, j;
-    tgArray array;
 
     // just bail if no work to do
     if ( Pts.rows() == 0 || Pts.cols() == 0 ) {
         return;
     }
 
+    // the various elevation sources, in order of preference
+    std::vector<std::string> demDirs;
+    for ( j = 0; j < (int)elev_src.size(); ++j ) {
+        demDirs.push_back( root + "/" + elev_src[j] );
+    }
+
     // set all elevations to -9999
     for ( j = 0; j < Pts.rows(); ++j ) {
         for ( i = 0; i < Pts.cols(); ++i ) {
@@ -126,28 +131,9 @@ static void tgCalcElevations( const std::string &root, const string_list elev_sr
 
         if ( found_one ) {
             SGBucket b( first );
-            std::string base = b.gen_base_path();
-
-            // try the various elevation sources
-            j = 0;
-            bool found_file = false;
-            while ( !found_file && j < (int)elev_src.size() ) {
-                std::string array_path = root + "/" + elev_src[j] + "/" + base + "/" + b.gen_index_str();
-
-                if ( array.open(array_path) ) {
-                    found_file = true;
-                    SG_LOG( SG_GENERAL, SG_INFO, "Using array_path = " << array_path );
-                }
-                j++;
-            }
-
-            // this will fill in a zero structure if no array data
-            // found/opened
-            array.parse( b );
-
-            // this will do a hasty job of removing voids by inserting
-            // data from the nearest neighbor (sort of)
-            array.remove_voids();
+            // parsed and void filled arrays are shared through the
+            // cache - or zero filled if no array data found/opened
+            tgArrayPtr array = tgArrayCache::instance().get( demDirs, b );
 
             // update all the non-updated elevations that are inside
             // this array file
@@ -158,8 +144,8 @@ static void tgCalcElevations( const std::string &root, const string_list elev_sr
                     SGGeod p = Pts.element(i,j);
                     if ( p.getElevationM() < -9000.0 ) {
                         done = false;
-                        elev = array.altitude_from_grid( p.getLongitudeDeg() * 3600.0,
-                                                         p.getLatitudeDeg() * 3600.0 );
+                        elev = array->altitude_from_grid( p.getLongitudeDeg() * 3600.0,
+                                                          p.getLatitudeDeg() * 3600.0 );
                         if ( elev > -9000 ) {
                             p.setElevationM( elev );
                             Pts.set(i, j, p);
@@ -168,8 +154,6 @@ static void tgCalcElevations( const std::string &root, const string_list elev_sr
                 }
             }
 
-            array.close();
-
         } else {
             done = true;
         }
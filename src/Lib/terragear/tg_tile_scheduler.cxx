@@ -0,0 +1,168 @@
+#include <algorithm>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+
+#include "tg_tile_scheduler.hxx"
+
+tgTileScheduler::tgTileScheduler( const std::vector<SGBucket>& buckets, int first, int last ) :
+    firstStage(first),
+    numStages( last >= first ? last - first + 1 : 0 ),
+    unfinished(0),
+    lastFinished(-1)
+{
+    for ( unsigned int i=0; i<buckets.size(); i++ ) {
+        if ( tileIndex.find( buckets[i].gen_index() ) == tileIndex.end() ) {
+            tileIndex[buckets[i].gen_index()] = tiles.size();
+            tiles.push_back( buckets[i] );
+        }
+    }
+
+    tasks.resize( tiles.size() * numStages );
+    for ( unsigned int i=0; i<tiles.size(); i++ ) {
+        for ( int s=0; s<numStages; s++ ) {
+            tasks[taskIndex( i, firstStage + s )].tile  = i;
+            tasks[taskIndex( i, firstStage + s )].stage = firstStage + s;
+        }
+    }
+
+    // a tile's later stages wait for the previous stage of the tile and
+    // its neighbours.  rows of different bucket widths can give more than
+    // one neighbour in a direction.
+    for ( unsigned int i=0; i<tiles.size() && numStages > 1; i++ ) {
+        std::vector<SGBucket>     neighbours;
+        std::vector<unsigned int> deps;
+
+        for ( int dx = -1; dx <= 1; dx++ ) {
+            for ( int dy = -1; dy <= 1; dy++ ) {
+                tiles[i].siblings( dx, dy, neighbours );
+            }
+        }
+
+        deps.push_back( i );
+        for ( unsigned int n=0; n<neighbours.size(); n++ ) {
+            std::map<long, unsigned int>::const_iterator it = tileIndex.find( neighbours[n].gen_index() );
+            if ( it != tileIndex.end() ) {
+                deps.push_back( it->second );
+            }
+        }
+        std::sort( deps.begin(), deps.end() );
+        deps.erase( std::unique( deps.begin(), deps.end() ), deps.end() );
+
+        for ( int s = firstStage+1; s < firstStage+numStages; s++ ) {
+            int t = taskIndex( i, s );
+
+            for ( unsigned int d=0; d<deps.size(); d++ ) {
+                tasks[taskIndex( deps[d], s-1 )].dependents.push_back( t );
+                tasks[t].waitingOn++;
+            }
+        }
+    }
+
+    for ( unsigned int t=0; t<tasks.size(); t++ ) {
+        if ( !tasks[t].waitingOn ) {
+            ready.push_back( t );
+        }
+    }
+    unfinished = tasks.size();
+
+    startTime.stamp();
+}
+
+bool tgTileScheduler::next( SGBucket& b, int& stage )
+{
+    lock.lock();
+
+    while ( ready.empty() && unfinished ) {
+        workReady.wait( lock );
+    }
+
+    if ( ready.empty() ) {
+        lock.unlock();
+        return false;
+    }
+
+    int t = ready.front();
+    ready.pop_front();
+
+    tasks[t].startMs = startTime.elapsedMSec();
+    b     = tiles[tasks[t].tile];
+    stage = tasks[t].stage;
+
+    lock.unlock();
+
+    return true;
+}
+
+void tgTileScheduler::done( const SGBucket& b, int stage )
+{
+    SGGuard<SGMutex> g( lock );
+
+    std::map<long, unsigned int>::const_iterator it = tileIndex.find( b.gen_index() );
+    if ( it == tileIndex.end() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "tgTileScheduler::done - unknown tile " << b.gen_index_str() );
+        return;
+    }
+
+    int       t   = taskIndex( it->second, stage );
+    tileTask& cur = tasks[t];
+    int64_t   now = startTime.elapsedMSec();
+
+    cur.finishMs = now;
+    cur.finished = true;
+    unfinished--;
+    lastFinished = t;
+
+    for ( unsigned int d=0; d<cur.dependents.size(); d++ ) {
+        tileTask& dep = tasks[cur.dependents[d]];
+
+        dep.lastDependency = t;
+        if ( --dep.waitingOn == 0 ) {
+            dep.readyMs = now;
+
+            // later stages go first - finishing tiles beats starting new ones
+            ready.push_front( cur.dependents[d] );
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_INFO, b.gen_index_str() << " - stage " << stage << " done, " << tasks.size() - unfinished << " of " << tasks.size() << " tile stages complete" );
+
+    // wake everyone once all is done, so they can exit
+    workReady.broadcast();
+}
+
+void tgTileScheduler::report( void ) const
+{
+    SGGuard<SGMutex> g( lock );
+
+    if ( lastFinished < 0 ) {
+        return;
+    }
+
+    // walk back from the last task to finish through the dependencies
+    // each task waited on last
+    std::vector<int> path;
+    for ( int t = lastFinished; t >= 0; t = tasks[t].lastDependency ) {
+        path.push_back( t );
+    }
+    std::reverse( path.begin(), path.end() );
+
+    int64_t workMs = 0;
+    int64_t queueMs = 0;
+    for ( unsigned int i=0; i<path.size(); i++ ) {
+        const tileTask& t = tasks[path[i]];
+
+        workMs  += t.finishMs - t.startMs;
+        queueMs += t.startMs - t.readyMs;
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Critical path: " << path.size() << " tile stages, " << tasks[lastFinished].finishMs << " ms total, " <<
+                                  workMs << " ms working, " << queueMs << " ms waiting for a free thread" );
+
+    for ( unsigned int i=0; i<path.size(); i++ ) {
+        const tileTask& t = tasks[path[i]];
+
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << tiles[t.tile].gen_index_str() << " stage " << t.stage << ": ready at " << t.readyMs << " ms, " <<
+                                      "ran " << t.startMs << " - " << t.finishMs << " ms" );
+    }
+}
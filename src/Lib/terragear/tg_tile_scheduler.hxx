@@ -0,0 +1,75 @@
+#ifndef __TG_TILE_SCHEDULER_HXX__
+#define __TG_TILE_SCHEDULER_HXX__
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+// Hands out ( tile, stage ) work to construction threads as soon as it
+// can run, instead of running each stage over all tiles behind a barrier.
+//
+// The first stage of a tile can run at any time.  A later stage of a tile
+// needs the previous stage of the tile itself, and of each of its eight
+// neighbours being built.  Neighbours outside of the tile list are assumed
+// to be done already.
+//
+// Worker threads loop on next() / done().  next() blocks until work is
+// ready, and returns false once everything has been done.
+class tgTileScheduler
+{
+public:
+    tgTileScheduler( const std::vector<SGBucket>& buckets, int firstStage, int lastStage );
+
+    bool next( SGBucket& b, int& stage );
+    void done( const SGBucket& b, int stage );
+
+    unsigned int getNumTasks( void ) const { return tasks.size(); }
+
+    // log the chain of tile stages that decided the total run time
+    void report( void ) const;
+
+private:
+    struct tileTask {
+        tileTask() : tile(0), stage(0), waitingOn(0), lastDependency(-1), readyMs(0), startMs(0), finishMs(0), finished(false) {}
+
+        unsigned int        tile;
+        int                 stage;
+
+        // tasks that can't start before this one is done
+        std::vector<int>    dependents;
+        unsigned int        waitingOn;
+
+        // the dependency that finished last - the one we waited for
+        int                 lastDependency;
+
+        int64_t             readyMs;
+        int64_t             startMs;
+        int64_t             finishMs;
+        bool                finished;
+    };
+
+    int taskIndex( unsigned int tile, int stage ) const {
+        return tile * numStages + ( stage - firstStage );
+    }
+
+    std::vector<SGBucket>       tiles;
+    std::map<long, unsigned int> tileIndex;
+
+    int                         firstStage;
+    int                         numStages;
+
+    std::vector<tileTask>       tasks;
+    std::deque<int>             ready;
+    unsigned int                unfinished;
+    int                         lastFinished;
+
+    mutable SGMutex             lock;
+    SGWaitCondition             workReady;
+    SGTimeStamp                 startTime;
+};
+
+#endif /* __TG_TILE_SCHEDULER_HXX__ */
@@ -623,7 +623,7 @@ void tgIntersectionEdge::Generate( void )
     for ( unsigned int pos=0; pos<NUM_CONSTRAINTS; pos++ ) {
         for ( unsigned int c=0; c< constraints[pos].size(); c++ ) {
 
-            if ( id == 818 ) {
+            if ( DEBUG_INTERSECTIONS && id == 818 ) {
                 constraints[pos][c].toShapefile( debugDataset.c_str(), debugConsLineLayer.c_str() );
                 sprintf( desc, "cons_%s_start", constraints[pos][c].getDescription().c_str() );
                 tgShapefile::FromEdgeArrPoint( constraints[pos][c].getStart(), debugDataset.c_str(), debugConsPointLayer.c_str(), desc );
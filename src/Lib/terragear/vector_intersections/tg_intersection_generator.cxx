@@ -1,5 +1,9 @@
 #include <ogrsf_frmts.h>
 
+#include <simgear/sg_inlines.h>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+
 #include "tg_segmentnetwork.hxx"
 #include "tg_polygon.hxx"
 #include "tg_shapefile.hxx"
@@ -11,6 +15,101 @@ void tgIntersectionGenerator::Insert( const SGGeod& s, const SGGeod& e, double w
     segNet.Add( s, e, w, z, t );
 }
 
+// nodes are handed out in blocks - a worker takes the next block when it's
+// done with the last one
+#define NODE_PASS_BLOCK (64)
+
+class tgIntersectionPassWorker : public SGThread
+{
+public:
+    tgIntersectionPassWorker( tgIntersectionGenerator* g, tgIntersectionGenerator::NodePass_e p, unsigned int& n, SGMutex& l ) :
+        generator(g), pass(p), next(n), lock(l) {}
+
+private:
+    virtual void run() {
+        unsigned int numNodes = generator->nodelist.size();
+
+        while ( true ) {
+            unsigned int begin;
+            {
+                SGGuard<SGMutex> g( lock );
+                begin = next;
+                next += NODE_PASS_BLOCK;
+            }
+            if ( begin >= numNodes ) {
+                break;
+            }
+
+            unsigned int end = SG_MIN2( begin + NODE_PASS_BLOCK, numNodes );
+            for ( unsigned int i=begin; i<end; i++ ) {
+                generator->RunNodePass( pass, generator->nodelist[i] );
+            }
+        }
+    }
+
+    tgIntersectionGenerator*                generator;
+    tgIntersectionGenerator::NodePass_e     pass;
+    unsigned int&                           next;
+    SGMutex&                                lock;
+};
+
+void tgIntersectionGenerator::RunNodePass( NodePass_e pass, tgIntersectionNode* node )
+{
+    switch( pass ) {
+        case PASS_CONSTRAIN_EDGES:
+            node->ConstrainEdges();
+            break;
+
+        case PASS_COMPLETE_SPECIAL_INTERSECTIONS:
+            node->CompleteSpecialIntersections();
+            break;
+
+        case PASS_GENERATE_EDGES:
+            node->GenerateEdges();
+            break;
+
+        case PASS_CHECK_ENDPOINT:
+            node->CheckEndpoint();
+            break;
+
+        case PASS_TEXTURE_EDGES:
+            if ( node->IsEndpoint() ) {
+                node->TextureEdges( texInfoCb );
+            }
+            break;
+    }
+}
+
+// run a pass over all nodes, and wait for it to finish
+void tgIntersectionGenerator::RunNodePass( NodePass_e pass )
+{
+    unsigned int numWorkers = SG_MIN2( numThreads, ( nodelist.size() + NODE_PASS_BLOCK - 1 ) / NODE_PASS_BLOCK );
+
+    // multi segment intersections walk onto the neighbours' edges
+    if ( pass == PASS_COMPLETE_SPECIAL_INTERSECTIONS ) {
+        numWorkers = 1;
+    }
+
+    if ( numWorkers <= 1 ) {
+        for (unsigned int i=0; i<nodelist.size(); i++) {
+            RunNodePass( pass, nodelist[i] );
+        }
+    } else {
+        unsigned int                            next = 0;
+        SGMutex                                 lock;
+        std::vector<tgIntersectionPassWorker*>  workers;
+
+        for ( unsigned int i=0; i<numWorkers; i++ ) {
+            workers.push_back( new tgIntersectionPassWorker( this, pass, next, lock ) );
+            workers.back()->start();
+        }
+        for ( unsigned int i=0; i<numWorkers; i++ ) {
+            workers[i]->join();
+            delete workers[i];
+        }
+    }
+}
+
 void tgIntersectionGenerator::ToShapefile( const char* prefix )
 {
 #if 0    
@@ -78,44 +177,35 @@ void tgIntersectionGenerator::Execute( void )
         ToShapefile("Capped");
 #endif
         
-        //find shared edge constraints at each node
-        SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Execute:AddConstraints");
-        for (unsigned int i=0; i<nodelist.size(); i++) {
-            SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Execute: ConstrainEdges at node " << i << " of " << nodelist.size() );
-            nodelist[i]->ConstrainEdges();
-        }
+        // find shared edge constraints at each node
+        // ( from here on, the node graph doesn't change )
+        SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Execute:AddConstraints at " << nodelist.size() << " nodes on " << numThreads << " threads" );
+        RunNodePass( PASS_CONSTRAIN_EDGES );
 
         // now complete special / multisegment intersections
         SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Execute:CompleteMultiSegment intersections");
-        for (unsigned int i=0; i<nodelist.size(); i++) {
-            SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Execute: complete multisegment at node " << i << " of " << nodelist.size() );
-            nodelist[i]->CompleteSpecialIntersections();
-        }
+        RunNodePass( PASS_COMPLETE_SPECIAL_INTERSECTIONS );
 
-        // dump the edges
-        // Open the datasource, skeleton, and constraints layers
-        void* dsid             = tgShapefile::OpenDatasource( debugDatabase );
-        void* skeleton_lid     = tgShapefile::OpenLayer( dsid, "skeleton", tgShapefile::LT_LINE );
-        void* constraints_lid  = tgShapefile::OpenLayer( dsid, "constraints", tgShapefile::LT_LINE );
-        void* startv_lid       = tgShapefile::OpenLayer( dsid, "startv", tgShapefile::LT_POINT );
-        for (tgintersectionedge_it it = edgelist.begin(); it != edgelist.end(); it++) {
-            (*it)->DumpArrangement( (OGRLayer*)skeleton_lid, (OGRLayer*)constraints_lid, (OGRLayer*)startv_lid, NULL );
+        // dump the edges - skeleton, constraints, and start vertex layers
+        if ( debugOutput.isEnabled() ) {
+            void* skeleton_lid     = debugOutput.getLayer( "skeleton", tgShapefile::LT_LINE );
+            void* constraints_lid  = debugOutput.getLayer( "constraints", tgShapefile::LT_LINE );
+            void* startv_lid       = debugOutput.getLayer( "startv", tgShapefile::LT_POINT );
+            for (tgintersectionedge_it it = edgelist.begin(); it != edgelist.end(); it++) {
+                (*it)->DumpArrangement( (OGRLayer*)skeleton_lid, (OGRLayer*)constraints_lid, (OGRLayer*)startv_lid, NULL );
+            }
         }
-        tgShapefile::CloseDatasource( dsid );
         
         // Generate the edge from each node
         SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Execute:GenerateEdges");
-        for (unsigned int i=0; i<nodelist.size(); i++) {
-            SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Execute: GenerateEdges at node " << i << " of " << nodelist.size() );
-            nodelist[i]->GenerateEdges();
-        }
+        RunNodePass( PASS_GENERATE_EDGES );
 
-        dsid                   = tgShapefile::OpenDatasource( debugDatabase );
-        void* poly_lid         = tgShapefile::OpenLayer( dsid, "polys", tgShapefile::LT_POLY );
-        for (tgintersectionedge_it it = edgelist.begin(); it != edgelist.end(); it++) {
-            (*it)->DumpArrangement(NULL, NULL, NULL, (OGRLayer*)poly_lid );
+        if ( debugOutput.isEnabled() ) {
+            void* poly_lid         = debugOutput.getLayer( "polys", tgShapefile::LT_POLY );
+            for (tgintersectionedge_it it = edgelist.begin(); it != edgelist.end(); it++) {
+                (*it)->DumpArrangement(NULL, NULL, NULL, (OGRLayer*)poly_lid );
+            }
         }
-        tgShapefile::CloseDatasource( dsid );
         
 #if 0        
         // Remove any edges that didn't get intersected
@@ -143,9 +233,7 @@ void tgIntersectionGenerator::Execute( void )
         SG_LOG(SG_GENERAL, LOG_INTERSECTION, "tgIntersectionGenerator::Texture");        
 
         // To texture, first find all nodes that contain the repeat endpoints.
-        for (unsigned int i=0; i<nodelist.size(); i++) {
-            nodelist[i]->CheckEndpoint();
-        }
+        RunNodePass( PASS_CHECK_ENDPOINT );
 
 #if DEBUG_TEXTURE        
         ToShapefile("Endpoints" );
@@ -158,13 +246,10 @@ void tgIntersectionGenerator::Execute( void )
             }
         }
         
-        // Now we traverse between all endpoints
-        for (unsigned int i=0; i<nodelist.size(); i++) {
-            if ( nodelist[i]->IsEndpoint() ) {
-                SG_LOG(SG_GENERAL, LOG_TEXTURE, "tgIntersectionGenerator::Texture ep " << i << " num_eps is " << num_ep );    
-                nodelist[i]->TextureEdges( texInfoCb );
-            }
-        }
+        // Now we traverse between all endpoints - each chain of edges between
+        // two endpoints is textured from the endpoint that owns it
+        SG_LOG(SG_GENERAL, LOG_TEXTURE, "tgIntersectionGenerator::Texture num_eps is " << num_ep );
+        RunNodePass( PASS_TEXTURE_EDGES );
 
         for (tgintersectionedge_it it = edgelist.begin(); it != edgelist.end(); it++) {
             (*it)->Verify( FLAGS_TEXTURED );
@@ -194,6 +279,8 @@ void tgIntersectionGenerator::Execute( void )
         }
 #endif
 
+        debugOutput.flush();
+
         SG_LOG(SG_GENERAL, SG_ALERT, "tgIntersectionGenerator::Complete");    
     }
 }
\ No newline at end of file
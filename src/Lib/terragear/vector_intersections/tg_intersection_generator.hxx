@@ -5,23 +5,55 @@
 #include "tg_intersection_edge.hxx"
 #include "tg_segmentnetwork.hxx"
 
+#include <terragear/tg_debug_shapefile.hxx>
+
 // intersection generator and segment network flags
 #define IG_DEBUG_COMPLETE       (0x01)
 
+// Once the node graph is built, the per node passes of Execute can run on
+// a pool of worker threads.  Those passes only write data the node owns -
+// the constraints at its own end of its edges, the edges originating from
+// it, its endpoint flag, and the texture chains it is the owner of - so
+// they need no locks, just a join before the next one starts.  The
+// special intersection pass is the exception: a multi segment walk sets
+// and applies constraints on edges of the neighbouring nodes, so it runs
+// on the calling thread, in node order.  The output is the same for any
+// number of threads.
+//
+// With more than one thread, texInfoCb is called from the workers, and
+// must be reentrant.  The workers share the exact node positions, so CGAL
+// must be built with thread support.
 class tgIntersectionGenerator {
 public:
-    tgIntersectionGenerator(const char* dbg, unsigned int cln_f, unsigned int int_f, tgIntersectionGeneratorTexInfoCb cb) : segNet(cln_f, dbg), texInfoCb(cb), flags(int_f)  {
+    tgIntersectionGenerator(const char* dbg, unsigned int cln_f, unsigned int int_f, tgIntersectionGeneratorTexInfoCb cb) : segNet(cln_f, dbg), texInfoCb(cb), flags(int_f), numThreads(1), debugOutput(dbg)  {
         strcpy(  debugDatabase, dbg );
     }
     
     void                                Insert( const SGGeod& s, const SGGeod& e, double w, int z, unsigned int t );
     void                                Execute( void );
+    void                                SetNumThreads( unsigned int n ) { numThreads = n ? n : 1; }
+
+    // debug shapefiles of the cleaned network and the edge arrangements - off by default
+    void                                SetDebugLevel( tgDebugShapefile::level_t l ) { debugOutput.setLevel( l ); segNet.SetDebugLevel( l ); }
+
     tgintersectionedge_it               edges_begin( void )  { return edgelist.begin(); }
     tgintersectionedge_it               edges_end( void )    { return edgelist.end(); }
     int                                 edges_size( void )   { return edgelist.size(); }
     
+    friend class tgIntersectionPassWorker;
+
 private:
+    typedef enum {
+        PASS_CONSTRAIN_EDGES = 0,
+        PASS_COMPLETE_SPECIAL_INTERSECTIONS,
+        PASS_GENERATE_EDGES,
+        PASS_CHECK_ENDPOINT,
+        PASS_TEXTURE_EDGES
+    } NodePass_e;
+
     void                                ToShapefile( const char* prefix );
+    void                                RunNodePass( NodePass_e pass );
+    void                                RunNodePass( NodePass_e pass, tgIntersectionNode* node );
 
     tgSegmentNetwork                    segNet;
     tgIntersectionNodeList              nodelist;
@@ -30,6 +62,8 @@ private:
     tgIntersectionGeneratorTexInfoCb    texInfoCb;
     char                                debugDatabase[256];
     unsigned int                        flags;    
+    unsigned int                        numThreads;
+    tgDebugShapefile                    debugOutput;
 };
 
 #endif /* __TG_INTERSECTION_GENERATOR_HXX__ */
\ No newline at end of file
@@ -17,6 +17,7 @@ tgIntersectionNode::tgIntersectionNode( const SGGeod& pos )
     start_v = NODE_UNTEXTURED;
     endpoint = false;
     id = cur_id++;
+    index = 0;
 }
 
 tgIntersectionNode::tgIntersectionNode( const edgeArrPoint& pos )
@@ -30,6 +31,7 @@ tgIntersectionNode::tgIntersectionNode( const edgeArrPoint& pos )
     start_v = NODE_UNTEXTURED;
     endpoint = false;
     id = cur_id++;
+    index = 0;
 }
 
 void tgIntersectionNode::CheckEndpoint( void )
@@ -295,6 +297,52 @@ void tgIntersectionNode::TextureToNextEndpoint( tgIntersectionEdgeInfo* cur_info
     } while (!done);
 }
 
+// the endpoint at the other end of the chain of edges starting with cur_info,
+// or NULL if the chain is broken - walks the chain like CalcDistanceToNextEndpoint
+tgIntersectionNode* tgIntersectionNode::FindNextEndpoint( tgIntersectionEdgeInfo* cur_info )
+{
+    tgIntersectionNode* next_node = NULL;
+    tgIntersectionEdge* cur_edge = NULL;
+
+    while ( cur_info ) {
+        cur_edge = cur_info->GetEdge();
+
+        if ( cur_info->IsOriginating() ) {
+            next_node = cur_edge->end;
+        } else {
+            next_node = cur_edge->start;
+        }
+
+        if ( next_node == this || next_node->IsEndpoint() ) {
+            return next_node;
+        }
+
+        cur_info = next_node->GetNextEdgeInfo( cur_edge );
+    }
+
+    return NULL;
+}
+
+// Which endpoint textures an edge chain.  Run one node after the other, the
+// lower index endpoint of a chain textures it, and the other end finds it
+// textured.  A cap edge with an endpoint at both ends is textured from
+// both, the higher index last.  Keeping to that, every chain has a single
+// owner, and the nodes can be textured in any order.
+bool tgIntersectionNode::OwnsTexture( tgIntersectionEdgeInfo* cur_info )
+{
+    tgIntersectionNode* other;
+
+    if ( cur_info->IsStartCap() || cur_info->IsEndCap() ) {
+        other = cur_info->IsOriginating() ? cur_info->GetEdge()->end : cur_info->GetEdge()->start;
+
+        return !( other->IsEndpoint() && other->GetIndex() > index );
+    } else {
+        other = FindNextEndpoint( cur_info );
+
+        return !( other && other->GetIndex() < index );
+    }
+}
+
 void tgIntersectionNode::TextureEdges( tgIntersectionGeneratorTexInfoCb texInfoCb ) 
 {
     if (!endpoint) {
@@ -308,8 +356,10 @@ void tgIntersectionNode::TextureEdges( tgIntersectionGeneratorTexInfoCb texInfoC
         SG_LOG(SG_GENERAL, LOG_TEXTURE, "tgIntersectionNode::TextureEdges edge " << i++ );
         
         if (*cur) {
-            // check for start CAP
-            if ( (*cur)->IsStartCap() ) {
+            if ( !OwnsTexture( (*cur) ) ) {
+                SG_LOG(SG_GENERAL, LOG_TEXTURE, "tgIntersectionNode::TextureEdges skip edge textured from the other end " );
+            } else if ( (*cur)->IsStartCap() ) {
+                // start CAP
                 SG_LOG(SG_GENERAL, LOG_TEXTURE, "tgIntersectionNode::TextureEdges found Start CAP " );
                 (*cur)->TextureStartCap(texInfoCb);
             } else if ( (*cur)->IsEndCap() ) {
@@ -1433,4 +1483,45 @@ void tgIntersectionNode::CompleteCap( tgIntersectionEdgeInfo* cur_info )
     
     ce->ApplyConstraint( true );    
 #endif    
-}
\ No newline at end of file
+}
+
+// cell size is twice the SGGeod_isEqual2D tolerance, so rounding in the
+// division can't push two equal locations more than one cell apart
+#define NODE_CELL_SIZE  (0.000000002)
+
+tgIntersectionNodeList::nodeCell tgIntersectionNodeList::GetCell( const SGGeod& loc )
+{
+    return nodeCell( (long long)floor( loc.getLongitudeDeg() / NODE_CELL_SIZE ),
+                     (long long)floor( loc.getLatitudeDeg()  / NODE_CELL_SIZE ) );
+}
+
+tgIntersectionNode* tgIntersectionNodeList::Find( const SGGeod& loc ) const
+{
+    nodeCell     cell = GetCell( loc );
+    unsigned int found = nodes.size();
+
+    for ( long long x = cell.first-1; x <= cell.first+1; x++ ) {
+        for ( long long y = cell.second-1; y <= cell.second+1; y++ ) {
+            nodeCellMap::const_iterator it = cells.find( nodeCell( x, y ) );
+            if ( it == cells.end() ) {
+                continue;
+            }
+
+            for ( unsigned int i=0; i<it->second.size(); i++ ) {
+                unsigned int idx = it->second[i];
+                if ( idx < found && SGGeod_isEqual2D( nodes[idx]->GetPosition(), loc ) ) {
+                    found = idx;
+                }
+            }
+        }
+    }
+
+    return ( found < nodes.size() ) ? nodes[found] : NULL;
+}
+
+void tgIntersectionNodeList::Insert( tgIntersectionNode* node )
+{
+    node->SetIndex( nodes.size() );
+    cells[GetCell( node->GetPosition() )].push_back( nodes.size() );
+    nodes.push_back( node );
+}
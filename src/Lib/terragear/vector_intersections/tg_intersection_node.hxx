@@ -3,6 +3,8 @@
 
 #include <stack>
 
+#include <boost/unordered_map.hpp>
+
 #include "tg_intersection_edge.hxx"
 
 // forward declarations
@@ -46,7 +48,14 @@ public:
     void                    CheckEndpoint( void );
     bool                    IsEndpoint( void ) const { return endpoint; }
     
+    // position in the node list
+    unsigned int            GetIndex( void ) const { return index; }
+    void                    SetIndex( unsigned int i ) { index = i; }
+
 private:
+    tgIntersectionNode*     FindNextEndpoint( tgIntersectionEdgeInfo* cur_info );
+    bool                    OwnsTexture( tgIntersectionEdgeInfo* cur_info );
+
     void GenerateBisectRays( void );
     void GeneratePrimaryBisectRays( double width, const tgintersectionedgeinfo_vector& edges );
     void GenerateSecondaryBisectRays( double width, const tgintersectionedgeinfo_vector& edges );
@@ -69,9 +78,15 @@ private:
     double                      start_v;
     bool                        endpoint;
     unsigned int                id;
+    unsigned int                index;
 };
 typedef std::vector<tgIntersectionNode*> tgintersectionnode_list;
 
+// nodes are looked up with SGGeod_isEqual2D, through a hash of the node
+// positions, quantized to cells twice the equality tolerance - a matching
+// node is always in the cell of the location, or one next to it.  When
+// more than one node matches, the first one added wins.  Every node knows
+// its index in the list.
 class tgIntersectionNodeList {
 public:
     tgIntersectionNodeList() {
@@ -79,71 +94,34 @@ public:
     }
     
     tgIntersectionNode* Get( const SGGeod& loc ) {
-        tgIntersectionNode* node = NULL;
-        
-        for ( unsigned int i=0; i<nodes.size(); i++ ) {
-            if ( SGGeod_isEqual2D(nodes[i]->GetPosition(), loc) ) {
-                node = nodes[i];
-                break;
-            }
-        }
+        tgIntersectionNode* node = Find( loc );
         
         if ( node == NULL ) {
             node = new tgIntersectionNode( loc );
-            nodes.push_back( node );
+            Insert( node );
         }
         
         return node;
     }
 
     tgIntersectionNode* Add( const SGGeod& loc ) {
-        tgIntersectionNode* node = NULL;
-        
-        for ( unsigned int i=0; i<nodes.size(); i++ ) {
-            if ( SGGeod_isEqual2D(nodes[i]->GetPosition(), loc) ) {
-                node = nodes[i];
-                break;
-            }
-        }
-        
-        if ( node == NULL ) {
-            node = new tgIntersectionNode( loc );
-            nodes.push_back( node );
-        }
-        
-        return node;
+        return Get( loc );
     }
 
     tgIntersectionNode* Add( const edgeArrPoint& loc ) {
-        tgIntersectionNode* node = NULL;
-        
         SGGeod gPos = SGGeod::fromDeg( CGAL::to_double(loc.x()), CGAL::to_double(loc.y()) );
-        for ( unsigned int i=0; i<nodes.size(); i++ ) {
-            if ( SGGeod_isEqual2D(nodes[i]->GetPosition(), gPos) ) {
-                node = nodes[i];
-                break;
-            }
-        }
+        tgIntersectionNode* node = Find( gPos );
         
         if ( node == NULL ) {
             node = new tgIntersectionNode( loc );
-            nodes.push_back( node );
+            Insert( node );
         }
         
         return node;
     }
     
     bool IsNode( const SGGeod& loc ) {
-        bool isnode = false;
-        
-        for ( unsigned int i=0; i<nodes.size(); i++ ) {
-            if ( SGGeod_isEqual2D(nodes[i]->GetPosition(), loc) ) {
-                isnode = true;
-                break;
-            }
-        }
-        
-        return isnode;
+        return ( Find( loc ) != NULL );
     }
     
     unsigned int size(void) const {
@@ -155,7 +133,16 @@ public:
     }
     
 private:
+    typedef std::pair<long long, long long>                                 nodeCell;
+    typedef boost::unordered_map<nodeCell, std::vector<unsigned int> >      nodeCellMap;
+
+    static nodeCell GetCell( const SGGeod& loc );
+
+    tgIntersectionNode* Find( const SGGeod& loc ) const;
+    void                Insert( tgIntersectionNode* node );
+
     tgintersectionnode_list    nodes;    
+    nodeCellMap                cells;
 };
 
 #endif /* __TG_INTERSECTION_NODE_HXX__ */
\ No newline at end of file
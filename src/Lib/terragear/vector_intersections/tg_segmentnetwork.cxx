@@ -21,7 +21,7 @@
 #define LOG_SHORT_EDGES         SG_DEBUG
 #define LOG_FIX_SHORT_SEGMENT   SG_DEBUG
 
-tgSegmentNetwork::tgSegmentNetwork( unsigned int cf, const std::string debugRoot ) : invalid_vh()
+tgSegmentNetwork::tgSegmentNetwork( unsigned int cf, const std::string debugRoot ) : invalid_vh(), debugOutput( "./edge_dbg/" + debugRoot )
 {
     clean_flags = cf;
 
@@ -57,7 +57,9 @@ void tgSegmentNetwork::Add( const SGGeod& source, const SGGeod& target, double w
             
 void tgSegmentNetwork::Execute( void )
 {    
-    std::cout << "Save Input to " << datasource << std::endl;
+    if ( debugOutput.isEnabled() ) {
+        SG_LOG(SG_GENERAL, SG_INFO, "tgSegmentNetwork::Save Input to " << debugOutput.getDatasource() );
+    }
     
     ToShapefiles( "input" );
 
@@ -90,6 +92,8 @@ void tgSegmentNetwork::Execute( void )
 
         GenerateOutput();
     }
+
+    debugOutput.flush();
 }
 
 bool tgSegmentNetwork::IsVertexHandleInList( segnetVertexHandle h, std::list<segnetVertexHandle>& vertexList )
@@ -863,8 +867,14 @@ void tgSegmentNetwork::DumpPolys( void )
                 ++cur;
             } while (cur != ccb);
             
-            if ( fabs( area ) < 0.00000000001 ) {
-                tgShapefile::FromSegmentList( segList, false, datasource, "polys", "poly" );
+            if ( fabs( area ) < 0.00000000001 && debugOutput.isEnabled() ) {
+                void* lid = debugOutput.getLayer( "polys", tgShapefile::LT_LINE );
+                char  seg_desc[64];
+
+                for ( unsigned int i=0; i<segList.size(); i++ ) {
+                    sprintf( seg_desc, "poly_%d", i+1 );
+                    tgShapefile::FromSegment( lid, segList[i], false, seg_desc );
+                }
             }
         }
     }
@@ -872,45 +882,48 @@ void tgSegmentNetwork::DumpPolys( void )
 
 void tgSegmentNetwork::ToShapefiles( const char* prefix )
 {
-#if 0    
     char layer[128];
- 
+    char desc[64];
+
+    if ( !debugOutput.isEnabled() ) {
+        return;
+    }
+
     if ( clean_flags ) {
         CGAL_precondition( arr.is_valid () );
     
         // first - write the vertex layer
-        std::vector<SGGeod> vertex_list;
-        typename segnetArrangement::Vertex_const_iterator vit;
+        sprintf(layer, "%s_sn_vertices", prefix );
+        void* vertex_lid = debugOutput.getLayer( layer, tgShapefile::LT_POINT );
+
+        unsigned int num = 1;
+        segnetArrangement::Vertex_const_iterator vit;
         for ( vit = arr.vertices_begin(); vit != arr.vertices_end(); ++vit ) {
-            vertex_list.push_back( SGGeod::fromDeg( CGAL::to_double(vit->point().x()), 
-                                                    CGAL::to_double(vit->point().y())) );
+            sprintf( desc, "vertex_%d", num++ );
+            tgShapefile::FromGeod( vertex_lid, SGGeod::fromDeg( CGAL::to_double(vit->point().x()), 
+                                                                CGAL::to_double(vit->point().y())), desc );
         }
-    
-        sprintf(layer, "%s_sn_vertices", prefix );
-        tgShapefile::FromGeodList( vertex_list, false, datasource, layer, "vertex" );
 
-        std::vector<tgSegment> segment_list;
-        typename segnetArrangement::Edge_const_iterator eit;
-    
+        sprintf(layer, "%s_sn_edges", prefix );
+        void* edge_lid = debugOutput.getLayer( layer, tgShapefile::LT_LINE );
+
+        num = 1;
+        segnetArrangement::Edge_const_iterator eit;
         for ( eit = arr.edges_begin(); eit != arr.edges_end(); ++eit ) {
             tgSegment   tgseg( SGGeod::fromDeg( CGAL::to_double( eit->source()->point().x() ),
                                                 CGAL::to_double( eit->source()->point().y() ) ),
                                SGGeod::fromDeg( CGAL::to_double( eit->target()->point().x() ),
                                                 CGAL::to_double( eit->target()->point().y() ) ) );
-            segment_list.push_back( tgseg );
+            sprintf( desc, "edge_%d", num++ );
+            tgShapefile::FromSegment( edge_lid, tgseg, false, desc );
         }
-
-        sprintf(layer, "%s_sn_edges", prefix );
-        tgShapefile::FromSegmentList( segment_list, false, datasource, layer, "edge" );
     } else {
-        std::vector<tgSegment> segment_list;
-        
+        sprintf(layer, "%s_sn_edges", prefix );
+        void* edge_lid = debugOutput.getLayer( layer, tgShapefile::LT_LINE );
+
         for ( unsigned int i=0; i<output.size(); i++ ) {
-            segment_list.push_back( tgSegment( output[i].start, output[i].end ) );
+            sprintf( desc, "edge_%d", i+1 );
+            tgShapefile::FromSegment( edge_lid, tgSegment( output[i].start, output[i].end ), false, desc );
         }
-        
-        sprintf(layer, "%s_sn_edges", prefix );
-        tgShapefile::FromSegmentList( segment_list, false, datasource, layer, "edge" );
     }
-#endif    
 }
\ No newline at end of file
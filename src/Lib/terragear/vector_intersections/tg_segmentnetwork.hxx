@@ -29,6 +29,7 @@
 #include <CGAL/Snap_rounding_2.h>
 
 #include <terragear/tg_cgal.hxx>
+#include <terragear/tg_debug_shapefile.hxx>
 
 // the network arrangement
 class segnetEdge 
@@ -141,6 +142,9 @@ public:
     void      Add( const SGGeod& source, const SGGeod& target, double width, int zorder, unsigned int type );
     void      Execute( void );
     
+    // debug output of the network after each cleaning step - off by default
+    void      SetDebugLevel( tgDebugShapefile::level_t l ) { debugOutput.setLevel( l ); }
+
     void      DumpPolys( void );
     void      ToShapefiles( const char* prefix );
     
@@ -199,6 +203,7 @@ private:
     
     
     char               datasource[128];
+    tgDebugShapefile   debugOutput;
 };
 
 #if 0
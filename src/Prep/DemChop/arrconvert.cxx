@@ -0,0 +1,127 @@
+// arrconvert.cxx -- convert .arr.gz elevation arrays to mappable .arr.raw
+//
+// tgArray prefers <index>.arr.raw over <index>.arr.gz when both exist,
+// and the raw file is at least as new.
+// The raw file holds the samples in native byte order, so it is read in
+// place - either plain, or, with --compress, in blocks deflated at
+// --level, inflated as they are first used.  Every converted array is
+// read back and compared with the original.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/misc/sg_path.hxx>
+
+#include <terragear/tg_array.hxx>
+
+static bool convert( const std::string& file, bool compressed, int block_size, int level )
+{
+    // <dir>/<index>.arr.gz -> <dir>/<index>
+    std::string base = file;
+    std::string::size_type pos = base.rfind( ".arr.gz" );
+    if ( pos != std::string::npos && pos + 7 == base.size() ) {
+        base.erase( pos );
+    }
+
+    SGBucket bucket( atol( SGPath( base ).file().c_str() ) );
+
+    // always from the .arr.gz - not from the .arr.raw of an earlier run
+    tgArray src;
+    if ( !src.open( base, false ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "arrconvert: can't open " << file );
+        return false;
+    }
+    src.parse( bucket );
+
+    if ( !src.write_raw( base, compressed, block_size, level ) ) {
+        return false;
+    }
+
+    tgArray dst;
+    if ( !dst.open( base ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "arrconvert: can't open " << base << ".arr.raw" );
+        return false;
+    }
+    dst.parse( bucket );
+
+    int diffs = 0;
+    if ( dst.get_cols() != src.get_cols() || dst.get_rows() != src.get_rows() ||
+         dst.get_originx() != src.get_originx() || dst.get_originy() != src.get_originy() ) {
+        diffs++;
+    }
+    for ( int i = 0; i < src.get_cols() && !diffs; i++ ) {
+        for ( int j = 0; j < src.get_rows(); j++ ) {
+            if ( dst.get_array_elev( i, j ) != src.get_array_elev( i, j ) ) {
+                diffs++;
+            }
+        }
+    }
+
+    if ( diffs ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "arrconvert: " << base << ".arr.raw differs from " << file );
+        return false;
+    }
+
+    SG_LOG( SG_GENERAL, SG_INFO, "arrconvert: " << file << " -> " << base << ".arr.raw" );
+
+    return true;
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<std::string> files;
+    bool                     compressed = false;
+    int                      block_size = 64;
+    int                      level = 1;
+    int                      errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_INFO );
+
+    for ( int i=1; i<argc; i++ ) {
+        std::string arg = argv[i];
+
+        if ( arg == "--compress" ) {
+            compressed = true;
+        } else if ( arg.find("--block=") == 0 ) {
+            block_size = atoi( arg.substr(8).c_str() );
+        } else if ( arg.find("--level=") == 0 ) {
+            level = atoi( arg.substr(8).c_str() );
+        } else if ( arg.find("--") == 0 ) {
+            files.clear();
+            break;
+        } else {
+            files.push_back( arg );
+        }
+    }
+
+    if ( files.empty() || block_size < 1 || level < 0 || level > 9 ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "Usage: " << argv[0] << " [--compress] [--block=<samples>] [--level=<0-9>] <file.arr.gz> ..." );
+        return 1;
+    }
+
+    for ( unsigned int i=0; i<files.size(); i++ ) {
+        if ( !convert( files[i], compressed, block_size, level ) ) {
+            errors++;
+        }
+    }
+
+    return errors ? 1 : 0;
+}
@@ -27,11 +27,18 @@
 //#endif
 
 #include <simgear/compiler.h>
+
+#include <vector>
+
 #include <simgear/bucket/newbucket.hxx>
 #include <simgear/debug/logstream.hxx>
 #include <simgear/io/lowlevel.hxx>
 #include <simgear/misc/sg_path.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
 
+#include <Lib/terragear/tg_raster_block_cache.hxx>
 #include <Lib/terragear/tg_rectangle.hxx>
 
 #include <ogrsf_frmts.h> 
@@ -40,6 +47,7 @@
 #include <ogr_spatialref.h>
 
 #include <boost/scoped_array.hpp>
+#include <boost/thread.hpp>
 
 /*
  * A simple benchmark using a 5x5 degree package
@@ -65,6 +73,21 @@
  * - Ralf Gerlich
  */
 
+/*
+ * Buckets are chopped on --threads workers, each with its own handles of
+ * the datasets - GDAL handles aren't thread safe.  North up WGS84 rasters
+ * - the usual DEMs - are sampled straight from blocks in the process
+ * wide tgRasterBlockCache, so neighbouring buckets on different workers
+ * read the raster blocks they share once.  Other rasters are warped, with
+ * one transformer per image and worker instead of one per bucket.
+ */
+
+// gzip level of the .arr.gz files
+int compression_level = 9;
+
+// simgear directory creation isn't thread safe
+SGMutex dir_lock;
+
 struct SimpleRasterTransformerInfo {
     GDALTransformerFunc pfnTransformer;
     void* pTransformerArg;
@@ -106,6 +129,7 @@ int SimpleRasterTransformer(void *pTransformerArg,
 class ImageInfo {
 public:
     ImageInfo(GDALDataset *dataset);
+    ~ImageInfo();
 
     void GetBounds(double &n, double &s, double &e, double &w) const {
         n = north;
@@ -159,11 +183,18 @@ protected:
 
     /* Pixel size in degs */
     double pxSizeX, pxSizeY;
+
+    /* north up in WGS84 - sampled from the block cache without warping */
+    bool northUpWGS84;
+
+    /* WGS84 -> raster transformer of the warp, made on first use */
+    void *genImgXfrm;
 };
 
 ImageInfo::ImageInfo(GDALDataset *dataset) :
     dataset(dataset),
-    srs(dataset->GetProjectionRef())
+    srs(dataset->GetProjectionRef()),
+    genImgXfrm(NULL)
 {
     OGRSpatialReference wgs84SRS;
 
@@ -211,6 +242,9 @@ ImageInfo::ImageInfo(GDALDataset *dataset) :
         exit(1);
     }
 
+    northUpWGS84 = srs.IsGeographic() && srs.IsSameGeogCS(&wgs84SRS) &&
+                   geoXfrm[2] == 0.0 && geoXfrm[4] == 0.0;
+
     east = west = geoX[0];
     north = south = geoY[0];
 
@@ -227,27 +261,51 @@ ImageInfo::ImageInfo(GDALDataset *dataset) :
            " e=" << east << " w=" << west);
 }
 
+ImageInfo::~ImageInfo()
+{
+    if (genImgXfrm) {
+        GDALDestroyGenImgProjTransformer(genImgXfrm);
+    }
+    OCTDestroyCoordinateTransformation(wgs84xform);
+    GDALClose(dataset);
+}
+
 void ImageInfo::GetDataChunk(int *buffer,
                              double x, double y,
                              double colstep, double rowstep,
                              int w, int h,
                              int srcband, int nodata)
 {
-    OGRSpatialReference wgs84SRS;
+    if (northUpWGS84) {
+        /* the sample centers of the warp below */
+        tgRasterBlockCache::instance().sampleGrid(GetDescription(), dataset->GetRasterBand(srcband), geoXfrm,
+                                                  x - pxSizeX * 0.5 + colstep * 0.5,
+                                                  y - pxSizeY * 0.5 + rowstep * 0.5,
+                                                  colstep, rowstep, w, h, buffer);
+        return;
+    }
 
-    wgs84SRS.SetWellKnownGeogCS( "EPSG:4326" );
+    if (!genImgXfrm) {
+        OGRSpatialReference wgs84SRS;
+
+        wgs84SRS.SetWellKnownGeogCS( "EPSG:4326" );
+
+        char* wgs84WKT;
+        wgs84SRS.exportToWkt(&wgs84WKT);
+
+        genImgXfrm = GDALCreateGenImgProjTransformer(
+            dataset, NULL,
+            NULL, wgs84WKT,
+            FALSE,
+            0.0,
+            1);
 
-    char* wgs84WKT;
-    wgs84SRS.exportToWkt(&wgs84WKT);
+        CPLFree(wgs84WKT);
+    }
 
     /* Setup a raster transformation from WGS84 to raster coordinates of the array files */
     SimpleRasterTransformerInfo xformData;
-    xformData.pTransformerArg = GDALCreateGenImgProjTransformer(
-        dataset, NULL,
-        NULL, wgs84WKT,
-        FALSE,
-        0.0,
-        1);
+    xformData.pTransformerArg = genImgXfrm;
 
     xformData.pfnTransformer = GDALGenImgProjTransform;
     xformData.x0 = x - pxSizeX * 0.5;
@@ -302,7 +360,6 @@ void ImageInfo::GetDataChunk(int *buffer,
     psWarpOptions->padfSrcNoDataImag = NULL;
     psWarpOptions->padfDstNoDataReal = NULL;
 
-    GDALDestroyGenImgProjTransformer( xformData.pTransformerArg );
     GDALDestroyWarpOptions( psWarpOptions );
 }
 
@@ -315,14 +372,21 @@ void write_bucket(const std::string& work_dir, SGBucket bucket,
     // generate output file name
     std::string base = bucket.gen_base_path();
     std::string path = work_dir + "/" + base;
-    SGPath sgp( path );
-    sgp.append( "dummy" );
-    sgp.create_dir( 0755 );
+    {
+        SGGuard<SGMutex> g( dir_lock );
+
+        SGPath sgp( path );
+        sgp.append( "dummy" );
+        sgp.create_dir( 0755 );
+    }
 
     std::string array_file = path + "/" + bucket.gen_index_str() + ".arr.gz";
 
+    char mode[8];
+    snprintf(mode, sizeof(mode), "wb%d", compression_level);
+
     gzFile fp;
-    if ( (fp = gzopen(array_file.c_str(), "wb9")) == NULL ) {
+    if ( (fp = gzopen(array_file.c_str(), mode)) == NULL ) {
         SG_LOG(SG_GENERAL, SG_ALERT, "cannot open " << array_file << " for writing!");
         exit(-1);
     }
@@ -333,18 +397,23 @@ void write_bucket(const std::string& work_dir, SGBucket bucket,
     sgWriteInt(fp, span_x); sgWriteInt(fp, col_step);
     sgWriteInt(fp, span_y); sgWriteInt(fp, row_step);
 
+    // column by column, in one write
+    boost::scoped_array<int16_t> samples(new int16_t[span_x * span_y]);
     for ( int x = 0; x < span_x; ++x ) {
         for ( int y = 0; y < span_y; ++y ) {
-            sgWriteShort(fp, buffer[ y * span_x + x ]);
+            samples[ x * span_y + y ] = buffer[ y * span_x + x ];
         }
     }
+    sgWriteShort(fp, span_x * span_y, samples.get());
 
-    gzclose(fp);
+    if ( gzclose(fp) != Z_OK ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "error writing " << array_file);
+    }
 }
 
 void process_bucket(const SGPath& work_dir, SGBucket bucket,
                     ImageInfo* images[], int imagecount,
-                    bool forceWrite = false)
+                    bool forceWrite)
 {
     double bnorth, bsouth, beast, bwest;
 
@@ -421,17 +490,102 @@ void process_bucket(const SGPath& work_dir, SGBucket bucket,
                  col_step, row_step);
 }
 
+struct ChopJob {
+    SGBucket bucket;
+    bool     forceWrite;
+};
+
+class ChopWorker : public SGThread
+{
+public:
+    ChopWorker(const SGPath& wd, const char** names, int count,
+               const std::vector<ChopJob>& j, unsigned int& n, SGMutex& l) :
+        work_dir(wd), datasetnames(names), datasetcount(count),
+        jobs(j), next(n), lock(l) {}
+
+private:
+    virtual void run() {
+        boost::scoped_array<ImageInfo *> images( new ImageInfo *[datasetcount] );
+
+        // our own handles - GDAL handles aren't thread safe
+        for (int i = 0; i < datasetcount; i++) {
+            GDALDataset* dataset = (GDALDataset*)GDALOpen(datasetnames[i], GA_ReadOnly);
+
+            if (dataset == NULL) {
+                SG_LOG(SG_GENERAL, SG_ALERT,
+                       "Could not open dataset '" << datasetnames[i] << "'"
+                       ":" << CPLGetLastErrorMsg());
+                exit(1);
+            }
+
+            images[i] = new ImageInfo(dataset);
+        }
+
+        // buckets are handed out in order, so the workers chop neighbours
+        // at the same time
+        while (true) {
+            unsigned int cur;
+            {
+                SGGuard<SGMutex> g( lock );
+                cur = next++;
+            }
+            if (cur >= jobs.size())
+                break;
+
+            process_bucket(work_dir, jobs[cur].bucket, images.get(), datasetcount, jobs[cur].forceWrite);
+        }
+
+        for (int i = 0; i < datasetcount; i++) {
+            delete images[i];
+        }
+    }
+
+    SGPath                      work_dir;
+    const char**                datasetnames;
+    int                         datasetcount;
+    const std::vector<ChopJob>& jobs;
+    unsigned int&               next;
+    SGMutex&                    lock;
+};
+
+static void usage(const char* name)
+{
+    SG_LOG(SG_GENERAL, SG_ALERT,
+           "Usage " << name << " [--threads[=<num>]] [--compression=<0-9>] [--raster-cache=<MB>]"
+           " <work_dir> <datasetname...> [-- <bucket-idx> ...]");
+    exit(-1);
+}
+
 int main(int argc, const char **argv)
 {
     sglog().setLogLevels( SG_ALL, SG_INFO );
 
-    if ( argc < 3 ) {
-        SG_LOG(SG_GENERAL, SG_ALERT,
-               "Usage " << argv[0] << " <work_dir> <datasetname...> [-- <bucket-idx> ...]");
-        exit(-1);
+    int num_threads = 1;
+    int argstart;
+
+    for (argstart = 1; argstart < argc; argstart++) {
+        std::string arg = argv[argstart];
+
+        if (arg.find("--") != 0 || arg == "--") {
+            break;
+        } else if (arg.find("--threads=") == 0) {
+            num_threads = atoi( arg.substr(10).c_str() );
+        } else if (arg == "--threads") {
+            num_threads = boost::thread::hardware_concurrency();
+        } else if (arg.find("--compression=") == 0) {
+            compression_level = atoi( arg.substr(14).c_str() );
+        } else if (arg.find("--raster-cache=") == 0) {
+            tgRasterBlockCache::instance().setBudget( (size_t)atol( arg.substr(15).c_str() ) * 1024 * 1024 );
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if ( argc - argstart < 2 || num_threads < 1 || compression_level < 0 || compression_level > 9 ) {
+        usage(argv[0]);
     }
 
-    SGPath work_dir(argv[1]);
+    SGPath work_dir(argv[argstart]);
     work_dir.create_dir( 0755 );
 
     GDALAllRegister();
@@ -439,11 +593,11 @@ int main(int argc, const char **argv)
     int datasetcount = 0, tilecount = 0;
     int dashpos;
 
-    for (dashpos = 2; dashpos < argc; dashpos++)
+    for (dashpos = argstart + 1; dashpos < argc; dashpos++)
         if (!strcmp(argv[dashpos], "--"))
             break;
 
-    datasetcount = dashpos - 2;
+    datasetcount = dashpos - argstart - 1;
     tilecount = (dashpos == argc ? 0 : argc - dashpos - 1);
 
     if (datasetcount == 0) {
@@ -453,9 +607,7 @@ int main(int argc, const char **argv)
     }
 
     const char** tilenames = argv + dashpos + 1;
-    const char** datasetnames = argv + 2;
-
-    boost::scoped_array<ImageInfo *> images( new ImageInfo *[datasetcount] );
+    const char** datasetnames = argv + argstart + 1;
 
     double north = -1000, south = 1000, east = -1000, west = 1000;
 
@@ -463,11 +615,12 @@ int main(int argc, const char **argv)
 
     /*
      * Step 1: Open all provided datasets and determine their bounds in WGS84.
+     *         The workers open their own handles.
      */
     for (int i = 0; i < datasetcount; i++) {
         GDALDataset* dataset;
 
-        dataset = (GDALDataset*)GDALOpenShared(datasetnames[i], GA_ReadOnly);
+        dataset = (GDALDataset*)GDALOpen(datasetnames[i], GA_ReadOnly);
 
         if (dataset == NULL) {
             SG_LOG(SG_GENERAL, SG_ALERT,
@@ -476,10 +629,10 @@ int main(int argc, const char **argv)
             exit(1);
         }
 
-        images[i] = new ImageInfo(dataset);
+        ImageInfo image(dataset);
 
         double inorth, isouth, ieast, iwest;
-        images[i]->GetBounds(inorth, isouth, ieast, iwest);
+        image.GetBounds(inorth, isouth, ieast, iwest);
 
         north = std::max(north, inorth);
         south = std::min(south, isouth);
@@ -497,6 +650,8 @@ int main(int argc, const char **argv)
      *         all of them. Warn if no sufficient coverage (non-null pixels) is
      *         available.
      */
+    std::vector<ChopJob> jobs;
+
     if (tilecount == 0) {
         /*
          * No tiles were specified, so we determine the common bounds of all
@@ -511,11 +666,11 @@ int main(int argc, const char **argv)
 
         SG_LOG(SG_GENERAL, SG_INFO, "dx=" << dx << " dy=" << dy);
 
-        for (int x = 0; x <= dx; x++) {
-            for (int y = 0; y <= dy; y++) {
-                SGBucket bucket = start.sibling(x, y);
-
-                process_bucket(work_dir, bucket, images.get(), datasetcount);
+        // row by row, west to east, the way the raster blocks are cached
+        for (int y = 0; y <= dy; y++) {
+            for (int x = 0; x <= dx; x++) {
+                ChopJob job = { start.sibling(x, y), false };
+                jobs.push_back(job);
             }
         }
     } else {
@@ -524,11 +679,30 @@ int main(int argc, const char **argv)
          * data is available, but write them in any case.
          */
         for (int i = 0; i < tilecount; i++) {
-            SGBucket bucket(atol(tilenames[i]));
-
-            process_bucket(work_dir, bucket, images.get(), datasetcount, true);
+            ChopJob job = { SGBucket(atol(tilenames[i])), true };
+            jobs.push_back(job);
         }
     }
 
+    SGTimeStamp t;
+    t.stamp();
+
+    unsigned int              next = 0;
+    SGMutex                   lock;
+    std::vector<ChopWorker *> workers;
+
+    for (int i = 0; i < num_threads; i++) {
+        workers.push_back(new ChopWorker(work_dir, datasetnames, datasetcount, jobs, next, lock));
+        workers.back()->start();
+    }
+
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i]->join();
+        delete workers[i];
+    }
+
+    SG_LOG(SG_GENERAL, SG_INFO, "chopped " << jobs.size() << " buckets on " << num_threads << " threads in " << t.elapsedMSec() / 1000.0 << " s");
+    tgRasterBlockCache::instance().report();
+
     return 0;
 }
@@ -31,7 +31,6 @@
 
 #include <simgear/compiler.h>
 #include <simgear/threads/SGThread.hxx>
-#include <simgear/threads/SGQueue.hxx>
 #include <simgear/debug/logstream.hxx>
 #include <simgear/math/sg_geodesy.hxx>
 #include <simgear/misc/sg_path.hxx>
@@ -39,6 +38,9 @@
 
 #include <Include/version.h>
 
+#include <terragear/tg_bounded_queue.hxx>
+#include <terragear/tg_feature_reader.hxx>
+#include <terragear/tg_profile.hxx>
 #include <terragear/polygon_set/tg_polygon_set.hxx>
 #include <terragear/polygon_set/tg_polygon_chop.hxx>
 
@@ -63,11 +65,11 @@ string attribute_query;
 bool use_spatial_query=false;
 double spat_min_x, spat_min_y, spat_max_x, spat_max_y;
 int num_threads = 16;
+unsigned int queue_size = 1024;     // ==0 => read the whole layer ahead
+double batch_size = 0.0;            // ==0 => don't read in batches
 bool save_shapefiles=false;
 std::string ds_name=".";
 
-SGLockedQueue<OGRFeature *> global_workQueue;
-
 /* very GDAL specific here... */
 inline static bool is_ocean_area( const std::string &area ) {
     return area == "Ocean" || area == "Bay  Estuary or Ocean";
@@ -86,7 +88,7 @@ inline static bool is_null_area( const std::string& area ) {
 class Decoder : public SGThread
 {
 public:
-    Decoder( OGRCoordinateTransformation *poct, int atf, tgChopper& c, SGMutex& l ) : chopper(c), lock(l) {
+    Decoder( tgBoundedQueue<OGRFeature *>& q, OGRCoordinateTransformation *poct, int atf, tgChopper& c, SGMutex& l ) : workQueue(q), chopper(c), lock(l) {
         poCT = poct;
         area_type_field = atf;
     }
@@ -94,9 +96,13 @@ public:
 private:
     virtual void run();
 
+    void processFeature(OGRFeature *poFeature);
     void processPolygon(OGRFeature *poFeature, OGRPolygon* poGeometry, const string& area_type );
 
 private:
+    // The features, as the main thread reads them
+    tgBoundedQueue<OGRFeature *>& workQueue;
+
     // The transformation for each geometry object
     OGRCoordinateTransformation *poCT;
 
@@ -128,87 +134,83 @@ void Decoder::processPolygon(OGRFeature *poFeature, OGRPolygon* poGeometry, cons
 
 void Decoder::run()
 {
-    // as long as we have geometry to parse, do so
-    while (!global_workQueue.empty()) {
-        OGRFeature *poFeature = global_workQueue.pop();
-        // SG_LOG( SG_GENERAL, SG_INFO, " chopping feature with thread " << current() << " remaining features is " << global_workQueue.size() );
-
-        if ( poFeature ) {
-            OGRGeometry *poGeometry = poFeature->GetGeometryRef();
-
-            if (poGeometry==NULL) {
-                SG_LOG( SG_GENERAL, SG_INFO, "Found feature without geometry!" );
-                if (!continue_on_errors) {
-                    SG_LOG( SG_GENERAL, SG_ALERT, "Aborting!" );
-                    exit( 1 );
-                } else {
-                    continue;
-                }
-            }
-
-            OGRwkbGeometryType geoType=wkbFlatten(poGeometry->getGeometryType());
-            if (geoType!=wkbPolygon && geoType!=wkbMultiPolygon) {
-                SG_LOG( SG_GENERAL, SG_INFO, "Unknown feature" );
-                 OGRFeature::DestroyFeature( poFeature );
+    OGRFeature *poFeature;
 
-                continue;
-            }
+    // until the main thread has read the whole layer, and we've got the rest
+    while ( workQueue.pop( poFeature ) ) {
+        processFeature( poFeature );
+        OGRFeature::DestroyFeature( poFeature );
+    }
 
-            string area_type_name=area_type;
-            if (area_type_field!=-1) {
-                area_type_name=poFeature->GetFieldAsString(area_type_field);
-            }
+    SG_LOG( SG_GENERAL, SG_INFO, " thread " << current() << " complete " );
+}
 
-            if ( is_ocean_area(area_type_name) ) {
-                // interior of polygon is ocean, holes are islands
+void Decoder::processFeature(OGRFeature *poFeature)
+{
+    OGRGeometry *poGeometry = poFeature->GetGeometryRef();
 
-                SG_LOG(  SG_GENERAL, SG_ALERT, "Ocean area ... SKIPPING!" );
-                OGRFeature::DestroyFeature( poFeature );
-                // Ocean data now comes from GSHHS so we want to ignore
-                // all other ocean data
-                continue;
-            } else if ( is_void_area(area_type_name) ) {
-                // interior is ????
+    if (poGeometry==NULL) {
+        SG_LOG( SG_GENERAL, SG_INFO, "Found feature without geometry!" );
+        if (!continue_on_errors) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "Aborting!" );
+            exit( 1 );
+        } else {
+            return;
+        }
+    }
 
-                // skip for now
-                SG_LOG(  SG_GENERAL, SG_ALERT, "Void area ... SKIPPING!" );
-                OGRFeature::DestroyFeature( poFeature );
-                continue;
-            } else if ( is_null_area(area_type_name) ) {
-                // interior is ????
+    OGRwkbGeometryType geoType=wkbFlatten(poGeometry->getGeometryType());
+    if (geoType!=wkbPolygon && geoType!=wkbMultiPolygon) {
+        SG_LOG( SG_GENERAL, SG_INFO, "Unknown feature" );
+        return;
+    }
 
-                // skip for now
-                SG_LOG(  SG_GENERAL, SG_ALERT, "Null area ... SKIPPING!" );
-                OGRFeature::DestroyFeature( poFeature );
-                continue;
-            }
+    string area_type_name=area_type;
+    if (area_type_field!=-1) {
+        area_type_name=poFeature->GetFieldAsString(area_type_field);
+    }
 
-            poGeometry->transform( poCT );
+    if ( is_ocean_area(area_type_name) ) {
+        // interior of polygon is ocean, holes are islands
+
+        SG_LOG(  SG_GENERAL, SG_ALERT, "Ocean area ... SKIPPING!" );
+        // Ocean data now comes from GSHHS so we want to ignore
+        // all other ocean data
+        return;
+    } else if ( is_void_area(area_type_name) ) {
+        // interior is ????
+
+        // skip for now
+        SG_LOG(  SG_GENERAL, SG_ALERT, "Void area ... SKIPPING!" );
+        return;
+    } else if ( is_null_area(area_type_name) ) {
+        // interior is ????
+
+        // skip for now
+        SG_LOG(  SG_GENERAL, SG_ALERT, "Null area ... SKIPPING!" );
+        return;
+    }
 
-            switch (geoType) {
-            case wkbPolygon: {
-                SG_LOG( SG_GENERAL, SG_DEBUG, "Polygon feature" );
-                processPolygon(poFeature, (OGRPolygon*)poGeometry, area_type_name);
-                break;
-            }
-            case wkbMultiPolygon: {
-                SG_LOG( SG_GENERAL, SG_DEBUG, "MultiPolygon feature" );
-                OGRMultiPolygon* multipoly=(OGRMultiPolygon*)poGeometry;
-                for (int i=0;i<multipoly->getNumGeometries();i++) {
-                    processPolygon(poFeature, (OGRPolygon*)(multipoly->getGeometryRef(i)), area_type_name);
-                }
-                break;
-            }
-            default:
-                /* Ignore unhandled objects */
-                break;
-            }
+    poGeometry->transform( poCT );
 
-            OGRFeature::DestroyFeature( poFeature );
+    switch (geoType) {
+    case wkbPolygon: {
+        SG_LOG( SG_GENERAL, SG_DEBUG, "Polygon feature" );
+        processPolygon(poFeature, (OGRPolygon*)poGeometry, area_type_name);
+        break;
+    }
+    case wkbMultiPolygon: {
+        SG_LOG( SG_GENERAL, SG_DEBUG, "MultiPolygon feature" );
+        OGRMultiPolygon* multipoly=(OGRMultiPolygon*)poGeometry;
+        for (int i=0;i<multipoly->getNumGeometries();i++) {
+            processPolygon(poFeature, (OGRPolygon*)(multipoly->getGeometryRef(i)), area_type_name);
         }
+        break;
+    }
+    default:
+        /* Ignore unhandled objects */
+        break;
     }
-
-    SG_LOG( SG_GENERAL, SG_INFO, " thread " << current() << " complete " );
 }
 
 #else
@@ -270,23 +272,10 @@ void processLayer(OGRLayer* poLayer, tgChopper& results, SGMutex& l )
     OGRCoordinateTransformation *poCT = OGRCreateCoordinateTransformation(oSourceSRS, &oTargetSRS);
 
     /* setup attribute and spatial queries */
-    if (use_spatial_query) {
-        double trans_min_x,trans_min_y,trans_max_x,trans_max_y;
-        /* do a simple reprojection of the source SRS */
-        OGRCoordinateTransformation *poCTinverse;
-
-        poCTinverse = OGRCreateCoordinateTransformation(&oTargetSRS, oSourceSRS);
-
-        trans_min_x=spat_min_x;
-        trans_min_y=spat_min_y;
-        trans_max_x=spat_max_x;
-        trans_max_y=spat_max_y;
-
-        poCTinverse->Transform(1,&trans_min_x,&trans_min_y);
-        poCTinverse->Transform(1,&trans_max_x,&trans_max_y);
+    tgFeatureReader reader( poLayer );
 
-        poLayer->SetSpatialFilterRect(trans_min_x, trans_min_y,
-                                      trans_max_x, trans_max_y);
+    if (use_spatial_query) {
+        reader.setExtent(spat_min_x, spat_min_y, spat_max_x, spat_max_y);
     }
 
     if (use_attribute_query) {
@@ -296,34 +285,44 @@ void processLayer(OGRLayer* poLayer, tgChopper& results, SGMutex& l )
         }
     }
 
+    reader.setBatchSize(batch_size);
+    reader.setStartRecord(start_record);
+
     OGRFeature *poFeature;
-    poLayer->SetNextByIndex(start_record);
+    SGTimeStamp start;
+    start.stamp();
 
 #if SUPPORT_MULTITHREADING    
 
-    // Generate the work queue for this layer
-    while ( ( poFeature = poLayer->GetNextFeature()) != NULL )
-    {
-        global_workQueue.push( poFeature );
-    }
+    // Start the decoders first - they transform and chop the features
+    // while we read the next ones.  With a queue size, we stop reading
+    // when that many features are waiting.
+    tgBoundedQueue<OGRFeature *> workQueue( queue_size );
 
-    // Now process the workqueue with threads
-    // this just generates all the tgPolygons
     std::vector<Decoder *> decoders;
     for (int i=0; i<num_threads; i++) {
-        Decoder* decoder = new Decoder( poCT, area_type_field, results, l );
+        Decoder* decoder = new Decoder( workQueue, poCT, area_type_field, results, l );
         decoder->start();
         decoders.push_back( decoder );
     }
 
+    while ( ( poFeature = reader.next()) != NULL )
+    {
+        workQueue.push( poFeature );
+    }
+    workQueue.close();
+
     // Then wait until they are finished
     for (unsigned int i=0; i<decoders.size(); i++) {
         decoders[i]->join();
+        delete decoders[i];
     }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "Layer " << layername << ": queued at most " << workQueue.peak() << " of " << reader.getNumRead() << " features" );
 #else
 
     // process each feature in the main thread
-    while ( ( poFeature = poLayer->GetNextFeature()) != NULL )
+    while ( ( poFeature = reader.next()) != NULL )
     {
         OGRGeometry *poGeometry = poFeature->GetGeometryRef();
 
@@ -392,6 +391,10 @@ void processLayer(OGRLayer* poLayer, tgChopper& results, SGMutex& l )
     }
 #endif
 
+    double secs = start.elapsedMSec() / 1000.0;
+    SG_LOG( SG_GENERAL, SG_ALERT, "Layer " << layername << ": " << reader.getNumRead() << " features in " << secs << " s - " <<
+            ( secs > 0.0 ? reader.getNumRead() / secs : 0.0 ) << " features/s, peak RSS " << tgProfile::peakRssKb() / 1024 << " MB" );
+
     OCTDestroyCoordinateTransformation ( poCT );
 }
 
@@ -430,6 +433,15 @@ void usage(char* progname) {
     SG_LOG( SG_GENERAL, SG_ALERT, "        Enable multithreading with user specified number of threads" );
     SG_LOG( SG_GENERAL, SG_ALERT, "--all-threads" );
     SG_LOG( SG_GENERAL, SG_ALERT, "        Enable multithreading with all available cpu cores" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "--queue-size features" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        Read at most this many features ahead of the decoders (default 1024)" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        0 reads the whole layer ahead, as fast as it comes" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "--batch-size degrees" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        Read the --spat extents, or the layer, in square batches of this size" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        so the chopper works on a few buckets at a time" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "--booleans hybrid|exact|verify" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        Clip with clipper, falling back to exact CGAL when it can't be trusted (default)," );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        always exact, or both, logging where they differ" );
     SG_LOG( SG_GENERAL, SG_ALERT, "" );
     SG_LOG( SG_GENERAL, SG_ALERT, "<work_dir>" );
     SG_LOG( SG_GENERAL, SG_ALERT, "        Directory to put the polygon files in" );
@@ -481,6 +493,20 @@ int main( int argc, char **argv ) {
             num_threads=atoi(argv[2]);
             argv+=2;
             argc-=2;
+        } else if (!strcmp(argv[1],"--queue-size")) {
+            if (argc<3) {
+                usage(progname);
+            }
+            queue_size=atoi(argv[2]);
+            argv+=2;
+            argc-=2;
+        } else if (!strcmp(argv[1],"--batch-size")) {
+            if (argc<3) {
+                usage(progname);
+            }
+            batch_size=atof(argv[2]);
+            argv+=2;
+            argc-=2;
         } else if (!strcmp(argv[1],"--start-record")) {
             if (argc<3) {
                 usage(progname);
@@ -507,6 +533,21 @@ int main( int argc, char **argv ) {
             spat_max_y=atof(argv[5]);
             argv+=5;
             argc-=5;
+        } else if (!strcmp(argv[1],"--booleans")) {
+            if (argc<3) {
+                usage(progname);
+            }
+            if (!strcmp(argv[2],"hybrid")) {
+                tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_HYBRID );
+            } else if (!strcmp(argv[2],"exact")) {
+                tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_EXACT );
+            } else if (!strcmp(argv[2],"verify")) {
+                tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_VERIFY );
+            } else {
+                usage(progname);
+            }
+            argv+=2;
+            argc-=2;
         } else if (!strcmp(argv[1],"--help")) {
             usage(progname);
         } else {
@@ -566,5 +607,7 @@ int main( int argc, char **argv ) {
 
     GDALClose(poDS);
 
+    tgPolygonSet::reportBooleans();
+
     return 0;
 }
@@ -0,0 +1,117 @@
+// fitconvert.cxx -- convert .fit.gz fitted node text to binary .fit.bin.gz
+//
+// tgArray prefers <index>.fit.bin.gz over <index>.fit.gz when both exist.
+// The binary file holds the nodes as doubles, and is read without parsing
+// any text.  The nodes of the text are converted exactly as tgArray would
+// read them, and every converted file is read back and compared with the
+// original.  With --remove, the text is deleted once it has been.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <simgear/debug/logstream.hxx>
+
+#include <terragear/tg_array.hxx>
+
+static bool convert( const std::string& file, bool remove_text )
+{
+    // <dir>/<index>.fit.gz -> <dir>/<index>
+    std::string base = file;
+    std::string::size_type pos = base.rfind( ".fit.gz" );
+    if ( pos != std::string::npos && pos + 7 == base.size() ) {
+        base.erase( pos );
+    } else {
+        SG_LOG( SG_GENERAL, SG_ALERT, "fitconvert: " << file << " isn't a .fit.gz file" );
+        return false;
+    }
+
+    std::vector<SGGeod> src;
+    if ( !tgArray::read_fitted( file, src ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "fitconvert: can't read " << file );
+        return false;
+    }
+
+    if ( !tgArray::write_fitted( base, src ) ) {
+        return false;
+    }
+
+    std::vector<SGGeod> dst;
+    if ( !tgArray::read_fitted( base + ".fit.bin.gz", dst ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "fitconvert: can't read " << base << ".fit.bin.gz" );
+        return false;
+    }
+
+    int diffs = ( dst.size() != src.size() );
+    for ( unsigned int i = 0; i < src.size() && !diffs; i++ ) {
+        if ( dst[i].getLongitudeDeg() != src[i].getLongitudeDeg() ||
+             dst[i].getLatitudeDeg()  != src[i].getLatitudeDeg() ||
+             dst[i].getElevationM()   != src[i].getElevationM() ) {
+            diffs++;
+        }
+    }
+
+    if ( diffs ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "fitconvert: " << base << ".fit.bin.gz differs from " << file );
+        return false;
+    }
+
+    SG_LOG( SG_GENERAL, SG_INFO, "fitconvert: " << file << " -> " << base << ".fit.bin.gz, " << src.size() << " nodes" );
+
+    if ( remove_text && ::remove( file.c_str() ) != 0 ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "fitconvert: can't remove " << file );
+        return false;
+    }
+
+    return true;
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<std::string> files;
+    bool                     remove_text = false;
+    int                      errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_INFO );
+
+    for ( int i=1; i<argc; i++ ) {
+        std::string arg = argv[i];
+
+        if ( arg == "--remove" ) {
+            remove_text = true;
+        } else if ( arg.find("--") == 0 ) {
+            files.clear();
+            break;
+        } else {
+            files.push_back( arg );
+        }
+    }
+
+    if ( files.empty() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "Usage: " << argv[0] << " [--remove] <file.fit.gz> ..." );
+        return 1;
+    }
+
+    for ( unsigned int i=0; i<files.size(); i++ ) {
+        if ( !convert( files[i], remove_text ) ) {
+            errors++;
+        }
+    }
+
+    return errors ? 1 : 0;
+}
@@ -119,6 +119,7 @@ Terra::real error_threshold=40.0;
 unsigned int min_points=50;
 unsigned int point_limit=1000;
 bool force=false;
+bool write_text=false;
 unsigned int num_threads = 1;
 
 inline int goal_not_met(Terra::GreedySubdivision* mesh)
@@ -163,11 +164,15 @@ bool endswith(const std::string& s1, const std::string& suffix) {
 void fit_file(const SGPath& path) {
     SG_LOG(SG_GENERAL, SG_INFO,"Working on file '" << path << "'");
 
-    SGPath outPath(path.dir());
-    outPath.append(path.file_base() + ".fit.gz");
+    std::string outBase = path.dir() + "/" + path.file_base();
+    SGPath outPath(outBase + ".fit.bin.gz");
+    SGPath textPath(outBase + ".fit.gz");
     if ( outPath.exists() ) {
         unlink( outPath.c_str() );
     }
+    if ( textPath.exists() ) {
+        unlink( textPath.c_str() );
+    }
 
     SGBucket bucket; // dummy bucket
     tgArray inarray(path.dir() + "/" + path.file_base());
@@ -180,13 +185,8 @@ void fit_file(const SGPath& path) {
 
     greedy_insertion(&mesh);
 
-    gzFile fp;
-    if ( (fp = gzopen( outPath.c_str(), "wb9" )) == NULL ) {
-        SG_LOG(SG_GENERAL, SG_ALERT, "ERROR: opening " << outPath << " for writing!");
-        return;
-    }
-
-    gzprintf(fp,"%d\n",mesh.pointCount());
+    std::vector<SGGeod> points;
+    points.reserve(mesh.pointCount());
 
     for (int x=0;x<DEM.width;x++) {
         for (int y=0;y<DEM.height;y++) {
@@ -196,17 +196,37 @@ void fit_file(const SGPath& path) {
             vx=(inarray.get_originx()+x*inarray.get_col_step())/3600.0;
             vy=(inarray.get_originy()+y*inarray.get_row_step())/3600.0;
             vz=DEM.eval(x,y);
-            gzprintf(fp,"%+03.8f %+02.8f %0.2f\n",vx,vy,vz);
+            points.push_back(SGGeod::fromDegM(vx,vy,vz));
         }
     }
 
+    if ( !tgArray::write_fitted(outBase, points) ) {
+        return;
+    }
+
+    if (!write_text)
+        return;
+
+    gzFile fp;
+    if ( (fp = gzopen( textPath.c_str(), "wb9" )) == NULL ) {
+        SG_LOG(SG_GENERAL, SG_ALERT, "ERROR: opening " << textPath << " for writing!");
+        return;
+    }
+
+    gzprintf(fp,"%d\n",(int)points.size());
+
+    for (unsigned int i=0;i<points.size();i++) {
+        gzprintf(fp,"%+03.8f %+02.8f %0.2f\n",
+                 points[i].getLongitudeDeg(),points[i].getLatitudeDeg(),points[i].getElevationM());
+    }
+
     gzclose(fp);
 }
 
 void queue_fit_file(const SGPath& path)
 {
     SGPath outPath(path.dir());
-    outPath.append(path.file_base() + ".fit.gz");
+    outPath.append(path.file_base() + ".fit.bin.gz");
 
     if (!force) {
         if (outPath.exists() && (path.modTime() < outPath.modTime())) {
@@ -262,6 +282,7 @@ void usage(char* progname, const std::string& msg) {
     SG_LOG(SG_GENERAL,SG_INFO, "\t -x | --maxnodes 1000");
     SG_LOG(SG_GENERAL,SG_INFO, "\t -e | --maxerror 40");
     SG_LOG(SG_GENERAL,SG_INFO, "\t -f | --force");
+    SG_LOG(SG_GENERAL,SG_INFO, "\t -t | --text");
     SG_LOG(SG_GENERAL,SG_INFO, "\t -j | --threads <number>");
     SG_LOG(SG_GENERAL,SG_INFO, "\t -v | --version");
     SG_LOG(SG_GENERAL,SG_INFO, "");
@@ -276,15 +297,19 @@ void usage(char* progname, const std::string& msg) {
     SG_LOG(SG_GENERAL,SG_INFO, "The input file must be a .arr.gz file such as that produced");
     SG_LOG(SG_GENERAL,SG_INFO, "by demchop or hgtchop utils.");
     SG_LOG(SG_GENERAL,SG_INFO, "");
-    SG_LOG(SG_GENERAL,SG_INFO, "Force will overwrite existing .arr.gz files, even if the input is older");
+    SG_LOG(SG_GENERAL,SG_INFO, "Force will overwrite existing .fit.bin.gz files, even if the input is older");
     SG_LOG(SG_GENERAL,SG_INFO, "");
     SG_LOG(SG_GENERAL,SG_INFO, "**** NOTE ****:");
     SG_LOG(SG_GENERAL,SG_INFO, "If a directory is input all .arr.gz files in directory will be");
     SG_LOG(SG_GENERAL,SG_INFO, "processed recursively.");
     SG_LOG(SG_GENERAL,SG_INFO, "");
-    SG_LOG(SG_GENERAL,SG_INFO, "The output file(s) is/are called .fit.gz and is simply a list of");
+    SG_LOG(SG_GENERAL,SG_INFO, "The output file(s) is/are called .fit.bin.gz and is simply a list of");
     SG_LOG(SG_GENERAL,SG_INFO, "from the resulting fitted surface nodes.  The user of the");
-    SG_LOG(SG_GENERAL,SG_INFO, ".fit.gz file will need to retriangulate the surface.");
+    SG_LOG(SG_GENERAL,SG_INFO, ".fit.bin.gz file will need to retriangulate the surface.");
+    SG_LOG(SG_GENERAL,SG_INFO, "");
+    SG_LOG(SG_GENERAL,SG_INFO, "Text will also write the nodes as text, to .fit.gz, for older tools.");
+    SG_LOG(SG_GENERAL,SG_INFO, "The text is rounded to 8 decimals, and slower to read.  Use fitconvert");
+    SG_LOG(SG_GENERAL,SG_INFO, "to convert existing .fit.gz files.");
 }
 
 struct option options[]={
@@ -293,6 +318,7 @@ struct option options[]={
     {"maxnodes",required_argument,NULL,'x'},
     {"maxerror",required_argument,NULL,'e'},
     {"force",no_argument,NULL,'f'},
+    {"text",no_argument,NULL,'t'},
     {"version",no_argument,NULL,'v'},
     {"threads",required_argument,NULL,'j'},
     {NULL,0,NULL,0}
@@ -302,7 +328,7 @@ int main(int argc, char** argv) {
     sglog().setLogLevels( SG_ALL, SG_INFO );
     int option;
 
-    while ((option=getopt_long(argc,argv,"hm:x:e:fvj:",options,NULL))!=-1) {
+    while ((option=getopt_long(argc,argv,"hm:x:e:ftvj:",options,NULL))!=-1) {
         switch (option) {
             case 'h':
                 usage(argv[0],"");
@@ -319,6 +345,9 @@ int main(int argc, char** argv) {
             case 'f':
                 force=true;
                 break;
+            case 't':
+                write_text=true;
+                break;
             case 'v':
                 SG_LOG(SG_GENERAL,SG_INFO,argv[0] << " version " << getTGVersion());
                 exit(0);
@@ -37,6 +37,7 @@
 
 #include <Include/version.h>
 
+#include <terragear/tg_debug_shapefile.hxx>
 #include <terragear/vector_intersections/tg_intersection_generator.hxx>
 
 #include <terragear/polygon_set/tg_polygon_set.hxx>
@@ -285,6 +286,8 @@ void usage(char* progname) {
     SG_LOG( SG_GENERAL, SG_ALERT, "        spatial query extents" );
     SG_LOG( SG_GENERAL, SG_ALERT, "--texture-lines" );
     SG_LOG( SG_GENERAL, SG_ALERT, "        Enable textured lines" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "--debug-level=off|buffered|full" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        Intersection debug shapefiles: none, written in the background, or as they come" );
     SG_LOG( SG_GENERAL, SG_ALERT, "" );
     SG_LOG( SG_GENERAL, SG_ALERT, "<work_dir>" );
     SG_LOG( SG_GENERAL, SG_ALERT, "        Directory to put the polygon files in" );
@@ -347,6 +350,7 @@ int main( int argc, char **argv ) {
     string work_dir = ".";
     string config = ".";
     int num_threads = 1;
+    tgDebugShapefile::level_t debug_level = tgDebugShapefile::DEBUG_OFF;
     
     double minx =  std::numeric_limits<double>::infinity();
     double miny =  std::numeric_limits<double>::infinity();
@@ -371,6 +375,10 @@ int main( int argc, char **argv ) {
             num_threads = atoi( arg.substr(10).c_str() );
         } else if (arg.find("--threads") == 0) {
             num_threads = boost::thread::hardware_concurrency();
+        } else if (arg.find("--debug-level=") == 0) {
+            if ( !tgDebugShapefile::parseLevel( arg.substr(14), debug_level ) ) {
+                usage(progname);
+            }
         }
     }
 
@@ -443,6 +451,8 @@ int main( int argc, char **argv ) {
         sprintf( debugdir, "./vectordecode/%s", bucket.gen_index_str().c_str() );
         
         tgIntersectionGenerator* pig = new tgIntersectionGenerator( debugdir, 0, 1, GetTextureInfo );
+        pig->SetNumThreads( num_threads );
+        pig->SetDebugLevel( debug_level );
         tgChopper results( work_dir, bucket.gen_index() );
 
         GDALDataset *poDS;        
@@ -524,6 +534,11 @@ int main( int argc, char **argv ) {
         
         delete pig;
     }
+
+    // let the debug writer finish
+    if ( debug_level == tgDebugShapefile::DEBUG_BUFFERED ) {
+        tgDebugShapefile::sync();
+    }
     
     return 0;
 }
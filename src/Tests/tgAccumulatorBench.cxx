@@ -0,0 +1,163 @@
+// tgAccumulatorBench.cxx -- benchmark tgAccumulator clipping
+//
+// Clips a tile's worth of random, overlapping landclass polygons in
+// priority order, the way tgMeshArrangement::clipPolys does - once with
+// the list based accumulator tgAccumulator used to be, and once with the
+// R-tree backed one.  The clipped areas must match exactly.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/polygon_set/tg_polygon_set.hxx>
+#include <terragear/polygon_set/tg_polygon_accumulator.hxx>
+
+#include "tg_test_util.hxx"
+
+// the accumulator as it was - a list of polygons_with_holes, scanned
+// linearly, and joined again for every subject
+class listAccumulator
+{
+public:
+    void Diff_and_Add_cgal( tgPolygonSet& subject ) {
+        cgalPoly_PolygonSet subPs = subject.getPs();
+        CGAL::Bbox_2 bbox = subject.getBoundingBox();
+
+        std::list<cgalPoly_PolygonWithHoles> accum;
+        std::list<tgAccumEntry>::const_iterator it;
+        for ( it=entries.begin(); it!=entries.end(); it++ ) {
+            if ( CGAL::do_overlap( bbox, it->bbox ) ) {
+                accum.push_back( *it->ps.polygons_with_holes_begin() );
+            }
+        }
+
+        cgalPoly_PolygonSet difPs;
+        difPs.join( accum.begin(), accum.end() );
+
+        if ( difPs.number_of_polygons_with_holes() ) {
+            subPs.difference( difPs );
+            subject.setPs( subPs );
+        }
+
+        std::list<cgalPoly_PolygonWithHoles> pwh_list;
+        subPs.polygons_with_holes( std::back_inserter(pwh_list) );
+        for ( std::list<cgalPoly_PolygonWithHoles>::const_iterator pit = pwh_list.begin(); pit != pwh_list.end(); ++pit ) {
+            tgAccumEntry entry;
+            entry.ps   = cgalPoly_PolygonSet( *pit );
+            entry.bbox = pit->outer_boundary().bbox();
+            entries.push_back( entry );
+        }
+    }
+
+private:
+    std::list<tgAccumEntry> entries;
+};
+
+// random convex polygons of very different sizes, like landclass data
+static void generatePolys( unsigned int count, unsigned int seed, std::vector<tgPolygonSet>& polys )
+{
+    srand( seed );
+
+    for ( unsigned int i=0; i<count; i++ ) {
+        double cx = 10.0 + 0.25  * rand() / RAND_MAX;
+        double cy = 45.0 + 0.125 * rand() / RAND_MAX;
+        double r  = 0.0005 + 0.004 * pow( (double)rand() / RAND_MAX, 3.0 );
+        int    n  = 3 + rand() % 6;
+
+        cgalPoly_Polygon poly;
+        for ( int j=0; j<n; j++ ) {
+            double a = 2.0 * M_PI * j / n;
+            poly.push_back( cgalPoly_Point( cx + r * cos( a ), cy + r * sin( a ) ) );
+        }
+
+        polys.push_back( tgPolygonSet( poly, tgPolygonSetMeta( tgPolygonSetMeta::META_TEXTURED, "Default" ) ) );
+    }
+}
+
+static cgalPoly_FT area( const cgalPoly_PolygonSet& ps )
+{
+    std::list<cgalPoly_PolygonWithHoles> pwh_list;
+    cgalPoly_FT total = 0;
+
+    ps.polygons_with_holes( std::back_inserter(pwh_list) );
+    for ( std::list<cgalPoly_PolygonWithHoles>::const_iterator it = pwh_list.begin(); it != pwh_list.end(); ++it ) {
+        total += it->outer_boundary().area();
+        for ( cgalPoly_PolygonWithHoles::Hole_const_iterator hit = it->holes_begin(); hit != it->holes_end(); ++hit ) {
+            total += hit->area();
+        }
+    }
+
+    return total;
+}
+
+template <typename A>
+static int64_t clip( A& accum, std::vector<tgPolygonSet>& polys )
+{
+    SGTimeStamp t;
+    t.stamp();
+
+    for ( unsigned int i=0; i<polys.size(); i++ ) {
+        accum.Diff_and_Add_cgal( polys[i] );
+    }
+
+    return t.elapsedMSec();
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int count = 2000;
+    bool         reference = true;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "polys", count );
+    options.addSwitch( "no-reference", reference, false );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    std::vector<tgPolygonSet> rtreePolys;
+    generatePolys( count, 1, rtreePolys );
+    std::vector<tgPolygonSet> listPolys( rtreePolys );
+
+    tgAccumulator rtreeAccum;
+    int64_t rtreeMs = clip( rtreeAccum, rtreePolys );
+    SG_LOG( SG_GENERAL, SG_ALERT, count << " polys: R-tree accumulator " << rtreeMs << " ms, " << rtreeAccum.getNumEntries() << " cached unions" );
+
+    if ( reference ) {
+        listAccumulator listAccum;
+        int64_t listMs = clip( listAccum, listPolys );
+        SG_LOG( SG_GENERAL, SG_ALERT, count << " polys: list accumulator " << listMs << " ms" );
+
+        for ( unsigned int i=0; i<count; i++ ) {
+            if ( area( rtreePolys[i].getPs() ) != area( listPolys[i].getPs() ) ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "poly " << i << " clipped differently" );
+                errors++;
+            }
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
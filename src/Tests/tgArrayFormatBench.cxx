@@ -0,0 +1,242 @@
+// tgArrayFormatBench.cxx -- cost of opening and querying an elevation
+//                           array in each format
+//
+// Writes a synthetic 1 arc second bucket array as .arr.gz, and converts
+// it to a plain and to a block compressed .arr.raw.  Then, for every
+// format, opens and parses the array and runs 1000 random
+// altitude_from_grid() queries, --runs times, and reports the average
+// time of both, and the size of the file.  All formats must answer every
+// query the same - and so must the .arr.gz with a damaged block
+// compressed .arr.raw beside it, which open() has to pass over.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/lowlevel.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_array.hxx>
+
+#include "tg_test_util.hxx"
+
+#define NUM_QUERIES     (1000)
+
+static long fileSize( const std::string& file )
+{
+    struct stat st;
+
+    return stat( file.c_str(), &st ) == 0 ? st.st_size : 0;
+}
+
+// hills, with a few voids
+static bool writeArray( const std::string& file, const SGBucket& b )
+{
+    int min_x  = (int)( ( b.get_center_lon() - 0.5 * b.get_width() ) * 3600.0 );
+    int min_y  = (int)( ( b.get_center_lat() - 0.5 * b.get_height() ) * 3600.0 );
+    int span_x = (int)( b.get_width() * 3600.0 ) + 1;
+    int span_y = (int)( b.get_height() * 3600.0 ) + 1;
+
+    gzFile fp = gzopen( file.c_str(), "wb9" );
+    if ( !fp ) {
+        return false;
+    }
+
+    sgWriteLong( fp, 0x54474152 );
+    sgWriteInt( fp, min_x ); sgWriteInt( fp, min_y );
+    sgWriteInt( fp, span_x ); sgWriteInt( fp, 1 );
+    sgWriteInt( fp, span_y ); sgWriteInt( fp, 1 );
+
+    std::vector<int16_t> samples( span_x * span_y );
+    for ( int x = 0; x < span_x; x++ ) {
+        for ( int y = 0; y < span_y; y++ ) {
+            bool isVoid = ( x % 97 == 13 && y % 89 == 7 );
+
+            samples[ x * span_y + y ] = isVoid ? -32768 : (int16_t)( 800.0 + 300.0 * sin( x * 0.01 ) * cos( y * 0.013 ) + ( x * 3 + y ) % 11 );
+        }
+    }
+    sgWriteShort( fp, samples.size(), &samples[0] );
+
+    return gzclose( fp ) == Z_OK;
+}
+
+// a copy of a block compressed .arr.raw with one more block than its
+// grid holds, or with two block offsets swapped
+#define RAW_NUM_BLOCKS_POS  (36)
+#define RAW_OFFSETS_POS     (40)
+
+static bool writeDamaged( const std::string& src, const std::string& dst, bool badCount )
+{
+    std::ifstream in( src.c_str(), std::ios::binary );
+    std::vector<char> data( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+
+    if ( data.size() < RAW_OFFSETS_POS + 3 * sizeof(uint64_t) ) {
+        return false;
+    }
+
+    if ( badCount ) {
+        uint32_t num_blocks;
+        memcpy( &num_blocks, &data[RAW_NUM_BLOCKS_POS], sizeof(num_blocks) );
+        num_blocks++;
+        memcpy( &data[RAW_NUM_BLOCKS_POS], &num_blocks, sizeof(num_blocks) );
+    } else {
+        std::swap_ranges( &data[RAW_OFFSETS_POS + sizeof(uint64_t)], &data[RAW_OFFSETS_POS + 2 * sizeof(uint64_t)],
+                          &data[RAW_OFFSETS_POS + 2 * sizeof(uint64_t)] );
+    }
+
+    std::ofstream out( dst.c_str(), std::ios::binary );
+    out.write( &data[0], data.size() );
+
+    return (bool)out;
+}
+
+static int run( const std::string& base, const SGBucket& b, const char* name, const std::string& file,
+                unsigned int runs, const std::vector<double>& lons, const std::vector<double>& lats, std::vector<double>& elevs )
+{
+    double openMs = 0.0, queryMs = 0.0;
+    int    errors = 0;
+
+    for ( unsigned int r=0; r<runs; r++ ) {
+        SGTimeStamp t;
+        t.stamp();
+
+        tgArray array;
+        if ( !array.open( base ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": can't open " << base );
+            return 1;
+        }
+        array.parse( b );
+
+        openMs += t.elapsedUSec() / 1000.0;
+        t.stamp();
+
+        std::vector<double> results( lons.size() );
+        for ( unsigned int i=0; i<lons.size(); i++ ) {
+            results[i] = array.altitude_from_grid( lons[i], lats[i] );
+        }
+
+        queryMs += t.elapsedUSec() / 1000.0;
+
+        if ( elevs.empty() ) {
+            elevs = results;
+        } else if ( r == 0 ) {
+            for ( unsigned int i=0; i<results.size(); i++ ) {
+                if ( results[i] != elevs[i] ) {
+                    SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": query " << i << " gave " << results[i] << ", expected " << elevs[i] );
+                    errors++;
+                }
+            }
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << " open + parse " << openMs / runs << " ms, " <<
+                                  lons.size() << " queries " << queryMs / runs << " ms, " <<
+                                  fileSize( file ) / 1024 << " KB" );
+
+    return errors;
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int runs = 20;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "runs", runs );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    if ( !runs ) {
+        runs = 1;
+    }
+
+    simgear::Dir tmp = simgear::Dir::tempDir( "tgArrayFormatBench" );
+    SGBucket     b( SGGeod::fromDeg( 7.1, 46.1 ) );
+    std::string  gzBase    = tmp.path().str() + "/gz/" + b.gen_index_str();
+    std::string  rawBase   = tmp.path().str() + "/raw/" + b.gen_index_str();
+    std::string  blockBase = tmp.path().str() + "/block/" + b.gen_index_str();
+
+    SGPath( gzBase ).create_dir( 0755 );
+    SGPath( rawBase ).create_dir( 0755 );
+    SGPath( blockBase ).create_dir( 0755 );
+
+    if ( !writeArray( gzBase + ".arr.gz", b ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << gzBase << ".arr.gz" );
+        return 1;
+    }
+
+    {
+        tgArray src;
+        src.open( gzBase );
+        src.parse( b );
+
+        if ( !src.write_raw( rawBase, false ) || !src.write_raw( blockBase, true ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "can't write the raw arrays" );
+            return 1;
+        }
+    }
+
+    // queries in arc seconds, inside the array
+    std::vector<double> lons( NUM_QUERIES ), lats( NUM_QUERIES ), elevs;
+    double west  = ( b.get_center_lon() - 0.5 * b.get_width() ) * 3600.0;
+    double south = ( b.get_center_lat() - 0.5 * b.get_height() ) * 3600.0;
+
+    srand( 11 );
+    for ( unsigned int i=0; i<NUM_QUERIES; i++ ) {
+        lons[i] = west + b.get_width() * 3600.0 * rand() / ( RAND_MAX + 1.0 );
+        lats[i] = south + b.get_height() * 3600.0 * rand() / ( RAND_MAX + 1.0 );
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "bucket " << b.gen_index_str() << ", 1 arc second, average of " << runs << " runs:" );
+
+    errors += run( gzBase, b, ".arr.gz            ", gzBase + ".arr.gz", runs, lons, lats, elevs );
+    errors += run( rawBase, b, ".arr.raw           ", rawBase + ".arr.raw", runs, lons, lats, elevs );
+    errors += run( blockBase, b, ".arr.raw, 64 blocks", blockBase + ".arr.raw", runs, lons, lats, elevs );
+
+    // the damaged files must be ignored, and the .arr.gz read instead
+    if ( !writeDamaged( blockBase + ".arr.raw", gzBase + ".arr.raw", true ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << gzBase << ".arr.raw" );
+        errors++;
+    }
+    errors += run( gzBase, b, "bad block count    ", gzBase + ".arr.gz", 1, lons, lats, elevs );
+
+    if ( !writeDamaged( blockBase + ".arr.raw", gzBase + ".arr.raw", false ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << gzBase << ".arr.raw" );
+        errors++;
+    }
+    errors += run( gzBase, b, "bad block offsets  ", gzBase + ".arr.gz", 1, lons, lats, elevs );
+
+    tmp.remove( true );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
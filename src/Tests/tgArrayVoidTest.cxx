@@ -0,0 +1,507 @@
+// tgArrayVoidTest.cxx -- void filling and closest non-void lookups of
+//                        elevation arrays
+//
+// Writes small 3 arc second arrays with synthetic void patterns - single
+// samples, square holes, a lake, strips along the edges, a single valid
+// sample, no valid sample and no void at all - and checks against a brute
+// force search that
+//
+// - closest_nonvoid_elev() at every grid point returns the elevation of
+//   a closest non-void sample, and between grid points one no more than
+//   a cell diagonal further away than the closest
+// - remove_voids() leaves no void, and fills every void with the
+//   elevation of a closest non-void sample
+//
+// Then times remove_voids() and closest_nonvoid_elev() on a 1201 x 1201
+// array with --voids percent of it void, against the row and column fill
+// and the search of every sample they used to do.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <simgear/constants.h>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/lowlevel.hxx>
+#include <simgear/math/SGMath.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_array.hxx>
+
+#include "tg_test_util.hxx"
+
+#define VOID_ELEV       (-32768)
+#define STEP            (3)
+#define NUM_QUERIES     (1000)
+
+// a column major grid of samples, as in the array files
+struct testGrid
+{
+    testGrid( int w, int h ) : cols(w), rows(h), originx(7 * 3600), originy(46 * 3600), samples(w * h) {}
+
+    short& at( int x, int y )       { return samples[x * rows + y]; }
+    short  at( int x, int y ) const { return samples[x * rows + y]; }
+
+    int                 cols, rows;
+    int                 originx, originy;
+    std::vector<short>  samples;
+};
+
+static bool writeArray( const std::string& file, const testGrid& g )
+{
+    gzFile fp = gzopen( file.c_str(), "wb1" );
+    if ( !fp ) {
+        return false;
+    }
+
+    sgWriteLong( fp, 0x54474152 );
+    sgWriteInt( fp, g.originx ); sgWriteInt( fp, g.originy );
+    sgWriteInt( fp, g.cols ); sgWriteInt( fp, STEP );
+    sgWriteInt( fp, g.rows ); sgWriteInt( fp, STEP );
+    sgWriteShort( fp, g.samples.size(), &g.samples[0] );
+
+    return gzclose( fp ) == Z_OK;
+}
+
+static void hills( testGrid& g )
+{
+    for ( int x = 0; x < g.cols; x++ ) {
+        for ( int y = 0; y < g.rows; y++ ) {
+            g.at( x, y ) = (short)( 800.0 + 300.0 * sin( x * 0.07 ) * cos( y * 0.05 ) + ( x * 7 + y * 3 ) % 13 );
+        }
+    }
+}
+
+// ground distance in the arrays' metric - arc seconds, the columns
+// closing in at the middle of the array
+static double colScale( const testGrid& g )
+{
+    double center_lat = ( g.originy + 0.5 * ( g.rows - 1 ) * STEP ) / 3600.0;
+
+    return cos( center_lat * SGD_DEGREES_TO_RADIANS );
+}
+
+// smallest squared distance from lon, lat to a non-void sample
+static double bruteNearest( const testGrid& g, double lon, double lat )
+{
+    double wx = colScale( g );
+    double mindist = std::numeric_limits<double>::max();
+
+    for ( int x = 0; x < g.cols; x++ ) {
+        for ( int y = 0; y < g.rows; y++ ) {
+            if ( g.at( x, y ) <= -9000 ) {
+                continue;
+            }
+
+            double dx = wx * ( g.originx + x * STEP - lon );
+            double dy = g.originy + y * STEP - lat;
+
+            mindist = std::min( mindist, dx * dx + dy * dy );
+        }
+    }
+
+    return mindist;
+}
+
+// is elev that of a non-void sample no more than slack further from
+// lon, lat than the closest?
+static bool isNearest( const testGrid& g, double lon, double lat, double elev, double slack )
+{
+    double wx = colScale( g );
+    double mindist = sqrt( bruteNearest( g, lon, lat ) );
+
+    for ( int x = 0; x < g.cols; x++ ) {
+        for ( int y = 0; y < g.rows; y++ ) {
+            if ( g.at( x, y ) <= -9000 || g.at( x, y ) != elev ) {
+                continue;
+            }
+
+            double dx = wx * ( g.originx + x * STEP - lon );
+            double dy = g.originy + y * STEP - lat;
+
+            if ( sqrt( dx * dx + dy * dy ) <= mindist * ( 1.0 + 1e-9 ) + slack ) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static int check( const std::string& dir, const char* name, const testGrid& g )
+{
+    std::string base = dir + "/" + name;
+    SGBucket    b;
+    int         errors = 0;
+    bool        allVoid = true;
+
+    for ( unsigned int i = 0; i < g.samples.size(); i++ ) {
+        if ( g.samples[i] > -9000 ) {
+            allVoid = false;
+        }
+    }
+
+    if ( !writeArray( base + ".arr.gz", g ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": can't write " << base << ".arr.gz" );
+        return 1;
+    }
+
+    tgArray array( base );
+    array.parse( b );
+
+    // at the grid points
+    for ( int x = 0; x < g.cols; x++ ) {
+        for ( int y = 0; y < g.rows; y++ ) {
+            double lon  = g.originx + x * STEP;
+            double lat  = g.originy + y * STEP;
+            double elev = array.closest_nonvoid_elev( lon, lat );
+            bool   ok   = allVoid ? ( elev == 0.0 ) : isNearest( g, lon, lat, elev, 0.0 );
+
+            if ( !ok ) {
+                if ( errors < 10 ) {
+                    SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": closest to " << x << ", " << y << " gave " << elev );
+                }
+                errors++;
+            }
+        }
+    }
+
+    // in between
+    double diagonal = STEP * sqrt( 1.0 + colScale( g ) * colScale( g ) );
+
+    srand( 23 );
+    for ( int i = 0; i < 200; i++ ) {
+        double lon  = g.originx + ( g.cols - 1 ) * STEP * ( rand() / ( RAND_MAX + 1.0 ) );
+        double lat  = g.originy + ( g.rows - 1 ) * STEP * ( rand() / ( RAND_MAX + 1.0 ) );
+        double elev = array.closest_nonvoid_elev( lon, lat );
+        bool   ok   = allVoid ? ( elev == 0.0 ) : isNearest( g, lon, lat, elev, diagonal );
+
+        if ( !ok ) {
+            if ( errors < 10 ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": closest to " << lon << ", " << lat << " gave " << elev );
+            }
+            errors++;
+        }
+    }
+
+    array.remove_voids();
+
+    int filled = 0;
+    for ( int x = 0; x < g.cols; x++ ) {
+        for ( int y = 0; y < g.rows; y++ ) {
+            int  elev = array.get_array_elev( x, y );
+            bool ok;
+
+            if ( g.at( x, y ) > -9000 ) {
+                ok = ( elev == g.at( x, y ) );
+            } else {
+                ok = allVoid ? ( elev == 0 ) : isNearest( g, g.originx + x * STEP, g.originy + y * STEP, elev, 0.0 );
+                filled++;
+            }
+
+            if ( !ok ) {
+                if ( errors < 10 ) {
+                    SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": " << x << ", " << y << " filled with " << elev );
+                }
+                errors++;
+            }
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": " << filled << " voids, " << errors << " errors" );
+
+    return errors;
+}
+
+// what remove_voids() used to do - two passes of filling along columns,
+// then along rows, from the last non-void sample
+static void legacyFill( testGrid& g )
+{
+    bool have_void = true;
+
+    for ( int pass = 0; pass < 2 && have_void; ++pass ) {
+        for ( int i = 0; i < g.cols; i++ ) {
+            int last_elev = VOID_ELEV;
+            have_void = false;
+            for ( int j = 0; j < g.rows; j++ ) {
+                if ( g.at( i, j ) > -9000 ) {
+                    last_elev = g.at( i, j );
+                } else if ( last_elev > -9000 ) {
+                    g.at( i, j ) = last_elev;
+                } else {
+                    have_void = true;
+                }
+            }
+            last_elev = VOID_ELEV;
+            have_void = false;
+            for ( int j = g.rows - 1; j >= 0; j-- ) {
+                if ( g.at( i, j ) > -9000 ) {
+                    last_elev = g.at( i, j );
+                } else if ( last_elev > -9000 ) {
+                    g.at( i, j ) = last_elev;
+                } else {
+                    have_void = true;
+                }
+            }
+        }
+
+        for ( int j = 0; j < g.rows; j++ ) {
+            int last_elev = VOID_ELEV;
+            have_void = false;
+            for ( int i = 0; i < g.cols; i++ ) {
+                if ( g.at( i, j ) > -9999 ) {
+                    last_elev = g.at( i, j );
+                } else if ( last_elev > -9999 ) {
+                    g.at( i, j ) = last_elev;
+                } else {
+                    have_void = true;
+                }
+            }
+            last_elev = VOID_ELEV;
+            have_void = false;
+            for ( int i = g.cols - 1; i >= 0; i-- ) {
+                if ( g.at( i, j ) > -9999 ) {
+                    last_elev = g.at( i, j );
+                } else if ( last_elev > -9999 ) {
+                    g.at( i, j ) = last_elev;
+                } else {
+                    have_void = true;
+                }
+            }
+        }
+    }
+}
+
+// what closest_nonvoid_elev() used to do - search every sample
+static double legacyClosest( const testGrid& g, double lon, double lat )
+{
+    double mindist = 99999999999.9;
+    double minelev = -9999.0;
+    SGGeod p0 = SGGeod::fromDeg( lon, lat );
+
+    for ( int row = 0; row < g.rows; row++ ) {
+        for ( int col = 0; col < g.cols; col++ ) {
+            SGGeod p1 = SGGeod::fromDeg( g.originx + col * STEP, g.originy + row * STEP );
+            double dist = SGGeodesy::distanceM( p0, p1 );
+            double elev = g.at( col, row );
+            if ( dist < mindist && elev > -9000 ) {
+                mindist = dist;
+                minelev = elev;
+            }
+        }
+    }
+
+    return minelev > -9999.0 ? minelev : 0.0;
+}
+
+static int timing( const std::string& dir, int voidPercent, int legacyQueries )
+{
+    testGrid g( 1201, 1201 );
+    hills( g );
+
+    // lakes and mountains, until enough is void
+    long numVoid = 0;
+    long target  = (long)g.samples.size() * voidPercent / 100;
+
+    srand( 29 );
+    while ( numVoid < target ) {
+        int cx = rand() % g.cols;
+        int cy = rand() % g.rows;
+        int r  = 3 + rand() % 60;
+
+        for ( int x = std::max( 0, cx - r ); x <= std::min( g.cols - 1, cx + r ); x++ ) {
+            for ( int y = std::max( 0, cy - r ); y <= std::min( g.rows - 1, cy + r ); y++ ) {
+                if ( ( x - cx ) * ( x - cx ) + ( y - cy ) * ( y - cy ) <= r * r && g.at( x, y ) > -9000 ) {
+                    g.at( x, y ) = VOID_ELEV;
+                    numVoid++;
+                }
+            }
+        }
+    }
+
+    std::string base = dir + "/timing";
+    if ( !writeArray( base + ".arr.gz", g ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << base << ".arr.gz" );
+        return 1;
+    }
+
+    double percent = 100.0 * numVoid / g.samples.size();
+    SG_LOG( SG_GENERAL, SG_ALERT, "1201 x 1201, " << percent << "% void:" );
+
+    std::vector<double> lons( NUM_QUERIES ), lats( NUM_QUERIES );
+    for ( int i = 0; i < NUM_QUERIES; i++ ) {
+        lons[i] = g.originx + ( g.cols - 1 ) * STEP * ( rand() / ( RAND_MAX + 1.0 ) );
+        lats[i] = g.originy + ( g.rows - 1 ) * STEP * ( rand() / ( RAND_MAX + 1.0 ) );
+    }
+
+    SGBucket    b;
+    SGTimeStamp t;
+    int         errors = 0;
+
+    {
+        tgArray array( base );
+        array.parse( b );
+
+        t.stamp();
+        double first = array.closest_nonvoid_elev( lons[0], lats[0] );
+        double buildMs = t.elapsedUSec() / 1000.0;
+
+        t.stamp();
+        for ( int i = 0; i < NUM_QUERIES; i++ ) {
+            array.closest_nonvoid_elev( lons[i], lats[i] );
+        }
+        double queryMs = t.elapsedUSec() / 1000.0;
+
+        t.stamp();
+        array.remove_voids();
+        double fillMs = t.elapsedUSec() / 1000.0;
+
+        for ( unsigned int i = 0; i < g.samples.size(); i++ ) {
+            if ( array.get_array_elev( i / g.rows, i % g.rows ) <= -9000 ) {
+                errors++;
+            }
+        }
+
+        SG_LOG( SG_GENERAL, SG_ALERT, "  distance transform: first lookup " << buildMs << " ms (" << first << " m), " <<
+                                      NUM_QUERIES << " lookups " << queryMs << " ms, remove_voids " << fillMs << " ms" );
+    }
+
+    if ( legacyQueries > 0 ) {
+        t.stamp();
+        for ( int i = 0; i < legacyQueries; i++ ) {
+            legacyClosest( g, lons[i], lats[i] );
+        }
+        double queryMs = t.elapsedUSec() / 1000.0;
+
+        testGrid legacy = g;
+        t.stamp();
+        legacyFill( legacy );
+        double fillMs = t.elapsedUSec() / 1000.0;
+
+        SG_LOG( SG_GENERAL, SG_ALERT, "  search / fill:      " << queryMs / legacyQueries << " ms per lookup, remove_voids " << fillMs << " ms" );
+    }
+
+    return errors;
+}
+
+int main( int argc, char** argv )
+{
+    int voidPercent   = 30;
+    int legacyQueries = 3;
+    int errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "voids",          voidPercent, "percent" );
+    options.add( "legacy-queries", legacyQueries );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    simgear::Dir tmp = simgear::Dir::tempDir( "tgArrayVoidTest" );
+    std::string  dir = tmp.path().str();
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "void patterns:" );
+
+    {
+        testGrid g( 81, 61 );
+        hills( g );
+        for ( int x = 0; x < g.cols; x++ ) {
+            for ( int y = 0; y < g.rows; y++ ) {
+                if ( x % 7 == 3 && y % 5 == 2 ) {
+                    g.at( x, y ) = VOID_ELEV;
+                }
+            }
+        }
+        errors += check( dir, "single", g );
+    }
+
+    {
+        testGrid g( 81, 61 );
+        hills( g );
+        for ( int x = 0; x < g.cols; x++ ) {
+            for ( int y = 0; y < g.rows; y++ ) {
+                if ( x % 16 >= 4 && x % 16 < 9 && y % 12 >= 3 && y % 12 < 8 ) {
+                    g.at( x, y ) = VOID_ELEV;
+                }
+            }
+        }
+        errors += check( dir, "holes", g );
+    }
+
+    {
+        testGrid g( 81, 61 );
+        hills( g );
+        for ( int x = 0; x < g.cols; x++ ) {
+            for ( int y = 0; y < g.rows; y++ ) {
+                if ( ( x - 45 ) * ( x - 45 ) + ( y - 28 ) * ( y - 28 ) < 25 * 25 ) {
+                    g.at( x, y ) = VOID_ELEV;
+                }
+            }
+        }
+        errors += check( dir, "lake", g );
+    }
+
+    {
+        testGrid g( 81, 61 );
+        hills( g );
+        for ( int x = 0; x < g.cols; x++ ) {
+            for ( int y = 0; y < g.rows; y++ ) {
+                if ( x < 10 || y >= g.rows - 8 ) {
+                    g.at( x, y ) = VOID_ELEV;
+                }
+            }
+        }
+        errors += check( dir, "edges", g );
+    }
+
+    {
+        testGrid g( 41, 31 );
+        for ( unsigned int i = 0; i < g.samples.size(); i++ ) {
+            g.samples[i] = VOID_ELEV;
+        }
+        g.at( 17, 25 ) = 1234;
+        errors += check( dir, "one_valid", g );
+    }
+
+    {
+        testGrid g( 41, 31 );
+        for ( unsigned int i = 0; i < g.samples.size(); i++ ) {
+            g.samples[i] = VOID_ELEV;
+        }
+        errors += check( dir, "all_void", g );
+    }
+
+    {
+        testGrid g( 41, 31 );
+        hills( g );
+        errors += check( dir, "no_void", g );
+    }
+
+    errors += timing( dir, voidPercent, legacyQueries );
+
+    tmp.remove( true );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
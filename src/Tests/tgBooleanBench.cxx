@@ -0,0 +1,246 @@
+// tgBooleanBench.cxx -- polygon booleans through clipper, with the exact
+//                       fallback, against exact CGAL
+//
+// Chops --polys jagged landclass polygons, some with holes, into buckets
+// the way tgChopper does, then clips the pieces of the --tiles fullest
+// buckets in priority order and against their bucket, the way stage 1
+// does.  Each engine runs with --booleans=hybrid or exact, or both, one
+// after the other - the chopped and clipped areas must then match.  Peak
+// RSS is for the whole process, so run the engines on their own to
+// compare memory.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_profile.hxx>
+#include <terragear/polygon_set/tg_polygon_set.hxx>
+#include <terragear/polygon_set/tg_polygon_accumulator.hxx>
+
+#include "tg_test_util.hxx"
+
+// same overlap tgChopper clips with
+#define CLIP_CORRECTION     (0.0002)
+
+typedef std::map<long int, tgPolygonSetList>    bucketPolys;
+
+struct booleanResult {
+    double  chopMs;
+    double  chopArea;
+    long    chopRssKb;
+    double  clipMs;
+    double  clipArea;
+    long    clipRssKb;
+};
+
+static cgalPoly_Polygon star( double cx, double cy, double r, int n, tgTestRandom& random )
+{
+    cgalPoly_Polygon poly;
+
+    for ( int i=0; i<n; i++ ) {
+        double a = 2.0 * M_PI * i / n;
+        double d = r * ( 0.6 + 0.4 * random.next() );
+
+        poly.push_back( cgalPoly_Point( cx + d * cos( a ), cy + d * sin( a ) ) );
+    }
+
+    return poly;
+}
+
+// star shaped around their centers, so always simple - a third of them
+// with a lake in the middle
+static void generatePolys( unsigned int count, std::vector<tgPolygonSet>& polys )
+{
+    tgTestRandom random( 5 );
+
+    for ( unsigned int i=0; i<count; i++ ) {
+        double cx = 10.0 + random.next();
+        double cy = 45.0 + random.next();
+        double r  = 0.01 + 0.15 * pow( random.next(), 2.0 );
+
+        cgalPoly_PolygonWithHoles pwh( star( cx, cy, r, 50 + random.next( 400 ), random ) );
+        if ( i % 3 == 0 ) {
+            cgalPoly_Polygon hole = star( cx, cy, 0.3 * r, 20 + random.next( 100 ), random );
+            hole.reverse_orientation();
+            pwh.add_hole( hole );
+        }
+
+        polys.push_back( tgPolygonSet( pwh, tgPolygonSetMeta( tgPolygonSetMeta::META_TEXTURED, "Default" ) ) );
+    }
+}
+
+static cgalPoly_Polygon bucketPoly( const SGBucket& b, double correction )
+{
+    cgalPoly_Polygon poly;
+
+    poly.push_back( cgalPoly_Point( b.get_corner( SG_BUCKET_SW ).getLongitudeDeg() - correction, b.get_corner( SG_BUCKET_SW ).getLatitudeDeg() - correction ) );
+    poly.push_back( cgalPoly_Point( b.get_corner( SG_BUCKET_SE ).getLongitudeDeg() + correction, b.get_corner( SG_BUCKET_SE ).getLatitudeDeg() - correction ) );
+    poly.push_back( cgalPoly_Point( b.get_corner( SG_BUCKET_NE ).getLongitudeDeg() + correction, b.get_corner( SG_BUCKET_NE ).getLatitudeDeg() + correction ) );
+    poly.push_back( cgalPoly_Point( b.get_corner( SG_BUCKET_NW ).getLongitudeDeg() - correction, b.get_corner( SG_BUCKET_NW ).getLatitudeDeg() + correction ) );
+
+    return poly;
+}
+
+// tgChopperChunk::clip, without the files
+static double chop( const std::vector<tgPolygonSet>& polys, bucketPolys& chopped )
+{
+    double area = 0.0;
+
+    for ( unsigned int i=0; i<polys.size(); i++ ) {
+        CGAL::Bbox_2          bb = polys[i].getBoundingBox();
+        std::vector<SGBucket> buckets;
+
+        sgGetBuckets( SGGeod::fromDeg( bb.xmin(), bb.ymin() ), SGGeod::fromDeg( bb.xmax(), bb.ymax() ), buckets );
+        for ( unsigned int j=0; j<buckets.size(); j++ ) {
+            tgPolygonSet piece;
+
+            piece.intersection2( polys[i], bucketPoly( buckets[j], CLIP_CORRECTION ) );
+            if ( !piece.isEmpty() ) {
+                area += piece.totalArea();
+                chopped[ buckets[j].gen_index() ].push_back( piece );
+            }
+        }
+    }
+
+    return area;
+}
+
+// tgMeshArrangement::clipPolys - everything of one priority
+static double clip( const std::vector<long int>& tiles, const bucketPolys& chopped )
+{
+    double area = 0.0;
+
+    for ( unsigned int i=0; i<tiles.size(); i++ ) {
+        SGBucket                b( tiles[i] );
+        cgalPoly_Polygon        base = bucketPoly( b, 0.0 );
+        tgPolygonSetList        polys = chopped.find( tiles[i] )->second;
+        tgAccumulator           accum;
+
+        for ( unsigned int j=0; j<polys.size(); j++ ) {
+            accum.Diff_and_Add_cgal( polys[j] );
+            polys[j].intersection2( base );
+
+            area += polys[j].totalArea();
+        }
+    }
+
+    return area;
+}
+
+static bool morePieces( const std::pair<long int, size_t>& a, const std::pair<long int, size_t>& b )
+{
+    return a.second > b.second;
+}
+
+static booleanResult run( const std::vector<tgPolygonSet>& polys, unsigned int numTiles )
+{
+    booleanResult r;
+    bucketPolys   chopped;
+    SGTimeStamp   t;
+
+    t.stamp();
+    r.chopArea  = chop( polys, chopped );
+    r.chopMs    = t.elapsedUSec() / 1000.0;
+    r.chopRssKb = tgProfile::peakRssKb();
+
+    std::vector< std::pair<long int, size_t> > counts;
+    for ( bucketPolys::const_iterator it = chopped.begin(); it != chopped.end(); it++ ) {
+        counts.push_back( std::make_pair( it->first, it->second.size() ) );
+    }
+    std::sort( counts.begin(), counts.end(), morePieces );
+
+    std::vector<long int> tiles;
+    for ( unsigned int i=0; i<counts.size() && i<numTiles; i++ ) {
+        tiles.push_back( counts[i].first );
+    }
+    std::sort( tiles.begin(), tiles.end() );
+
+    t.stamp();
+    r.clipArea  = clip( tiles, chopped );
+    r.clipMs    = t.elapsedUSec() / 1000.0;
+    r.clipRssKb = tgProfile::peakRssKb();
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "  chopped into " << chopped.size() << " buckets in " << r.chopMs << " ms - " <<
+                                  ( r.chopMs > 0.0 ? 1000.0 * polys.size() / r.chopMs : 0.0 ) << " polys/s, peak RSS " << r.chopRssKb / 1024 << " MB" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  clipped " << tiles.size() << " tiles in " << r.clipMs << " ms, peak RSS " << r.clipRssKb / 1024 << " MB" );
+
+    return r;
+}
+
+static bool sameArea( double a, double b )
+{
+    return fabs( a - b ) <= 1.0e-6 * std::max( fabs( a ), fabs( b ) );
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int count    = 2000;
+    unsigned int numTiles = 8;
+    std::string  method   = "both";
+    int          errors   = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "polys", count );
+    options.add( "tiles", numTiles );
+    options.addChoice( "booleans", method, "hybrid|exact|both" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    std::vector<tgPolygonSet> polys;
+    generatePolys( count, polys );
+
+    booleanResult hybrid, exact;
+
+    if ( method != "exact" ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, count << " polys, hybrid booleans:" );
+        tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_HYBRID );
+        hybrid = run( polys, numTiles );
+    }
+    if ( method != "hybrid" ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, count << " polys, exact booleans:" );
+        tgPolygonSet::setBooleanMethod( tgPolygonSet::BOOLEANS_EXACT );
+        exact = run( polys, numTiles );
+    }
+
+    if ( method == "both" ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "chop " << exact.chopMs / hybrid.chopMs << "x, clip " << exact.clipMs / hybrid.clipMs << "x faster through clipper" );
+
+        if ( !sameArea( hybrid.chopArea, exact.chopArea ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  chopped area " << hybrid.chopArea << " differs from exact " << exact.chopArea );
+            errors++;
+        }
+        if ( !sameArea( hybrid.clipArea, exact.clipArea ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  clipped area " << hybrid.clipArea << " differs from exact " << exact.clipArea );
+            errors++;
+        }
+    }
+
+    tgPolygonSet::reportBooleans();
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -47,6 +47,7 @@ using std::string;
 
 string area_type="Default";
 int num_threads = 4;
+unsigned int flush_size = CHOPPER_FLUSH_SIZE;
 
 std::vector<SGBucket> bucketList;
 SGLockedQueue<OGRFeature *> global_workQueue;
@@ -208,6 +209,8 @@ void usage(char* progname) {
     SG_LOG( SG_GENERAL, SG_ALERT, "        Area type for all objects from file" );
     SG_LOG( SG_GENERAL, SG_ALERT, "--threads" );
     SG_LOG( SG_GENERAL, SG_ALERT, "        Enable multithreading with user specified number of threads" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "--flush-size polys" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "        Chopped polys to buffer per bucket - 1 writes every poly as it is chopped" );
     SG_LOG( SG_GENERAL, SG_ALERT, "<work_dir>" );
     SG_LOG( SG_GENERAL, SG_ALERT, "        Directory to put the polygon files in" );
     SG_LOG( SG_GENERAL, SG_ALERT, "<datasource>" );
@@ -232,6 +235,13 @@ int main( int argc, char **argv ) {
             area_type=argv[2];
             argv+=2;
             argc-=2;
+        } else if (!strcmp(argv[1],"--flush-size")) {
+            if (argc<3) {
+                usage(progname);
+            }
+            flush_size=atoi(argv[2]);
+            argv+=2;
+            argc-=2;
         } else if (!strcmp(argv[1],"--help")) {
             usage(progname);
         } else {
@@ -253,6 +263,7 @@ int main( int argc, char **argv ) {
     sgp.create_dir( 0755 );
 
     tgChopper results( work_dir );
+    results.SetFlushSize( flush_size );
 
     SG_LOG( SG_GENERAL, SG_INFO, "Opening datasource " << datasource << " for reading." );
 
@@ -268,6 +279,9 @@ int main( int argc, char **argv ) {
 
     SG_LOG( SG_GENERAL, SG_ALERT, "Processing datasource " << datasource );
 
+    SGTimeStamp chop_start;
+    chop_start.stamp();
+
     OGRLayer  *poLayer;
     if (argc>4) {
         for (int i=3;i<argc;i++) {
@@ -292,6 +306,11 @@ int main( int argc, char **argv ) {
 
     GDALClose(poDS);
 
+    // write what's still buffered before reading the buckets back
+    results.Flush();
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "chopped " << shapefilePolys.size() << " polys in " << chop_start.elapsedMSec() << " ms, flush size " << flush_size );
+
     char resDatasource[64];
     sprintf(resDatasource, "./%s", resultname.c_str() );
     
@@ -316,9 +335,9 @@ int main( int argc, char **argv ) {
         SGBucket    bucket = bucketList[i];
         tgPolygonSetList polys;
         
-        // load 2D polygons from correct path
-        poly_path = work_dir + "/" + bucket.gen_base_path() + '/' + bucket.gen_index_str() + '/' + area_type + ".shp";
-        tgPolygonSet::fromShapefile( poly_path, polys );
+        // load 2D polygons from the bucket's polys file
+        poly_path = work_dir + "/" + bucket.gen_base_path() + '/' + bucket.gen_index_str() + ".polys.gz";
+        tgPolygonSet::fromPolysFile( poly_path, polys );
         
         for ( unsigned int j=0; j<polys.size(); j++ ) {
             choppedPolys.push_back( polys[j] );
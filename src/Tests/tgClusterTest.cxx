@@ -0,0 +1,368 @@
+// tgClusterTest.cxx -- equivalence and timing of tgCluster
+//
+// Compares tgCluster against the original exact kernel Voronoi
+// implementation, kept here as the reference.  Every input node must be
+// located to the same cluster center ( to within rounding ) by both.
+// Also times tgCluster on 10k and 100k node inputs.
+//
+// Inputs are generated with a fixed seed, or read from a file of
+// "lon lat fixed" lines recorded with --record.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <string>
+
+#include <CGAL/Delaunay_triangulation_2.h>
+#include <CGAL/Voronoi_diagram_2.h>
+#include <CGAL/Delaunay_triangulation_adaptation_traits_2.h>
+#include <CGAL/Delaunay_triangulation_adaptation_policies_2.h>
+#include <CGAL/centroid.h>
+#include <CGAL/Dimension.h>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_cluster.hxx>
+
+#include "tg_test_util.hxx"
+
+#define CLUSTER_RADIUS  (0.0000025)
+#define LOCATE_EPSILON  (0.000000000001)
+
+// the original implementation - exact kernel throughout, Voronoi point
+// location, and a linear scan of the cells for every node
+typedef CGAL::Delaunay_triangulation_2<EPECKernel>                           refDT;
+typedef CGAL::Delaunay_triangulation_adaptation_traits_2<refDT>              refAT;
+typedef CGAL::Delaunay_triangulation_caching_degeneracy_removal_policy_2<refDT> refAP;
+typedef CGAL::Voronoi_diagram_2<refDT,refAT,refAP>                           refVD;
+
+typedef boost::tuple<EPECPoint_2, std::vector<tgClusterNode>::iterator>     refData;
+typedef CGAL::Search_traits_2<EPECKernel>                                    refTraitsBase;
+typedef CGAL::Search_traits_adapter<refData, CGAL::Nth_of_tuple_property_map<0, refData>, refTraitsBase>  refTraits;
+typedef CGAL::Fuzzy_sphere<refTraits>                                        refFuzzyCir;
+typedef CGAL::Kd_tree<refTraits>                                             refTree;
+
+class refCluster
+{
+public:
+    refCluster( const std::list<tgClusterNode>& points, double err );
+    EPECPoint_2 Locate( const EPECPoint_2& point ) const;
+
+private:
+    void computenewcentroids( void );
+
+    std::list<tgClusterNode>    nodes;
+    std::vector<EPECPoint_2>    oldcells, newcells;
+    refVD                       vd;
+};
+
+EPECPoint_2 refCluster::Locate( const EPECPoint_2& point ) const
+{
+    refVD::Locate_result lr = vd.locate( point );
+    EPECPoint_2          q;
+
+    if ( refVD::Vertex_handle* v = boost::get<refVD::Vertex_handle>(&lr) ) {
+        q = (*v)->site(0)->point();
+    } else if ( refVD::Halfedge_handle* e = boost::get<refVD::Halfedge_handle>(&lr) ) {
+        q = (*e)->up()->point();
+    } else if ( refVD::Face_handle* f = boost::get<refVD::Face_handle>(&lr) ) {
+        q = (*f)->dual()->point();
+    }
+
+    return q;
+}
+
+void refCluster::computenewcentroids( void )
+{
+    std::vector< std::vector<EPECPoint_2> > cellNodes( oldcells.size() );
+    CGAL::Dimension_tag<0> tg;
+
+    vd.clear();
+    for ( unsigned int i=0; i<oldcells.size(); i++ ) {
+        vd.insert( oldcells[i] );
+    }
+
+    for ( std::list<tgClusterNode>::iterator it = nodes.begin(); it != nodes.end(); it++ ) {
+        EPECPoint_2 q = Locate( it->point );
+
+        for ( unsigned int i=0; i<oldcells.size(); i++ ) {
+            if ( oldcells[i] == q ) {
+                cellNodes[i].push_back( it->point );
+                break;
+            }
+        }
+    }
+
+    newcells.clear();
+    for ( unsigned int i=0; i<oldcells.size(); i++ ) {
+        if ( cellNodes[i].empty() ) {
+            newcells.push_back( oldcells[i] );
+        } else {
+            newcells.push_back( CGAL::centroid( cellNodes[i].begin(), cellNodes[i].end(), tg ) );
+        }
+    }
+}
+
+refCluster::refCluster( const std::list<tgClusterNode>& points, double err )
+{
+    std::vector<tgClusterNode> oldcentroids( points.begin(), points.end() );
+    std::vector<tgClusterNode> newcentroids;
+    std::vector<tgClusterNode>::iterator it;
+    std::list<refData> query_result;
+    std::list<refData>::iterator qrit;
+    refTree tree;
+
+    // remove dups
+    for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
+        tree.insert( refData( it->point, it ) );
+    }
+    for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
+        if ( !it->added ) {
+            bool fixed = it->fixed;
+            it->added = true;
+
+            refFuzzyCir query_circle( it->point, 0.000000001 );
+            query_result.clear();
+            tree.search( std::back_inserter( query_result ), query_circle );
+            for ( qrit = query_result.begin(); qrit != query_result.end(); qrit++ ) {
+                std::vector<tgClusterNode>::iterator pos_it = boost::get<1>(*qrit);
+                pos_it->added = true;
+                if ( pos_it->fixed ) {
+                    fixed = true;
+                }
+            }
+            newcentroids.push_back( tgClusterNode( it->point, fixed ) );
+        }
+    }
+
+    oldcentroids.clear();
+    for ( it = newcentroids.begin(); it != newcentroids.end(); it++ ) {
+        oldcentroids.push_back( tgClusterNode( it->point, it->fixed ) );
+    }
+
+    // merge centers
+    bool merged_centroid;
+    do {
+        tree.clear();
+        for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
+            tree.insert( refData( it->point, it ) );
+        }
+
+        newcentroids.clear();
+        merged_centroid = false;
+
+        for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
+            if ( !it->added ) {
+                refFuzzyCir query_circle( it->point, err );
+                query_result.clear();
+                tree.search( std::back_inserter( query_result ), query_circle );
+
+                if ( query_result.size() > 1 ) {
+                    std::vector<EPECPoint_2> fixedPos, notFixedPos;
+                    CGAL::Dimension_tag<0>   tg;
+
+                    for ( qrit = query_result.begin(); qrit != query_result.end(); qrit++ ) {
+                        std::vector<tgClusterNode>::iterator pos_it = boost::get<1>(*qrit);
+                        if ( !pos_it->added ) {
+                            if ( pos_it->fixed ) {
+                                fixedPos.push_back( boost::get<0>(*qrit) );
+                            } else {
+                                notFixedPos.push_back( boost::get<0>(*qrit) );
+                            }
+                            pos_it->added = true;
+                        }
+                    }
+
+                    if ( !fixedPos.empty() ) {
+                        for ( unsigned int i=0; i<fixedPos.size(); i++ ) {
+                            newcentroids.push_back( tgClusterNode( fixedPos[i], true ) );
+                        }
+                    } else if ( !notFixedPos.empty() ) {
+                        newcentroids.push_back( tgClusterNode( CGAL::centroid( notFixedPos.begin(), notFixedPos.end(), tg ), false ) );
+                        merged_centroid = true;
+                    } else {
+                        newcentroids.push_back( tgClusterNode( it->point, it->fixed ) );
+                    }
+                } else {
+                    std::vector<tgClusterNode>::iterator pos_it = boost::get<1>(*query_result.begin());
+                    pos_it->added = true;
+                    newcentroids.push_back( tgClusterNode( boost::get<0>(*query_result.begin()), pos_it->fixed ) );
+                }
+            }
+        }
+
+        oldcentroids = newcentroids;
+    } while ( merged_centroid );
+
+    // Lloyd relaxation
+    nodes = points;
+    for ( it = oldcentroids.begin(); it != oldcentroids.end(); it++ ) {
+        oldcells.push_back( it->point );
+    }
+
+    for ( int iiter = 0; iiter < 40; iiter++ ) {
+        computenewcentroids();
+        if ( newcells == oldcells ) {
+            break;
+        }
+        oldcells = newcells;
+    }
+}
+
+// clumps of nodes around random centers, with some fixed nodes on a
+// "tile edge" at lat == 0.0, plus exact duplicates
+static void generateNodes( unsigned int count, unsigned int seed, std::list<tgClusterNode>& nodes )
+{
+    srand( seed );
+
+    while ( nodes.size() < count ) {
+        double cx = 0.25 * rand() / RAND_MAX;
+        double cy = 0.125 * rand() / RAND_MAX;
+        int    clump = 1 + rand() % 5;
+
+        for ( int i=0; i<clump && nodes.size() < count; i++ ) {
+            double x = cx + 4.0 * CLUSTER_RADIUS * ( (double)rand() / RAND_MAX - 0.5 );
+            double y = cy + 4.0 * CLUSTER_RADIUS * ( (double)rand() / RAND_MAX - 0.5 );
+            bool   fixed = ( rand() % 20 ) == 0;
+
+            if ( fixed ) {
+                y = 0.0;
+            }
+
+            nodes.push_back( tgClusterNode( EPECPoint_2( x, y ), fixed ) );
+            if ( rand() % 50 == 0 ) {
+                nodes.push_back( tgClusterNode( EPECPoint_2( x, y ), false ) );
+            }
+        }
+    }
+}
+
+static bool readNodes( const std::string& filename, std::list<tgClusterNode>& nodes )
+{
+    std::ifstream in( filename.c_str() );
+    double x, y;
+    int    fixed;
+
+    if ( !in ) {
+        return false;
+    }
+
+    while ( in >> x >> y >> fixed ) {
+        nodes.push_back( tgClusterNode( EPECPoint_2( x, y ), fixed != 0 ) );
+    }
+
+    return true;
+}
+
+static void writeNodes( const std::string& filename, const std::list<tgClusterNode>& nodes )
+{
+    std::ofstream out( filename.c_str() );
+
+    out << std::setprecision(17);
+    for ( std::list<tgClusterNode>::const_iterator it = nodes.begin(); it != nodes.end(); it++ ) {
+        out << CGAL::to_double( it->point.x() ) << " " << CGAL::to_double( it->point.y() ) << " " << ( it->fixed ? 1 : 0 ) << std::endl;
+    }
+}
+
+static int compare( const std::list<tgClusterNode>& nodes )
+{
+    SGTimeStamp refTime;
+    refTime.stamp();
+    refCluster reference( nodes, CLUSTER_RADIUS );
+    int64_t refMs = refTime.elapsedMSec();
+
+    SGTimeStamp newTime;
+    newTime.stamp();
+    tgCluster cluster( nodes, CLUSTER_RADIUS, "" );
+    int64_t newMs = newTime.elapsedMSec();
+
+    int mismatches = 0;
+    for ( std::list<tgClusterNode>::const_iterator it = nodes.begin(); it != nodes.end(); it++ ) {
+        EPECPoint_2 a = reference.Locate( it->point );
+        EPECPoint_2 b = cluster.Locate( it->point );
+
+        if ( fabs( CGAL::to_double( a.x() - b.x() ) ) > LOCATE_EPSILON ||
+             fabs( CGAL::to_double( a.y() - b.y() ) ) > LOCATE_EPSILON ) {
+            mismatches++;
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, nodes.size() << " nodes: reference " << refMs << " ms, tgCluster " << newMs << " ms, " <<
+                                  cluster.getNumCentroids() << " centers, " << mismatches << " mismatches" );
+
+    return mismatches;
+}
+
+static void timeCluster( unsigned int count )
+{
+    std::list<tgClusterNode> nodes;
+    generateNodes( count, 1234, nodes );
+
+    SGTimeStamp t;
+    t.stamp();
+    tgCluster cluster( nodes, CLUSTER_RADIUS, "" );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "tgCluster of " << nodes.size() << " nodes: " << t.elapsedMSec() << " ms, " << cluster.getNumCentroids() << " centers" );
+}
+
+int main( int argc, char** argv )
+{
+    std::string  input;
+    std::string  record;
+    unsigned int count = 2000;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "input",  input, "nodes file" );
+    options.add( "record", record, "nodes file" );
+    options.add( "nodes",  count );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    if ( !input.empty() ) {
+        std::list<tgClusterNode> nodes;
+        if ( !readNodes( input, nodes ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "can't read " << input );
+            return 1;
+        }
+        errors += compare( nodes );
+    } else {
+        // a few different seeds for the equivalence check
+        for ( unsigned int seed = 1; seed <= 4; seed++ ) {
+            std::list<tgClusterNode> nodes;
+            generateNodes( count, seed, nodes );
+
+            if ( !record.empty() && seed == 1 ) {
+                writeNodes( record, nodes );
+            }
+            errors += compare( nodes );
+        }
+    }
+
+    timeCluster( 10000 );
+    timeCluster( 100000 );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " mismatches" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+// tgFaceLookupBench.cxx -- benchmark arrangement face meta lookups
+//
+// Builds a synthetic tile from a dense grid of landclass squares, then
+// times looking up every face in the arrangement's face meta table - once
+// with the linear scan findPolyFace used to do, and once through the
+// face index.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <string>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_mutex.hxx>
+#include <terragear/mesh/tg_mesh.hxx>
+
+#include "tg_test_util.hxx"
+
+// the lookup as it was before the face index
+static meshArrFaceConstHandle linearFind( const std::vector<tgMeshFaceMeta>& metaLookup, meshArrFaceConstHandle f )
+{
+    meshArrFaceConstHandle face = (meshArrFaceConstHandle)NULL;
+
+    for ( unsigned int i=0; i<metaLookup.size(); i++ ) {
+        if ( metaLookup[i].face == f ) {
+            face = f;
+            break;
+        }
+    }
+
+    return face;
+}
+
+int main( int argc, char** argv )
+{
+    int side = 230;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "side", side, "squares per side" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    names.push_back( "Default" );
+    names.push_back( "Ocean" );
+
+    tgMutex  lock;
+    SGBucket b( SGGeod::fromDeg( 10.01, 45.01 ) );
+    tgMesh   mesh;
+
+    mesh.initPriorities( names );
+    mesh.setLock( &lock );
+    mesh.clipAgainstBucket( b );
+
+    double minx = b.get_center_lon() - 0.5 * b.get_width();
+    double miny = b.get_center_lat() - 0.5 * b.get_height();
+    double dx   = b.get_width()  / side;
+    double dy   = b.get_height() / side;
+
+    // squares with a gap, so every one is a face of its own
+    tgPolygonSetList squares;
+    for ( int y=0; y<side; y++ ) {
+        for ( int x=0; x<side; x++ ) {
+            double x0 = minx + x * dx + 0.1 * dx;
+            double y0 = miny + y * dy + 0.1 * dy;
+            double x1 = x0 + 0.8 * dx;
+            double y1 = y0 + 0.8 * dy;
+
+            cgalPoly_Point square[4];
+            square[0] = cgalPoly_Point( x0, y0 );
+            square[1] = cgalPoly_Point( x1, y0 );
+            square[2] = cgalPoly_Point( x1, y1 );
+            square[3] = cgalPoly_Point( x0, y1 );
+
+            squares.push_back( tgPolygonSet( cgalPoly_Polygon( square, square+4 ), tgPolygonSetMeta( tgPolygonSetMeta::META_TEXTURED, names[0] ) ) );
+        }
+    }
+    mesh.addPolys( 0, squares );
+
+    cgalPoly_Point ocean[4];
+    ocean[0] = cgalPoly_Point( minx - dx,                miny - dy );
+    ocean[1] = cgalPoly_Point( minx + b.get_width() + dx, miny - dy );
+    ocean[2] = cgalPoly_Point( minx + b.get_width() + dx, miny + b.get_height() + dy );
+    ocean[3] = cgalPoly_Point( minx - dx,                miny + b.get_height() + dy );
+    mesh.addPoly( 1, tgPolygonSet( cgalPoly_Polygon( ocean, ocean+4 ), tgPolygonSetMeta( tgPolygonSetMeta::META_TEXTURED, names[1] ) ) );
+
+    SGTimeStamp genTime;
+    genTime.stamp();
+    mesh.generate();
+    SG_LOG( SG_GENERAL, SG_ALERT, "generated tile from " << squares.size() + 1 << " polys in " << genTime.elapsedMSec() << " ms" );
+
+    const tgMeshArrangement&           arr  = mesh.getArrangement();
+    const std::vector<tgMeshFaceMeta>& meta = arr.getFaceMeta();
+
+    std::vector<meshArrFaceConstHandle> faces;
+    for ( unsigned int i=0; i<meta.size(); i++ ) {
+        faces.push_back( meta[i].face );
+    }
+
+    // linear scan
+    unsigned int linearFound = 0;
+    SGTimeStamp linearTime;
+    linearTime.stamp();
+    for ( unsigned int i=0; i<faces.size(); i++ ) {
+        if ( linearFind( meta, faces[i] ) != (meshArrFaceConstHandle)NULL ) {
+            linearFound++;
+        }
+    }
+    int64_t linearMs = linearTime.elapsedMSec();
+
+    // face index
+    unsigned int indexFound = 0;
+    SGTimeStamp indexTime;
+    indexTime.stamp();
+    for ( unsigned int i=0; i<faces.size(); i++ ) {
+        if ( arr.findPolyFace( faces[i] ) != (meshArrFaceConstHandle)NULL ) {
+            indexFound++;
+        }
+    }
+    int64_t indexUs = indexTime.elapsedUSec();
+
+    SG_LOG( SG_GENERAL, SG_ALERT, faces.size() << " face lookups: linear scan " << linearMs << " ms, index " << indexUs << " us" );
+
+    if ( linearFound != faces.size() || indexFound != faces.size() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "lookup mismatch: linear found " << linearFound << " index found " << indexFound );
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,295 @@
+// tgFeaturePipelineBench.cxx -- memory and throughput of the poly-decode
+//                               feature pipeline
+//
+// Writes a large synthetic polygon layer - in UTM, so every feature needs
+// transforming - to a temporary shapefile, and decodes it the way
+// poly-decode does, with the decoders building a tgPolygonSet from every
+// feature:
+//
+// unbounded - the whole layer is read before the decoders start, as
+//             poly-decode used to
+// bounded   - the decoders start first, at most --queue features are read
+//             ahead of them
+// batched   - bounded, reading the layer in 1 degree batches
+// extent    - bounded, reading a 2 x 2 degree extent in half degree
+//             batches
+//
+// and reports the throughput and the growth of the process peak RSS of
+// each.  The peak RSS only grows, so the unbounded run goes last.  Every
+// run must decode every feature exactly once - the extent run those
+// inside the extent, and the strips entering it far from their first
+// vertex.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <ogrsf_frmts.h>
+#include <gdal_priv.h>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_bounded_queue.hxx>
+#include <terragear/tg_feature_reader.hxx>
+#include <terragear/tg_profile.hxx>
+#include <terragear/polygon_set/tg_polygon_set.hxx>
+
+#include "tg_test_util.hxx"
+
+#define RING_POINTS     (64)
+#define NUM_STRIPS      (8)
+#define STRIP_WIDTH     (0.01)
+
+class decodeThread : public SGThread
+{
+public:
+    decodeThread( tgBoundedQueue<OGRFeature *>& q, OGRSpatialReference* srs, std::vector<unsigned char>& s, SGMutex& l ) : workQueue(q), seen(s), lock(l) {
+        OGRSpatialReference wgs84;
+        wgs84.SetWellKnownGeogCS( "WGS84" );
+
+        poCT = OGRCreateCoordinateTransformation( srs, &wgs84 );
+    }
+
+    ~decodeThread() {
+        OCTDestroyCoordinateTransformation( poCT );
+    }
+
+private:
+    virtual void run() {
+        OGRFeature* poFeature;
+
+        while ( workQueue.pop( poFeature ) ) {
+            OGRGeometry* poGeometry = poFeature->GetGeometryRef();
+            poGeometry->transform( poCT );
+
+            tgPolygonSetMeta meta( tgPolygonSetMeta::META_TEXTURED, "Default" );
+            tgPolygonSet     shapes( (OGRPolygon*)poGeometry, meta );
+
+            {
+                SGGuard<SGMutex> g( lock );
+                seen[poFeature->GetFID()]++;
+            }
+
+            OGRFeature::DestroyFeature( poFeature );
+        }
+    }
+
+    tgBoundedQueue<OGRFeature *>&   workQueue;
+    OGRCoordinateTransformation*    poCT;
+    std::vector<unsigned char>&     seen;
+    SGMutex&                        lock;
+};
+
+// a thin hook starting west of the extent at lat, running south of it,
+// and turning north into it at lon - the first vertex is beside another
+// batch than the one the strip enters through
+static void strip( double lon, double lat, OGRLinearRing& ring )
+{
+    ring.addPoint( 6.5, lat );
+    ring.addPoint( 6.5, lat + STRIP_WIDTH );
+    ring.addPoint( 7.5 + STRIP_WIDTH, lat + STRIP_WIDTH );
+    ring.addPoint( 7.5 + STRIP_WIDTH, 45.5 + STRIP_WIDTH );
+    ring.addPoint( lon, 45.5 + STRIP_WIDTH );
+    ring.addPoint( lon, 46.25 );
+    ring.addPoint( lon + STRIP_WIDTH, 46.25 );
+    ring.addPoint( lon + STRIP_WIDTH, 45.5 );
+    ring.addPoint( 7.5, 45.5 );
+    ring.addPoint( 7.5, lat );
+}
+
+// circles scattered over 4 x 4 degrees, then NUM_STRIPS strips entering
+// 8 - 10 x 46 - 48 from the south.  envs gets their WGS84 envelopes.
+static bool writeLayer( const std::string& path, unsigned int numFeatures, std::vector<OGREnvelope>& envs )
+{
+    GDALDriver* poDriver = GetGDALDriverManager()->GetDriverByName( "ESRI Shapefile" );
+    if ( !poDriver ) {
+        return false;
+    }
+
+    GDALDataset* poDS = poDriver->Create( path.c_str(), 0, 0, 0, GDT_Unknown, NULL );
+    if ( !poDS ) {
+        return false;
+    }
+
+    OGRSpatialReference utm, wgs84;
+    utm.SetWellKnownGeogCS( "WGS84" );
+    utm.SetUTM( 32, TRUE );
+    wgs84.SetWellKnownGeogCS( "WGS84" );
+
+    OGRLayer* poLayer = poDS->CreateLayer( "polys", &utm, wkbPolygon, NULL );
+    OGRCoordinateTransformation* poCT = OGRCreateCoordinateTransformation( &wgs84, &utm );
+
+    srand( 5 );
+
+    for ( unsigned int i=0; i<numFeatures + NUM_STRIPS; i++ ) {
+        OGRLinearRing ring;
+
+        if ( i < numFeatures ) {
+            double lon = 7.0 + 4.0 * rand() / RAND_MAX;
+            double lat = 45.0 + 4.0 * rand() / RAND_MAX;
+            double r   = 0.002 + 0.01 * rand() / RAND_MAX;
+
+            for ( unsigned int p=0; p<RING_POINTS; p++ ) {
+                double a = -2.0 * M_PI * p / RING_POINTS;
+                ring.addPoint( lon + r * cos( a ), lat + r * sin( a ) );
+            }
+        } else {
+            unsigned int s = i - numFeatures;
+            strip( 9.1 + 0.03 * s, 47.1 + 0.03 * s, ring );
+        }
+        ring.closeRings();
+
+        OGRPolygon poly;
+        poly.addRing( &ring );
+
+        OGREnvelope env;
+        poly.getEnvelope( &env );
+        envs.push_back( env );
+
+        poly.transform( poCT );
+
+        OGRFeature* poFeature = OGRFeature::CreateFeature( poLayer->GetLayerDefn() );
+        poFeature->SetGeometry( &poly );
+        poLayer->CreateFeature( poFeature );
+        OGRFeature::DestroyFeature( poFeature );
+    }
+
+    OCTDestroyCoordinateTransformation( poCT );
+    GDALClose( poDS );
+
+    return true;
+}
+
+// with an extent, the features entirely inside it and the strips must be
+// decoded once, the others at most once
+static int decode( const std::string& path, const char* name, const std::vector<OGREnvelope>& envs, unsigned int numThreads, unsigned int queueSize, bool readAhead, double batchSize, const OGREnvelope* extent )
+{
+    unsigned int numFeatures = envs.size();
+
+    GDALDataset* poDS = (GDALDataset*)GDALOpenEx( path.c_str(), GDAL_OF_VECTOR, NULL, NULL, NULL );
+    OGRLayer*    poLayer = poDS->GetLayer( 0 );
+
+    std::vector<unsigned char>      seen( numFeatures, 0 );
+    SGMutex                         lock;
+    tgBoundedQueue<OGRFeature *>    workQueue( queueSize );
+    tgFeatureReader                 reader( poLayer );
+    std::vector<decodeThread *>     decoders;
+
+    reader.setBatchSize( batchSize );
+    if ( extent ) {
+        reader.setExtent( extent->MinX, extent->MinY, extent->MaxX, extent->MaxY );
+    }
+
+    long        rssBefore = tgProfile::peakRssKb();
+    SGTimeStamp t;
+    t.stamp();
+
+    for ( unsigned int i=0; i<numThreads && !readAhead; i++ ) {
+        decoders.push_back( new decodeThread( workQueue, poLayer->GetSpatialRef(), seen, lock ) );
+        decoders.back()->start();
+    }
+
+    OGRFeature* poFeature;
+    while ( ( poFeature = reader.next() ) != NULL ) {
+        workQueue.push( poFeature );
+    }
+    workQueue.close();
+
+    for ( unsigned int i=0; i<numThreads && readAhead; i++ ) {
+        decoders.push_back( new decodeThread( workQueue, poLayer->GetSpatialRef(), seen, lock ) );
+        decoders.back()->start();
+    }
+
+    for ( unsigned int i=0; i<decoders.size(); i++ ) {
+        decoders[i]->join();
+        delete decoders[i];
+    }
+
+    double secs = t.elapsedMSec() / 1000.0;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": " << reader.getNumRead() << " features in " << secs << " s - " <<
+            ( secs > 0.0 ? reader.getNumRead() / secs : 0.0 ) << " features/s, at most " << workQueue.peak() << " queued, " <<
+            "peak RSS + " << ( tgProfile::peakRssKb() - rssBefore ) / 1024 << " MB" );
+
+    GDALClose( poDS );
+
+    int errors = 0;
+    for ( unsigned int i=0; i<numFeatures; i++ ) {
+        bool required = !extent || extent->Contains( envs[i] ) || i >= numFeatures - NUM_STRIPS;
+
+        if ( seen[i] > 1 || ( required && seen[i] != 1 ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": feature " << i << " decoded " << (int)seen[i] << " times" );
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int numFeatures = 200000;
+    unsigned int numThreads  = 4;
+    unsigned int queueSize   = 1024;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "features", numFeatures );
+    options.add( "threads",  numThreads );
+    options.add( "queue",    queueSize, "features" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    GDALAllRegister();
+
+    simgear::Dir tmp = simgear::Dir::tempDir( "tgFeaturePipelineBench" );
+    std::string  path = tmp.path().str() + "/polys.shp";
+
+    std::vector<OGREnvelope> envs;
+    if ( !writeLayer( path, numFeatures, envs ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << path );
+        return 1;
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, numFeatures << " features, " << numThreads << " decoders:" );
+
+    OGREnvelope extent;
+    extent.MinX = 8.0;
+    extent.MinY = 46.0;
+    extent.MaxX = 10.0;
+    extent.MaxY = 48.0;
+
+    errors += decode( path, "bounded  ", envs, numThreads, queueSize, false, 0.0, NULL );
+    errors += decode( path, "batched  ", envs, numThreads, queueSize, false, 1.0, NULL );
+    errors += decode( path, "extent   ", envs, numThreads, queueSize, false, 0.5, &extent );
+    errors += decode( path, "unbounded", envs, numThreads, 0, true, 0.0, NULL );
+
+    tmp.remove( true );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
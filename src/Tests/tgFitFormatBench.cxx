@@ -0,0 +1,258 @@
+// tgFitFormatBench.cxx -- precision and parse time of the fitted node
+//                         formats
+//
+// Makes up --points fitted nodes the way terrafit does - on the grid of
+// a 1 arc second bucket array - plus a few at the ends of the lon / lat
+// and elevation ranges, and writes them as .fit.gz text, the way terrafit
+// used to, and as .fit.bin.gz.  Then checks
+//
+// - the binary file reads back exactly, the text to within its rounding
+// - tgArray prefers the binary file, and falls back to the text when the
+//   binary file is missing or isn't one
+// - a binary file claiming far more points than it holds is rejected
+//
+// and reports the average time of reading each format, --runs times, and
+// the size of the files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/lowlevel.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_array.hxx>
+
+#include "tg_test_util.hxx"
+
+// the text holds 8 decimals of degrees, and 2 of meters - and rounding
+// to them may be a hair over half the last decimal off
+#define TEXT_DEG_TOLERANCE  (0.5e-8 + 1e-12)
+#define TEXT_ELEV_TOLERANCE (0.005 + 1e-9)
+
+static long fileSize( const std::string& file )
+{
+    struct stat st;
+
+    return stat( file.c_str(), &st ) == 0 ? st.st_size : 0;
+}
+
+// terrafit's old output
+static bool writeText( const std::string& file, const std::vector<SGGeod>& points )
+{
+    gzFile fp = gzopen( file.c_str(), "wb9" );
+    if ( !fp ) {
+        return false;
+    }
+
+    gzprintf( fp, "%d\n", (int)points.size() );
+    for ( unsigned int i=0; i<points.size(); i++ ) {
+        gzprintf( fp, "%+03.8f %+02.8f %0.2f\n",
+                  points[i].getLongitudeDeg(), points[i].getLatitudeDeg(), points[i].getElevationM() );
+    }
+
+    return gzclose( fp ) == Z_OK;
+}
+
+static int compare( const char* name, const std::vector<SGGeod>& expected, const std::vector<SGGeod>& points, double degTol, double elevTol )
+{
+    double maxDeg = 0.0, maxElev = 0.0;
+    int    errors = 0;
+
+    if ( points.size() != expected.size() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": " << points.size() << " points, expected " << expected.size() );
+        return 1;
+    }
+
+    for ( unsigned int i=0; i<points.size(); i++ ) {
+        double dLon  = fabs( points[i].getLongitudeDeg() - expected[i].getLongitudeDeg() );
+        double dLat  = fabs( points[i].getLatitudeDeg() - expected[i].getLatitudeDeg() );
+        double dElev = fabs( points[i].getElevationM() - expected[i].getElevationM() );
+
+        maxDeg  = std::max( maxDeg, std::max( dLon, dLat ) );
+        maxElev = std::max( maxElev, dElev );
+
+        if ( dLon > degTol || dLat > degTol || dElev > elevTol ) {
+            if ( errors < 10 ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": point " << i << " is " << points[i] << ", expected " << expected[i] );
+            }
+            errors++;
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": " << points.size() << " points, max error " << maxDeg << " deg, " << maxElev << " m" );
+
+    return errors;
+}
+
+// what tgArray makes of the fitted files next to base
+static int load( const char* name, const std::string& base, const SGBucket& b, const std::vector<SGGeod>& expected, double degTol, double elevTol )
+{
+    tgArray array;
+    if ( !array.open( base ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << name << ": can't open " << base );
+        return 1;
+    }
+    array.parse( b );
+
+    return compare( name, expected, array.get_fitted_list(), degTol, elevTol );
+}
+
+static double timeRead( const std::string& file, unsigned int runs, size_t expected, int& errors )
+{
+    SGTimeStamp t;
+    t.stamp();
+
+    for ( unsigned int r=0; r<runs; r++ ) {
+        std::vector<SGGeod> points;
+
+        if ( !tgArray::read_fitted( file, points ) || points.size() != expected ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  can't read " << file );
+            errors++;
+            break;
+        }
+    }
+
+    return t.elapsedUSec() / 1000.0 / runs;
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int numPoints = 1000;
+    unsigned int runs = 100;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "points", numPoints );
+    options.add( "runs",   runs );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    if ( !runs ) {
+        runs = 1;
+    }
+
+    simgear::Dir tmp = simgear::Dir::tempDir( "tgFitFormatBench" );
+    SGBucket     b( SGGeod::fromDeg( -122.3, 37.6 ) );
+    std::string  base = tmp.path().str() + "/" + b.gen_index_str();
+
+    // an array for tgArray to open the fitted files with
+    {
+        tgArray zero;
+        zero.parse( b );
+
+        if ( !zero.write_raw( base, false ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << base << ".arr.raw" );
+            return 1;
+        }
+    }
+
+    std::vector<SGGeod> points;
+    double west  = ( b.get_center_lon() - 0.5 * b.get_width() ) * 3600.0;
+    double south = ( b.get_center_lat() - 0.5 * b.get_height() ) * 3600.0;
+    int    span_x = (int)( b.get_width() * 3600.0 ) + 1;
+    int    span_y = (int)( b.get_height() * 3600.0 ) + 1;
+
+    srand( 19 );
+    for ( unsigned int i=0; i<numPoints; i++ ) {
+        int x = rand() % span_x;
+        int y = rand() % span_y;
+
+        points.push_back( SGGeod::fromDegM( ( west + x ) / 3600.0, ( south + y ) / 3600.0, rand() % 4000 - 100 ) );
+    }
+    points.push_back( SGGeod::fromDegM( -180.0, -90.0, -32767.0 ) );
+    points.push_back( SGGeod::fromDegM( 179.99972222, 89.99972222, 8848.86 ) );
+    points.push_back( SGGeod::fromDegM( 1.0 / 3.0, -2.0 / 3.0, 0.005 ) );
+
+    std::string binFile  = base + ".fit.bin.gz";
+    std::string textFile = base + ".fit.gz";
+
+    if ( !writeText( textFile, points ) || !tgArray::write_fitted( base, points ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write the fitted files" );
+        return 1;
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "round trip:" );
+    {
+        std::vector<SGGeod> bin, text;
+
+        if ( !tgArray::read_fitted( binFile, bin ) || !tgArray::read_fitted( textFile, text ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "can't read the fitted files" );
+            return 1;
+        }
+
+        errors += compare( ".fit.bin.gz", points, bin, 0.0, 0.0 );
+        errors += compare( ".fit.gz     ", points, text, TEXT_DEG_TOLERANCE, TEXT_ELEV_TOLERANCE );
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "tgArray:" );
+    errors += load( "both           ", base, b, points, 0.0, 0.0 );
+
+    // parse time, while both are there
+    double binMs  = timeRead( binFile, runs, points.size(), errors );
+    double textMs = timeRead( textFile, runs, points.size(), errors );
+
+    rename( binFile.c_str(), ( binFile + ".bak" ).c_str() );
+    errors += load( "text only      ", base, b, points, TEXT_DEG_TOLERANCE, TEXT_ELEV_TOLERANCE );
+
+    {
+        gzFile fp = gzopen( binFile.c_str(), "wb" );
+        gzprintf( fp, "%d\n", 1 );
+        gzclose( fp );
+    }
+    errors += load( "not binary     ", base, b, points, TEXT_DEG_TOLERANCE, TEXT_ELEV_TOLERANCE );
+
+    // the count must not size the read - only two points follow
+    {
+        std::string hugeFile = tmp.path().str() + "/huge.fit.bin.gz";
+        gzFile fp = gzopen( hugeFile.c_str(), "wb" );
+        double coords[6] = { 7.0, 46.0, 500.0, 7.5, 46.5, 600.0 };
+
+        sgWriteLong( fp, 0x54474654 );
+        sgWriteLong( fp, 1 );
+        sgWriteLong( fp, 0x7fffffff );
+        sgWriteDouble( fp, 6, coords );
+        gzclose( fp );
+
+        std::vector<SGGeod> huge;
+        if ( tgArray::read_fitted( hugeFile, huge ) || !huge.empty() ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  huge count: read " << huge.size() << " points" );
+            errors++;
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, points.size() << " points, average of " << runs << " reads:" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  .fit.gz      " << textMs << " ms, " << fileSize( textFile ) / 1024.0 << " KB" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  .fit.bin.gz  " << binMs << " ms, " << fileSize( binFile + ".bak" ) / 1024.0 << " KB" );
+
+    tmp.remove( true );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+// tgIntersectionDebugBench.cxx -- cost of the intersection debug shapefiles
+//
+// Runs tgIntersectionGenerator over a large synthetic street grid with the
+// debug output off, buffered and full, and reports the wall time each run
+// took, and what turning the debug output off saves.  For buffered output,
+// the time the background writer needs to catch up is reported apart.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <string>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_debug_shapefile.hxx>
+#include <terragear/vector_intersections/tg_intersection_generator.hxx>
+
+#include "tg_test_util.hxx"
+
+static int texInfo( unsigned int info, bool cap, std::string& material, double& atlas_startu, double& atlas_endu, double& atlas_startv, double& atlas_endv, double& v_dist )
+{
+    material     = "lf_street";
+    atlas_startu = 0.0;
+    atlas_endu   = 1.0;
+    atlas_startv = cap ? 0.9 : 0.0;
+    atlas_endv   = cap ? 1.0 : 0.9;
+    v_dist       = 20.0;
+
+    return 0;
+}
+
+static int64_t run( tgDebugShapefile::level_t level, const char* name, unsigned int size, unsigned int& numEdges )
+{
+    const double spacing = 0.001;
+
+    tgIntersectionGenerator ig( name, 0, 0, texInfo );
+    ig.SetDebugLevel( level );
+
+    for ( unsigned int y=0; y<size; y++ ) {
+        for ( unsigned int x=0; x<size; x++ ) {
+            SGGeod cur = SGGeod::fromDeg( 10.0 + x * spacing, 45.0 + y * spacing );
+
+            if ( x+1 < size ) {
+                ig.Insert( cur, SGGeod::fromDeg( 10.0 + (x+1) * spacing, 45.0 + y * spacing ), 8.0, 0, 1 );
+            }
+            if ( y+1 < size ) {
+                ig.Insert( cur, SGGeod::fromDeg( 10.0 + x * spacing, 45.0 + (y+1) * spacing ), 8.0, 0, 1 );
+            }
+        }
+    }
+
+    SGTimeStamp t;
+    t.stamp();
+
+    ig.Execute();
+    numEdges = ig.edges_size();
+
+    return t.elapsedMSec();
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int size = 100;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "grid", size, "streets" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    unsigned int numEdges;
+
+    int64_t offMs  = run( tgDebugShapefile::DEBUG_OFF, "debug_bench_off", size, numEdges );
+    int64_t fullMs = run( tgDebugShapefile::DEBUG_FULL, "debug_bench_full", size, numEdges );
+    int64_t bufMs  = run( tgDebugShapefile::DEBUG_BUFFERED, "debug_bench_buffered", size, numEdges );
+
+    SGTimeStamp t;
+    t.stamp();
+    tgDebugShapefile::sync();
+    int64_t writerMs = t.elapsedMSec();
+
+    SG_LOG( SG_GENERAL, SG_ALERT, numEdges << " edges:" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  debug off      " << offMs << " ms" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  debug buffered " << bufMs << " ms ( + " << writerMs << " ms background write after the run )" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  debug full     " << fullMs << " ms" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  off saves " << fullMs - offMs << " ms over full, " << bufMs - offMs << " ms over buffered" );
+
+    return 0;
+}
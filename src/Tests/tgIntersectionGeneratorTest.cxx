@@ -0,0 +1,184 @@
+// tgIntersectionGeneratorTest.cxx -- determinism test for tgIntersectionGenerator
+//
+// Generates the edge polygons of a synthetic street network - a grid of
+// two street types, with diagonals and dead ends, and south of it a row of
+// acute forks whose branches start with a few meter long segment, so the
+// bisector of the fork runs past its end and the multi segment walk goes
+// on to the next edge - once on a single thread, and once on a pool of
+// worker threads.  Every edge must get the same polygon and texture
+// information either way.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cstdlib>
+#include <string>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/math/sg_geodesy.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/vector_intersections/tg_intersection_generator.hxx>
+
+#include "tg_test_util.hxx"
+
+#define STREET_WIDTH    (8.0)
+#define FORK_STUB       (3.0)       // meters - well inside the street width
+
+// called from the workers - no state
+static int texInfo( unsigned int info, bool cap, std::string& material, double& atlas_startu, double& atlas_endu, double& atlas_startv, double& atlas_endv, double& v_dist )
+{
+    material     = ( info == 1 ) ? "lf_street" : "lf_road";
+    atlas_startu = ( info == 1 ) ? 0.0 : 0.5;
+    atlas_endu   = atlas_startu + 0.5;
+    atlas_startv = cap ? 0.9 : 0.0;
+    atlas_endv   = cap ? 1.0 : 0.9;
+    v_dist       = ( info == 1 ) ? 20.0 : 35.0;
+
+    return 0;
+}
+
+static void addStreets( tgIntersectionGenerator& ig, unsigned int size )
+{
+    const double spacing = 0.001;
+
+    srand( 3 );
+
+    for ( unsigned int y=0; y<size; y++ ) {
+        for ( unsigned int x=0; x<size; x++ ) {
+            SGGeod cur = SGGeod::fromDeg( 10.0 + x * spacing, 45.0 + y * spacing );
+
+            // every fourth row and column is a road
+            if ( x+1 < size ) {
+                ig.Insert( cur, SGGeod::fromDeg( 10.0 + (x+1) * spacing, 45.0 + y * spacing ), STREET_WIDTH, 0, ( y % 4 ) ? 1 : 2 );
+            }
+            if ( y+1 < size && rand() % 8 ) {
+                ig.Insert( cur, SGGeod::fromDeg( 10.0 + x * spacing, 45.0 + (y+1) * spacing ), STREET_WIDTH, 0, ( x % 4 ) ? 1 : 2 );
+            }
+
+            // a few diagonals, and dead ends into the blocks
+            if ( x+1 < size && y+1 < size && rand() % 10 == 0 ) {
+                ig.Insert( cur, SGGeod::fromDeg( 10.0 + (x+1) * spacing, 45.0 + (y+1) * spacing ), STREET_WIDTH, 0, 1 );
+            } else if ( rand() % 10 == 0 ) {
+                ig.Insert( cur, SGGeod::fromDeg( 10.0 + (x+0.4) * spacing, 45.0 + (y+0.3) * spacing ), STREET_WIDTH, 0, 1 );
+            }
+        }
+    }
+}
+
+static SGGeod offset( const SGGeod& p, double heading, double dist )
+{
+    return SGGeodesy::direct( p, heading, dist );
+}
+
+// a street running east, and one or two branches forking off it at 10 to
+// 30 degrees - each a short stub, then bending a little further away
+static void addForks( tgIntersectionGenerator& ig, unsigned int size )
+{
+    srand( 7 );
+
+    for ( unsigned int x=0; x<size; x++ ) {
+        SGGeod       fork  = SGGeod::fromDeg( 10.0 + x * 0.002, 44.98 );
+        double       angle = 10.0 + 20.0 * rand() / RAND_MAX;
+        unsigned int type  = ( x % 2 ) ? 1 : 2;
+
+        ig.Insert( fork, offset( fork, 90.0, 120.0 ), STREET_WIDTH, 0, type );
+
+        SGGeod stub = offset( fork, 90.0 - angle, FORK_STUB );
+        ig.Insert( fork, stub, STREET_WIDTH, 0, type );
+        ig.Insert( stub, offset( stub, 90.0 - angle - 5.0, 80.0 ), STREET_WIDTH, 0, type );
+
+        if ( rand() % 2 ) {
+            stub = offset( fork, 90.0 + angle, FORK_STUB );
+            ig.Insert( fork, stub, STREET_WIDTH, 0, 3 - type );
+            ig.Insert( stub, offset( stub, 90.0 + angle + 5.0, 80.0 ), STREET_WIDTH, 0, 3 - type );
+        }
+    }
+}
+
+static int64_t generate( tgIntersectionGenerator& ig, unsigned int size, unsigned int numThreads )
+{
+    addStreets( ig, size );
+    addForks( ig, size );
+    ig.SetNumThreads( numThreads );
+
+    SGTimeStamp t;
+    t.stamp();
+
+    ig.Execute();
+
+    return t.elapsedMSec();
+}
+
+static bool sameMeta( const tgPolygonSetMeta& a, const tgPolygonSetMeta& b )
+{
+    return a.material == b.material && a.method == b.method &&
+           a.reflon == b.reflon && a.reflat == b.reflat && a.length == b.length && a.heading == b.heading &&
+           a.minu == b.minu && a.maxu == b.maxu && a.minv == b.minv && a.maxv == b.maxv;
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int numThreads = 4;
+    unsigned int size = 24;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "threads", numThreads );
+    options.add( "grid",    size, "streets" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    tgIntersectionGenerator serial( "intersection_test_serial", 0, 0, texInfo );
+    tgIntersectionGenerator parallel( "intersection_test_parallel", 0, 0, texInfo );
+
+    int64_t serialMs   = generate( serial, size, 1 );
+    int64_t parallelMs = generate( parallel, size, numThreads );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, serial.edges_size() << " edges: 1 thread " << serialMs << " ms, " << numThreads << " threads " << parallelMs << " ms" );
+
+    if ( serial.edges_size() != parallel.edges_size() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "edge count differs: " << serial.edges_size() << " / " << parallel.edges_size() );
+        errors++;
+    } else {
+        tgintersectionedge_it sit = serial.edges_begin();
+        tgintersectionedge_it pit = parallel.edges_begin();
+        unsigned int          idx = 0;
+
+        for ( ; sit != serial.edges_end(); sit++, pit++, idx++ ) {
+            tgPolygonSet sp = (*sit)->GetPoly( "serial" );
+            tgPolygonSet pp = (*pit)->GetPoly( "parallel" );
+
+            std::vector<cgalPoly_Segment> ssegs, psegs;
+            sp.toSegments( ssegs, false );
+            pp.toSegments( psegs, false );
+
+            if ( ssegs != psegs ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "edge " << idx << " polygon differs: " << ssegs.size() << " / " << psegs.size() << " segments" );
+                errors++;
+            } else if ( !sameMeta( sp.getMeta(), pp.getMeta() ) ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "edge " << idx << " texture differs" );
+                errors++;
+            }
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
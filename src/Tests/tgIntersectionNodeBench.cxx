@@ -0,0 +1,187 @@
+// tgIntersectionNodeBench.cxx -- benchmark tgIntersectionNodeList lookups
+//
+// Builds the node graph of a synthetic grid road network the way
+// tgIntersectionGenerator::Execute does - a node lookup for both ends of
+// every segment, and an edge for every segment whose ends differ.  Some
+// segment ends are moved by less than the SGGeod_isEqual2D tolerance, and
+// some segments are too short to survive.  The hashed node list is timed
+// at full size, and compared against the linear scan it replaced, which
+// must give the same nodes and edges.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cstdlib>
+#include <string>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_misc.hxx>
+#include <terragear/vector_intersections/tg_intersection_node.hxx>
+
+#include "tg_test_util.hxx"
+
+// the node list as it was - a linear scan for every lookup
+class listNodeList
+{
+public:
+    ~listNodeList() {
+        for ( unsigned int i=0; i<nodes.size(); i++ ) {
+            delete nodes[i];
+        }
+    }
+
+    tgIntersectionNode* Add( const edgeArrPoint& loc ) {
+        SGGeod gPos = SGGeod::fromDeg( CGAL::to_double(loc.x()), CGAL::to_double(loc.y()) );
+
+        for ( unsigned int i=0; i<nodes.size(); i++ ) {
+            if ( SGGeod_isEqual2D( nodes[i]->GetPosition(), gPos ) ) {
+                return nodes[i];
+            }
+        }
+
+        nodes.push_back( new tgIntersectionNode( loc ) );
+        return nodes.back();
+    }
+
+    unsigned int size( void ) const { return nodes.size(); }
+    tgIntersectionNode* operator[]( int index ) { return nodes[index]; }
+
+private:
+    tgintersectionnode_list nodes;
+};
+
+struct gridSegment {
+    edgeArrPoint start;
+    edgeArrPoint end;
+};
+
+// streets on a square grid, a few ends slightly off the grid point
+static void generateGrid( unsigned int size, unsigned int seed, std::vector<gridSegment>& segs )
+{
+    const double spacing = 0.0005;
+    const double jitter  = 0.0000000004;
+
+    srand( seed );
+
+    std::vector<edgeArrPoint> ends;
+    for ( unsigned int y=0; y<size; y++ ) {
+        for ( unsigned int x=0; x<size; x++ ) {
+            double lon = 10.0 + x * spacing;
+            double lat = 45.0 + y * spacing;
+
+            for ( unsigned int dir=0; dir<2; dir++ ) {
+                unsigned int nx = x + ( dir == 0 ? 1 : 0 );
+                unsigned int ny = y + ( dir == 1 ? 1 : 0 );
+                if ( nx >= size || ny >= size ) {
+                    continue;
+                }
+
+                double nlon = 10.0 + nx * spacing;
+                double nlat = 45.0 + ny * spacing;
+                if ( rand() % 10 == 0 ) {
+                    nlon += jitter * ( (double)rand() / RAND_MAX - 0.5 );
+                    nlat += jitter * ( (double)rand() / RAND_MAX - 0.5 );
+                }
+
+                gridSegment seg;
+                seg.start = edgeArrPoint( lon, lat );
+                seg.end   = edgeArrPoint( nlon, nlat );
+                segs.push_back( seg );
+
+                // a degenerate segment now and then
+                if ( rand() % 50 == 0 ) {
+                    seg.end = edgeArrPoint( lon + jitter, lat );
+                    segs.push_back( seg );
+                }
+            }
+        }
+    }
+}
+
+template <typename L>
+static int64_t buildGraph( L& nodelist, const std::vector<gridSegment>& segs, unsigned int& numEdges )
+{
+    SGTimeStamp t;
+    t.stamp();
+
+    numEdges = 0;
+    for ( unsigned int i=0; i<segs.size(); i++ ) {
+        tgIntersectionNode* start = nodelist.Add( segs[i].start );
+        tgIntersectionNode* end   = nodelist.Add( segs[i].end );
+
+        if ( start != end ) {
+            numEdges++;
+        }
+    }
+
+    return t.elapsedMSec();
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int gridSize = 240;
+    unsigned int refGridSize = 80;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "grid",           gridSize, "streets" );
+    options.add( "reference-grid", refGridSize, "streets" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    // the linear scan is too slow to run at full size
+    std::vector<gridSegment> segs;
+    generateGrid( refGridSize, 1, segs );
+
+    tgIntersectionNodeList hashList;
+    listNodeList           linearList;
+    unsigned int           hashEdges, linearEdges;
+
+    int64_t hashMs   = buildGraph( hashList, segs, hashEdges );
+    int64_t linearMs = buildGraph( linearList, segs, linearEdges );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, segs.size() << " segments: hashed " << hashMs << " ms, linear " << linearMs << " ms" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  nodes " << hashList.size() << " / " << linearList.size() << ", edges " << hashEdges << " / " << linearEdges );
+
+    if ( hashList.size() != linearList.size() || hashEdges != linearEdges ) {
+        errors++;
+    } else {
+        for ( unsigned int i=0; i<hashList.size(); i++ ) {
+            if ( !SGGeod_isEqual2D( hashList[i]->GetPosition(), linearList[i]->GetPosition() ) ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "node " << i << " differs" );
+                errors++;
+            }
+        }
+    }
+
+    // full size
+    segs.clear();
+    generateGrid( gridSize, 2, segs );
+
+    tgIntersectionNodeList bigList;
+    unsigned int           bigEdges;
+
+    hashMs = buildGraph( bigList, segs, bigEdges );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, segs.size() << " segments: hashed " << hashMs << " ms, " << bigList.size() << " nodes, " << bigEdges << " edges" );
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
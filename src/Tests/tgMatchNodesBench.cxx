@@ -0,0 +1,198 @@
+// tgMatchNodesBench.cxx -- shared edge matching with the kd-trees and the
+//                          sorted merge
+//
+// Makes up the four shared edges of a tile with a dense coastline - each
+// with --nodes nodes on the current tile, and its neighbor's nodes: most
+// the same, some a hair off, some close enough to merge, some far enough
+// apart to be added, and a few duplicates, as where two buckets meet on a
+// northern or southern edge.  Then matches every edge, --runs times, with
+// the kd-trees stage 2 used to build, and with the merge of the edges
+// sorted along them, as loadTriangulation sorts them, and reports the
+// average time of each.  Both must add and move the same nodes.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/mesh/tg_mesh.hxx>
+
+#include "tg_test_util.hxx"
+
+static double frand( void )
+{
+    return rand() / ( RAND_MAX + 1.0 );
+}
+
+static bool lessX( const meshVertexInfo& a, const meshVertexInfo& b )
+{
+    return a.getX() < b.getX();
+}
+
+static bool lessY( const meshVertexInfo& a, const meshVertexInfo& b )
+{
+    return a.getY() < b.getY();
+}
+
+// nodes along one edge of b - the current tile's, with a vertex in cdt
+// each, and the neighbor's
+static void makeEdge( const SGBucket& b, edgeType edge, int numNodes, int& nextId, meshTriCDT& cdt,
+                      std::map<int, meshTriVertexHandle>& handles,
+                      std::vector<meshVertexInfo>& current, std::vector<meshVertexInfo>& neighbor )
+{
+    bool   alongLon = ( edge == NORTH_EDGE || edge == SOUTH_EDGE );
+    double minPos, span, fixed;
+
+    if ( alongLon ) {
+        minPos = b.get_center_lon() - 0.5 * b.get_width();
+        span   = b.get_width();
+        fixed  = b.get_center_lat() + ( edge == NORTH_EDGE ? 0.5 : -0.5 ) * b.get_height();
+    } else {
+        minPos = b.get_center_lat() - 0.5 * b.get_height();
+        span   = b.get_height();
+        fixed  = b.get_center_lon() + ( edge == EAST_EDGE ? 0.5 : -0.5 ) * b.get_width();
+    }
+
+    for ( int i=0; i<numNodes; i++ ) {
+        double pos = minPos + span * frand();
+
+        // the edge nodes are found within 5e-8 degrees of the edge
+        double off = 8e-8 * ( frand() - 0.5 );
+
+        meshTriPoint p = alongLon ? meshTriPoint( pos, fixed + off ) : meshTriPoint( fixed + off, pos );
+        int          id = nextId++;
+
+        handles[id] = cdt.insert( p );
+        current.push_back( meshVertexInfo( id, p, 0.0 ) );
+
+        double kind = frand();
+        double move = 0.0;
+
+        if ( kind < 0.65 ) {
+            // the same node
+        } else if ( kind < 0.75 ) {
+            // a hair off - still the same
+            move = 2e-7 * ( frand() - 0.5 );
+        } else if ( kind < 0.85 ) {
+            // close enough to merge
+            move = 1e-6 + 5e-5 * frand();
+        } else if ( kind < 0.95 ) {
+            // not on the neighbor edge
+            continue;
+        } else {
+            // only on the neighbor edge
+            move = 2e-4 + 1e-3 * frand();
+        }
+
+        meshTriPoint np = alongLon ? meshTriPoint( pos + move, fixed + off ) : meshTriPoint( fixed + off, pos + move );
+        neighbor.push_back( meshVertexInfo( -1, np, 0.0 ) );
+
+        // corners of buckets meeting on the edge
+        if ( kind > 0.998 ) {
+            neighbor.push_back( meshVertexInfo( -1, np, 0.0 ) );
+        }
+    }
+
+    if ( alongLon ) {
+        std::sort( current.begin(), current.end(), lessX );
+        std::sort( neighbor.begin(), neighbor.end(), lessX );
+    } else {
+        std::sort( current.begin(), current.end(), lessY );
+        std::sort( neighbor.begin(), neighbor.end(), lessY );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    int numNodes = 12000;
+    int runs = 5;
+    int errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "nodes", numNodes, "per edge" );
+    options.add( "runs",  runs );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    if ( runs < 1 ) {
+        runs = 1;
+    }
+
+    SGBucket                            b( SGGeod::fromDeg( -4.9, 56.6 ) );
+    meshTriCDT                          cdt;
+    std::map<int, meshTriVertexHandle>  handles;
+    std::vector<meshVertexInfo>         current[4], neighbor[4];
+    int                                 nextId = 1;
+    const char*                         edgestr[4] = { "north", "south", "east ", "west " };
+
+    srand( 31 );
+    for ( int e=0; e<4; e++ ) {
+        makeEdge( b, (edgeType)e, numNodes, nextId, cdt, handles, current[e], neighbor[e] );
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "bucket " << b.gen_index_str() << ", average of " << runs << " runs:" );
+
+    double kdTotal = 0.0, mergeTotal = 0.0;
+
+    for ( int e=0; e<4; e++ ) {
+        std::vector<meshTriPoint> kdAdded, mergeAdded;
+        std::vector<movedNode>    kdMoved, mergeMoved;
+        SGTimeStamp               t;
+
+        t.stamp();
+        for ( int r=0; r<runs; r++ ) {
+            kdAdded.clear();
+            kdMoved.clear();
+            tgMeshTriangulation::matchNodesKdTree( current[e], neighbor[e], handles, kdAdded, kdMoved );
+        }
+        double kdMs = t.elapsedUSec() / 1000.0 / runs;
+
+        t.stamp();
+        for ( int r=0; r<runs; r++ ) {
+            mergeAdded.clear();
+            mergeMoved.clear();
+            tgMeshTriangulation::matchNodesMerge( (edgeType)e, current[e], neighbor[e], handles, mergeAdded, mergeMoved );
+        }
+        double mergeMs = t.elapsedUSec() / 1000.0 / runs;
+
+        kdTotal    += kdMs;
+        mergeTotal += mergeMs;
+
+        bool same = tgMeshTriangulation::sameMatch( kdAdded, kdMoved, mergeAdded, mergeMoved );
+        if ( !same ) {
+            errors++;
+        }
+
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << edgestr[e] << ": " << current[e].size() << " current, " << neighbor[e].size() << " neighbor nodes, " <<
+                                      mergeAdded.size() << " added, " << mergeMoved.size() << " moved - kd-tree " << kdMs << " ms, merge " << mergeMs << " ms" <<
+                                      ( same ? "" : " - DIFFERENT" ) );
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "  tile : kd-tree " << kdTotal << " ms, merge " << mergeTotal << " ms" );
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
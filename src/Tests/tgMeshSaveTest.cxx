@@ -0,0 +1,209 @@
+// tgMeshSaveTest.cxx -- stress test for saving stage 1 tiles from
+//                       multiple threads
+//
+// Generates a grid of synthetic tiles, saves them all from a single
+// thread, then again from a pool of threads, and checks that every
+// file written by the threaded run is byte identical to the serial one.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <algorithm>
+#include <string>
+
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_bounded_queue.hxx>
+#include <terragear/tg_directory.hxx>
+#include <terragear/tg_mutex.hxx>
+#include <terragear/mesh/tg_mesh.hxx>
+
+#include "tg_test_util.hxx"
+
+struct tileJob {
+    tileJob() : mesh(NULL) {}
+    tileJob( tgMesh* m, const SGBucket& b ) : mesh(m), bucket(b) {}
+
+    tgMesh*     mesh;
+    SGBucket    bucket;
+};
+
+static std::string tilePath( const std::string& base, const SGBucket& b )
+{
+    return base + "/" + b.gen_base_path() + "/" + b.gen_index_str();
+}
+
+static void saveTile( const std::string& base, const tileJob& job )
+{
+    std::string path = tilePath( base, job.bucket );
+
+    tgMakeDirectory( path );
+    job.mesh->save( path );
+}
+
+class tgSaveThread : public SGThread
+{
+public:
+    tgSaveThread( tgBoundedQueue<tileJob>& q, const std::string& b ) : workQueue(q), base(b) {}
+
+private:
+    // the queue is closed before the threads start, so pop() only fails
+    // once it is empty
+    virtual void run() {
+        tileJob job;
+
+        while ( workQueue.pop( job ) ) {
+            saveTile( base, job );
+        }
+    }
+
+    tgBoundedQueue<tileJob>& workQueue;
+    std::string             base;
+};
+
+// a landclass island inside an ocean tile - enough to give the
+// arrangement, shared edges and TDS something to write
+static tgMesh* generateTile( const SGBucket& b, tgMutex* lock )
+{
+    std::vector<tgTestOutline> islands( 1 );
+    islands[0].push_back( SGVec2d( -0.30, -0.20 ) );
+    islands[0].push_back( SGVec2d(  0.10, -0.35 ) );
+    islands[0].push_back( SGVec2d(  0.35,  0.05 ) );
+    islands[0].push_back( SGVec2d(  0.05,  0.30 ) );
+    islands[0].push_back( SGVec2d( -0.25,  0.15 ) );
+
+    tgMesh* mesh = tgTestTile( b, islands, lock );
+    mesh->generate();
+
+    return mesh;
+}
+
+static void listFiles( const SGPath& dir, const std::string& rel, std::vector<std::string>& files )
+{
+    simgear::Dir d( dir );
+
+    simgear::PathList children = d.children( simgear::Dir::TYPE_FILE | simgear::Dir::TYPE_DIR | simgear::Dir::NO_DOT_OR_DOTDOT );
+    BOOST_FOREACH( const SGPath& p, children ) {
+        std::string name = rel.empty() ? p.file() : rel + "/" + p.file();
+
+        if ( p.isDir() ) {
+            listFiles( p, name, files );
+        } else {
+            files.push_back( name );
+        }
+    }
+}
+
+int main( int argc, char** argv )
+{
+    std::string work_dir    = "./tgMeshSaveTest";
+    int         num_tiles   = 256;
+    int         num_threads = boost::thread::hardware_concurrency();
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "work-dir", work_dir, "dir" );
+    options.add( "tiles",    num_tiles );
+    options.add( "threads",  num_threads );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    if ( num_threads < 2 ) {
+        num_threads = 2;
+    }
+
+    GDALAllRegister();
+
+    std::vector<SGBucket> buckets;
+    tgTestBlock( SGGeod::fromDeg( 10.01, 45.01 ), num_tiles, buckets );
+
+    tgMutex lock;
+    std::vector<tileJob> jobs;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "generating " << buckets.size() << " tiles" );
+    for ( unsigned int i=0; i<buckets.size(); i++ ) {
+        jobs.push_back( tileJob( generateTile( buckets[i], &lock ), buckets[i] ) );
+    }
+
+    // serial reference
+    std::string serialBase = work_dir + "/serial";
+    SGTimeStamp serialTime;
+    serialTime.stamp();
+    for ( unsigned int i=0; i<jobs.size(); i++ ) {
+        saveTile( serialBase, jobs[i] );
+    }
+    SG_LOG( SG_GENERAL, SG_ALERT, "serial save of " << jobs.size() << " tiles took " << serialTime.elapsedMSec() << " ms" );
+
+    // and the same tiles from all threads at once
+    std::string threadBase = work_dir + "/threaded";
+    tgBoundedQueue<tileJob> wq;
+    for ( unsigned int i=0; i<jobs.size(); i++ ) {
+        wq.push( jobs[i] );
+    }
+    wq.close();
+
+    SGTimeStamp threadTime;
+    threadTime.stamp();
+
+    std::vector<tgSaveThread*> savers;
+    for ( int i=0; i<num_threads; i++ ) {
+        savers.push_back( new tgSaveThread( wq, threadBase ) );
+        savers.back()->start();
+    }
+    for ( unsigned int i=0; i<savers.size(); i++ ) {
+        savers[i]->join();
+        delete savers[i];
+    }
+    SG_LOG( SG_GENERAL, SG_ALERT, "threaded save of " << jobs.size() << " tiles with " << num_threads << " threads took " << threadTime.elapsedMSec() << " ms" );
+
+    // compare
+    std::vector<std::string> serialFiles, threadFiles;
+    listFiles( SGPath( serialBase ), "", serialFiles );
+    listFiles( SGPath( threadBase ), "", threadFiles );
+
+    std::sort( serialFiles.begin(), serialFiles.end() );
+    std::sort( threadFiles.begin(), threadFiles.end() );
+
+    int errors = 0;
+    if ( serialFiles != threadFiles ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "file lists differ: serial has " << serialFiles.size() << " threaded has " << threadFiles.size() );
+        errors++;
+    } else {
+        for ( unsigned int i=0; i<serialFiles.size(); i++ ) {
+            if ( !tgTestSameContents( serialBase + "/" + serialFiles[i], threadBase + "/" + threadFiles[i] ) ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "contents differ: " << serialFiles[i] );
+                errors++;
+            }
+        }
+    }
+
+    for ( unsigned int i=0; i<jobs.size(); i++ ) {
+        delete jobs[i].mesh;
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, serialFiles.size() << " files compared, " << errors << " errors" );
+
+    return errors ? 1 : 0;
+}
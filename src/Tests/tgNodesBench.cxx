@@ -0,0 +1,166 @@
+// tgNodesBench.cxx -- benchmark TGNodes::unique_add
+//
+// Adds a tile's worth of random nodes, a fifth of them within the fuzz
+// tolerance of a node added before, interleaving inserts and lookups the
+// way the tile builders do.  The spatial hash is timed at full size, and
+// compared against the k-d tree TGNodes used to search, which must give
+// the same index for every node.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cstdlib>
+#include <string>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_nodes.hxx>
+
+#include "tg_test_util.hxx"
+
+// unique_add as it was - search a CGAL k-d tree, which rebuilds itself
+// on the first search after an insert
+typedef boost::tuple<TGNodePoint,double,unsigned int>                                                           refNodeData;
+typedef CGAL::Search_traits_adapter<refNodeData,CGAL::Nth_of_tuple_property_map<0, refNodeData>,TGNodeTraitsBase> refNodeTraits;
+typedef CGAL::Fuzzy_sphere<refNodeTraits>                                                                       refNodeFuzzyCir;
+typedef CGAL::Kd_tree<refNodeTraits>                                                                            refNodeTree;
+
+class refNodes
+{
+public:
+    refNodes() : numNodes(0) {}
+
+    unsigned int unique_add( SGGeod& p ) {
+        std::list<refNodeData> searchResults;
+        unsigned int           index;
+
+        TGNodePoint     pt( p.getLongitudeDeg(), p.getLatitudeDeg() );
+        refNodeFuzzyCir query_circle( pt, 0.0000001 );
+
+        tree.search( std::back_inserter( searchResults ), query_circle );
+
+        if ( searchResults.empty() ) {
+            index = numNodes++;
+            positions.push_back( p );
+            tree.insert( refNodeData( pt, p.getElevationM(), index ) );
+        } else {
+            index = boost::get<2>( searchResults.front() );
+            p = positions[index];
+        }
+
+        return index;
+    }
+
+    unsigned int size( void ) const { return numNodes; }
+
+private:
+    refNodeTree         tree;
+    std::vector<SGGeod> positions;
+    unsigned int        numNodes;
+};
+
+// random nodes in a tile - every fifth one a near duplicate of an earlier one
+static void generateNodes( unsigned int count, unsigned int seed, std::vector<SGGeod>& nodes )
+{
+    srand( seed );
+
+    for ( unsigned int i=0; i<count; i++ ) {
+        if ( i > 0 && rand() % 5 == 0 ) {
+            const SGGeod& dup = nodes[ rand() % nodes.size() ];
+            double dx = ( (double)rand() / RAND_MAX - 0.5 ) * 0.00000005;
+            double dy = ( (double)rand() / RAND_MAX - 0.5 ) * 0.00000005;
+
+            nodes.push_back( SGGeod::fromDegM( dup.getLongitudeDeg() + dx, dup.getLatitudeDeg() + dy, 100.0 ) );
+        } else {
+            nodes.push_back( SGGeod::fromDegM( 10.0 + 0.125 * rand() / RAND_MAX, 45.0 + 0.125 * rand() / RAND_MAX, 100.0 ) );
+        }
+    }
+}
+
+template <typename N>
+static int64_t addNodes( N& n, const std::vector<SGGeod>& nodes, std::vector<unsigned int>& indices )
+{
+    SGTimeStamp t;
+    t.stamp();
+
+    for ( unsigned int i=0; i<nodes.size(); i++ ) {
+        SGGeod p = nodes[i];
+        indices.push_back( n.unique_add( p ) );
+    }
+
+    return t.elapsedMSec();
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int count = 1000000;
+    unsigned int refCount = 20000;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "nodes",           count );
+    options.add( "reference-nodes", refCount );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    // the k-d tree is too slow to run at full size
+    std::vector<SGGeod>       nodes;
+    std::vector<unsigned int> hashIndices, refIndices;
+
+    generateNodes( refCount, 1, nodes );
+
+    TGNodes hashNodes;
+    int64_t hashMs = addNodes( hashNodes, nodes, hashIndices );
+
+    refNodes kdNodes;
+    int64_t kdMs = addNodes( kdNodes, nodes, refIndices );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, refCount << " adds: spatial hash " << hashMs << " ms, k-d tree " << kdMs << " ms, " <<
+                                  hashNodes.size() << " / " << kdNodes.size() << " unique nodes" );
+
+    if ( hashNodes.size() != kdNodes.size() ) {
+        errors++;
+    }
+    for ( unsigned int i=0; i<nodes.size(); i++ ) {
+        if ( hashIndices[i] != refIndices[i] ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "node " << i << " added as " << hashIndices[i] << ", k-d tree gave " << refIndices[i] );
+            errors++;
+        }
+    }
+
+    // full size - every lookup must find the node it was added as
+    nodes.clear();
+    hashIndices.clear();
+    generateNodes( count, 2, nodes );
+
+    TGNodes bigNodes;
+    hashMs = addNodes( bigNodes, nodes, hashIndices );
+
+    for ( unsigned int i=0; i<nodes.size(); i++ ) {
+        if ( bigNodes.find( nodes[i] ) != (int)hashIndices[i] ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "node " << i << " found as " << bigNodes.find( nodes[i] ) << ", added as " << hashIndices[i] );
+            errors++;
+        }
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, count << " adds: spatial hash " << hashMs << " ms, " << bigNodes.size() << " unique nodes" );
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
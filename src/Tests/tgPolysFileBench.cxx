@@ -0,0 +1,219 @@
+// tgPolysFileBench.cxx -- stage 1 load time and file count of the chopped
+//                         polygon containers
+//
+// Builds a dense synthetic bucket - many small polygons over many
+// materials - and stores it twice, the way the chopper used to, as one
+// shapefile per material in <index>/, and the way it does now, as a single
+// <index>.polys.gz.  Reports the files each needs, and the time stage 1
+// takes to load each back.  Both loads must give the same sets, with the
+// same area, for every material.  A polys file claiming far more surface
+// coefficients than it holds must be rejected.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#include <ogrsf_frmts.h>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/lowlevel.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/polygon_set/tg_polygon_set.hxx>
+
+#include "tg_test_util.hxx"
+
+#define RING_POINTS     (16)
+
+typedef std::map<std::string, double> areaMap;
+
+static void sumAreas( const tgPolygonSetList& polys, areaMap& areas, std::map<std::string, unsigned int>& counts )
+{
+    for ( unsigned int i=0; i<polys.size(); i++ ) {
+        areas[polys[i].getMeta().material]  += polys[i].totalArea();
+        counts[polys[i].getMeta().material] += 1;
+    }
+}
+
+static unsigned int countFiles( const SGPath& p )
+{
+    simgear::Dir      d( p );
+    simgear::PathList files = d.children( simgear::Dir::TYPE_FILE | simgear::Dir::NO_DOT_OR_DOTDOT );
+
+    return files.size();
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int numPolys     = 20000;
+    unsigned int numMaterials = 40;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "polys",     numPolys );
+    options.add( "materials", numMaterials );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    if ( !numMaterials ) {
+        numMaterials = 1;
+    }
+
+    // a bucket's worth of small rounded squares, round robin over the materials
+    tgPolygonSetList polys;
+    srand( 7 );
+
+    for ( unsigned int i=0; i<numPolys; i++ ) {
+        double lon = 10.0  + 0.125 * rand() / RAND_MAX;
+        double lat = 45.0  + 0.125 * rand() / RAND_MAX;
+        double r   = 0.0002 + 0.001 * rand() / RAND_MAX;
+
+        OGRLinearRing ring;
+        for ( unsigned int p=0; p<RING_POINTS; p++ ) {
+            double a = 2.0 * M_PI * p / RING_POINTS;
+            ring.addPoint( lon + r * cos( a ), lat + r * sin( a ) );
+        }
+        ring.closeRings();
+
+        OGRPolygon poly;
+        poly.addRing( &ring );
+
+        char material[32];
+        sprintf( material, "material_%02u", i % numMaterials );
+
+        tgPolygonSetMeta meta( tgPolygonSetMeta::META_TEXTURED, material );
+        polys.push_back( tgPolygonSet( &poly, meta ) );
+    }
+
+    simgear::Dir tmp = simgear::Dir::tempDir( "tgPolysFileBench" );
+    SGPath       shpDir( tmp.path() );
+    std::string  polysFile = tmp.path().str() + "/2900000.polys.gz";
+
+    shpDir.append( "2900000" );
+
+    // write both
+    GDALDataset* poDS = tgPolygonSet::openDatasource( shpDir.c_str() );
+    if ( !poDS ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't create " << shpDir.str() );
+        return 1;
+    }
+
+    std::map<std::string, OGRLayer*> layers;
+    for ( unsigned int i=0; i<polys.size(); i++ ) {
+        const std::string& material = polys[i].getMeta().material;
+
+        if ( layers.find( material ) == layers.end() ) {
+            layers[material] = tgPolygonSet::openLayer( poDS, wkbPolygon25D, tgPolygonSet::LF_ALL, material.c_str() );
+        }
+        polys[i].toShapefile( layers[material] );
+    }
+    GDALClose( poDS );
+
+    if ( !tgPolygonSet::toPolysFile( polysFile, polys ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << polysFile );
+        return 1;
+    }
+
+    // load them back, as stage 1 does
+    SGTimeStamp      t;
+    tgPolygonSetList shpPolys, binPolys;
+
+    t.stamp();
+    simgear::Dir      dir( shpDir );
+    simgear::PathList files = dir.children( simgear::Dir::TYPE_FILE );
+    for ( unsigned int i=0; i<files.size(); i++ ) {
+        if ( files[i].extension() == "shp" ) {
+            tgPolygonSetList layer;
+
+            tgPolygonSet::fromShapefile( files[i], layer );
+            shpPolys.insert( shpPolys.end(), layer.begin(), layer.end() );
+        }
+    }
+    int64_t shpMs = t.elapsedMSec();
+
+    t.stamp();
+    if ( !tgPolygonSet::fromPolysFile( polysFile, binPolys ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't read " << polysFile );
+        errors++;
+    }
+    int64_t binMs = t.elapsedMSec();
+
+    SG_LOG( SG_GENERAL, SG_ALERT, numPolys << " polys, " << numMaterials << " materials:" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  shapefiles " << countFiles( shpDir ) << " files, loaded in " << shpMs << " ms" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  polys file 1 file, loaded in " << binMs << " ms" );
+
+    // both must hold the same polygons
+    areaMap                             shpAreas, binAreas;
+    std::map<std::string, unsigned int> shpCounts, binCounts;
+
+    sumAreas( shpPolys, shpAreas, shpCounts );
+    sumAreas( binPolys, binAreas, binCounts );
+
+    if ( shpCounts != binCounts ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  got " << binPolys.size() << " sets from the polys file, " << shpPolys.size() << " from the shapefiles" );
+        errors++;
+    }
+
+    for ( areaMap::iterator it = shpAreas.begin(); it != shpAreas.end(); ++it ) {
+        double bin = binAreas[it->first];
+
+        if ( fabs( bin - it->second ) > 1e-9 * it->second ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  " << it->first << ": area " << bin << " from the polys file, " << it->second << " from the shapefiles" );
+            errors++;
+        }
+    }
+
+    // the coefficient count must not size the read - only two follow
+    {
+        std::string      hugeFile = tmp.path().str() + "/huge.polys.gz";
+        gzFile           fp = gzopen( hugeFile.c_str(), "wb" );
+        tgPolygonSetList huge;
+
+        sgWriteUInt( fp, 0x54475053 );
+        sgWriteUInt( fp, 1 );
+        sgWriteUInt( fp, 1 );
+
+        sgWriteInt( fp, 0 );
+        sgWriteString( fp, "Default" );
+        sgWriteInt( fp, 0 );
+        for ( int i=0; i<14; i++ ) {
+            sgWriteDouble( fp, 0.0 );
+        }
+        sgWriteUInt( fp, 0xffffffff );
+        sgWriteDouble( fp, 1.0 );
+        sgWriteDouble( fp, 2.0 );
+        gzclose( fp );
+
+        if ( tgPolygonSet::fromPolysFile( hugeFile, huge ) || !huge.empty() ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  huge coefficient count: read " << huge.size() << " sets" );
+            errors++;
+        }
+    }
+
+    tmp.remove( true );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,424 @@
+// tgRasterChopBench.cxx -- throughput of chopping a DEM into .arr.gz files
+//
+// Writes a synthetic 1 x 1 degree, 1 arc second GeoTIFF DEM and chops it
+// into buckets twice:
+//
+// legacy - the way gdalchop used to: a GDAL warp set up for every bucket,
+//          every sample written with its own sgWriteShort(), gzip level 9
+// cached - the way it does now: samples from the shared raster block cache,
+//          written in one go at --compression, on 1 and on --threads
+//          workers with their own dataset handles
+//
+// and reports the time each took and the size of the output.  All runs
+// must write the same arrays.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <gdal_priv.h>
+#include <gdalwarper.h>
+#include <ogr_spatialref.h>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/lowlevel.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_raster_block_cache.hxx>
+
+#include "tg_test_util.hxx"
+
+#define DEM_SIZE    (3601)
+#define DEM_LON     (7)
+#define DEM_LAT     (46)
+
+static const double pxSize = 1.0 / 3600.0;
+
+// hills, and a lake of nodata
+static bool writeDem( const std::string& path )
+{
+    GDALDriver* poDriver = GetGDALDriverManager()->GetDriverByName( "GTiff" );
+    if ( !poDriver ) {
+        return false;
+    }
+
+    GDALDataset* poDS = poDriver->Create( path.c_str(), DEM_SIZE, DEM_SIZE, 1, GDT_Int16, NULL );
+    if ( !poDS ) {
+        return false;
+    }
+
+    double geoXfrm[6] = { DEM_LON - pxSize * 0.5, pxSize, 0.0, DEM_LAT + 1 + pxSize * 0.5, 0.0, -pxSize };
+    poDS->SetGeoTransform( geoXfrm );
+
+    OGRSpatialReference wgs84;
+    wgs84.SetWellKnownGeogCS( "EPSG:4326" );
+
+    char* wkt;
+    wgs84.exportToWkt( &wkt );
+    poDS->SetProjection( wkt );
+    CPLFree( wkt );
+
+    GDALRasterBand* band = poDS->GetRasterBand( 1 );
+    band->SetNoDataValue( -32768 );
+
+    std::vector<short> line( DEM_SIZE );
+    for ( int y=0; y<DEM_SIZE; y++ ) {
+        for ( int x=0; x<DEM_SIZE; x++ ) {
+            double dx = x - 1800.0, dy = y - 1800.0;
+
+            if ( dx * dx + dy * dy < 200.0 * 200.0 ) {
+                line[x] = -32768;
+            } else {
+                line[x] = (short)( 1000.0 + 400.0 * sin( x * 0.004 ) * cos( y * 0.003 ) + ( ( x * 7 + y * 13 ) % 17 ) );
+            }
+        }
+        band->RasterIO( GF_Write, 0, y, DEM_SIZE, 1, &line[0], DEM_SIZE, 1, GDT_Int16, 0, 0 );
+    }
+
+    GDALClose( poDS );
+
+    return true;
+}
+
+struct benchBucket {
+    SGBucket    b;
+    int         min_x, min_y, span_x, span_y;
+    double      west, south;
+};
+
+static std::string arrayFile( const std::string& dir, const benchBucket& bb )
+{
+    return dir + "/" + bb.b.gen_index_str() + ".arr.gz";
+}
+
+static void writeHeader( gzFile fp, const benchBucket& bb )
+{
+    sgWriteLong( fp, 0x54474152 );
+    sgWriteInt( fp, bb.min_x ); sgWriteInt( fp, bb.min_y );
+    sgWriteInt( fp, bb.span_x ); sgWriteInt( fp, 1 );
+    sgWriteInt( fp, bb.span_y ); sgWriteInt( fp, 1 );
+}
+
+// the warp of gdalchop - a raster to WGS84 transformer scaled to the
+// bucket's grid
+struct warpGridInfo {
+    void*  genImgXfrm;
+    double x0, y0, step;
+};
+
+static int warpGridTransform( void* arg, int bDstToSrc, int nPointCount, double* x, double* y, double* z, int* panSuccess )
+{
+    warpGridInfo* info = (warpGridInfo*)arg;
+    int success;
+
+    if ( bDstToSrc ) {
+        for ( int i=0; i<nPointCount; i++ ) {
+            x[i] = info->x0 + info->step * x[i];
+            y[i] = info->y0 + info->step * y[i];
+        }
+        success = GDALGenImgProjTransform( info->genImgXfrm, bDstToSrc, nPointCount, x, y, z, panSuccess );
+    } else {
+        success = GDALGenImgProjTransform( info->genImgXfrm, bDstToSrc, nPointCount, x, y, z, panSuccess );
+        for ( int i=0; i<nPointCount; i++ ) {
+            x[i] = ( x[i] - info->x0 ) / info->step;
+            y[i] = ( y[i] - info->y0 ) / info->step;
+        }
+    }
+
+    return success;
+}
+
+static void chopLegacy( GDALDataset* poDS, const benchBucket& bb, const std::string& dir )
+{
+    std::vector<int> buffer( bb.span_x * bb.span_y, 0 );
+
+    OGRSpatialReference wgs84;
+    wgs84.SetWellKnownGeogCS( "EPSG:4326" );
+
+    char* wkt;
+    wgs84.exportToWkt( &wkt );
+
+    warpGridInfo info;
+    info.genImgXfrm = GDALCreateGenImgProjTransformer( poDS, NULL, NULL, wkt, FALSE, 0.0, 1 );
+    info.x0   = bb.west - pxSize * 0.5;
+    info.y0   = bb.south - pxSize * 0.5;
+    info.step = pxSize;
+    CPLFree( wkt );
+
+    int    srcBand = 1, dstBand = 1;
+    int    hasNodata;
+    double nodataReal = poDS->GetRasterBand( 1 )->GetNoDataValue( &hasNodata );
+    double nodataImag = 0.0;
+
+    GDALWarpOptions* psWarpOptions = GDALCreateWarpOptions();
+    psWarpOptions->hSrcDS            = poDS;
+    psWarpOptions->nBandCount        = 1;
+    psWarpOptions->panSrcBands       = &srcBand;
+    psWarpOptions->panDstBands       = &dstBand;
+    psWarpOptions->padfSrcNoDataReal = hasNodata ? &nodataReal : NULL;
+    psWarpOptions->padfSrcNoDataImag = hasNodata ? &nodataImag : NULL;
+    psWarpOptions->eResampleAlg      = GRA_NearestNeighbour;
+    psWarpOptions->eWorkingDataType  = GDT_Int32;
+    psWarpOptions->pfnTransformer    = warpGridTransform;
+    psWarpOptions->pTransformerArg   = &info;
+
+    GDALWarpOperation oOperation;
+    oOperation.Initialize( psWarpOptions );
+    oOperation.WarpRegionToBuffer( 0, 0, bb.span_x, bb.span_y, &buffer[0], GDT_Int32 );
+
+    psWarpOptions->panSrcBands       = NULL;
+    psWarpOptions->panDstBands       = NULL;
+    psWarpOptions->padfSrcNoDataReal = NULL;
+    psWarpOptions->padfSrcNoDataImag = NULL;
+    GDALDestroyWarpOptions( psWarpOptions );
+    GDALDestroyGenImgProjTransformer( info.genImgXfrm );
+
+    gzFile fp = gzopen( arrayFile( dir, bb ).c_str(), "wb9" );
+    writeHeader( fp, bb );
+    for ( int x=0; x<bb.span_x; x++ ) {
+        for ( int y=0; y<bb.span_y; y++ ) {
+            sgWriteShort( fp, buffer[ y * bb.span_x + x ] );
+        }
+    }
+    gzclose( fp );
+}
+
+class chopThread : public SGThread
+{
+public:
+    chopThread( const std::string& p, const std::vector<benchBucket>& b, const std::string& d, int l, unsigned int& n, SGMutex& m ) :
+        path(p), buckets(b), dir(d), level(l), next(n), lock(m) {}
+
+private:
+    virtual void run() {
+        GDALDataset* poDS = (GDALDataset*)GDALOpen( path.c_str(), GA_ReadOnly );
+        double       geoXfrm[6];
+
+        poDS->GetGeoTransform( geoXfrm );
+
+        char mode[8];
+        sprintf( mode, "wb%d", level );
+
+        while ( true ) {
+            unsigned int cur;
+            {
+                SGGuard<SGMutex> g( lock );
+                cur = next++;
+            }
+            if ( cur >= buckets.size() ) {
+                break;
+            }
+
+            const benchBucket& bb = buckets[cur];
+            std::vector<int>   buffer( bb.span_x * bb.span_y, 0 );
+
+            tgRasterBlockCache::instance().sampleGrid( path, poDS->GetRasterBand( 1 ), geoXfrm,
+                                                       bb.west, bb.south, pxSize, pxSize,
+                                                       bb.span_x, bb.span_y, &buffer[0] );
+
+            std::vector<int16_t> samples( bb.span_x * bb.span_y );
+            for ( int x=0; x<bb.span_x; x++ ) {
+                for ( int y=0; y<bb.span_y; y++ ) {
+                    samples[ x * bb.span_y + y ] = buffer[ y * bb.span_x + x ];
+                }
+            }
+
+            gzFile fp = gzopen( arrayFile( dir, bb ).c_str(), mode );
+            writeHeader( fp, bb );
+            sgWriteShort( fp, samples.size(), &samples[0] );
+            gzclose( fp );
+        }
+
+        GDALClose( poDS );
+    }
+
+    std::string                     path;
+    const std::vector<benchBucket>& buckets;
+    std::string                     dir;
+    int                             level;
+    unsigned int&                   next;
+    SGMutex&                        lock;
+};
+
+static int64_t chopCached( const std::string& path, const std::vector<benchBucket>& buckets, const std::string& dir, int level, int numThreads )
+{
+    tgRasterBlockCache::instance().clear();
+
+    SGTimeStamp t;
+    t.stamp();
+
+    unsigned int              next = 0;
+    SGMutex                   lock;
+    std::vector<chopThread *> threads;
+
+    for ( int i=0; i<numThreads; i++ ) {
+        threads.push_back( new chopThread( path, buckets, dir, level, next, lock ) );
+        threads.back()->start();
+    }
+    for ( unsigned int i=0; i<threads.size(); i++ ) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    return t.elapsedMSec();
+}
+
+static bool readArray( const std::string& file, std::vector<char>& data )
+{
+    gzFile fp = gzopen( file.c_str(), "rb" );
+    if ( !fp ) {
+        return false;
+    }
+
+    char buf[65536];
+    int  n;
+
+    data.clear();
+    while ( ( n = gzread( fp, buf, sizeof(buf) ) ) > 0 ) {
+        data.insert( data.end(), buf, buf + n );
+    }
+    gzclose( fp );
+
+    return true;
+}
+
+static long dirSize( const std::string& dir )
+{
+    simgear::Dir      d( ( SGPath( dir ) ) );
+    simgear::PathList files = d.children( simgear::Dir::TYPE_FILE );
+    long              size = 0;
+
+    for ( unsigned int i=0; i<files.size(); i++ ) {
+        struct stat st;
+
+        if ( stat( files[i].c_str(), &st ) == 0 ) {
+            size += st.st_size;
+        }
+    }
+
+    return size;
+}
+
+static int compare( const std::vector<benchBucket>& buckets, const std::string& ref, const std::string& dir )
+{
+    int errors = 0;
+
+    for ( unsigned int i=0; i<buckets.size(); i++ ) {
+        std::vector<char> a, b;
+
+        if ( !readArray( arrayFile( ref, buckets[i] ), a ) || !readArray( arrayFile( dir, buckets[i] ), b ) || a != b ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  bucket " << buckets[i].b.gen_index_str() << " differs in " << dir );
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+int main( int argc, char** argv )
+{
+    int numThreads = 4;
+    int level      = 6;
+    int errors     = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "threads",     numThreads );
+    options.add( "compression", level, "0-9" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    GDALAllRegister();
+
+    simgear::Dir tmp = simgear::Dir::tempDir( "tgRasterChopBench" );
+    std::string  dem = tmp.path().str() + "/dem.tif";
+
+    if ( !writeDem( dem ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "can't write " << dem );
+        return 1;
+    }
+
+    // the buckets inside the DEM, row by row
+    std::vector<benchBucket> buckets;
+    SGBucket start( SGGeod::fromDeg( DEM_LON + 0.001, DEM_LAT + 0.001 ) );
+    SGBucket end( SGGeod::fromDeg( DEM_LON + 0.999, DEM_LAT + 0.999 ) );
+    int dx, dy;
+
+    sgBucketDiff( start, end, &dx, &dy );
+    for ( int y=0; y<=dy; y++ ) {
+        for ( int x=0; x<=dx; x++ ) {
+            benchBucket bb;
+
+            bb.b      = start.sibling( x, y );
+            bb.west   = bb.b.get_center_lon() - bb.b.get_width() * 0.5;
+            bb.south  = bb.b.get_center_lat() - bb.b.get_height() * 0.5;
+            bb.min_x  = (int)( bb.west * 3600.0 );
+            bb.min_y  = (int)( bb.south * 3600.0 );
+            bb.span_x = (int)( bb.b.get_width() * 3600 ) + 1;
+            bb.span_y = (int)( bb.b.get_height() * 3600 ) + 1;
+
+            buckets.push_back( bb );
+        }
+    }
+
+    std::string legacyDir = tmp.path().str() + "/legacy";
+    std::string singleDir = tmp.path().str() + "/single";
+    std::string multiDir  = tmp.path().str() + "/multi";
+
+    SGPath( legacyDir + "/dummy" ).create_dir( 0755 );
+    SGPath( singleDir + "/dummy" ).create_dir( 0755 );
+    SGPath( multiDir + "/dummy" ).create_dir( 0755 );
+
+    SGTimeStamp t;
+    t.stamp();
+
+    GDALDataset* poDS = (GDALDataset*)GDALOpen( dem.c_str(), GA_ReadOnly );
+    for ( unsigned int i=0; i<buckets.size(); i++ ) {
+        chopLegacy( poDS, buckets[i], legacyDir );
+    }
+    GDALClose( poDS );
+
+    int64_t legacyMs = t.elapsedMSec();
+    int64_t singleMs = chopCached( dem, buckets, singleDir, level, 1 );
+    int64_t multiMs  = chopCached( dem, buckets, multiDir, level, numThreads );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, buckets.size() << " buckets of a 1 x 1 degree, 1 arc second DEM:" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  legacy, level 9             " << legacyMs << " ms, " << dirSize( legacyDir ) / 1024 << " KB" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  cached, level " << level << ",  1 thread  " << singleMs << " ms, " << dirSize( singleDir ) / 1024 << " KB" );
+    SG_LOG( SG_GENERAL, SG_ALERT, "  cached, level " << level << ", " << numThreads << " threads " << multiMs << " ms, " << dirSize( multiDir ) / 1024 << " KB" );
+    tgRasterBlockCache::instance().report();
+
+    errors += compare( buckets, legacyDir, singleDir );
+    errors += compare( buckets, legacyDir, multiDir );
+
+    tmp.remove( true );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+// tgRefineBudgetTest.cxx -- stage 1 triangulation refinement budget
+//
+// Generates a tile with a jagged coastline, refined without a limit and
+// with ever smaller Steiner point budgets - each must stop at its budget
+// - then times the tile with and without --validate-mesh.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_mutex.hxx>
+#include <terragear/mesh/tg_mesh.hxx>
+
+#include "tg_test_util.hxx"
+
+// an island with a jagged coast in an ocean tile - lots of short
+// constraints for the mesher to refine around
+static unsigned int generateTile( const SGBucket& b, int coastNodes, double& ms )
+{
+    std::vector<tgTestOutline> islands( 1 );
+    for ( int i=0; i<coastNodes; i++ ) {
+        double a = 2.0 * M_PI * i / coastNodes;
+        double r = ( i % 2 ) ? 0.30 : 0.36;
+
+        islands[0].push_back( SGVec2d( r * cos( a ), r * sin( a ) ) );
+    }
+
+    tgMutex lock;
+    tgMesh* mesh = tgTestTile( b, islands, &lock );
+
+    SGTimeStamp t;
+    t.stamp();
+    mesh->generate();
+    ms = t.elapsedUSec() / 1000.0;
+
+    unsigned int vertices = mesh->getTriangulation().getNumVertices();
+    delete mesh;
+
+    return vertices;
+}
+
+int main( int argc, char** argv )
+{
+    int coastNodes = 400;
+    int errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "coast", coastNodes, "nodes" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    SGBucket b( SGGeod::fromDeg( -4.9, 56.6 ) );
+    double   ms;
+
+    // no refinement at all, then no limit
+    tgMeshTriangulation::setRefineBudget( 1, 0.0 );
+    unsigned int base = generateTile( b, coastNodes, ms ) - 1;
+
+    tgMeshTriangulation::setRefineBudget( 0, 0.0 );
+    unsigned int full = generateTile( b, coastNodes, ms );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "unlimited: " << full - base << " Steiner points, " << ms << " ms" );
+    if ( full <= base ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  no refinement to limit" );
+        errors++;
+    }
+
+    for ( unsigned int budget = ( full - base ) / 2; budget > 0; budget /= 4 ) {
+        tgMeshTriangulation::setRefineBudget( budget, 0.0 );
+        unsigned int vertices = generateTile( b, coastNodes, ms );
+
+        SG_LOG( SG_GENERAL, SG_ALERT, "budget " << budget << ": " << vertices - base << " Steiner points, " << ms << " ms" );
+
+        if ( vertices > base + budget ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "  over budget" );
+            errors++;
+        }
+    }
+
+    tgMeshTriangulation::setRefineBudget( 0, 0.0 );
+    tgMeshTriangulation::setValidate( true );
+    generateTile( b, coastNodes, ms );
+    SG_LOG( SG_GENERAL, SG_ALERT, "unlimited, validated: " << ms << " ms" );
+
+    tgMeshTriangulation::reportRefinement();
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
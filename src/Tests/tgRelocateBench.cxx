@@ -0,0 +1,187 @@
+// tgRelocateBench.cxx -- stage 2 edge node relocation, one vertex at a
+//                        time and in a single rebuild
+//
+// Triangulates a tile with --points interior points, a constrained
+// boundary with --edge-nodes nodes on every edge and coastlines running
+// into it, then moves --moved of the edge nodes along their edge and adds
+// --added nodes on every edge, as matching the neighbor tiles does.  Both
+// relocations start from the same triangulation; they must end up with
+// the same vertexes, constrained edges and face materials.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <string>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/mesh/tg_mesh.hxx>
+
+#include "tg_test_util.hxx"
+
+struct relocateParams {
+    int     numPoints;
+    int     numEdgeNodes;
+    int     numMoved;
+    int     numAdded;
+};
+
+// the same tile every time - with the nodes to move and add
+static void buildTile( const SGBucket& b, const relocateParams& p, meshTriCDT& cdt,
+                       std::vector<movedNode>& moved, std::vector<meshTriPoint>& added )
+{
+    double minx = b.get_center_lon() - 0.5 * b.get_width();
+    double miny = b.get_center_lat() - 0.5 * b.get_height();
+    double w    = b.get_width();
+    double h    = b.get_height();
+
+    tgTestRandom random( 17 );
+
+    std::vector<meshTriPoint> points;
+    for ( int i=0; i<p.numPoints; i++ ) {
+        points.push_back( meshTriPoint( minx + w * ( 0.01 + 0.98 * random.next() ), miny + h * ( 0.01 + 0.98 * random.next() ) ) );
+    }
+    cdt.insert( points.begin(), points.end() );
+
+    // the boundary - corners, and numEdgeNodes between them on every edge,
+    // north, south, east, west
+    meshTriPoint corner[4] = {
+        meshTriPoint( minx,     miny ),
+        meshTriPoint( minx + w, miny ),
+        meshTriPoint( minx + w, miny + h ),
+        meshTriPoint( minx,     miny + h )
+    };
+    int   cornerIdx[4][2] = { {3, 2}, {0, 1}, {1, 2}, {0, 3} };
+    double step = 1.0 / ( p.numEdgeNodes + 1 );
+
+    for ( int e=0; e<4; e++ ) {
+        const meshTriPoint& s = corner[ cornerIdx[e][0] ];
+        const meshTriPoint& t = corner[ cornerIdx[e][1] ];
+
+        std::vector<meshTriVertexHandle> nodes;
+        std::vector<double>              along;
+
+        nodes.push_back( cdt.insert( s ) );
+        along.push_back( 0.0 );
+        for ( int i=1; i<=p.numEdgeNodes; i++ ) {
+            double f = i * step;
+
+            nodes.push_back( cdt.insert( meshTriPoint( s.x() + f * ( t.x() - s.x() ), s.y() + f * ( t.y() - s.y() ) ), nodes.back()->face() ) );
+            along.push_back( f );
+        }
+        nodes.push_back( cdt.insert( t ) );
+        along.push_back( 1.0 );
+
+        for ( unsigned int i=1; i<nodes.size(); i++ ) {
+            cdt.insert_constraint( nodes[i-1], nodes[i] );
+        }
+
+        // coastlines running into the edge every 50 nodes
+        for ( unsigned int i=25; i+1<nodes.size(); i+=50 ) {
+            meshTriVertexHandle prev = nodes[i];
+            double              x = nodes[i]->point().x(), y = nodes[i]->point().y();
+            double              dx = ( e == EAST_EDGE ? -1 : e == WEST_EDGE ? 1 : 0 ) * 0.002 * w;
+            double              dy = ( e == NORTH_EDGE ? -1 : e == SOUTH_EDGE ? 1 : 0 ) * 0.002 * h;
+
+            for ( int j=1; j<=10; j++ ) {
+                meshTriVertexHandle next = cdt.insert( meshTriPoint( x + j * dx + ( dy ? 0.0005 * w * ( random.next() - 0.5 ) : 0.0 ),
+                                                                     y + j * dy + ( dx ? 0.0005 * h * ( random.next() - 0.5 ) : 0.0 ) ), prev->face() );
+                cdt.insert_constraint( prev, next );
+                prev = next;
+            }
+        }
+
+        // move some nodes between the corners a little along the edge,
+        // and add some between them
+        for ( int i=0; i<p.numMoved && i<p.numEdgeNodes; i++ ) {
+            int    n = 1 + (int)( (double)i * p.numEdgeNodes / p.numMoved );
+            double f = along[n] + 0.2 * step * ( random.next() - 0.5 );
+
+            moved.push_back( movedNode( nodes[n], nodes[n]->point(), meshTriPoint( s.x() + f * ( t.x() - s.x() ), s.y() + f * ( t.y() - s.y() ) ) ) );
+        }
+        for ( int i=0; i<p.numAdded; i++ ) {
+            int    n = (int)( random.next() * p.numEdgeNodes );
+            double f = along[n] + ( 0.35 + 0.3 * random.next() ) * step;
+
+            added.push_back( meshTriPoint( s.x() + f * ( t.x() - s.x() ), s.y() + f * ( t.y() - s.y() ) ) );
+        }
+    }
+
+    // the coastlines don't close, so the tile is a single land area
+    for ( meshTriCDT::Finite_faces_iterator fit = cdt.finite_faces_begin(); fit != cdt.finite_faces_end(); fit++ ) {
+        fit->info().setMaterial( "Grass" );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    relocateParams p;
+    int            errors = 0;
+
+    p.numPoints     = 200000;
+    p.numEdgeNodes  = 4000;
+    p.numMoved      = 2000;
+    p.numAdded      = 500;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "points",     p.numPoints );
+    options.add( "edge-nodes", p.numEdgeNodes, "per edge" );
+    options.add( "moved",      p.numMoved, "per edge" );
+    options.add( "added",      p.numAdded, "per edge" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    SGBucket b( SGGeod::fromDeg( -4.9, 56.6 ) );
+
+    meshTriCDT                  incremental, rebuild;
+    std::vector<movedNode>      incMoved, rebMoved;
+    std::vector<meshTriPoint>   incAdded, rebAdded;
+
+    buildTile( b, p, incremental, incMoved, incAdded );
+    buildTile( b, p, rebuild, rebMoved, rebAdded );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, incremental.number_of_vertices() << " vertexes, moving " << incMoved.size() << " and adding " << incAdded.size() << " nodes" );
+
+    SGTimeStamp t;
+
+    t.stamp();
+    tgMeshTriangulation::relocateIncremental( incremental, incMoved, incAdded );
+    double incMs = t.elapsedUSec() / 1000.0;
+
+    t.stamp();
+    tgMeshTriangulation::relocateRebuild( rebuild, rebMoved, rebAdded );
+    double rebMs = t.elapsedUSec() / 1000.0;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "  incremental " << incMs << " ms, rebuild " << rebMs << " ms" );
+
+    if ( !incremental.is_valid() || !rebuild.is_valid() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  triangulation not valid" );
+        errors++;
+    }
+    if ( !tgMeshTriangulation::sameConstraints( incremental, rebuild ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  constrained edges or materials differ" );
+        errors++;
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
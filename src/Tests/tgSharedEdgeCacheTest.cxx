@@ -0,0 +1,260 @@
+// tgSharedEdgeCacheTest.cxx -- stage 2 shared edge reads through the
+//                              process wide edge cache
+//
+// Saves a block of synthetic stage 1 tiles, then reads the shared edges
+// every tile of the block reads in stage 2 - its own four, and the
+// opposite edges of the tiles around it - from a pool of threads, first
+// straight from the shapefiles, then through tgSharedEdgeCache.  Every
+// edge must come back with the same nodes, and the cache must open every
+// file just once.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_bounded_queue.hxx>
+#include <terragear/tg_directory.hxx>
+#include <terragear/tg_mutex.hxx>
+#include <terragear/mesh/tg_mesh.hxx>
+#include <terragear/mesh/tg_mesh_shared_edge_cache.hxx>
+
+#include "tg_test_util.hxx"
+
+static const char* edgestr[4] = { "north", "south", "east", "west" };
+
+struct edgeRead {
+    edgeRead( const SGBucket& b, edgeType e ) : bucket(b), edge(e) {}
+
+    SGBucket    bucket;
+    edgeType    edge;
+};
+
+static std::string edgeFile( const std::string& base, const SGBucket& b, edgeType edge )
+{
+    return base + "/" + b.gen_base_path() + "/" + b.gen_index_str() + "/stage1_" + edgestr[edge] + ".shp";
+}
+
+// the edges loadTriangulation reads for b, in the order it reads them
+static void tileReads( const SGBucket& b, std::vector<edgeRead>& reads )
+{
+    std::vector<SGBucket> across;
+
+    reads.push_back( edgeRead( b, NORTH_EDGE ) );
+    reads.push_back( edgeRead( b, SOUTH_EDGE ) );
+    reads.push_back( edgeRead( b, EAST_EDGE ) );
+    reads.push_back( edgeRead( b, WEST_EDGE ) );
+
+    b.siblings( 0, 1, across );
+    for ( unsigned int i=0; i<across.size(); i++ ) {
+        reads.push_back( edgeRead( across[i], SOUTH_EDGE ) );
+    }
+
+    across.clear();
+    b.siblings( 0, -1, across );
+    for ( unsigned int i=0; i<across.size(); i++ ) {
+        reads.push_back( edgeRead( across[i], NORTH_EDGE ) );
+    }
+
+    reads.push_back( edgeRead( b.sibling( -1, 0 ), EAST_EDGE ) );
+    reads.push_back( edgeRead( b.sibling(  1, 0 ), WEST_EDGE ) );
+}
+
+// a landclass island inside an ocean tile - with nodes on every edge
+static tgMesh* generateTile( const SGBucket& b, tgMutex* lock )
+{
+    std::vector<tgTestOutline> islands( 1 );
+    islands[0].push_back( SGVec2d( -0.8, -0.2 ) );
+    islands[0].push_back( SGVec2d(  0.2, -0.8 ) );
+    islands[0].push_back( SGVec2d(  0.8,  0.2 ) );
+    islands[0].push_back( SGVec2d( -0.2,  0.8 ) );
+
+    tgMesh* mesh = tgTestTile( b, islands, lock );
+    mesh->generate();
+
+    return mesh;
+}
+
+class tgEdgeReadThread : public SGThread
+{
+public:
+    tgEdgeReadThread( tgBoundedQueue<SGBucket>& q, const std::string& b, bool c, SGMutex& l, std::vector<edgeRead>& f ) :
+        tiles(q), base(b), cached(c), tri(NULL), failLock(l), failed(f) {}
+
+private:
+    virtual void run() {
+        SGBucket tile;
+
+        while ( tiles.pop( tile ) ) {
+            std::vector<edgeRead> reads;
+            tileReads( tile, reads );
+
+            for ( unsigned int i=0; i<reads.size(); i++ ) {
+                std::string                 file = edgeFile( base, reads[i].bucket, reads[i].edge );
+                std::vector<meshVertexInfo> direct;
+
+                tri.fromShapefile( file, direct );
+                if ( !cached ) {
+                    continue;
+                }
+
+                tgSharedEdgePtr nodes = tgSharedEdgeCache::instance().get( tri, file, reads[i].bucket, reads[i].edge );
+                if ( !sameNodes( direct, *nodes ) ) {
+                    SGGuard<SGMutex> g( failLock );
+                    failed.push_back( reads[i] );
+                }
+            }
+        }
+    }
+
+    static bool sameNodes( const std::vector<meshVertexInfo>& a, const std::vector<meshVertexInfo>& b ) {
+        if ( a.size() != b.size() ) {
+            return false;
+        }
+        for ( unsigned int i=0; i<a.size(); i++ ) {
+            if ( a[i].getId() != b[i].getId() || a[i].getPoint() != b[i].getPoint() || a[i].getZ() != b[i].getZ() ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    tgBoundedQueue<SGBucket>&   tiles;
+    std::string                 base;
+    bool                        cached;
+    tgMeshTriangulation         tri;
+
+    SGMutex&                    failLock;
+    std::vector<edgeRead>&      failed;
+};
+
+static double readAll( const std::vector<SGBucket>& buckets, const std::string& base, bool cached, int numThreads, std::vector<edgeRead>& failed )
+{
+    tgBoundedQueue<SGBucket> tiles;
+    SGMutex                  failLock;
+    SGTimeStamp              t;
+
+    for ( unsigned int i=0; i<buckets.size(); i++ ) {
+        tiles.push( buckets[i] );
+    }
+    tiles.close();
+
+    t.stamp();
+
+    std::vector<tgEdgeReadThread*> readers;
+    for ( int i=0; i<numThreads; i++ ) {
+        readers.push_back( new tgEdgeReadThread( tiles, base, cached, failLock, failed ) );
+        readers.back()->start();
+    }
+    for ( unsigned int i=0; i<readers.size(); i++ ) {
+        readers[i]->join();
+        delete readers[i];
+    }
+
+    return t.elapsedUSec() / 1000.0;
+}
+
+int main( int argc, char** argv )
+{
+    int numTiles   = 64;
+    int numThreads = boost::thread::hardware_concurrency();
+    int errors     = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "tiles",   numTiles );
+    options.add( "threads", numThreads );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    if ( numThreads < 2 ) {
+        numThreads = 2;
+    }
+
+    GDALAllRegister();
+
+    // a square-ish block of tiles, where the bucket width changes
+    std::vector<SGBucket> buckets;
+    tgTestBlock( SGGeod::fromDeg( 10.01, 21.76 ), numTiles, buckets );
+
+    simgear::Dir tmp = simgear::Dir::tempDir( "tgSharedEdgeCacheTest" );
+    std::string  base = tmp.path().str();
+    tgMutex      lock;
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "saving " << buckets.size() << " tiles" );
+    for ( unsigned int i=0; i<buckets.size(); i++ ) {
+        tgMesh*     mesh = generateTile( buckets[i], &lock );
+        std::string path = base + "/" + buckets[i].gen_base_path() + "/" + buckets[i].gen_index_str();
+
+        tgMakeDirectory( path );
+        mesh->save( path );
+        delete mesh;
+    }
+
+    // every file stage 2 of the block reads
+    std::set<std::string> files;
+    unsigned long         lookups = 0;
+    for ( unsigned int i=0; i<buckets.size(); i++ ) {
+        std::vector<edgeRead> reads;
+        tileReads( buckets[i], reads );
+
+        for ( unsigned int j=0; j<reads.size(); j++ ) {
+            files.insert( edgeFile( base, reads[j].bucket, reads[j].edge ) );
+        }
+        lookups += reads.size();
+    }
+
+    std::vector<edgeRead> failed;
+    double directMs = readAll( buckets, base, false, numThreads, failed );
+    double cachedMs = readAll( buckets, base, true,  numThreads, failed ) - directMs;
+
+    for ( unsigned int i=0; i<failed.size(); i++ ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << failed[i].bucket.gen_index_str() << " " << edgestr[failed[i].edge] << " edge differs" );
+        errors++;
+    }
+
+    tgSharedEdgeCache& cache = tgSharedEdgeCache::instance();
+    if ( cache.getOpens() != files.size() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  opened " << cache.getOpens() << " files, expected " << files.size() );
+        errors++;
+    }
+    if ( cache.getOpens() + cache.getHits() != lookups ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "  " << cache.getOpens() + cache.getHits() << " lookups, expected " << lookups );
+        errors++;
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, lookups << " edge reads: " << lookups << " shapefile opens, " << directMs << " ms direct - " <<
+                                  cache.getOpens() << " opens, about " << cachedMs << " ms through the cache" );
+    cache.report();
+
+    tmp.remove( true );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,271 @@
+// tgSnapRoundTest.cxx -- correctness and scaling of tgMeshSnapRound
+//
+// Builds arrangements of random, densely crossing segments, snap rounds
+// them with tgMeshArrangement::doSnapRound, then adds a few more segments
+// and rounds again, which only removes and inserts the edges that moved.
+// Both times no two edges may cross or touch anywhere except at shared
+// endpoints, and every vertex must be a lattice point.  Then rounds one
+// such tile per thread with an increasing number of threads, to show that
+// tiles no longer serialize on a lock.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/mesh/tg_mesh.hxx>
+#include <terragear/mesh/tg_mesh_snap_round.hxx>
+
+#include "tg_test_util.hxx"
+
+// same pixel size as the arrangement cleaning - 2^-22 degrees
+#define PIXEL_SIZE  (1.0 / 4194304.0)
+
+// random segments within a box a few hundred pixels wide, at a bucket
+// corner so the tile edge lattice is exercised.  every few segments
+// gets a near parallel neighbour less than a pixel away.
+static void generateSegments( unsigned int count, unsigned int seed, std::vector<meshArrSegment>& segs )
+{
+    double ox = 10.125;
+    double oy = 45.125;
+    double w  = 400.0 * PIXEL_SIZE;
+
+    srand( seed );
+
+    while ( segs.size() < count ) {
+        double x0 = ox + w * rand() / RAND_MAX;
+        double y0 = oy + w * rand() / RAND_MAX;
+        double x1 = ox + w * rand() / RAND_MAX;
+        double y1 = oy + w * rand() / RAND_MAX;
+
+        if ( x0 == x1 && y0 == y1 ) {
+            continue;
+        }
+        segs.push_back( meshArrSegment( meshArrPoint( x0, y0 ), meshArrPoint( x1, y1 ) ) );
+
+        if ( rand() % 4 == 0 ) {
+            double d = 0.3 * PIXEL_SIZE * rand() / RAND_MAX;
+            segs.push_back( meshArrSegment( meshArrPoint( x0 + d, y0 ), meshArrPoint( x1 + d, y1 + d ) ) );
+        }
+    }
+}
+
+// everything doSnapRound left in the arrangement
+static void snapRound( tgMeshArrangement& arr, std::vector<meshTriSegment>& out )
+{
+    arr.doSnapRound();
+    arr.getSegments( out );
+}
+
+// rounded points are lattice points - exact as doubles
+static int offLattice( const std::vector<meshTriSegment>& segs )
+{
+    tgMeshSnapRound sr( PIXEL_SIZE );
+    int off = 0;
+
+    for ( unsigned int i=0; i<segs.size(); i++ ) {
+        meshArrPoint s( segs[i].source().x(), segs[i].source().y() );
+        meshArrPoint t( segs[i].target().x(), segs[i].target().y() );
+
+        if ( sr.snap( s ) != s || sr.snap( t ) != t ) {
+            off++;
+        }
+    }
+
+    return off;
+}
+
+static bool onInterior( const meshTriSegment& s, const meshTriPoint& p )
+{
+    return p != s.source() && p != s.target() && s.has_on( p );
+}
+
+// do the segments meet anywhere other than at shared endpoints?
+static bool crosses( const meshTriSegment& a, const meshTriSegment& b )
+{
+    CGAL::Orientation o1 = CGAL::orientation( a.source(), a.target(), b.source() );
+    CGAL::Orientation o2 = CGAL::orientation( a.source(), a.target(), b.target() );
+    CGAL::Orientation o3 = CGAL::orientation( b.source(), b.target(), a.source() );
+    CGAL::Orientation o4 = CGAL::orientation( b.source(), b.target(), a.target() );
+
+    if ( o1 * o2 < 0 && o3 * o4 < 0 ) {
+        return true;
+    }
+
+    return onInterior( a, b.source() ) || onInterior( a, b.target() ) ||
+           onInterior( b, a.source() ) || onInterior( b, a.target() );
+}
+
+static bool byMinX( const meshTriSegment& a, const meshTriSegment& b )
+{
+    return a.bbox().xmin() < b.bbox().xmin();
+}
+
+static int countCrossings( std::vector<meshTriSegment>& segs )
+{
+    int crossings = 0;
+
+    std::sort( segs.begin(), segs.end(), byMinX );
+
+    for ( unsigned int i=0; i<segs.size(); i++ ) {
+        CGAL::Bbox_2 bi = segs[i].bbox();
+
+        for ( unsigned int j=i+1; j<segs.size() && segs[j].bbox().xmin() <= bi.xmax(); j++ ) {
+            if ( CGAL::do_overlap( bi, segs[j].bbox() ) && crosses( segs[i], segs[j] ) ) {
+                if ( crossings < 10 ) {
+                    SG_LOG( SG_GENERAL, SG_ALERT, "crossing: " << segs[i] << " and " << segs[j] );
+                }
+                crossings++;
+            }
+        }
+    }
+
+    return crossings;
+}
+
+// a full rounding - every edge moves, and the arrangement is rebuilt -
+// then a few more segments crossing the rounded ones, so only the edges
+// they split move, and are removed and inserted again
+static int checkTile( unsigned int count, unsigned int seed )
+{
+    std::vector<meshArrSegment> input, extra;
+    generateSegments( count, seed, input );
+    generateSegments( count / 20 + 1, seed + 1000, extra );
+
+    tgMeshArrangement arr( NULL );
+    arr.addSegments( input );
+
+    std::vector<meshTriSegment> output;
+    snapRound( arr, output );
+
+    int full = countCrossings( output ) + offLattice( output );
+    unsigned int rounded = output.size();
+
+    arr.addSegments( extra );
+    unsigned int split = arr.getNumEdges();
+
+    output.clear();
+    snapRound( arr, output );
+
+    int partial = countCrossings( output ) + offLattice( output );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "seed " << seed << ": " << input.size() << " segments, " << rounded << " rounded edges, " << full << " errors - " <<
+                                  extra.size() << " more segments, " << split << " edges, " << output.size() << " rounded edges, " << partial << " errors" );
+
+    return full + partial;
+}
+
+// the tile edge must stay where it is
+static int checkLattice( void )
+{
+    tgMeshSnapRound sr( PIXEL_SIZE );
+    int errors = 0;
+
+    double edges[4] = { 45.125, -45.125, 179.875, 0.0 };
+    for ( unsigned int i=0; i<4; i++ ) {
+        meshArrPoint p( edges[i], edges[(i+1)%4] );
+
+        if ( sr.snap( p ) != p ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "bucket corner " << edges[i] << ", " << edges[(i+1)%4] << " moved" );
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+class tgSnapRoundThread : public SGThread
+{
+public:
+    tgSnapRoundThread( unsigned int c, unsigned int s ) : count(c), seed(s) {}
+
+private:
+    virtual void run() {
+        std::vector<meshArrSegment> input;
+        generateSegments( count, seed, input );
+
+        tgMeshArrangement arr( NULL );
+        arr.addSegments( input );
+
+        std::vector<meshTriSegment> output;
+        snapRound( arr, output );
+    }
+
+    unsigned int count;
+    unsigned int seed;
+};
+
+static void scaling( unsigned int count, unsigned int maxThreads )
+{
+    int64_t single = 0;
+
+    for ( unsigned int n=1; n<=maxThreads; n*=2 ) {
+        std::vector<tgSnapRoundThread*> threads;
+
+        SGTimeStamp t;
+        t.stamp();
+
+        for ( unsigned int i=0; i<n; i++ ) {
+            threads.push_back( new tgSnapRoundThread( count, 100 + i ) );
+            threads.back()->start();
+        }
+        for ( unsigned int i=0; i<n; i++ ) {
+            threads[i]->join();
+            delete threads[i];
+        }
+
+        int64_t ms = t.elapsedMSec();
+        if ( n == 1 ) {
+            single = ms;
+        }
+
+        // every thread does the same work - ideally the time stays flat
+        SG_LOG( SG_GENERAL, SG_ALERT, n << " threads, one tile each: " << ms << " ms, " <<
+                                      ( ms ? 100.0 * single / ms : 100.0 ) << "% efficiency" );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    unsigned int count = 500;
+    unsigned int maxThreads = 8;
+    int          errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "segments", count, "per tile" );
+    options.add( "threads",  maxThreads, "max threads" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    errors += checkLattice();
+    for ( unsigned int seed = 1; seed <= 4; seed++ ) {
+        errors += checkTile( count, seed );
+    }
+
+    scaling( count, maxThreads );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+// tgTdsTest.cxx -- round trip and load timing of the binary stage 1
+//                  triangulation file
+//
+// Generates a synthetic tile, writes its triangulation as tds.bin and as
+// the debug shapefiles, then checks that loading tds.bin and writing it
+// again reproduces the file byte for byte.  Finally times repeated loads
+// from both formats.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <string>
+
+#include <simgear/constants.h>
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_directory.hxx>
+#include <terragear/tg_mutex.hxx>
+#include <terragear/mesh/tg_mesh.hxx>
+
+#include "tg_test_util.hxx"
+
+// a ring of landclass islands inside an ocean tile
+static tgMesh* generateTile( const SGBucket& b, int islands, tgMutex* lock )
+{
+    std::vector<tgTestOutline> outlines( islands );
+
+    for ( int i=0; i<islands; i++ ) {
+        double a  = 2.0 * SGD_PI * i / islands;
+        double ix = 0.3 * cos( a );
+        double iy = 0.3 * sin( a );
+        double r  = 0.05;
+
+        outlines[i].push_back( SGVec2d( ix - r,       iy - r ) );
+        outlines[i].push_back( SGVec2d( ix + r,       iy - 1.5 * r ) );
+        outlines[i].push_back( SGVec2d( ix + 1.5 * r, iy + r ) );
+        outlines[i].push_back( SGVec2d( ix,           iy + 1.5 * r ) );
+        outlines[i].push_back( SGVec2d( ix - 1.5 * r, iy + 0.5 * r ) );
+    }
+
+    tgMesh* mesh = tgTestTile( b, outlines, lock );
+    mesh->generate();
+
+    return mesh;
+}
+
+static double timeLoads( const std::string& path, int reps )
+{
+    SGTimeStamp t;
+    t.stamp();
+
+    for ( int i=0; i<reps; i++ ) {
+        tgMesh mesh;
+        mesh.loadTds( path );
+    }
+
+    return (double)t.elapsedMSec() / reps;
+}
+
+int main( int argc, char** argv )
+{
+    std::string work_dir = "./tgTdsTest";
+    int         islands  = 64;
+    int         reps     = 10;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "work-dir", work_dir, "dir" );
+    options.add( "islands",  islands );
+    options.add( "reps",     reps );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    GDALAllRegister();
+
+    tgMutex  lock;
+    SGBucket bucket( SGGeod::fromDeg( 10.01, 45.01 ) );
+    tgMesh*  mesh = generateTile( bucket, islands, &lock );
+
+    std::string binPath   = work_dir + "/bin";
+    std::string shpPath   = work_dir + "/shp";
+    std::string roundPath = work_dir + "/roundtrip";
+
+    tgMakeDirectory( binPath );
+    tgMakeDirectory( shpPath );
+    tgMakeDirectory( roundPath );
+
+    mesh->saveTds( binPath );
+    mesh->saveTdsShapefile( shpPath );
+    delete mesh;
+
+    int errors = 0;
+
+    // binary -> mesh -> binary must be lossless
+    tgMesh loaded;
+    if ( !loaded.loadTds( binPath ) ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "failed to load " << binPath << "/tds.bin" );
+        errors++;
+    } else {
+        loaded.saveTds( roundPath );
+        if ( !tgTestSameContents( binPath + "/tds.bin", roundPath + "/tds.bin" ) ) {
+            SG_LOG( SG_GENERAL, SG_ALERT, "round trip of tds.bin is not byte identical" );
+            errors++;
+        }
+    }
+
+    double binMs = timeLoads( binPath, reps );
+    double shpMs = timeLoads( shpPath, reps );
+
+    SG_LOG( SG_GENERAL, SG_ALERT, "load tds.bin: " << binMs << " ms, shapefiles: " << shpMs << " ms ( average of " << reps << " )" );
+    SG_LOG( SG_GENERAL, SG_ALERT, errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+// tgTileSchedulerTest.cxx -- ordering test for tgTileScheduler
+//
+// Runs three stages over a synthetic grid of tiles from several threads,
+// with a random delay for every tile stage.  Whenever a tile stage
+// starts, the previous stage of the tile and of all its neighbours must
+// already be done, and every tile stage must run exactly once.  The grid
+// crosses 22 degrees, where the bucket width doubles, so every tile of
+// the first wide row has to wait on both narrow tiles below it.  The
+// neighbours are found from the tile bounds here, not with siblings()
+// as the scheduler does.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cmath>
+#include <map>
+#include <string>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/debug/logstream.hxx>
+#include <simgear/threads/SGGuard.hxx>
+#include <simgear/threads/SGThread.hxx>
+#include <simgear/timing/timestamp.hxx>
+
+#include <terragear/tg_tile_scheduler.hxx>
+
+#include "tg_test_util.hxx"
+
+#define FIRST_STAGE (1)
+#define LAST_STAGE  (3)
+
+// bounds touching or overlapping, corners included
+static bool touches( const SGBucket& a, const SGBucket& b )
+{
+    const double eps = 1e-9;
+
+    return fabs( a.get_center_lon() - b.get_center_lon() ) <= 0.5 * ( a.get_width()  + b.get_width()  ) + eps &&
+           fabs( a.get_center_lat() - b.get_center_lat() ) <= 0.5 * ( a.get_height() + b.get_height() ) + eps;
+}
+
+// what has run so far - checked against the dependency rules as each tile
+// stage starts
+class stageLog
+{
+public:
+    stageLog( const std::vector<SGBucket>& t ) : tiles(t), neighbours(t.size()), wideTiles(0), violations(0), overlaps(0) {
+        for ( unsigned int i=0; i<tiles.size(); i++ ) {
+            index[tiles[i].gen_index()] = i;
+            for ( int s=FIRST_STAGE; s<=LAST_STAGE; s++ ) {
+                runs[key( i, s )] = 0;
+                finished[key( i, s )] = false;
+            }
+        }
+
+        // the tile itself is in its list, too
+        for ( unsigned int i=0; i<tiles.size(); i++ ) {
+            int below = 0;
+
+            for ( unsigned int j=0; j<tiles.size(); j++ ) {
+                if ( touches( tiles[i], tiles[j] ) ) {
+                    neighbours[i].push_back( j );
+
+                    // a narrower tile right below this one
+                    if ( tiles[j].get_center_lat() < tiles[i].get_center_lat() - 0.5 * tiles[i].get_height() &&
+                         tiles[j].get_width() < tiles[i].get_width() &&
+                         fabs( tiles[j].get_center_lon() - tiles[i].get_center_lon() ) < 0.5 * tiles[i].get_width() ) {
+                        below++;
+                    }
+                }
+            }
+
+            if ( below == 2 ) {
+                wideTiles++;
+            }
+        }
+    }
+
+    void start( const SGBucket& b, int stage ) {
+        SGGuard<SGMutex> g( lock );
+        unsigned int i = index[b.gen_index()];
+
+        runs[key( i, stage )]++;
+
+        if ( stage > FIRST_STAGE ) {
+            for ( unsigned int n=0; n<neighbours[i].size(); n++ ) {
+                unsigned int j = neighbours[i][n];
+
+                if ( !finished[key( j, stage-1 )] ) {
+                    SG_LOG( SG_GENERAL, SG_ALERT, b.gen_index_str() << " stage " << stage << " started before " <<
+                                                  tiles[j].gen_index_str() << " stage " << stage-1 << " finished" );
+                    violations++;
+                }
+            }
+
+            // did we start before the previous stage was done everywhere?
+            for ( unsigned int t=0; t<tiles.size(); t++ ) {
+                if ( !finished[key( t, stage-1 )] ) {
+                    overlaps++;
+                    break;
+                }
+            }
+        }
+    }
+
+    void finish( const SGBucket& b, int stage ) {
+        SGGuard<SGMutex> g( lock );
+
+        finished[key( index[b.gen_index()], stage )] = true;
+    }
+
+    int check( void ) {
+        for ( std::map<int, int>::const_iterator it = runs.begin(); it != runs.end(); it++ ) {
+            if ( it->second != 1 ) {
+                SG_LOG( SG_GENERAL, SG_ALERT, "tile stage " << it->first << " ran " << it->second << " times" );
+                violations++;
+            }
+        }
+
+        return violations;
+    }
+
+    int getOverlaps( void ) const { return overlaps; }
+
+    // tiles with two narrower neighbours right below them
+    int getWideTiles( void ) const { return wideTiles; }
+
+private:
+    int key( unsigned int tile, int stage ) const { return tile * 10 + stage; }
+
+    std::vector<SGBucket>                       tiles;
+    std::vector< std::vector<unsigned int> >    neighbours;
+    int                                         wideTiles;
+    std::map<long, unsigned int>                index;
+    std::map<int, int>                          runs;
+    std::map<int, bool>                         finished;
+    int                                         violations;
+    int                                         overlaps;
+    SGMutex                                     lock;
+};
+
+class tgTestWorker : public SGThread
+{
+public:
+    tgTestWorker( tgTileScheduler& s, stageLog& l, unsigned int seed, int max ) : scheduler(s), log(l), random(seed), maxDelay(max) {}
+
+private:
+    virtual void run() {
+        SGBucket b;
+        int      stage;
+
+        while ( scheduler.next( b, stage ) ) {
+            log.start( b, stage );
+
+            // some tiles are much slower than others
+            random = random * 1103515245 + 12345;
+            unsigned int delay = ( random >> 16 ) % ( maxDelay + 1 );
+            if ( ( random >> 8 ) % 16 == 0 ) {
+                delay *= 5;
+            }
+            SGTimeStamp::sleepForMSec( delay );
+
+            log.finish( b, stage );
+            scheduler.done( b, stage );
+        }
+    }
+
+    tgTileScheduler&    scheduler;
+    stageLog&           log;
+    unsigned int        random;
+    int                 maxDelay;
+};
+
+int main( int argc, char** argv )
+{
+    int numThreads = 4;
+    int width = 8;
+    int height = 6;
+    int maxDelay = 20;
+
+    sglog().setLogLevels( SG_ALL, SG_ALERT );
+
+    tgTestOptions options;
+    options.add( "threads",   numThreads );
+    options.add( "width",     width, "tiles" );
+    options.add( "height",    height, "tiles" );
+    options.add( "max-delay", maxDelay, "ms" );
+    if ( !options.parse( argc, argv ) ) {
+        return 1;
+    }
+
+    // a block of tiles, two rows below 22 degrees and the rest above,
+    // where the buckets are twice as wide
+    std::vector<SGBucket> buckets;
+    SGBucket start( SGGeod::fromDeg( 10.01, 21.76 ) );
+    for ( int y=0; y<height; y++ ) {
+        for ( int x=0; x<width; x++ ) {
+            buckets.push_back( start.sibling( x, y ) );
+        }
+    }
+
+    tgTileScheduler scheduler( buckets, FIRST_STAGE, LAST_STAGE );
+    stageLog        log( buckets );
+
+    SGTimeStamp t;
+    t.stamp();
+
+    std::vector<tgTestWorker*> workers;
+    for ( int i=0; i<numThreads; i++ ) {
+        workers.push_back( new tgTestWorker( scheduler, log, 17 + i, maxDelay ) );
+        workers.back()->start();
+    }
+    for ( int i=0; i<numThreads; i++ ) {
+        workers[i]->join();
+        delete workers[i];
+    }
+
+    scheduler.report();
+
+    int errors = log.check();
+
+    // make sure the grid really crossed the width change
+    if ( height > 2 && width > 1 && log.getWideTiles() == 0 ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "no tile above two narrower ones - the grid doesn't cross 22 degrees" );
+        errors++;
+    }
+
+    SG_LOG( SG_GENERAL, SG_ALERT, scheduler.getNumTasks() << " tile stages on " << numThreads << " threads in " << t.elapsedMSec() << " ms, " <<
+                                  log.getOverlaps() << " started before the previous stage was done everywhere, " << errors << " errors" );
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+// tg_test_util.cxx -- what the test and benchmark programs share
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#include <simgear/debug/logstream.hxx>
+
+#include <terragear/tg_mutex.hxx>
+#include <terragear/mesh/tg_mesh.hxx>
+
+#include "tg_test_util.hxx"
+
+void tgTestNames( std::vector<std::string>& names )
+{
+    names.clear();
+    names.push_back( "Default" );
+    names.push_back( "Ocean" );
+}
+
+tgMesh* tgTestTile( const SGBucket& b, const std::vector<tgTestOutline>& islands, tgMutex* lock )
+{
+    std::vector<std::string> names;
+    tgTestNames( names );
+
+    tgMesh* mesh = new tgMesh();
+
+    mesh->initPriorities( names );
+    mesh->setLock( lock );
+    mesh->clipAgainstBucket( b );
+
+    double cx = b.get_center_lon();
+    double cy = b.get_center_lat();
+    double w  = b.get_width();
+    double h  = b.get_height();
+
+    cgalPoly_Point ocean[4];
+    ocean[0] = cgalPoly_Point( cx - w, cy - h );
+    ocean[1] = cgalPoly_Point( cx + w, cy - h );
+    ocean[2] = cgalPoly_Point( cx + w, cy + h );
+    ocean[3] = cgalPoly_Point( cx - w, cy + h );
+
+    for ( unsigned int i=0; i<islands.size(); i++ ) {
+        std::vector<cgalPoly_Point> island;
+
+        for ( unsigned int j=0; j<islands[i].size(); j++ ) {
+            island.push_back( cgalPoly_Point( cx + islands[i][j].x() * w, cy + islands[i][j].y() * h ) );
+        }
+
+        mesh->addPoly( 0, tgPolygonSet( cgalPoly_Polygon( island.begin(), island.end() ), tgPolygonSetMeta( tgPolygonSetMeta::META_TEXTURED, names[0] ) ) );
+    }
+    mesh->addPoly( 1, tgPolygonSet( cgalPoly_Polygon( ocean, ocean+4 ), tgPolygonSetMeta( tgPolygonSetMeta::META_TEXTURED, names[1] ) ) );
+
+    return mesh;
+}
+
+void tgTestBlock( const SGGeod& start, int numTiles, std::vector<SGBucket>& buckets )
+{
+    SGBucket first( start );
+    int      side = 1;
+
+    while ( side * side < numTiles ) {
+        side++;
+    }
+    for ( int y=0; y<side && (int)buckets.size()<numTiles; y++ ) {
+        for ( int x=0; x<side && (int)buckets.size()<numTiles; x++ ) {
+            buckets.push_back( first.sibling( x, y ) );
+        }
+    }
+}
+
+bool tgTestSameContents( const std::string& a, const std::string& b )
+{
+    std::ifstream fa( a.c_str(), std::ios::binary );
+    std::ifstream fb( b.c_str(), std::ios::binary );
+
+    if ( !fa || !fb ) {
+        return false;
+    }
+
+    std::string ca( (std::istreambuf_iterator<char>(fa)), std::istreambuf_iterator<char>() );
+    std::string cb( (std::istreambuf_iterator<char>(fb)), std::istreambuf_iterator<char>() );
+
+    return ca == cb;
+}
+
+void tgTestOptions::add( const std::string& name, int& value, const std::string& arg )
+{
+    options.push_back( option( name, OPTION_INT, &value, arg ) );
+}
+
+void tgTestOptions::add( const std::string& name, std::string& value, const std::string& arg )
+{
+    options.push_back( option( name, OPTION_STRING, &value, arg ) );
+}
+
+void tgTestOptions::addChoice( const std::string& name, std::string& value, const std::string& choices )
+{
+    options.push_back( option( name, OPTION_CHOICE, &value, choices ) );
+}
+
+void tgTestOptions::addSwitch( const std::string& name, bool& value, bool set )
+{
+    options.push_back( option( name, OPTION_SWITCH, &value, "" ) );
+    options.back().set = set;
+}
+
+bool tgTestOptions::apply( const option& o, const std::string& arg ) const
+{
+    std::string prefix = "--" + o.name;
+
+    if ( o.type == OPTION_SWITCH ) {
+        if ( arg != prefix ) {
+            return false;
+        }
+        *(bool*)o.value = o.set;
+        return true;
+    }
+
+    prefix += "=";
+    if ( arg.find( prefix ) != 0 ) {
+        return false;
+    }
+
+    std::string value = arg.substr( prefix.size() );
+
+    switch ( o.type ) {
+        case OPTION_INT:
+            *(int*)o.value = atoi( value.c_str() );
+            return true;
+
+        case OPTION_STRING:
+            *(std::string*)o.value = value;
+            return true;
+
+        case OPTION_CHOICE:
+            if ( ( "|" + o.arg + "|" ).find( "|" + value + "|" ) == std::string::npos ) {
+                return false;
+            }
+            *(std::string*)o.value = value;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool tgTestOptions::parse( int argc, char** argv ) const
+{
+    for ( int i=1; i<argc; i++ ) {
+        std::string  arg = argv[i];
+        unsigned int o;
+
+        for ( o=0; o<options.size() && !apply( options[o], arg ); o++ ) {
+        }
+
+        if ( o == options.size() ) {
+            std::string usage;
+
+            for ( o=0; o<options.size(); o++ ) {
+                usage += " [--" + options[o].name;
+                if ( options[o].type != OPTION_SWITCH ) {
+                    usage += "=<" + options[o].arg + ">";
+                }
+                usage += "]";
+            }
+            SG_LOG( SG_GENERAL, SG_ALERT, "Usage: " << argv[0] << usage );
+
+            return false;
+        }
+    }
+
+    return true;
+}
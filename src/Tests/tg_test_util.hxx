@@ -0,0 +1,111 @@
+// tg_test_util.hxx -- what the test and benchmark programs share: the
+//                     synthetic ocean tiles, file comparison, command
+//                     line options and a repeatable random sequence
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef __TG_TEST_UTIL_HXX__
+#define __TG_TEST_UTIL_HXX__
+
+#include <string>
+#include <vector>
+
+#include <simgear/bucket/newbucket.hxx>
+#include <simgear/math/SGMath.hxx>
+
+class tgMesh;
+class tgMutex;
+
+// an island outline, in fractions of the tile width and height from the
+// tile center
+typedef std::vector<SGVec2d> tgTestOutline;
+
+// the landclass names of the synthetic tiles - the islands are Default,
+// the ocean around them is Ocean
+void tgTestNames( std::vector<std::string>& names );
+
+// an ocean tile, twice the size of the bucket and clipped to it, with a
+// Default island for every outline.  The mesh is ready to generate().
+tgMesh* tgTestTile( const SGBucket& b, const std::vector<tgTestOutline>& islands, tgMutex* lock );
+
+// a square-ish block of numTiles buckets, starting at the bucket of start
+void tgTestBlock( const SGGeod& start, int numTiles, std::vector<SGBucket>& buckets );
+
+// true if both files can be read and are byte identical
+bool tgTestSameContents( const std::string& a, const std::string& b );
+
+// the --name=<value> options of a test program.  parse() logs the usage
+// line and returns false on anything it doesn't know.
+class tgTestOptions
+{
+public:
+    void add( const std::string& name, int& value, const std::string& arg = "num" );
+    void add( const std::string& name, std::string& value, const std::string& arg );
+
+    // one of the words in choices, separated by '|'
+    void addChoice( const std::string& name, std::string& value, const std::string& choices );
+
+    // --name without a value, setting value to set
+    void addSwitch( const std::string& name, bool& value, bool set );
+
+    bool parse( int argc, char** argv ) const;
+
+private:
+    enum optionType {
+        OPTION_INT,
+        OPTION_STRING,
+        OPTION_CHOICE,
+        OPTION_SWITCH
+    };
+
+    struct option {
+        option( const std::string& n, optionType t, void* v, const std::string& a ) : name(n), type(t), value(v), arg(a), set(false) {}
+
+        std::string name;
+        optionType  type;
+        void*       value;
+        std::string arg;
+        bool        set;
+    };
+
+    bool apply( const option& o, const std::string& arg ) const;
+
+    std::vector<option> options;
+};
+
+// a repeatable random sequence - each generator keeps its own state, so
+// the data doesn't depend on who else called rand()
+class tgTestRandom
+{
+public:
+    tgTestRandom( unsigned int seed ) : state(seed) {}
+
+    // [0, 1)
+    double next( void ) {
+        state = state * 1103515245 + 12345;
+        return ( ( state >> 8 ) & 0xffffff ) / 16777216.0;
+    }
+
+    // [0, n)
+    int next( int n ) {
+        return (int)( next() * n );
+    }
+
+private:
+    unsigned int state;
+};
+
+#endif /* __TG_TEST_UTIL_HXX__ */
@@ -0,0 +1,122 @@
+// polys2shp.cxx -- convert the chopper's per bucket polys files back to
+//                  shapefiles, for looking at them in a GIS
+//
+// Every <index>.polys.gz becomes a datasource <index>/ next to it - or
+// under --dest - with one layer per material, the layout the chopper used
+// to write.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ogrsf_frmts.h>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/misc/sg_path.hxx>
+
+#include <terragear/polygon_set/tg_polygon_set.hxx>
+
+static const std::string suffix = ".polys.gz";
+
+static bool convert( const std::string& file, const std::string& dest )
+{
+    tgPolygonSetList polys;
+
+    bool ok = tgPolygonSet::fromPolysFile( file, polys );
+    if ( polys.empty() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "polys2shp: nothing read from " << file );
+        return ok;
+    }
+
+    // <dir>/<index>.polys.gz -> <dest or dir>/<index>
+    SGPath      in( file );
+    std::string name = in.file();
+    if ( name.size() > suffix.size() && name.compare( name.size() - suffix.size(), suffix.size(), suffix ) == 0 ) {
+        name.erase( name.size() - suffix.size() );
+    }
+
+    SGPath out( dest.empty() ? in.dir() : dest );
+    out.append( name );
+
+    GDALDataset* poDS = tgPolygonSet::openDatasource( out.c_str() );
+    if ( !poDS ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "polys2shp: can't create " << out.str() );
+        return false;
+    }
+
+    std::map<std::string, OGRLayer*> layers;
+    for ( unsigned int i=0; i<polys.size(); i++ ) {
+        const std::string& material = polys[i].getMeta().material;
+
+        std::map<std::string, OGRLayer*>::iterator lit = layers.find( material );
+        if ( lit == layers.end() ) {
+            lit = layers.insert( std::make_pair( material, tgPolygonSet::openLayer( poDS, wkbPolygon25D, tgPolygonSet::LF_ALL, material.c_str() ) ) ).first;
+        }
+
+        if ( lit->second ) {
+            polys[i].toShapefile( lit->second );
+        }
+    }
+
+    GDALClose( poDS );
+
+    SG_LOG( SG_GENERAL, SG_INFO, "polys2shp: " << file << " -> " << out.str() << " : " << polys.size() << " polys in " << layers.size() << " layers" );
+
+    return ok;
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<std::string> files;
+    std::string              dest;
+    int                      errors = 0;
+
+    sglog().setLogLevels( SG_ALL, SG_INFO );
+
+    for ( int i=1; i<argc; i++ ) {
+        std::string arg = argv[i];
+
+        if ( arg.find("--dest=") == 0 ) {
+            dest = arg.substr(7);
+        } else if ( arg.find("--") == 0 ) {
+            files.clear();
+            break;
+        } else {
+            files.push_back( arg );
+        }
+    }
+
+    if ( files.empty() ) {
+        SG_LOG( SG_GENERAL, SG_ALERT, "Usage: " << argv[0] << " [--dest=<dir>] <file.polys.gz> ..." );
+        return 1;
+    }
+
+    if ( !dest.empty() ) {
+        SGPath d( dest );
+        d.append( "dummy" );
+        d.create_dir( 0755 );
+    }
+
+    for ( unsigned int i=0; i<files.size(); i++ ) {
+        if ( !convert( files[i], dest ) ) {
+            errors++;
+        }
+    }
+
+    return errors ? 1 : 0;
+}